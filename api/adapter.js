@@ -37,6 +37,7 @@
 'use strict';
 
 const EventEmitter = require('events');
+const fs = require('fs');
 const _ = require('underscore');
 
 const AdapterState = require('./adapterState');
@@ -50,9 +51,14 @@ const ToText = require('./util/toText');
 const logLevel = require('./util/logLevel');
 const Security = require('./security');
 const HexConv = require('./util/hexConv');
+const GattCache = require('./util/gattCache');
+const ProbeCache = require('./util/probeCache');
 
 const MAX_SUPPORTED_ATT_MTU = 247;
 
+const SERVICE_CHANGED_UUID = '2A05';
+const DATABASE_HASH_UUID = '2B2A';
+
 /** Class to mediate error conditions. */
 class Error {
     /**
@@ -72,6 +78,15 @@ const _makeError = function (userMessage, description) {
     return new Error(userMessage, description);
 };
 
+// Values from the driver are Arrays or Buffers, depending on the valueFormat open option
+const _concatValues = function (first, second) {
+    if (first instanceof Uint8Array || second instanceof Uint8Array) {
+        return Buffer.concat([Buffer.from(first), Buffer.from(second)]);
+    }
+
+    return first.concat(second);
+};
+
 /**
  * Class representing a transport adapter (SoftDevice RPC module).
  *
@@ -143,6 +158,13 @@ class Adapter extends EventEmitter {
 
         this._keys = null;
         this._attMtuMap = {};
+        this._gattCacheDirectory = null;
+        this._peerIdentities = {};
+        this._useProbeCache = false;
+        this._enableBLEParams = null;
+        this._autoReplyPolicy = null;
+        this._connectionStatsTimer = null;
+        this._logLevel = logLevel.INFO;
 
         this._init();
     }
@@ -161,6 +183,10 @@ class Adapter extends EventEmitter {
         this._preparedWritesMap = {};
 
         this._pendingNotificationsAndIndications = {};
+
+        this._notificationSubscriptions = {};
+
+        this._pendingGattCaches = {};
     }
 
     _getServiceType(service) {
@@ -213,22 +239,45 @@ class Adapter extends EventEmitter {
         return this._notSupportedMessage;
     }
 
-    _maxReadPayloadSize(deviceInstanceId) {
-        return this.getCurrentAttMtu(deviceInstanceId) - 1;
-    }
-
     _maxShortWritePayloadSize(deviceInstanceId) {
         return this.getCurrentAttMtu(deviceInstanceId) - 3;
     }
 
-    _maxLongWritePayloadSize(deviceInstanceId) {
-        return this.getCurrentAttMtu(deviceInstanceId) - 5;
+    _setKeyPair(keys) {
+        this._keys = keys;
+
+        // The native DHKey reply must use the key pair the public key is distributed from
+        if (this._autoReplyPolicy && this._autoReplyPolicy.lescDhkey) {
+            this._applyAutoReplyPolicy();
+        }
     }
 
     _generateKeyPair() {
         if (this._keys === null) {
-            this._keys = this._security.generateKeyPair();
+            this._setKeyPair(this._security.takeKeyPair());
+        }
+    }
+
+    // Takes the key pair from the pool in a worker thread, so an empty pool never generates on the main thread
+    _generateKeyPairAsync(callback) {
+        if (this._keys !== null) {
+            callback();
+            return;
         }
+
+        this._security.generateKeyPairAsync((err, keys) => {
+            if (err) {
+                callback(err);
+                return;
+            }
+
+            // Another call may have set the key pair while this one was taken
+            if (this._keys === null) {
+                this._setKeyPair(keys);
+            }
+
+            callback();
+        });
     }
 
     /**
@@ -259,6 +308,57 @@ class Adapter extends EventEmitter {
         return this._security.generatePublicKey(this._keys.sk).pk;
     }
 
+    /**
+     * Compute shared secret in a worker thread.
+     *
+     * @param {Object} [peerPublicKey] Peer public key.
+     * @param {function(Error, string)} callback Callback signature: (err, sharedSecret) => {}.
+     * @returns {void}
+     */
+    computeSharedSecretAsync(peerPublicKey, callback) {
+        this._generateKeyPairAsync(keyPairErr => {
+            if (this._checkAndPropagateError(keyPairErr, 'Failed to generate key-pair.', callback)) { return; }
+
+            let publicKey = peerPublicKey;
+
+            if (publicKey === null || publicKey === undefined) {
+                publicKey = this._keys;
+            }
+
+            this._security.generateSharedSecretAsync(this._keys.sk, publicKey.pk, (err, result) => {
+                if (this._checkAndPropagateError(err, 'Failed to compute shared secret.', callback)) { return; }
+                if (callback) { callback(undefined, result.ss); }
+            });
+        });
+    }
+
+    /**
+     * Compute public key in a worker thread.
+     *
+     * @param {function(Error, string)} callback Callback signature: (err, publicKey) => {}.
+     * @returns {void}
+     */
+    computePublicKeyAsync(callback) {
+        this._generateKeyPairAsync(keyPairErr => {
+            if (this._checkAndPropagateError(keyPairErr, 'Failed to generate key-pair.', callback)) { return; }
+
+            this._security.generatePublicKeyAsync(this._keys.sk, (err, result) => {
+                if (this._checkAndPropagateError(err, 'Failed to compute public key.', callback)) { return; }
+                if (callback) { callback(undefined, result.pk); }
+            });
+        });
+    }
+
+    /**
+     * Set how many key-pairs are generated ahead of time in the background, shared by all adapters in the process.
+     *
+     * @param {number} size The number of key-pairs to keep available, 0 stops generating them. Defaults to 1.
+     * @returns {void}
+     */
+    setKeyPairPoolSize(size) {
+        this._security.setKeyPairPoolSize(size);
+    }
+
     /**
      * Deletes any previously generated key-pair.
      *
@@ -403,10 +503,64 @@ class Adapter extends EventEmitter {
      * <li>{string} [flowControl='none']: Whether flow control should be configured with this adapter's serial port.
      * <li>{number} [eventInterval=0]: Interval to use for sending BLE driver events to JavaScript.
      *                                 If `0`, events will be sent as soon as they are received from the BLE driver.
+     * <li>{number} [eventBatchLatency=0]: Enables adaptive batching, used instead of <code>eventInterval</code>.
+     *                                   Events are sent to JavaScript when <code>eventBatchSize</code> events are
+     *                                   waiting, or when the oldest waiting event has waited this many ms,
+     *                                   whichever comes first. If `0`, adaptive batching is not used.
+     * <li>{number} [eventBatchSize=0]: Number of events sent to JavaScript at once with adaptive batching.
+     *                                   If `0` or larger than <code>eventQueueSize</code>, a batch is sent when
+     *                                   the event queue is full. Requires <code>eventBatchLatency</code>.
+     * <li>{number} [eventBatchConnectionLimit=0]: Most events of one connection sent to JavaScript at once. The events
+     *                                   of the connections are interleaved, and the events over the limit are sent
+     *                                   right after, so a busy connection does not hold back the others.
+     *                                   If `0`, the events are sent in the order they are received.
+     * <li>{number} [eventQueueSize=64]: Number of BLE driver events that can wait for JavaScript before
+     *                                   <code>eventQueueOverflowPolicy</code> is applied, at most 16384. The queue
+     *                                   does not grow, its slots are allocated up front when the adapter is opened.
+     *                                   Compare <code>eventQueueHighWaterMark</code> from <code>getStats</code>
+     *                                   with this size to tune it.
+     * <li>{string} [eventQueueOverflowPolicy='dropNewest']: What to do with events when the event queue is full.
+     *                                   'block' halts the BLE driver until there is room, 'dropOldest' discards
+     *                                   the oldest queued event, 'dropNewest' discards the incoming event and
+     *                                   'coalesceAdvReports' replaces the queued advertising report of the same
+     *                                   peer with an incoming one, or else the oldest queued report of another
+     *                                   peer, and blocks for other events. An incoming report is only discarded
+     *                                   if there is no queued report to replace.
+     * <li>{string} [eventTimeFormat='string']: Format of the <code>time</code> property of BLE driver events
+     *                                   and status events. 'string' gives an ISO 8601 string, as in earlier
+     *                                   versions, 'number' gives milliseconds since epoch, which is cheaper to
+     *                                   create and can be passed to the <code>Date</code> constructor.
+     *                                   Regardless of format, events also have a <code>timestamp</code>
+     *                                   property with the monotonic time in microseconds the event was
+     *                                   received, intended for measuring time between events.
+     * <li>{string} [valueFormat='array']: Format of characteristic and descriptor values in BLE driver events,
+     *                                   such as notifications, read responses and writes. 'array' gives an
+     *                                   Array of numbers, 'buffer' gives a Buffer, which is considerably cheaper
+     *                                   to create for large values. Values passed to the driver may always be
+     *                                   given as Array, Buffer or Uint8Array.
      * <li>{string} [logLevel='info']: The verbosity of logging the developer wants with this adapter.
+     *                                   One of 'trace', 'debug', 'info', 'warning', 'error' or 'fatal'.
+     *                                   Events are only logged at 'trace' and 'debug'.
+     * <li>{number} [logBurstLimit=0]: Max number of driver log messages emitted in every
+     *                                   <code>logBurstInterval</code>, 0 is no limit. The number of
+     *                                   suppressed messages is logged with the next emitted message.
+     * <li>{number} [logBurstInterval=1000]: Interval of the log rate limit in milliseconds.
+     * <li>{string} [logFile]: File the driver log messages are also written to, in a compact binary
+     *                                   format, see <code>api/util/logFile.js</code>. The rate limit does not
+     *                                   apply to the file. The file is written from the JavaScript thread,
+     *                                   messages are truncated to 256 bytes and are counted in
+     *                                   <code>logDroppedCount</code> if the log queue is full.
+     * <li>{string} [eventCaptureFile]: File the raw events received from the SoftDevice are captured to, see
+     *                                   <code>api/util/eventCapture.js</code>. A capture can be replayed with the
+     *                                   <code>replayEvents</code> method of the native adapter.
+     * <li>{number} [eventCaptureSegmentSize=16777216]: Bytes the capture file grows by, a multiple of 1 MiB.
      * <li>{number} [retransmissionInterval=250]: The time interval to wait between retransmitted packets.
      * <li>{number} [responseTimeout=1500]: Response timeout of the data link layer.
      * <li>{boolean} [enableBLE=true]: Whether the BLE stack should be initialized and enabled.
+     * <li>{boolean} [useProbeCache=false]: Use the firmware version, name and address read from this device when
+     *                                   it was last opened with the same <code>enableBLEParams</code>, instead of
+     *                                   reading them after enabling BLE. See <code>api/util/probeCache.js</code>.
+     *                                   Requires a serial number.
      * </ul>
      * @param {function(Error)} [callback] Callback signature: err => {}.
      * @returns {void}
@@ -436,6 +590,13 @@ class Adapter extends EventEmitter {
                 parity: 'none',
                 flowControl: 'none',
                 eventInterval: 0,
+                eventBatchLatency: 0,
+                eventBatchSize: 0,
+                eventBatchConnectionLimit: 0,
+                eventQueueSize: 64,
+                eventQueueOverflowPolicy: 'dropNewest',
+                eventTimeFormat: 'string',
+                valueFormat: 'array',
                 logLevel: 'info',
                 retransmissionInterval: 250,
                 responseTimeout: 1500,
@@ -446,12 +607,21 @@ class Adapter extends EventEmitter {
             if (!options.parity) options.parity = 'none';
             if (!options.flowControl) options.flowControl = 'none';
             if (!options.eventInterval) options.eventInterval = 0;
+            if (!options.eventBatchLatency) options.eventBatchLatency = 0;
+            if (!options.eventBatchSize) options.eventBatchSize = 0;
+            if (!options.eventBatchConnectionLimit) options.eventBatchConnectionLimit = 0;
+            if (!options.eventQueueSize) options.eventQueueSize = 64;
+            if (!options.eventQueueOverflowPolicy) options.eventQueueOverflowPolicy = 'dropNewest';
+            if (!options.eventTimeFormat) options.eventTimeFormat = 'string';
+            if (!options.valueFormat) options.valueFormat = 'array';
             if (!options.logLevel) options.logLevel = 'info';
             if (!options.retransmissionInterval) options.retransmissionInterval = 250;
             if (!options.responseTimeout) options.responseTimeout = 1500;
             if (options.enableBLE === undefined) options.enableBLE = true;
         }
 
+        this._useProbeCache = options.useProbeCache === true;
+
         this._changeState({
             opening: true,
             baudRate: options.baudRate,
@@ -459,10 +629,13 @@ class Adapter extends EventEmitter {
             flowControl: options.flowControl,
         });
 
-        options.logCallback = this._logCallback.bind(this);
+        this._logLevel = logLevel.fromString(options.logLevel);
+        options.logBatch = true;
+        options.logCallback = this._logBatchCallback.bind(this);
         options.eventCallback = this._eventCallback.bind(this);
         options.statusCallback = this._statusCallback.bind(this);
         options.enableBLEParams = options.enableBLEParams || this._getDefaultEnableBLEParams();
+        this._enableBLEParams = options.enableBLE ? options.enableBLEParams : null;
 
         this._adapter.open(this._state.port, options, err => {
             this._changeState({ opening: false });
@@ -480,7 +653,7 @@ class Adapter extends EventEmitter {
 
             if (options.enableBLE) {
                 this._changeState({ bleEnabled: true });
-                this.getState(getStateError => {
+                this._probeState(getStateError => {
                     this._checkAndPropagateError(getStateError, 'Error retrieving adapter state.', callback);
                 });
             }
@@ -514,6 +687,8 @@ class Adapter extends EventEmitter {
                 bleEnabled: false,
             });
 
+            this.setConnectionStatsInterval(0);
+
             this._adapter.close(error => {
                 /**
                  * Adapter closed event.
@@ -533,17 +708,51 @@ class Adapter extends EventEmitter {
      *
      * This function will issue a reset command to the connectivity device.
      *
+     * The reset disables BLE. A warm reset enables BLE again with the <code>enableBLEParams</code> this adapter
+     * was opened with, so the adapter is usable when the callback is called, without closing and opening it.
+     * The connections, GATT server attributes and notification subscriptions are gone after either reset.
+     * GATT client procedures and write streams active on the connections fail with
+     * <code>BLE_ERROR_INVALID_CONN_HANDLE</code>.
+     *
+     * @param {Object} [options] Reset options:
+     * <ul>
+     * <li>{boolean} [warm=false]: Enable BLE again after the reset. Requires the adapter to be opened with
+     *                             <code>enableBLE</code>.
+     * </ul>
      * @param {function(Error)} [callback] Callback signature: err => {}.
      * @returns {void}
      */
-    connReset(callback) {
+    connReset(options, callback) {
+        if (typeof options === 'function') {
+            callback = options;
+            options = undefined;
+        }
+
         if (!this.state.available) {
             if (callback) callback(_makeError('The adapter is not available.'));
             return;
         }
 
-        this._adapter.connReset(error => {
-            if (callback) callback(error);
+        if (!options || !options.warm) {
+            this._adapter.connReset(error => {
+                if (callback) callback(error);
+            });
+            return;
+        }
+
+        if (!this._enableBLEParams) {
+            if (callback) callback(_makeError('A warm reset requires the adapter to be opened with enableBLE.'));
+            return;
+        }
+
+        // The status of the reset is delivered before the callback, this adapter's state is cleared by now
+        this._adapter.connReset({ enableBLEParams: this._enableBLEParams }, error => {
+            if (this._checkAndPropagateError(error, 'Failed to warm reset the connectivity device.', callback)) return;
+
+            this._changeState({ available: true, bleEnabled: true });
+            this._probeState(err => {
+                if (callback) callback(err);
+            });
         });
     }
 
@@ -554,7 +763,29 @@ class Adapter extends EventEmitter {
      * <li>{number} eventCallbackTotalCount
      * <li>{number} eventCallbackBatchMaxCount
      * <li>{number} eventCallbackBatchAvgCount
+     * <li>{number} eventQueueSize
+     * <li>{number} eventQueueDroppedNewestCount
+     * <li>{number} eventQueueDroppedOldestCount
+     * <li>{number} eventQueueCoalescedCount
+     * <li>{number} eventQueueBlockedCount
+     * <li>{number} eventBatchFullCount
+     * <li>{number} eventBatchLatencyCount
+     * <li>{number} eventUnsubscribedCount Events dropped because they are not in the event subscription.
+     * <li>{number} eventRoutedCount Notifications and indications sent to a listener of <code>subscribeNotifications</code>.
+     * <li>{number} advReportFilteredCount
+     * <li>{number} advReportDedupHitCount
+     * <li>{number} advReportDedupMissCount
+     * <li>{number} eventQueueHighWaterMark Most events waiting in the event queue at once.
+     * <li>{number} logQueueHighWaterMark Most log entries waiting in the log queue at once.
+     * <li>{number} statusQueueHighWaterMark Most status entries waiting in the status queue at once.
+     * <li>{number} eventCaptureCount Events written to the current event capture file.
+     * <li>{number} eventCaptureDroppedCount Events not captured because the capture file could not grow.
+     * <li>{Object} eventLatency Time from an event is received from the BLE driver until it is converted.
+     * <li>{Object} eventConversionTime Time converting an event to JavaScript, keyed by event id.
+     * <li>{Object} eventCallbackTime Time spent in the JavaScript event callback for each batch of events.
      * </ul>
+     * The durations are in microseconds, as objects with the properties <code>count</code>, <code>p50</code>,
+     * <code>p99</code> and <code>max</code>. The percentiles are accurate to within 12.5%.
      *
      * @returns {Object} This adapters stats.
      */
@@ -562,6 +793,160 @@ class Adapter extends EventEmitter {
         return this._adapter.getStats();
     }
 
+    /**
+     * Clear all stats returned by <code>getStats</code>.
+     *
+     * @returns {void}
+     */
+    resetStats() {
+        this._adapter.resetStats();
+    }
+
+    /**
+     * Change the log level given to <code>open</code>, see its <code>logLevel</code> option.
+     *
+     * @param {string} level One of 'trace', 'debug', 'info', 'warning', 'error' or 'fatal'.
+     * @returns {void}
+     */
+    setLogLevel(level) {
+        this._adapter.setLogLevel(level);
+        this._logLevel = logLevel.fromString(level);
+    }
+
+    /**
+     * Start capturing the raw events received from the SoftDevice to a file, or stop it, see the
+     * <code>eventCaptureFile</code> option of <code>open</code>. A capture in progress is closed first.
+     *
+     * @param {string|null} path The capture file, which is truncated, or null to stop capturing.
+     * @param {Object} [options] Capture options.
+     * @param {number} [options.segmentSize=16777216] Bytes the capture file grows by, a multiple of 1 MiB.
+     * @returns {void}
+     */
+    setEventCapture(path, options) {
+        this._adapter.setEventCapture(path, options ? options.segmentSize : undefined);
+    }
+
+    /**
+     * Only pass on the events with the given ids from the BLE driver, such as
+     * <code>adapter.driver.BLE_GAP_EVT_RSSI_CHANGED</code>. Other events are dropped before they are
+     * converted to JavaScript. The adapter keeps track of connections, security and attributes through
+     * the events, so only leave out events the application does not use, such as scan reports,
+     * RSSI changes or TX complete events.
+     *
+     * @param {number[]|null} eventIds The event ids to pass on, or null to pass all events on.
+     * @returns {void}
+     */
+    setEventSubscription(eventIds) {
+        this._adapter.setEventSubscription(eventIds);
+    }
+
+    /**
+     * Receive the notifications and indications of a characteristic, or of all characteristics of a device,
+     * through <code>listener</code> instead of the <code>characteristicValueChanged</code> event. The BLE driver
+     * routes them to the listener by connection and attribute handle, apart from the other events. The listener
+     * is called with all values of a characteristic received at once, the value of the characteristic is set to
+     * the last of them. Indications are confirmed as usual. A characteristic subscription takes precedence over
+     * a device subscription, and the subscriptions of a device end when it disconnects.
+     *
+     * @param {string} id Unique ID of the GATT characteristic, or instance ID of the connected device.
+     * @param {function(Characteristic, Array[])} listener Called with the characteristic and the values received.
+     * @returns {void}
+     */
+    subscribeNotifications(id, listener) {
+        const characteristic = this._characteristics[id];
+        const device = characteristic ? this._getDeviceByCharacteristicId(id) : this._devices[id];
+
+        if (!device || !device.connected) {
+            throw new Error('Subscribe notifications failed: Could not get characteristic or connected device with id ' + id);
+        }
+
+        const subscription = {
+            deviceInstanceId: device.instanceId,
+            connHandle: device.connectionHandle,
+            handle: characteristic ? characteristic.valueHandle : null,
+        };
+
+        this._adapter.setHvxRoute(subscription.connHandle, subscription.handle, events => this._routeHvxEvents(events, listener));
+        this._notificationSubscriptions[id] = subscription;
+    }
+
+    /**
+     * Stop a subscription made with <code>subscribeNotifications</code>, the notifications and indications
+     * are emitted as <code>characteristicValueChanged</code> events again.
+     *
+     * @param {string} id The ID given to <code>subscribeNotifications</code>.
+     * @returns {void}
+     */
+    unsubscribeNotifications(id) {
+        const subscription = this._notificationSubscriptions[id];
+
+        if (!subscription) {
+            return;
+        }
+
+        this._adapter.setHvxRoute(subscription.connHandle, subscription.handle, null);
+        delete this._notificationSubscriptions[id];
+    }
+
+    /**
+     * Get the traffic of each connected device, since it connected or since <code>resetStats</code> was called.
+     * The stats are keyed by device instance id, with these members:
+     * <ul>
+     * <li>{number} connHandle
+     * <li>{number} rxPackets Notifications, indications, read responses and writes received.
+     * <li>{number} rxBytes
+     * <li>{number} txPackets Writes, notifications and indications accepted by the SoftDevice.
+     * <li>{number} txBytes
+     * <li>{number} txPendingPackets Write commands and notifications accepted by the SoftDevice, not yet transmitted.
+     * <li>{number} gattcTimeoutCount
+     * <li>{number} gattsTimeoutCount
+     * <li>{number} droppedEventCount Events of the connection dropped by the event queue overflow policy.
+     * <li>{Object} gattcLatency Time from a GATT client request is made until its response is received.
+     * </ul>
+     * <code>gattcLatency</code> has the same form as the durations returned by <code>getStats</code>.
+     *
+     * @returns {Object} The stats of the connected devices.
+     */
+    getConnectionStats() {
+        const stats = {};
+
+        for (let connection of this._adapter.getConnectionStats()) {
+            const device = this._getDeviceByConnectionHandle(connection.connHandle);
+
+            if (device) {
+                stats[device.instanceId] = connection;
+            }
+        }
+
+        return stats;
+    }
+
+    /**
+     * Emit the stats returned by <code>getConnectionStats</code> periodically, as <code>connectionStats</code> events.
+     *
+     * @param {number} interval Time between the events in milliseconds, 0 stops the events.
+     * @returns {void}
+     */
+    setConnectionStatsInterval(interval) {
+        if (this._connectionStatsTimer) {
+            clearInterval(this._connectionStatsTimer);
+            this._connectionStatsTimer = null;
+        }
+
+        if (interval > 0) {
+            this._connectionStatsTimer = setInterval(() => {
+                /**
+                 * Periodic traffic stats of the connected devices, see <code>setConnectionStatsInterval</code>.
+                 *
+                 * @event Adapter#connectionStats
+                 * @type {Object}
+                 * @property {Object} stats - The stats returned by <code>getConnectionStats</code>.
+                 */
+                this.emit('connectionStats', this.getConnectionStats());
+            }, interval);
+        }
+    }
+
     /**
      * @summary Enable the BLE stack.
      *
@@ -717,11 +1102,24 @@ class Adapter extends EventEmitter {
         this.emit('logMessage', severity, message);
     }
 
+    _logBatchCallback(entries) {
+        entries.forEach(entry => this._logCallback(entry[0], entry[1]));
+    }
+
     _eventCallback(eventArray) {
         eventArray.forEach(event => {
-            const text = new ToText(event);
-            // TODO: set the correct level for different types of events:
-            this.emit('logMessage', logLevel.DEBUG, text.toString());
+            // Batched scan reports are not SoftDevice events, and are not logged one by one
+            if (event.id === this._bleDriver.BLE_GAP_EVT_ADV_REPORT_BATCH) {
+                this._parseGapAdvertisementReportBatchEvent(event);
+                return;
+            }
+
+            // Formatting every event is costly, skip it unless the message is wanted
+            if (this._logLevel <= logLevel.DEBUG && this.listenerCount('logMessage') > 0) {
+                const text = new ToText(event);
+                // TODO: set the correct level for different types of events:
+                this.emit('logMessage', logLevel.DEBUG, text.toString());
+            }
 
             switch (event.id) {
                 case this._bleDriver.BLE_GAP_EVT_CONNECTED:
@@ -881,6 +1279,11 @@ class Adapter extends EventEmitter {
         device.connected = true;
         this._devices[device.instanceId] = device;
 
+        // The SoftDevice resolved the address of a bonded peer from its identity
+        if (deviceAddress.addr_id_peer) {
+            this._peerIdentities[device.address] = device.address;
+        }
+
         this._attMtuMap[device.instanceId] = this.driver.GATT_MTU_SIZE_DEFAULT || this.driver.BLE_GATT_ATT_MTU_DEFAULT;
 
         this._changeState({ connecting: false });
@@ -899,6 +1302,7 @@ class Adapter extends EventEmitter {
         this.emit('deviceConnected', device);
 
         this._addDeviceToAllPerConnectionValues(device.instanceId);
+        this._restoreGattCache(device);
 
         if (deviceRole === 'peripheral') {
             const callback = this._gapOperationsMap.connecting.callback;
@@ -921,6 +1325,14 @@ class Adapter extends EventEmitter {
         device.connected = false;
 
         if (device.instanceId in this._attMtuMap) delete this._attMtuMap[device.instanceId];
+        delete this._pendingGattCaches[device.instanceId];
+
+        // The BLE driver removes the routes of the connection itself
+        Object.keys(this._notificationSubscriptions).forEach(id => {
+            if (this._notificationSubscriptions[id].deviceInstanceId === device.instanceId) {
+                delete this._notificationSubscriptions[id];
+            }
+        });
 
         // TODO: Delete all operations for this device.
 
@@ -1005,8 +1417,9 @@ class Adapter extends EventEmitter {
          * @type {Object}
          * @property {Device} device - The <code>Device</code> instance representing the BLE peer we're connected to.
          * @property {Object} event.peer_params - Initiator Security Parameters.
+         * @property {boolean} autoReplied - The request was replied to by the auto reply policy.
          */
-        this.emit('secParamsRequest', device, event.peer_params);
+        this.emit('secParamsRequest', device, event.peer_params, event.auto_replied === true);
     }
 
     _parseConnSecUpdateEvent(event) {
@@ -1042,6 +1455,10 @@ class Adapter extends EventEmitter {
         const device = this._getDeviceByConnectionHandle(event.conn_handle);
         device.ownPeriphInitiatedPairingPending = false;
 
+        if (event.auth_status === this._bleDriver.BLE_GAP_SEC_STATUS_SUCCESS && event.bonded) {
+            this._onBonded(device, event);
+        }
+
         /**
          * Authentication procedure completed with status.
          *
@@ -1123,8 +1540,9 @@ class Adapter extends EventEmitter {
          * @property {Object} event.pk_peer - LE Secure Connections remote P-256 Public Key.
          * @property {Object} event.oobd_req - LESC OOB data required. A call to <code>replyLescDhkey</code> is
          *                                     required to complete the procedure.
+         * @property {boolean} autoReplied - The DHKey was replied with natively, see <code>setAutoReplyPolicy</code>.
          */
-        this.emit('lescDhkeyRequest', device, event.pk_peer, event.oobd_req);
+        this.emit('lescDhkeyRequest', device, event.pk_peer, event.oobd_req, event.auto_replied === true);
     }
 
     _parseSecInfoRequest(event) {
@@ -1137,8 +1555,9 @@ class Adapter extends EventEmitter {
          * @type {Object}
          * @property {Device} device - The <code>Device</code> instance representing the BLE peer we're connected to.
          * @property {Object} event - Security Information Request Event Parameters
+         * @property {boolean} autoReplied - The request was replied to from the bond store.
          */
-        this.emit('secInfoRequest', device, event);
+        this.emit('secInfoRequest', device, event, event.auto_replied === true);
     }
 
     _parseGapSecurityRequestEvent(event) {
@@ -1172,8 +1591,9 @@ class Adapter extends EventEmitter {
          * @type {Object}
          * @property {Device} device - The <code>Device</code> instance representing the BLE peer we're connected to.
          * @property {Object} connectionParameters - GAP Connection Parameters.
+         * @property {boolean} autoReplied - The request was replied to by the auto reply policy.
          */
-        this.emit('connParamUpdateRequest', device, connectionParameters);
+        this.emit('connParamUpdateRequest', device, connectionParameters, event.auto_replied === true);
     }
 
     _parseGapDataLengthUpdateRequestEvent(event) {
@@ -1186,11 +1606,12 @@ class Adapter extends EventEmitter {
          * @type {Object}
          * @property {Device} device - The <code>Device</code> instance representing the BLE peer we're connected to.
          * @property {Object} event - DataLength Update Request Event Parameters.
+         * @property {boolean} autoReplied - The request was replied to by the auto reply policy.
          */
         this.emit('dataLengthUpdateRequest', device, {
             max_rx_octets: event.peer_params.max_tx_octets,
             max_tx_octets: event.peer_params.max_rx_octets,
-        });
+        }, event.auto_replied === true);
     }
 
     _parseGapDataLengthUpdateEvent(event) {
@@ -1225,11 +1646,12 @@ class Adapter extends EventEmitter {
          * @type {Object}
          * @property {Device} device - The <code>Device</code> instance representing the BLE peer we're connected to.
          * @property {Object} event - PHY Update Request Event Parameters.
+         * @property {boolean} autoReplied - The request was replied to by the auto reply policy.
          */
         this.emit('phyUpdateRequest', device, {
             tx_phys: event.peer_preferred_phys.rx_phys,
             rx_phys: event.peer_preferred_phys.tx_phys,
-        });
+        }, event.auto_replied === true);
     }
 
     _parseGapPhyUpdateEvent(event) {
@@ -1266,6 +1688,29 @@ class Adapter extends EventEmitter {
         this.emit('deviceDiscovered', discoveredDevice);
     }
 
+    _parseGapAdvertisementReportBatchEvent(event) {
+        /**
+         * Scan reports received since the previous batch, when scan report batching is enabled with
+         * <code>setScanFilter</code>. All arrays are views of the same ArrayBuffer.
+         * Report <code>i</code> has the advertising data
+         * <code>data.subarray(dataOffsets[i], dataOffsets[i + 1])</code> and the address
+         * <code>addresses.subarray(i * 6, i * 6 + 6)</code>, least significant byte first.
+         *
+         * @event Adapter#advertisementReports
+         * @type {Object}
+         * @property {number} count - Number of reports in the batch.
+         * @property {Float64Array} timestamps - Monotonic receive time of each report in microseconds.
+         * @property {Uint32Array} dataOffsets - Start of the advertising data of each report, <code>count + 1</code> entries.
+         * @property {Uint8Array} addresses - Peer addresses, 6 bytes per report.
+         * @property {Uint8Array} addressTypes - Peer address types (BLE_GAP_ADDR_TYPE_*).
+         * @property {Int8Array} rssi - Received signal strength in dBm.
+         * @property {Uint8Array} types - Advertising types (BLE_GAP_ADV_TYPE_*).
+         * @property {Uint8Array} scanRsp - 1 if the report is a scan response.
+         * @property {Uint8Array} data - Advertising data of all reports.
+         */
+        this.emit('advertisementReports', event);
+    }
+
     _parseGapTimeoutEvent(event) {
         switch (event.src) {
             case this._bleDriver.BLE_GAP_TIMEOUT_SRC_ADVERTISING:
@@ -1708,46 +2153,11 @@ class Adapter extends EventEmitter {
                 });
                 break;
             }
-        } else {
-            if (event.gatt_status !== this._bleDriver.BLE_GATT_STATUS_SUCCESS) {
-                delete this._gattOperationsMap[device.instanceId];
-                gattOperation.callback(_makeError(`Read operation failed: ${event.gatt_status_name} (0x${HexConv.numberToHexString(event.gatt_status)})`));
-                return;
-            }
-
-            gattOperation.readBytes = gattOperation.readBytes ? gattOperation.readBytes.concat(event.data) : event.data;
-
-            if (event.data.length < this._maxReadPayloadSize(device.instanceId)) {
-                delete this._gattOperationsMap[device.instanceId];
-                gattOperation.callback(undefined, gattOperation.readBytes);
-            } else if (event.data.length === this._maxReadPayloadSize(device.instanceId)) {
-                // We need to read more:
-                this._adapter.gattcRead(event.conn_handle, event.handle, gattOperation.readBytes.length, err => {
-                    if (err) {
-                        delete this._gattOperationsMap[device.instanceId];
-                        this.emit('error', _makeError('Read value failed', err));
-                        gattOperation.callback('Failed reading at byte #' + gattOperation.readBytes.length);
-                    }
-                });
-            } else {
-                delete this._gattOperationsMap[device.instanceId];
-                this.emit('error', 'Length of Read response is > mtu');
-                gattOperation.callback('Invalid read response length. (> mtu)');
-            }
         }
     }
 
     _parseGattcWriteResponseEvent(event) {
-        // 1. Check if there is a long write in progress for this device
-        // 2a. If there is check if it is done after next write
-        // 2ai. If it is done after next write
-        //      Perform the last write and if success, exec write on fail, cancel write
-        //      callback, delete callback, delete pending write, emit
-        // 2aii. if not done, issue one more PREPARED_WRITE, update pendingwrite
-
-        // TODO: Do more checking of write response?
         const device = this._getDeviceByConnectionHandle(event.conn_handle);
-        const handle = event.handle;
         const gattOperation = this._gattOperationsMap[device.instanceId];
 
         if (!device) {
@@ -1759,52 +2169,7 @@ class Adapter extends EventEmitter {
 
         if (event.write_op === this._bleDriver.BLE_GATT_OP_WRITE_CMD) {
             gattOperation.attribute.value = gattOperation.value;
-        } else if (event.write_op === this._bleDriver.BLE_GATT_OP_PREP_WRITE_REQ) {
-
-            const writeParameters = {
-                write_op: 0,
-                flags: 0,
-                handle: handle,
-                offset: 0,
-                len: 0,
-                value: [],
-            };
-
-            if (gattOperation.bytesWritten < gattOperation.value.length) {
-                const value = gattOperation.value.slice(gattOperation.bytesWritten, gattOperation.bytesWritten + this._maxLongWritePayloadSize(device.instanceId));
-
-                writeParameters.write_op = this._bleDriver.BLE_GATT_OP_PREP_WRITE_REQ;
-                writeParameters.handle = handle;
-                writeParameters.offset = gattOperation.bytesWritten;
-                writeParameters.len = value.length;
-                writeParameters.value = value;
-                gattOperation.bytesWritten += value.length;
-
-                this._adapter.gattcWrite(device.connectionHandle, writeParameters, err => {
-
-                    if (err) {
-                        this._longWriteCancel(device, gattOperation.attribute);
-                        this.emit('error', _makeError('Failed to write value to device/handle ' + device.instanceId + '/' + handle, err));
-                        return;
-                    }
-                });
-            } else {
-                writeParameters.write_op = this._bleDriver.BLE_GATT_OP_EXEC_WRITE_REQ;
-                writeParameters.flags = this._bleDriver.BLE_GATT_EXEC_WRITE_FLAG_PREPARED_WRITE;
-
-                this._adapter.gattcWrite(device.connectionHandle, writeParameters, err => {
-
-                    if (err) {
-                        this._longWriteCancel(device, gattOperation.attribute);
-                        this.emit('error', _makeError('Failed to write value to device/handle ' + device.instanceId + '/' + handle, err));
-                        return;
-                    }
-                });
-            }
-
-            return;
-        } else if (event.write_op === this._bleDriver.BLE_GATT_OP_WRITE_REQ ||
-                   event.write_op === this._bleDriver.BLE_GATT_OP_EXEC_WRITE_REQ) {
+        } else if (event.write_op === this._bleDriver.BLE_GATT_OP_WRITE_REQ) {
             gattOperation.attribute.value = gattOperation.value;
             delete this._gattOperationsMap[device.instanceId];
             if (event.gatt_status !== this._bleDriver.BLE_GATT_STATUS_SUCCESS) {
@@ -1908,6 +2273,20 @@ class Adapter extends EventEmitter {
     }
 
     _parseGattcHvxEvent(event) {
+        const characteristic = this._takeHvxEvent(event);
+        if (!characteristic) {
+            return;
+        }
+
+        this.emit('characteristicValueChanged', characteristic);
+
+        if (characteristic.uuid === SERVICE_CHANGED_UUID) {
+            this._invalidateGattCache(this._getDeviceByConnectionHandle(event.conn_handle));
+        }
+    }
+
+    // Confirms an indication and updates the value of its characteristic, returns the characteristic if found
+    _takeHvxEvent(event) {
         if (event.type === this._bleDriver.BLE_GATT_HVX_INDICATION) {
             this._adapter.gattcConfirmHandleValue(event.conn_handle, event.handle, error => {
                 if (error) {
@@ -1920,11 +2299,46 @@ class Adapter extends EventEmitter {
         const characteristic = this._getCharacteristicByValueHandle(device.instanceId, event.handle);
         if (!characteristic) {
             this.emit('logMessage', logLevel.DEBUG, `Cannot handle HVX event. No characteristic value with handle ${event.handle} found.`);
-            return;
+            return undefined;
         }
 
         characteristic.value = event.data;
-        this.emit('characteristicValueChanged', characteristic);
+        return characteristic;
+    }
+
+    // HVX events routed by the BLE driver to a listener of subscribeNotifications. The values of
+    // consecutive events of the same characteristic are given to the listener at once.
+    _routeHvxEvents(events, listener) {
+        let characteristic = null;
+        let values = [];
+
+        const flush = () => {
+            if (values.length > 0) {
+                listener(characteristic, values);
+                values = [];
+            }
+        };
+
+        events.forEach(event => {
+            const target = this._takeHvxEvent(event);
+            if (!target) {
+                return;
+            }
+
+            if (target !== characteristic) {
+                flush();
+                characteristic = target;
+            }
+
+            values.push(event.data);
+
+            if (characteristic.uuid === SERVICE_CHANGED_UUID) {
+                flush();
+                this._invalidateGattCache(this._getDeviceByConnectionHandle(event.conn_handle));
+            }
+        });
+
+        flush();
     }
 
     _parseGattcExchangeMtuResponseEvent(event) {
@@ -2137,6 +2551,11 @@ class Adapter extends EventEmitter {
 
     _parseGattsExchangeMtuRequestEvent(event) {
         const device = this._getDeviceByConnectionHandle(event.conn_handle);
+        const autoReplied = event.auto_replied === true;
+
+        if (autoReplied) {
+            this._attMtuMap[device.instanceId] = Math.min(event.client_rx_mtu, this._autoReplyPolicy.attMtu);
+        }
 
         /**
          * ATT MTU Request.
@@ -2145,8 +2564,9 @@ class Adapter extends EventEmitter {
          * @type {Object}
          * @property {Device} device - The <code>Device</code> instance representing the BLE peer we're connected to.
          * @property {Object} mtu - requested ATT MTU.
+         * @property {boolean} autoReplied - The request was replied to by the auto reply policy.
          */
-        this.emit('attMtuRequest', device, event.client_rx_mtu);
+        this.emit('attMtuRequest', device, event.client_rx_mtu, autoReplied);
     }
 
     _parseMemoryRequestEvent(event) {
@@ -2173,7 +2593,29 @@ class Adapter extends EventEmitter {
     }
 
     _setAttributeValueWithOffset(attribute, value, offset) {
-        attribute.value = attribute.value.slice(0, offset).concat(value);
+        attribute.value = _concatValues(attribute.value.slice(0, offset), value);
+    }
+
+    // Updates this adapter's state after BLE is enabled, from the probe cache if the open option useProbeCache is set
+    _probeState(callback) {
+        const serialNumber = this._state.serialNumber;
+        const useProbeCache = this._useProbeCache && serialNumber !== undefined;
+        const fingerprint = ProbeCache.fingerprint(this._enableBLEParams);
+        const probed = useProbeCache ? ProbeCache.shared.get(serialNumber, fingerprint) : undefined;
+
+        if (probed !== undefined) {
+            this._changeState(Object.assign(probed, { available: true, bleEnabled: true }));
+            if (callback) { callback(undefined, this._state); }
+            return;
+        }
+
+        this.getState((err, state) => {
+            if (!err && useProbeCache) {
+                ProbeCache.shared.set(serialNumber, fingerprint, state);
+            }
+
+            if (callback) { callback(err, state); }
+        });
     }
 
     /**
@@ -2391,35 +2833,192 @@ class Adapter extends EventEmitter {
     }
 
     /**
-     * Stop scanning (GAP Discovery procedure, Observer Procedure).
+     * @summary Filter scan reports in the native layer.
      *
-     * @param {function(Error)} [callback] Callback signature: err => {}.
+     * Reports not matching the filter are dropped before they are queued, and are counted in the
+     * <code>advReportFilteredCount</code> statistic. A report matches when it passes every criterion given.
+     * Call with <code>null</code> to remove the filter.
+     *
+     * @param {Object|null} filter The scan report filter.
+     * Available filter options:
+     * <ul>
+     * <li>{Array<string|Object>} [addresses] Peer addresses. The report must come from one of them. A string formatted
+     *                                       as 'AA:BB:CC:DD:EE:FF' matches the address with any address type, an object
+     *                                       <code>{ address, type }</code> as in the <code>peer_addr</code> of reports
+     *                                       also matches the address type.
+     * <li>{number} [minRssi] Minimum RSSI in dBm.
+     * <li>{string[]} [serviceUuids] 16, 32 or 128 bit service UUIDs as hexadecimal strings. The advertising data
+     *                               must list one of them.
+     * <li>{number[]} [manufacturerIds] Company identifiers. The manufacturer specific data must start with one of them.
+     * <li>{string} [namePrefix] The shortened or complete local name must start with this prefix.
+     * <li>{Object} [dedup] Suppress repeated reports per device, keyed by address and scan response flag.
+     *                       A report of a known device is passed on only if it changed, and the counters
+     *                       <code>advReportDedupHitCount</code> (suppressed) and <code>advReportDedupMissCount</code>
+     *                       (passed on) are updated.
+     *     <ul>
+     *     <li>{boolean} [payloadChange] Pass on the report when the advertising data changed. Defaults to false.
+     *     <li>{number} [rssiDelta] Pass on the report when the RSSI moved by at least this many dB. Defaults to 0 (off).
+     *     <li>{number} [interval] Pass on at most one report per device in this many ms. Defaults to 0 (off).
+     *     <li>{number} [maxDevices] Number of devices tracked. When the table is full, a device not seen
+     *                              recently is evicted, and is reported as new when it is seen again. Defaults to 1024.
+     *     </ul>
+     *     If neither payloadChange nor rssiDelta is set every report counts as changed, so only interval applies.
+     * <li>{boolean} [batch] If true, accepted reports are emitted in the compact <code>advertisementReports</code>
+     *                       event instead of <code>deviceDiscovered</code>. Defaults to false.
+     * </ul>
      * @returns {void}
      */
-    stopScan(callback) {
-        this._adapter.gapStopScan(err => {
-            if (err) {
-                // TODO: probably is state already set to false, but should we make sure? if yes, emit stateChanged?
-                this.emit('error', _makeError('Error occured when stopping scanning', err));
-            } else {
-                this._changeState({ scanning: false });
-            }
-
-            if (callback) { callback(err); }
-        });
+    setScanFilter(filter) {
+        this._adapter.gapSetScanFilter(filter || null);
     }
 
     /**
-     * @summary Create a connection (GAP Link Establishment).
-     *
-     * If a scanning procedure is currently in progress it will be automatically stopped when calling this function.
+     * @summary Reply to time critical requests from peers in the native layer.
      *
-     * The application will be informed of a connection being established with a event:DeviceConnectedEvent.
+     * The requests covered by the policy are replied to as soon as they are received, without waiting for
+     * the event to be handled in JavaScript. The request events are still emitted, with <code>autoReplied</code>
+     * set to true, and must not be replied to again. If a native reply fails the event is emitted as a normal
+     * request. Call with <code>null</code> to remove the policy.
      *
-     * @param {string|Object} deviceAddress The peer address. If the use_whitelist bit is set in scanParams,
-     *                                      then this is ignored. If given as a string,
-     *                                      `address.type='BLE_GAP_ADDR_TYPE_RANDOM_STATIC'` by default. Else,
-     *                                      an Object with members: { address: {string}, type: {string} } must be given.
+     * @param {Object|null} policy The auto reply policy.
+     * Available policy options:
+     * <ul>
+     * <li>{Object} [connectionParameters] Accept connection parameter update requests, with the requested
+     *                                     parameters clamped to these limits, in the same units as
+     *                                     <code>connParamUpdateRequest</code>.
+     *     <ul>
+     *     <li>{number} [minConnectionInterval] Minimum connection interval in 1.25 ms units.
+     *     <li>{number} [maxConnectionInterval] Maximum connection interval in 1.25 ms units.
+     *     <li>{number} [maxSlaveLatency] Maximum slave latency in number of connection events.
+     *     <li>{number} [minConnectionSupervisionTimeout] Minimum supervision timeout in 10 ms units.
+     *     <li>{number} [maxConnectionSupervisionTimeout] Maximum supervision timeout in 10 ms units.
+     *     <li>{boolean} [reject] Reject the requests instead.
+     *     </ul>
+     * <li>{Object} [secParams] Reply to security parameters requests in the peripheral role with these parameters,
+     *                          see <code>replySecParams</code>. LE Secure Connections requires <code>lescDhkey</code>.
+     * <li>{boolean} [lescDhkey] Reply to LESC DHKey requests with the DHKey computed from the key-pair of this
+     *                           adapter, see <code>computePublicKey</code>. If the adapter has no key-pair yet, one is
+     *                           taken in a worker thread, and LESC requests are handled in JavaScript until then.
+     * <li>{number} [attMtu] Reply to ATT MTU exchange requests with this ATT MTU. SoftDevice API version 5 only.
+     * <li>{number} [maxDataLength] Reply to data length update requests with this many octets. SoftDevice API version 5 only.
+     * <li>{Object} [phys] Reply to PHY update requests with these preferred PHYs, <code>{ tx_phys, rx_phys }</code>.
+     *                     SoftDevice API version 5 only.
+     * </ul>
+     * @returns {void}
+     */
+    setAutoReplyPolicy(policy) {
+        this._autoReplyPolicy = policy || null;
+
+        if (policy && policy.lescDhkey && this._keys === null) {
+            // Until the key pair is taken in a worker thread, LESC requests are passed on to JavaScript
+            const interimPolicy = Object.assign({}, policy, { lescDhkey: false });
+
+            if (policy.secParams && policy.secParams.lesc) {
+                delete interimPolicy.secParams;
+            }
+
+            this._adapter.setAutoReplyPolicy(interimPolicy);
+            this._generateKeyPairAsync(err => {
+                if (err) {
+                    this.emit('error', _makeError('Failed to generate key-pair for the auto reply policy', err));
+                }
+            });
+            return;
+        }
+
+        this._applyAutoReplyPolicy();
+    }
+
+    _applyAutoReplyPolicy() {
+        let nativePolicy = this._autoReplyPolicy;
+
+        if (nativePolicy && nativePolicy.lescDhkey) {
+            nativePolicy = Object.assign({}, nativePolicy, { lescPrivateKey: this._keys.sk });
+        }
+
+        this._adapter.setAutoReplyPolicy(nativePolicy);
+    }
+
+    /**
+     * @summary Keep bonds in the native layer.
+     *
+     * Keys of completed bondings are stored by peer address. Security information requests from bonded peers are
+     * replied to as soon as they are received, and the <code>secInfoRequest</code> event is emitted with
+     * <code>autoReplied</code> set to true. Peers are matched by the address they connect with, or by the identity
+     * address they distributed when bonding. Call with <code>null</code> to remove the bond store.
+     *
+     * @param {Object|null} options The bond store options.
+     * Available options:
+     * <ul>
+     * <li>{string} [path] File the bonds are read from and saved to on every change.
+     * <li>{boolean} [encryptOnConnect] Encrypt connections in the central role to bonded peers when they are
+     *                                  established. Defaults to false.
+     * </ul>
+     * @returns {void}
+     */
+    setBondStore(options) {
+        this._adapter.setBondStore(options || null);
+    }
+
+    /**
+     * Get the bonds in the bond store.
+     *
+     * @returns {Object[]} Bonds with <code>peer_addr</code>, <code>own_key</code> and <code>peer_key</code> telling
+     *                     which keys are stored, and <code>lesc</code> and <code>auth</code> of the keys.
+     */
+    getBonds() {
+        return this._adapter.getBonds();
+    }
+
+    /**
+     * Delete the bond with a peer from the bond store.
+     *
+     * @param {Object} address Peer address, <code>{ address, type }</code> as in <code>getBonds</code>.
+     * @returns {boolean} False if there was no bond with the peer.
+     */
+    deleteBond(address) {
+        return this._adapter.deleteBond(address);
+    }
+
+    /**
+     * Delete all bonds from the bond store.
+     *
+     * @returns {void}
+     */
+    clearBonds() {
+        this._adapter.clearBonds();
+    }
+
+    /**
+     * Stop scanning (GAP Discovery procedure, Observer Procedure).
+     *
+     * @param {function(Error)} [callback] Callback signature: err => {}.
+     * @returns {void}
+     */
+    stopScan(callback) {
+        this._adapter.gapStopScan(err => {
+            if (err) {
+                // TODO: probably is state already set to false, but should we make sure? if yes, emit stateChanged?
+                this.emit('error', _makeError('Error occured when stopping scanning', err));
+            } else {
+                this._changeState({ scanning: false });
+            }
+
+            if (callback) { callback(err); }
+        });
+    }
+
+    /**
+     * @summary Create a connection (GAP Link Establishment).
+     *
+     * If a scanning procedure is currently in progress it will be automatically stopped when calling this function.
+     *
+     * The application will be informed of a connection being established with a event:DeviceConnectedEvent.
+     *
+     * @param {string|Object} deviceAddress The peer address. If the use_whitelist bit is set in scanParams,
+     *                                      then this is ignored. If given as a string,
+     *                                      `address.type='BLE_GAP_ADDR_TYPE_RANDOM_STATIC'` by default. Else,
+     *                                      an Object with members: { address: {string}, type: {string} } must be given.
      * @param {Object} options The scan and connection parameters.
      * Available options:
      * <ul>
@@ -3725,6 +4324,359 @@ class Adapter extends EventEmitter {
             .catch(error => { if (callback) callback(error); });
     }
 
+    /**
+     * Discovers all services, characteristics and descriptors of a GATT server in one native operation.
+     *
+     * The result has the same form as the result of `getAttributes`, but the values of the characteristics and
+     * descriptors are not read. The discovery requests are issued natively as the responses arrive, which makes
+     * this much faster than `getAttributes` for devices with large attribute tables. If attributes of the device
+     * have been discovered or restored from the GATT cache before, this is the same as `getAttributes`.
+     *
+     * @param {string} deviceInstanceId The device's unique Id.
+     * @param {function(Error, Object)} [callback] Callback signature: (err, attributes) => {} where `attributes` contains
+     *                                           the device's GATT attributes (services, characteristics and
+     *                                           descriptors).
+     * @returns {void}
+     */
+    discoverAttributes(deviceInstanceId, callback) {
+        const device = this.getDevice(deviceInstanceId);
+        if (!device) {
+            throw new Error('Attribute discovery failed: Could not get device with id ' + deviceInstanceId);
+        }
+
+        if (_.some(this._services, service => service.deviceInstanceId === deviceInstanceId)) {
+            this.getAttributes(deviceInstanceId, callback);
+            return;
+        }
+
+        if (this._gattOperationsMap[device.instanceId]) {
+            this.emit('error', _makeError('Failed to discover attributes, a GATT operation already in progress'));
+            return;
+        }
+
+        const gattOperation = { callback, pendingHandleReads: {}, parent: device };
+        this._gattOperationsMap[device.instanceId] = gattOperation;
+
+        this._adapter.gattcDiscoverDatabase(device.connectionHandle, (err, services) => {
+            // The operation has already been ended with an error if the device disconnected
+            if (this._gattOperationsMap[device.instanceId] !== gattOperation) {
+                return;
+            }
+
+            delete this._gattOperationsMap[device.instanceId];
+
+            if (err) {
+                this.emit('error', _makeError('Failed to discover attributes', err));
+                if (callback) { callback(err); }
+                return;
+            }
+
+            const database = services.map(service => ({
+                uuid: this._attributeUuid(service.uuid, service.uuid128),
+                startHandle: service.handle_range.start_handle,
+                endHandle: service.handle_range.end_handle,
+                characteristics: service.characteristics.map(characteristic => ({
+                    uuid: this._attributeUuid(characteristic.uuid, characteristic.uuid128),
+                    declarationHandle: characteristic.handle_decl,
+                    valueHandle: characteristic.handle_value,
+                    properties: characteristic.char_props,
+                    descriptors: characteristic.descriptors.map(descriptor => ({
+                        uuid: this._attributeUuid(descriptor.uuid),
+                        handle: descriptor.handle,
+                    })),
+                })),
+            }));
+
+            const data = this._addDatabase(device, database);
+
+            if (!this._gattCacheDirectory) {
+                if (callback) { callback(undefined, data); }
+                return;
+            }
+
+            this._readDatabaseHash(device, (hashError, databaseHash) => {
+                if (!hashError) {
+                    const cacheKey = this._gattCacheKey(device);
+
+                    if (cacheKey && (cacheKey.bonded || databaseHash)) {
+                        this._saveGattCache(cacheKey.address, database, databaseHash);
+                    } else if (device.connected) {
+                        // Saved if the peer bonds on this connection
+                        this._pendingGattCaches[device.instanceId] = { database, databaseHash };
+                    }
+                }
+
+                if (callback) { callback(undefined, data); }
+            });
+        });
+    }
+
+    /**
+     * Sets the directory of the GATT cache, or disables the cache.
+     *
+     * With a cache directory, the attribute table discovered by `discoverAttributes` is stored in a file per peer
+     * identity address. The attributes are restored from the file when the peer connects again, so `getServices`,
+     * `getAttributes` and `discoverAttributes` do not discover them again.
+     *
+     * Bonded peers are cached by the identity address they distributed when bonding, or by their public or static
+     * random address. A bonded peer with a resolvable private address is recognized when the SoftDevice resolves
+     * its address, or when it is in the bond store, see `setBondStore`. A table discovered before bonding is saved
+     * when the bonding completes. Unbonded peers are only cached if they have a public or static random address
+     * and a Database Hash (0x2B2A), and their attributes are only restored with the hash.
+     *
+     * The cache entry of a peer is invalidated, and its attributes removed from the adapter, when the peer indicates
+     * Service Changed (0x2A05), or when its Database Hash differs from the cached one when restored.
+     * `servicesChanged` is emitted then.
+     *
+     * @param {string|null} directory Existing directory of the cache files, null disables the cache.
+     * @returns {void}
+     */
+    setGattCacheDirectory(directory) {
+        this._gattCacheDirectory = directory || null;
+    }
+
+    // Attributes of the device that are already present, by handle, are not added again
+    _addDatabase(device, database) {
+        const data = { 'services': {} };
+
+        for (let service of database) {
+            let newService = _.find(this._services, existing =>
+                existing.deviceInstanceId === device.instanceId && existing.startHandle === service.startHandle);
+
+            if (!newService) {
+                newService = new Service(device.instanceId, service.uuid);
+                newService.startHandle = service.startHandle;
+                newService.endHandle = service.endHandle;
+                this._services[newService.instanceId] = newService;
+                newService.characteristics = {};
+                this.emit('serviceAdded', newService);
+            }
+
+            data.services[newService.instanceId] = newService;
+
+            for (let characteristic of service.characteristics) {
+                if (_.some(this._characteristics, existing =>
+                        existing.serviceInstanceId === newService.instanceId &&
+                        existing.declarationHandle === characteristic.declarationHandle)) {
+                    continue;
+                }
+
+                const newCharacteristic = new Characteristic(newService.instanceId, characteristic.uuid, [], characteristic.properties);
+                newCharacteristic.declarationHandle = characteristic.declarationHandle;
+                newCharacteristic.valueHandle = characteristic.valueHandle;
+                this._characteristics[newCharacteristic.instanceId] = newCharacteristic;
+                newService.characteristics[newCharacteristic.instanceId] = newCharacteristic;
+                newCharacteristic.descriptors = [];
+
+                for (let descriptor of characteristic.descriptors) {
+                    const newDescriptor = new Descriptor(newCharacteristic.instanceId, descriptor.uuid || 'Unknown 128 bit descriptor uuid ', null);
+                    newDescriptor.handle = descriptor.handle;
+                    this._descriptors[newDescriptor.instanceId] = newDescriptor;
+                    newCharacteristic.descriptors.push(newDescriptor);
+                }
+            }
+        }
+
+        return data;
+    }
+
+    _removeDeviceAttributes(deviceInstanceId) {
+        for (let serviceInstanceId in this._services) {
+            if (this._services[serviceInstanceId].deviceInstanceId !== deviceInstanceId) {
+                continue;
+            }
+
+            for (let characteristicInstanceId in this._characteristics) {
+                if (this._characteristics[characteristicInstanceId].serviceInstanceId !== serviceInstanceId) {
+                    continue;
+                }
+
+                for (let descriptorInstanceId in this._descriptors) {
+                    if (this._descriptors[descriptorInstanceId].characteristicInstanceId === characteristicInstanceId) {
+                        delete this._descriptors[descriptorInstanceId];
+                    }
+                }
+
+                delete this._characteristics[characteristicInstanceId];
+            }
+
+            delete this._services[serviceInstanceId];
+        }
+    }
+
+    // Calls back with the value of the Database Hash characteristic, or null if the device has none
+    _readDatabaseHash(device, callback) {
+        const hashCharacteristic = _.find(this._characteristics, characteristic =>
+            characteristic.uuid === DATABASE_HASH_UUID &&
+            this._getDeviceByCharacteristicId(characteristic.instanceId) === device);
+
+        if (!hashCharacteristic) {
+            callback(undefined, null);
+            return;
+        }
+
+        try {
+            this.readCharacteristicValue(hashCharacteristic.instanceId, (err, value) => callback(err, value));
+        } catch (err) {
+            callback(err);
+        }
+    }
+
+    // Identity address of a bonded peer, known from the bonding on this adapter, from the SoftDevice resolving
+    // its address, or from the bond store. Null if the peer is not known to be bonded.
+    _peerIdentityAddress(device) {
+        if (this._peerIdentities[device.address]) {
+            return this._peerIdentities[device.address];
+        }
+
+        if (_.some(this._adapter.getBonds(), bond => bond.peer_addr.address === device.address)) {
+            return device.address;
+        }
+
+        return null;
+    }
+
+    // The address the GATT cache of a peer is stored by, with bonded telling if the peer is bonded. Unbonded peers
+    // with a resolvable or non-resolvable private address can not be recognized again, and are not cached.
+    _gattCacheKey(device) {
+        const identity = this._peerIdentityAddress(device);
+
+        if (identity) {
+            return { address: identity, bonded: true };
+        }
+
+        if (device.addressType === 'BLE_GAP_ADDR_TYPE_PUBLIC' || device.addressType === 'BLE_GAP_ADDR_TYPE_RANDOM_STATIC') {
+            return { address: device.address, bonded: false };
+        }
+
+        return null;
+    }
+
+    _onBonded(device, event) {
+        const idKey = event.keyset && event.keyset.keys_peer && event.keyset.keys_peer.id_key;
+
+        if (event.kdist_peer && event.kdist_peer.id && idKey) {
+            this._peerIdentities[device.address] = idKey.id_addr_info.address;
+        } else if (device.addressType === 'BLE_GAP_ADDR_TYPE_PUBLIC' || device.addressType === 'BLE_GAP_ADDR_TYPE_RANDOM_STATIC') {
+            this._peerIdentities[device.address] = device.address;
+        }
+
+        const pending = this._pendingGattCaches[device.instanceId];
+        delete this._pendingGattCaches[device.instanceId];
+
+        if (pending && this._gattCacheDirectory && this._peerIdentities[device.address]) {
+            this._saveGattCache(this._peerIdentities[device.address], pending.database, pending.databaseHash);
+        }
+    }
+
+    _saveGattCache(address, database, databaseHash) {
+        const file = GattCache.filePath(this._gattCacheDirectory, address);
+
+        fs.writeFile(file, GattCache.encode(database, databaseHash), err => {
+            if (err) {
+                this.emit('logMessage', logLevel.DEBUG, `Failed to save GATT cache ${file}: ${err.message}`);
+            }
+        });
+    }
+
+    _restoreGattCache(device) {
+        if (!this._gattCacheDirectory) {
+            return;
+        }
+
+        const cacheKey = this._gattCacheKey(device);
+
+        if (!cacheKey) {
+            return;
+        }
+
+        const file = GattCache.filePath(this._gattCacheDirectory, cacheKey.address);
+
+        fs.readFile(file, (err, buffer) => {
+            if (err) {
+                return;
+            }
+
+            // The attributes may have been discovered, a discovery started, or the device disconnected, while the
+            // file was read
+            if (!device.connected || this._devices[device.instanceId] !== device ||
+                this._gattOperationsMap[device.instanceId] ||
+                _.some(this._services, service => service.deviceInstanceId === device.instanceId)) {
+                return;
+            }
+
+            let cache;
+
+            try {
+                cache = GattCache.decode(buffer);
+            } catch (decodeError) {
+                this.emit('logMessage', logLevel.DEBUG, `Ignoring GATT cache ${file}: ${decodeError.message}`);
+                fs.unlink(file, () => {});
+                return;
+            }
+
+            // Changes of the table of an unbonded peer can only be detected with the Database Hash
+            if (!cacheKey.bonded && !cache.databaseHash) {
+                return;
+            }
+
+            this._addDatabase(device, cache.services);
+            this.emit('logMessage', logLevel.DEBUG, `Restored GATT attributes of ${device.address} from cache`);
+
+            if (!cache.databaseHash) {
+                return;
+            }
+
+            this._readDatabaseHash(device, (hashError, databaseHash) => {
+                if (hashError) {
+                    this.emit('logMessage', logLevel.DEBUG, `Failed to verify GATT cache of ${device.address}: ${hashError.message || hashError}`);
+                    return;
+                }
+
+                if (!databaseHash || !_.isEqual(Array.from(databaseHash), cache.databaseHash)) {
+                    this._invalidateGattCache(device);
+                }
+            });
+        });
+    }
+
+    _invalidateGattCache(device) {
+        if (this._gattCacheDirectory) {
+            const cacheKey = this._gattCacheKey(device);
+
+            if (cacheKey) {
+                fs.unlink(GattCache.filePath(this._gattCacheDirectory, cacheKey.address), () => {});
+            }
+
+            delete this._pendingGattCaches[device.instanceId];
+            this._removeDeviceAttributes(device.instanceId);
+        }
+
+        /**
+         * The attribute table of a peer has changed, its attributes must be discovered again.
+         * The attributes are removed from the adapter when the GATT cache is enabled.
+         *
+         * @event Adapter#servicesChanged
+         * @type {Object}
+         * @property {Device} device - The <code>Device</code> instance representing the BLE peer.
+         */
+        this.emit('servicesChanged', device);
+    }
+
+    _attributeUuid(uuid, uuid128) {
+        if (uuid128) {
+            return HexConv.arrayTo128BitUuid(uuid128);
+        }
+
+        if (uuid.type >= this._bleDriver.BLE_UUID_TYPE_VENDOR_BEGIN) {
+            return this._converter.lookupVsUuid(uuid);
+        } else if (uuid.type === this._bleDriver.BLE_UUID_TYPE_UNKNOWN) {
+            return null;
+        }
+
+        return HexConv.numberTo16BitUuid(uuid.uuid);
+    }
+
     /**
      * Reads the value of a GATT characteristic.
      *
@@ -3754,13 +4706,7 @@ class Adapter extends EventEmitter {
             throw new Error('Characteristic value read failed: A gatt operation already in progress with device id ' + device.instanceId);
         }
 
-        this._gattOperationsMap[device.instanceId] = { callback: callback, readBytes: [] };
-
-        this._adapter.gattcRead(device.connectionHandle, characteristic.valueHandle, 0, err => {
-            if (err) {
-                this.emit('error', _makeError('Read characteristic value failed', err));
-            }
-        });
+        this._longRead(device, characteristic.valueHandle, 'Read characteristic value failed', callback);
     }
 
     /**
@@ -3801,7 +4747,6 @@ class Adapter extends EventEmitter {
                 throw new Error('Long writes do not support BLE_GATT_OP_WRITE_CMD');
             }
 
-            this._gattOperationsMap[device.instanceId].bytesWritten = this._maxLongWritePayloadSize(device.instanceId);
             this._longWrite(device, characteristic, value, completeCallback);
         } else {
             this._gattOperationsMap[device.instanceId].bytesWritten = value.length;
@@ -3809,6 +4754,165 @@ class Adapter extends EventEmitter {
         }
     }
 
+    /**
+     * Streams a value of any length to a GATT characteristic of a remote device with write without response.
+     *
+     * The value is split into packets of the current ATT MTU minus 3 bytes. The packets are written natively,
+     * keeping the SoftDevice TX queue full, without a round trip to JavaScript per packet. Other operations on
+     * the adapter can be done while the stream is active, but only one stream can be active per device.
+     *
+     * @param {string} characteristicId Unique ID of the GATT characteristic.
+     * @param {Buffer|Uint8Array|array} value The value (bytes) to be written.
+     * @param {function(Error, number)} callback Called once all packets have been transmitted.
+     *                                           Signature: (err, bytesWritten) => {}
+     * @returns {void}
+     */
+    writeCharacteristicValueStream(characteristicId, value, callback) {
+        const characteristic = this.getCharacteristic(characteristicId);
+        if (!characteristic) {
+            throw new Error('Characteristic value stream failed: Could not get characteristic with id ' + characteristicId);
+        }
+
+        const device = this._getDeviceByCharacteristicId(characteristicId);
+        if (!device) {
+            throw new Error('Characteristic value stream failed: Could not get device');
+        }
+
+        const buffer = Buffer.isBuffer(value) || value instanceof Uint8Array ? value : Buffer.from(value);
+
+        this._adapter.gattcWriteStream(device.connectionHandle, characteristic.valueHandle, buffer,
+            this._maxShortWritePayloadSize(device.instanceId), (err, bytesWritten) => {
+                if (err) {
+                    const error = _makeError('Characteristic value stream failed', err);
+                    this.emit('error', error);
+                    if (callback) { callback(error, bytesWritten); }
+                    return;
+                }
+
+                if (callback) { callback(undefined, bytesWritten); }
+            });
+    }
+
+    /**
+     * Writes one Secure DFU object (init packet or firmware) of a remote device to its DFU packet characteristic.
+     *
+     * The object is written natively as write commands of the current ATT MTU minus 3 bytes, keeping the
+     * SoftDevice TX queue full, and the CRC32 of the DFU image is accumulated natively as it is written. With a
+     * packet receipt notification (PRN) value, the receipts on the control point characteristic are checked
+     * natively, and the write is held back when it is more than two receipts ahead of the target. The receipts
+     * that are due are not emitted as <code>characteristicValueChanged</code>. Notifications must be enabled on the
+     * control point characteristic.
+     *
+     * @param {string} packetCharacteristicId Unique ID of the DFU packet characteristic.
+     * @param {string} controlPointCharacteristicId Unique ID of the DFU control point characteristic.
+     * @param {Buffer|Uint8Array|array} data The object data (bytes) to be written.
+     * @param {Object} [options] Write options.
+     * @param {number} [options.chunkSize] Bytes per write command, defaults to the current ATT MTU - 3.
+     * @param {number} [options.prn] The PRN value set on the target, 0 (default) if receipts are disabled.
+     * @param {number} [options.offset] Offset in the DFU image the object starts at, defaults to 0.
+     * @param {number} [options.crc32] CRC32 of the DFU image up to offset, defaults to 0.
+     * @param {function(number)} [options.progress] Called as the packets are written, in batches.
+     *                                              Signature: offset => {}
+     * @param {function(Error, Object)} callback Called once the object has been transmitted, with the offset and
+     *                                           CRC32 written. If the write failed, with the offset and CRC32 of
+     *                                           the last matching receipt. Signature: (err, { offset, crc32 }) => {}
+     * @returns {void}
+     */
+    writeDfuObject(packetCharacteristicId, controlPointCharacteristicId, data, options, callback) {
+        if (typeof options === 'function') {
+            callback = options;
+            options = {};
+        }
+
+        options = options || {};
+
+        const packetCharacteristic = this.getCharacteristic(packetCharacteristicId);
+        const controlPointCharacteristic = this.getCharacteristic(controlPointCharacteristicId);
+        if (!packetCharacteristic || !controlPointCharacteristic) {
+            throw new Error('DFU object write failed: Could not get DFU characteristics');
+        }
+
+        const device = this._getDeviceByCharacteristicId(packetCharacteristicId);
+        if (!device) {
+            throw new Error('DFU object write failed: Could not get device');
+        }
+
+        const buffer = Buffer.isBuffer(data) || data instanceof Uint8Array ? data : Buffer.from(data);
+        const chunkSize = options.chunkSize || this._maxShortWritePayloadSize(device.instanceId);
+        const progress = typeof options.progress === 'function' ? options.progress : null;
+
+        this._adapter.gattcWriteDfuObject(device.connectionHandle, packetCharacteristic.valueHandle,
+            controlPointCharacteristic.valueHandle, buffer, chunkSize, options.prn || 0, options.offset || 0,
+            options.crc32 || 0, progress, (err, written) => {
+                if (err) {
+                    const error = _makeError('DFU object write failed', err);
+                    this.emit('error', error);
+                    if (callback) { callback(error, written); }
+                    return;
+                }
+
+                if (callback) { callback(undefined, written); }
+            });
+    }
+
+    /**
+     * Streams samples of a local GATT characteristic to a connected device as notifications.
+     *
+     * Each sample is sent as one notification. The notifications are sent natively as fast as the SoftDevice
+     * TX queue allows, without a round trip to JavaScript per notification. Only one stream can be active per
+     * device. The value of the characteristic in the local attribute table is not changed.
+     *
+     * @param {string} characteristicId Unique ID of the local GATT characteristic.
+     * @param {string} deviceInstanceId Unique ID of the device to notify.
+     * @param {Buffer|Uint8Array|array} value The samples (bytes) to be sent, back to back.
+     * @param {Object} [options] Stream options.
+     * @param {number} [options.sampleSize] Bytes per notification, defaults to the current ATT MTU - 3.
+     * @param {function(number, number)} [options.progress] Called as the samples are sent, in batches.
+     *                                                      Signature: (samplesSent, samplesTransmitted) => {}
+     * @param {function(Error, number)} callback Called once all samples have been transmitted.
+     *                                           Signature: (err, samplesSent) => {}
+     * @returns {void}
+     */
+    notifyCharacteristicValueStream(characteristicId, deviceInstanceId, value, options, callback) {
+        if (typeof options === 'function') {
+            callback = options;
+            options = {};
+        }
+
+        options = options || {};
+
+        const characteristic = this.getCharacteristic(characteristicId);
+        if (!characteristic || !this._instanceIdIsOnLocalDevice(characteristicId)) {
+            throw new Error('Characteristic value stream failed: Could not get local characteristic with id ' + characteristicId);
+        }
+
+        const device = this.getDevice(deviceInstanceId);
+        if (!device) {
+            throw new Error('Characteristic value stream failed: Could not get device with id ' + deviceInstanceId);
+        }
+
+        const maxSampleSize = this._maxShortWritePayloadSize(device.instanceId);
+        const sampleSize = options.sampleSize || maxSampleSize;
+
+        if (sampleSize > maxSampleSize) {
+            throw new Error('Characteristic value stream failed: Sample size is larger than ' + maxSampleSize);
+        }
+
+        const buffer = Buffer.isBuffer(value) || value instanceof Uint8Array ? value : Buffer.from(value);
+
+        this._adapter.gattsHVXStream(device.connectionHandle, characteristic.valueHandle, buffer, sampleSize,
+            options.progress || null, (err, samplesSent) => {
+                if (err) {
+                    const error = _makeError('Characteristic value stream failed', err);
+                    this.emit('error', error);
+                    if (callback) { callback(error, samplesSent); }
+                    return;
+                }
+
+                if (callback) { callback(undefined, samplesSent); }
+            });
+    }
+
     _getDeviceByDescriptorId(descriptorId) {
         const descriptor = this._descriptors[descriptorId];
         if (!descriptor) {
@@ -3884,13 +4988,7 @@ class Adapter extends EventEmitter {
             throw new Error('Descriptor read failed: A gatt operation already in progress with device with id ' + device.instanceId);
         }
 
-        this._gattOperationsMap[device.instanceId] = { callback: callback, readBytes: [] };
-
-        this._adapter.gattcRead(device.connectionHandle, descriptor.handle, 0, err => {
-            if (err) {
-                this.emit('error', _makeError('Read descriptor value failed', err));
-            }
-        });
+        this._longRead(device, descriptor.handle, 'Read descriptor value failed', callback);
     }
 
     /**
@@ -3933,7 +5031,6 @@ class Adapter extends EventEmitter {
                 throw new Error('Long writes do not support BLE_GATT_OP_WRITE_CMD');
             }
 
-            this._gattOperationsMap[device.instanceId].bytesWritten = this._maxLongWritePayloadSize(device.instanceId);
             this._longWrite(device, descriptor, value, callback);
         } else {
             this._gattOperationsMap[device.instanceId].bytesWritten = value.length;
@@ -4008,50 +5105,53 @@ class Adapter extends EventEmitter {
         ]);
     }
 
-    _longWrite(device, attribute, value, callback) {
-        if (value.length < this._maxShortWritePayloadSize(device.instanceId)) {
-            throw new Error('Wrong write method. Use regular write for payload sizes < ' + this._maxShortWritePayloadSize(device.instanceId));
-        }
+    _longRead(device, handle, errorMessage, callback) {
+        const gattOperation = { callback };
+        this._gattOperationsMap[device.instanceId] = gattOperation;
 
-        const writeParameters = {
-            write_op: this._bleDriver.BLE_GATT_OP_PREP_WRITE_REQ,
-            flags: this._bleDriver.BLE_GATT_EXEC_WRITE_FLAG_PREPARED_WRITE,
-            handle: attribute.handle,
-            offset: 0,
-            len: this._maxLongWritePayloadSize(device.instanceId),
-            value: value.slice(0, this._maxLongWritePayloadSize(device.instanceId)),
-        };
+        // The read blob requests are done natively, the value is read with one call
+        this._adapter.gattcReadLong(device.connectionHandle, handle, this.getCurrentAttMtu(device.instanceId), (err, value) => {
+            // The operation has already been ended with an error if the device disconnected
+            if (this._gattOperationsMap[device.instanceId] !== gattOperation) {
+                return;
+            }
+
+            delete this._gattOperationsMap[device.instanceId];
 
-        this._adapter.gattcWrite(device.connectionHandle, writeParameters, err => {
             if (err) {
-                this._longWriteCancel(device, attribute);
-                this.emit('error', _makeError('Failed to write value to device/handle ' + device.instanceId + '/' + attribute.handle, err));
+                this.emit('error', _makeError(errorMessage, err));
+                if (callback) { callback(err); }
                 return;
             }
 
+            if (callback) { callback(undefined, value); }
         });
     }
 
-    _longWriteCancel(device, attribute) {
+    _longWrite(device, attribute, value, callback) {
         const gattOperation = this._gattOperationsMap[device.instanceId];
-        const writeParameters = {
-            write_op: this._bleDriver.BLE_GATT_OP_EXEC_WRITE_REQ,
-            flags: this._bleDriver.BLE_GATT_EXEC_WRITE_FLAG_PREPARED_CANCEL,
-            handle: attribute.handle,
-            offset: 0,
-            len: 0,
-            value: [],
-        };
+        const buffer = Buffer.isBuffer(value) || value instanceof Uint8Array ? value : Buffer.from(value);
+
+        // The prepare write requests and the execute write request are done natively. The prepared
+        // writes are cancelled if one of them fails.
+        this._adapter.gattcWriteLong(device.connectionHandle, attribute.handle, buffer, this.getCurrentAttMtu(device.instanceId), err => {
+            // The operation has already been ended with an error if the device disconnected
+            if (this._gattOperationsMap[device.instanceId] !== gattOperation) {
+                return;
+            }
 
-        this._adapter.gattcWrite(device.connectionHandle, writeParameters, err => {
             delete this._gattOperationsMap[device.instanceId];
 
             if (err) {
-                this.emit('error', _makeError('Failed to cancel failed long write', err));
-                gattOperation.callback('Failed to write and failed to cancel write');
-            } else {
-                gattOperation.callback('Failed to write value to device/handle ' + device.instanceId + '/' + attribute.handle);
+                this.emit('error', _makeError('Failed to write value to device/handle ' + device.instanceId + '/' + attribute.handle, err));
+                if (callback) { callback(err); }
+                return;
             }
+
+            attribute.value = gattOperation.value;
+            this._emitAttributeValueChanged(attribute);
+
+            if (callback) { callback(undefined, attribute); }
         });
     }
 
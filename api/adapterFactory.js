@@ -43,6 +43,7 @@ const _bleDriverV5 = require('bindings')('pc-ble-driver-js-sd_api_v5');
 
 const Adapter = require('./adapter');
 const logLevel = require('./util/logLevel');
+const ProbeCache = require('./util/probeCache');
 const EventEmitter = require('events');
 
 const _bleDrivers = { v2: _bleDriverV2, v5: _bleDriverV5 };
@@ -124,7 +125,17 @@ class AdapterFactory extends EventEmitter {
         this._adapters = {};
 
         if (options.enablePolling) {
-            this.updateInterval = setInterval(this._updateAdapterList.bind(this), UPDATE_INTERVAL_MS);
+            // The native adapter list is kept up to date by hotplug notifications where the platform has them,
+            // the list is then only read again when an adapter is attached or detached
+            const driver = this._bleDrivers.v2;
+            const monitored = typeof driver.startAdapterMonitor === 'function'
+                && driver.startAdapterMonitor(() => this._updateAdapterList());
+
+            if (monitored) {
+                setImmediate(() => this._updateAdapterList());
+            } else {
+                this.updateInterval = setInterval(this._updateAdapterList.bind(this), UPDATE_INTERVAL_MS);
+            }
         }
     }
 
@@ -134,7 +145,8 @@ class AdapterFactory extends EventEmitter {
      * The mapping of SoftDevice API version to pc-ble-driver AddOn can be overridden
      * by providing a custom `bleDrivers` argument. By default the AdapterFactory will
      * poll for added/removed adapters every 2 seconds and emit 'added' and 'removed'
-     * events. This can be disabled by passing `enablePolling: false` as part of the
+     * events. On Linux and macOS the adapters are not polled, the events are emitted
+     * when the operating system reports that a serial port is attached or detached. This can be disabled by passing `enablePolling: false` as part of the
      * options object.
      *
      * @param {Object} [bleDrivers] Optional object mapping version to pc-ble-driver AddOn.
@@ -305,6 +317,67 @@ class AdapterFactory extends EventEmitter {
         });
     }
 
+    /**
+     * @summary Open several adapters at once.
+     *
+     * The adapters are opened concurrently, each in its own native command thread, so bringing up N adapters
+     * takes about as long as opening the slowest one. Combined with the <code>useProbeCache</code> open option,
+     * adapters opened before skip reading their state after BLE is enabled.
+     *
+     * @param {Adapter[]} adapters The adapters to open.
+     * @param {Object|function(Adapter): Object} options Open options of all adapters, see <code>Adapter.open</code>,
+     *                                                 or a function returning the open options of an adapter.
+     *                                                 Every adapter gets its own copy of the options.
+     * @param {function(Error, Object[])} [callback] Callback signature: (err, results) => {}, where `results` has
+     *                                               `{ adapter, error }` for the adapters, in the order given.
+     *                                               `err` is set if any adapter failed to open.
+     * @returns {void}
+     */
+    openAdapters(adapters, options, callback) {
+        const results = adapters.map(adapter => ({ adapter, error: undefined }));
+        let pending = adapters.length;
+
+        if (pending === 0) {
+            if (callback) callback(undefined, results);
+            return;
+        }
+
+        adapters.forEach((adapter, index) => {
+            // Adapter.open adds its own callbacks to the options
+            const adapterOptions = Object.assign({}, typeof options === 'function' ? options(adapter) : options);
+            let opened = false;
+
+            adapter.open(adapterOptions, error => {
+                // Adapter.open may report an error after the adapter is opened, the first outcome counts
+                if (opened) return;
+                opened = true;
+
+                results[index].error = error;
+                pending -= 1;
+
+                if (pending === 0 && callback) {
+                    const failedCount = results.filter(result => result.error).length;
+                    const err = failedCount > 0
+                        ? new Error(`Failed to open ${failedCount} of ${adapters.length} adapters.`)
+                        : undefined;
+                    callback(err, results);
+                }
+            });
+        });
+    }
+
+    /**
+     * Read and write the state cached with the <code>useProbeCache</code> open option in a file, so adapters
+     * are probed only once across runs.
+     *
+     * @param {string|null} file The file, null keeps the cache in memory only.
+     * @param {function(Error)} [callback] Callback signature: err => {}.
+     * @returns {void}
+     */
+    setProbeCacheFile(file, callback) {
+        ProbeCache.shared.setFile(file, callback);
+    }
+
     /**
      * Create Adapter with custom serialport
      *
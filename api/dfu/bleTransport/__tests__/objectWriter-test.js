@@ -233,3 +233,101 @@ describe('writeObject', () => {
         });
     });
 });
+
+describe('writeObject with native DFU object writes', () => {
+
+    let adapter;
+    let controlPointService;
+    let objectWriter;
+
+    beforeEach(() => {
+        adapter = {
+            writeDfuObject: jest.fn()
+        };
+        controlPointService = {
+            calculateChecksum: jest.fn()
+        };
+        objectWriter = new ObjectWriter(adapter, 'controlPointId', 'packetId');
+        objectWriter._controlPointService = controlPointService;
+        objectWriter.setPrn(4);
+        objectWriter.setMtuSize(244);
+    });
+
+    describe('when the native write has succeeded', () => {
+
+        beforeEach(() => {
+            adapter.writeDfuObject.mockImplementation((packetId, controlPointId, data, options, callback) => {
+                options.progress(options.offset + data.length);
+                callback(undefined, { offset: options.offset + data.length, crc32: 0x5678 });
+            });
+        });
+
+        it('should write the whole object with the PRN and MTU size', () => {
+            return objectWriter.writeObject([1, 2, 3], 1, 10, 0x1234).then(() => {
+                const call = adapter.writeDfuObject.mock.calls[0];
+                expect(call[0]).toEqual('packetId');
+                expect(call[1]).toEqual('controlPointId');
+                expect(call[2]).toEqual([1, 2, 3]);
+                expect(call[3].prn).toEqual(4);
+                expect(call[3].chunkSize).toEqual(244);
+                expect(call[3].offset).toEqual(10);
+                expect(call[3].crc32).toEqual(0x1234);
+            });
+        });
+
+        it('should return progress info (offset and crc32)', () => {
+            return objectWriter.writeObject([1, 2, 3], 1, 10, 0x1234).then(progressInfo => {
+                expect(progressInfo).toEqual({ offset: 13, crc32: 0x5678 });
+            });
+        });
+
+        it('should emit packetWritten event', () => {
+            const onEventEmitted = jest.fn();
+            objectWriter.on('packetWritten', onEventEmitted);
+            return objectWriter.writeObject([1, 2, 3], 1, 10, 0x1234).then(() => {
+                expect(onEventEmitted).toHaveBeenCalledWith({ offset: 13, type: 1 });
+            });
+        });
+    });
+
+    describe('when the native write has failed', () => {
+
+        const data = [1, 2, 3, 4];
+
+        beforeEach(() => {
+            adapter.writeDfuObject
+                .mockImplementationOnce((packetId, controlPointId, value, options, callback) => {
+                    callback(new Error('Timeout'), { offset: options.offset, crc32: options.crc32 });
+                })
+                .mockImplementation((packetId, controlPointId, value, options, callback) => {
+                    callback(undefined, { offset: options.offset + value.length, crc32: 0x9abc });
+                });
+        });
+
+        it('should resume from the offset reported by the target if its CRC32 matches', () => {
+            // CRC32 of [1, 2]
+            controlPointService.calculateChecksum.mockReturnValue(Promise.resolve({ offset: 2, crc32: 0xb6cc4292 }));
+            return objectWriter.writeObject(data, 1).then(progressInfo => {
+                const call = adapter.writeDfuObject.mock.calls[1];
+                expect(call[2]).toEqual([3, 4]);
+                expect(call[3].offset).toEqual(2);
+                expect(call[3].crc32).toEqual(0xb6cc4292);
+                expect(progressInfo).toEqual({ offset: 4, crc32: 0x9abc });
+            });
+        });
+
+        it('should return error with code INVALID_CRC if the CRC32 reported by the target does not match', () => {
+            controlPointService.calculateChecksum.mockReturnValue(Promise.resolve({ offset: 2, crc32: 0x1234 }));
+            return objectWriter.writeObject(data, 1).catch(error => {
+                expect(error.code).toEqual(ErrorCode.INVALID_CRC);
+            });
+        });
+
+        it('should return error with code WRITE_ERROR if the target cannot be asked for its offset', () => {
+            controlPointService.calculateChecksum.mockReturnValue(Promise.reject(new Error('Disconnected')));
+            return objectWriter.writeObject(data, 1).catch(error => {
+                expect(error.code).toEqual(ErrorCode.WRITE_ERROR);
+            });
+        });
+    });
+});
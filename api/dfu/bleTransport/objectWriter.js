@@ -37,15 +37,18 @@
 'use strict';
 
 const EventEmitter = require('events');
+const crc = require('crc');
 const splitArray = require('../../util/arrayUtil').splitArray;
 const arrayToInt = require('../../util/intArrayConv').arrayToInt;
 const ControlPointOpcode = require('../dfuConstants').ControlPointOpcode;
 const ErrorCode = require('../dfuConstants').ErrorCode;
 const createError = require('../dfuConstants').createError;
 const NotificationQueue = require('./notificationQueue');
+const ControlPointService = require('./controlPointService');
 const PacketWriter = require('./packetWriter');
 
 const DEFAULT_MTU_SIZE = 20;
+const MAX_RESUMES = 3;
 
 class ObjectWriter extends EventEmitter {
 
@@ -53,7 +56,9 @@ class ObjectWriter extends EventEmitter {
         super();
         this._adapter = adapter;
         this._packetCharacteristicId = packetCharacteristicId;
+        this._controlPointCharacteristicId = controlPointCharacteristicId;
         this._notificationQueue = new NotificationQueue(adapter, controlPointCharacteristicId);
+        this._controlPointService = new ControlPointService(adapter, controlPointCharacteristicId);
         this._mtuSize = DEFAULT_MTU_SIZE;
         this._abort = false;
     }
@@ -61,6 +66,11 @@ class ObjectWriter extends EventEmitter {
     /**
      * Writes DFU data object according to the given MTU size.
      *
+     * If the adapter supports it, the whole object is written natively, with
+     * the PRN receipts checked natively. If that fails, the target is asked for
+     * its offset and CRC32, and the write is resumed from there if they match
+     * the data written.
+     *
      * @param data byte array that should be written
      * @param type the ObjectType that we are writing
      * @param offset the offset to continue from (optional)
@@ -68,6 +78,9 @@ class ObjectWriter extends EventEmitter {
      * @returns promise that returns progress info (CRC32 value and offset)
      */
     writeObject(data, type, offset, crc32) {
+        if (typeof this._adapter.writeDfuObject === 'function') {
+            return this._writeObjectNative(data, type, offset || 0, crc32 || 0, 0);
+        }
         const packets = splitArray(data, this._mtuSize);
         const packetWriter = this._createPacketWriter(offset, crc32);
         this._notificationQueue.startListening();
@@ -112,6 +125,70 @@ class ObjectWriter extends EventEmitter {
         this._mtuSize = mtuSize;
     }
 
+    _writeObjectNative(data, type, offset, crc32, resumes) {
+        return this._checkAbortState()
+            .then(() => this._writeDfuObject(data, type, offset, crc32))
+            .catch(error => {
+                if (error.code === ErrorCode.ABORTED || resumes >= MAX_RESUMES) {
+                    throw error;
+                }
+                return this._getResumePoint(data, offset, crc32, error)
+                    .then(resumePoint => this._writeObjectNative(data.slice(resumePoint.offset - offset), type,
+                        resumePoint.offset, resumePoint.crc32, resumes + 1));
+            });
+    }
+
+    _writeDfuObject(data, type, offset, crc32) {
+        return new Promise((resolve, reject) => {
+            const options = {
+                chunkSize: this._mtuSize,
+                prn: this._prn || 0,
+                offset,
+                crc32,
+                progress: progressOffset => {
+                    this.emit('packetWritten', {
+                        offset: progressOffset,
+                        type
+                    });
+                },
+            };
+            this._adapter.writeDfuObject(this._packetCharacteristicId, this._controlPointCharacteristicId,
+                data, options, (error, progress) => {
+                    if (error) {
+                        const message = 'When writing data to DFU Packet ' +
+                          'Characteristic on DFU Target: ' + error.message;
+                        reject(createError(ErrorCode.WRITE_ERROR, message));
+                    } else {
+                        resolve(progress);
+                    }
+                });
+        });
+    }
+
+    /**
+     * The target keeps what it has received of an object. Returns the offset
+     * and CRC32 it reports if they are within the data that was being written
+     * and match it, or throws the error of the write otherwise.
+     */
+    _getResumePoint(data, offset, crc32, writeError) {
+        return this._controlPointService.calculateChecksum()
+            .catch(() => {
+                throw writeError;
+            })
+            .then(response => {
+                const written = response.offset - offset;
+                if (written < 0 || written > data.length) {
+                    throw writeError;
+                }
+                const expectedCrc32 = written > 0 ? crc.crc32(Buffer.from(data.slice(0, written)), crc32) : crc32;
+                if (response.crc32 !== expectedCrc32) {
+                    throw createError(ErrorCode.INVALID_CRC, `Error when resuming at offset ` +
+                        `${response.offset}. Got CRC ${response.crc32}, but expected ${expectedCrc32}.`);
+                }
+                return { offset: response.offset, crc32: response.crc32 };
+            });
+    }
+
     _writePackets(packetWriter, packets, objectType) {
         return packets.reduce((prevPromise, packet) => {
             return prevPromise.then(() => this._writePacket(packetWriter, packet, objectType));
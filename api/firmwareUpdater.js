@@ -39,6 +39,7 @@
 const os = require('os');
 const fs = require('fs');
 const FirmwareRegistry = require('./firmwareRegistry');
+const ProbeCache = require('./util/probeCache');
 
 /**
  * Converts from family ID (used by pc-nrfjprog-js) to family string.
@@ -231,6 +232,8 @@ class FirmwareUpdater {
                 const firmwareString = FirmwareUpdater.getFirmwareString(deviceInfo.family, os.platform());
                 const INPUT_FORMAT_HEX_STRING = 1;
                 return this._program(serialNumber, firmwareString, { inputFormat: INPUT_FORMAT_HEX_STRING })
+                    // The version read when the device was last opened is not the version of the new firmware
+                    .then(() => ProbeCache.shared.invalidate(serialNumber))
                     .then(() => deviceInfo);
             })
             .then(deviceInfo => this._createVersionInfo(serialNumber, deviceInfo.family, os.platform()))
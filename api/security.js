@@ -36,6 +36,8 @@
 
 'use strict';
 
+const DEFAULT_KEY_PAIR_POOL_SIZE = 1;
+
 /**
  * Class that provides security functionality through the pc-ble-driver-js AddOn.
  */
@@ -49,6 +51,7 @@ class Security {
     constructor(bleDriver) {
         this._bleDriver = bleDriver;
         this._bleDriver.eccInit();
+        this._bleDriver.eccSetKeypairPoolSize(DEFAULT_KEY_PAIR_POOL_SIZE);
     }
 
     /**
@@ -80,6 +83,60 @@ class Security {
     generateSharedSecret(privateKey, publicKey) {
         return this._bleDriver.eccComputeSharedSecret(privateKey, publicKey);
     }
+
+    /**
+     * Method that takes a public/private key pair from the pool of key pairs generated in the background.
+     * The key pair is generated in the calling thread if the pool is empty.
+     *
+     * @returns {Object} The public private key pair.
+     */
+    takeKeyPair() {
+        return this._bleDriver.eccTakeKeypair();
+    }
+
+    /**
+     * Method that sets how many key pairs are generated ahead of time in the background.
+     * The pool is shared by all adapters in the process.
+     *
+     * @param {number} size The number of key pairs to keep available, 0 stops generating them.
+     * @returns {void}
+     */
+    setKeyPairPoolSize(size) {
+        this._bleDriver.eccSetKeypairPoolSize(size);
+    }
+
+    /**
+     * Method that generates a public/private key pair in a worker thread.
+     *
+     * @param {function(Error, Object)} callback Callback signature: (err, keyPair) => {}.
+     * @returns {void}
+     */
+    generateKeyPairAsync(callback) {
+        this._bleDriver.eccGenerateKeypairAsync(callback);
+    }
+
+    /**
+     * Method that generates a public key in a worker thread.
+     *
+     * @param {Array} privateKey The private key that should be used to generate the public key.
+     * @param {function(Error, Object)} callback Callback signature: (err, { pk }) => {}.
+     * @returns {void}
+     */
+    generatePublicKeyAsync(privateKey, callback) {
+        this._bleDriver.eccComputePublicKeyAsync(privateKey, callback);
+    }
+
+    /**
+     * Method that generates a shared secret in a worker thread.
+     *
+     * @param {Array} privateKey The private key that should be used to generate the shared secret.
+     * @param {Array} publicKey The public key that should be used to generate the shared secret.
+     * @param {function(Error, Object)} callback Callback signature: (err, { ss }) => {}.
+     * @returns {void}
+     */
+    generateSharedSecretAsync(privateKey, publicKey, callback) {
+        this._bleDriver.eccComputeSharedSecretAsync(privateKey, publicKey, callback);
+    }
 }
 
 module.exports = Security;
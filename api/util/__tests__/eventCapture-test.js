@@ -0,0 +1,96 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+'use strict';
+
+const eventCapture = require('../eventCapture');
+
+function header(segmentSize) {
+    const buffer = Buffer.alloc(16);
+    buffer.write('PBEC', 0);
+    buffer.writeUInt16LE(1, 4);
+    buffer.writeUInt16LE(5, 6);
+    buffer.writeUInt32LE(segmentSize, 8);
+    return buffer;
+}
+
+function record(adapterId, timestamp, event) {
+    const buffer = Buffer.alloc(12);
+    buffer.writeUInt16LE(event.length, 0);
+    buffer.writeUInt16LE(adapterId, 2);
+    buffer.writeUInt32LE(timestamp % 0x100000000, 4);
+    buffer.writeUInt32LE(Math.floor(timestamp / 0x100000000), 8);
+    return Buffer.concat([buffer, Buffer.from(event)]);
+}
+
+describe('eventCapture decode', () => {
+    it('should decode records', () => {
+        const buffer = Buffer.concat([header(1024 * 1024), record(1, 0x123456789A, [0x1D, 0x00, 0x08, 0x00]), record(2, 5, [0x50, 0x00])]);
+        const capture = eventCapture.decode(buffer);
+
+        expect(capture.apiVersion).toEqual(5);
+        expect(capture.records.length).toEqual(2);
+        expect(capture.records[0].adapterId).toEqual(1);
+        expect(capture.records[0].timestamp).toEqual(0x123456789A);
+        expect(capture.records[0].eventId).toEqual(0x1D);
+        expect(capture.records[0].event).toEqual(Buffer.from([0x1D, 0x00, 0x08, 0x00]));
+        expect(capture.records[1].eventId).toEqual(0x50);
+    });
+
+    it('should continue at the next segment after the zero end of a segment', () => {
+        const segmentSize = 64;
+        const first = Buffer.concat([header(segmentSize), record(1, 1, [0x10, 0x00, 0x01, 0x02])]);
+        const padding = Buffer.alloc(segmentSize - first.length);
+        const buffer = Buffer.concat([first, padding, record(1, 2, [0x11, 0x00])]);
+
+        expect(eventCapture.decode(buffer).records.map(r => r.timestamp)).toEqual([1, 2]);
+    });
+
+    it('should stop at the zero end of the last segment and at a truncated record', () => {
+        const complete = record(1, 1, [0x10, 0x00]);
+        const truncated = record(1, 2, [0x11, 0x00, 0x01, 0x02]).slice(0, 14);
+
+        expect(eventCapture.decode(Buffer.concat([header(1024 * 1024), complete, Buffer.alloc(40)])).records.length).toEqual(1);
+        expect(eventCapture.decode(Buffer.concat([header(1024 * 1024), complete, truncated])).records.length).toEqual(1);
+    });
+
+    it('should throw on other files and versions', () => {
+        expect(() => eventCapture.decode(Buffer.from('PBLG'))).toThrow();
+        const other = header(1024 * 1024);
+        other.writeUInt16LE(2, 4);
+        expect(() => eventCapture.decode(other)).toThrow();
+    });
+});
@@ -0,0 +1,129 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+const GattCache = require('../gattCache');
+
+const notifyProperties = GattCache.byteToProperties(0x12);
+
+const services = [
+    {
+        uuid: '1800',
+        startHandle: 1,
+        endHandle: 5,
+        characteristics: [
+            {
+                uuid: '2A00',
+                declarationHandle: 2,
+                valueHandle: 3,
+                properties: GattCache.byteToProperties(0x02),
+                descriptors: [],
+            },
+        ],
+    },
+    {
+        uuid: '6E400001B5A3F393E0A9E50E24DCCA9E',
+        startHandle: 6,
+        endHandle: 0xFFFF,
+        characteristics: [
+            {
+                uuid: '6E400003B5A3F393E0A9E50E24DCCA9E',
+                declarationHandle: 7,
+                valueHandle: 8,
+                properties: notifyProperties,
+                descriptors: [{ uuid: '2902', handle: 9 }, { uuid: null, handle: 10 }],
+            },
+        ],
+    },
+];
+
+describe('gattCache encode and decode', () => {
+    it('should restore the encoded services', () => {
+        const cache = GattCache.decode(GattCache.encode(services));
+        expect(cache.services).toEqual(services);
+        expect(cache.databaseHash).toBeNull();
+    });
+
+    it('should restore the database hash', () => {
+        const hash = [0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10];
+        const cache = GattCache.decode(GattCache.encode(services, hash));
+        expect(cache.databaseHash).toEqual(hash);
+        expect(cache.services).toEqual(services);
+    });
+
+    it('should store uuids little endian', () => {
+        const buffer = GattCache.encode([{ uuid: '180F', startHandle: 1, endHandle: 2, characteristics: [] }]);
+        expect(buffer).toEqual(Buffer.from([0x47, 0x41, 0x54, 0x43, 0x01, 0x00, 0x01, 0x00,
+            0x01, 0x00, 0x02, 0x00, 0x02, 0x0F, 0x18, 0x00, 0x00]));
+    });
+
+    it('should throw if the buffer is not a GATT cache', () => {
+        expect(() => GattCache.decode(Buffer.from('foobar'))).toThrow();
+    });
+
+    it('should throw if the version is not supported', () => {
+        const buffer = GattCache.encode(services);
+        buffer[4] = 0x7F;
+        expect(() => GattCache.decode(buffer)).toThrow();
+    });
+
+    it('should throw if the buffer is truncated', () => {
+        const buffer = GattCache.encode(services);
+        expect(() => GattCache.decode(buffer.slice(0, buffer.length - 1))).toThrow();
+    });
+});
+
+describe('gattCache properties conversion', () => {
+    it('should convert properties to the declaration byte', () => {
+        expect(GattCache.propertiesToByte({ read: true, notify: true, write: false })).toEqual(0x12);
+    });
+
+    it('should convert the declaration byte to properties', () => {
+        expect(notifyProperties).toEqual({
+            broadcast: false,
+            read: true,
+            write_wo_resp: false,
+            write: false,
+            notify: true,
+            indicate: false,
+            auth_signed_wr: false,
+        });
+    });
+});
+
+describe('gattCache file path', () => {
+    it('should name the file after the address', () => {
+        expect(GattCache.filePath('/tmp', 'E1:02:03:04:05:F6')).toEqual(require('path').join('/tmp', 'E102030405F6.gattcache'));
+    });
+});
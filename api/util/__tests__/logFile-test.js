@@ -0,0 +1,88 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+'use strict';
+
+const logFile = require('../logFile');
+const logLevel = require('../logLevel');
+
+function record(timestamp, severity, message) {
+    const header = Buffer.alloc(11);
+    header.writeUInt32LE(timestamp % 0x100000000, 0);
+    header.writeUInt32LE(Math.floor(timestamp / 0x100000000), 4);
+    header.writeUInt8(severity, 8);
+    header.writeUInt16LE(Buffer.byteLength(message), 9);
+    return Buffer.concat([header, Buffer.from(message)]);
+}
+
+const HEADER = Buffer.from([0x50, 0x42, 0x4C, 0x47, 0x01]);
+
+describe('logFile decode', () => {
+    it('should decode records', () => {
+        const buffer = Buffer.concat([HEADER, record(0x123456789A, logLevel.DEBUG, 'first'), record(5, logLevel.ERROR, '')]);
+
+        expect(logFile.decode(buffer)).toEqual([
+            { timestamp: 0x123456789A, severity: logLevel.DEBUG, message: 'first' },
+            { timestamp: 5, severity: logLevel.ERROR, message: '' },
+        ]);
+    });
+
+    it('should skip a truncated last record', () => {
+        const complete = record(1, logLevel.INFO, 'complete');
+        const truncated = record(2, logLevel.INFO, 'truncated').slice(0, 14);
+
+        expect(logFile.decode(Buffer.concat([HEADER, complete, truncated]))).toEqual([
+            { timestamp: 1, severity: logLevel.INFO, message: 'complete' },
+        ]);
+    });
+
+    it('should throw on other files and versions', () => {
+        expect(() => logFile.decode(Buffer.from('GATC'))).toThrow();
+        expect(() => logFile.decode(Buffer.from([0x50, 0x42, 0x4C, 0x47, 0x02]))).toThrow();
+    });
+});
+
+describe('logLevel fromString', () => {
+    it('should map option names to levels', () => {
+        expect(logLevel.fromString('trace')).toEqual(logLevel.TRACE);
+        expect(logLevel.fromString('warning')).toEqual(logLevel.WARNING);
+        expect(logLevel.fromString('fatal')).toEqual(logLevel.FATAL);
+    });
+
+    it('should treat unknown names as debug', () => {
+        expect(logLevel.fromString('verbose')).toEqual(logLevel.DEBUG);
+    });
+});
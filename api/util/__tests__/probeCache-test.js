@@ -0,0 +1,98 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+const ProbeCache = require('../probeCache');
+
+const state = {
+    firmwareVersion: { version_number: 8, company_id: 89, subversion_number: 140 },
+    name: 'nRF5x',
+    address: 'E1:02:03:04:05:F6',
+};
+
+describe('probeCache', () => {
+    let cache;
+
+    beforeEach(() => {
+        cache = new ProbeCache();
+    });
+
+    it('should return the state probed with the same configuration', () => {
+        const fingerprint = ProbeCache.fingerprint({ gap_enable_params: { periph_conn_count: 1 } });
+        cache.set('680123456', fingerprint, state);
+
+        expect(cache.get('680123456', ProbeCache.fingerprint({ gap_enable_params: { periph_conn_count: 1 } }))).toEqual(state);
+        expect(cache.get('680654321', fingerprint)).toBeUndefined();
+    });
+
+    it('should not return the state probed with another configuration', () => {
+        cache.set('680123456', ProbeCache.fingerprint({ gap_enable_params: { periph_conn_count: 1 } }), state);
+
+        expect(cache.get('680123456', ProbeCache.fingerprint({ gap_enable_params: { periph_conn_count: 2 } }))).toBeUndefined();
+    });
+
+    it('should remove invalidated devices', () => {
+        const fingerprint = ProbeCache.fingerprint();
+        cache.set('680123456', fingerprint, state);
+
+        expect(cache.invalidate('680123456')).toBe(true);
+        expect(cache.invalidate('680123456')).toBe(false);
+        expect(cache.get('680123456', fingerprint)).toBeUndefined();
+        expect(cache.size).toEqual(0);
+    });
+
+    it('should find a serial number with and without leading zeros', () => {
+        const fingerprint = ProbeCache.fingerprint();
+        cache.set('000680123456', fingerprint, state);
+
+        expect(cache.get(680123456, fingerprint)).toEqual(state);
+        expect(cache.invalidate(680123456)).toBe(true);
+    });
+
+    it('should decode what it encodes', () => {
+        const fingerprint = ProbeCache.fingerprint();
+        cache.set('680123456', fingerprint, state);
+
+        const decoded = new ProbeCache();
+        decoded.decode(cache.encode());
+
+        expect(decoded.get('680123456', fingerprint)).toEqual(state);
+    });
+
+    it('should throw if the buffer is not a probe cache', () => {
+        expect(() => cache.decode(Buffer.from('{"version":0,"entries":[]}'))).toThrow();
+        expect(() => cache.decode(Buffer.from('null'))).toThrow();
+    });
+});
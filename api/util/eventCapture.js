@@ -0,0 +1,108 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+'use strict';
+
+// Raw event capture written by the eventCaptureFile option of Adapter.open, all numbers little endian:
+//
+// header: 'PBEC', version (2 bytes), SoftDevice API version (2 bytes), segment size (4 bytes), reserved (4 bytes)
+// record: event length (2 bytes), adapter id (2 bytes), timestamp (8 bytes, monotonic microseconds), event
+//
+// The event is the ble_evt_t as received from the SoftDevice, starting with its header: event id (2 bytes) and
+// event length (2 bytes). Records do not cross segment boundaries, an event length of 0, or too few bytes
+// left for a record header, means the next record starts at the next segment. The peer key of a LESC DHKey request
+// (64 bytes), which the event only points to, follows the ble_evt_t and is included in the event length.
+//
+// A file may end with zeros up to the end of a segment if the process was stopped while capturing.
+
+const MAGIC = 'PBEC';
+const VERSION = 1;
+const HEADER_LENGTH = 16;
+const RECORD_HEADER_LENGTH = 12;
+
+/**
+ * Decodes an event capture file.
+ *
+ * @param {Buffer} buffer The content of the capture file.
+ * @returns {Object} `{ apiVersion, records: [{ adapterId, timestamp, eventId, event }] }`, timestamp is a
+ *                   Number of microseconds and event a Buffer that shares memory with buffer.
+ * @throws {Error} If the buffer is not an event capture of this version.
+ */
+function decode(buffer) {
+    if (buffer.length < HEADER_LENGTH || buffer.slice(0, MAGIC.length).toString() !== MAGIC) {
+        throw new Error('Not an event capture');
+    }
+
+    const version = buffer.readUInt16LE(4);
+    if (version !== VERSION) {
+        throw new Error(`Event capture version ${version} is not supported`);
+    }
+
+    const apiVersion = buffer.readUInt16LE(6);
+    const segmentSize = buffer.readUInt32LE(8);
+    const records = [];
+    let offset = HEADER_LENGTH;
+
+    while (offset + RECORD_HEADER_LENGTH <= buffer.length) {
+        const segmentEnd = (Math.floor(offset / segmentSize) + 1) * segmentSize;
+        const length = buffer.readUInt16LE(offset);
+
+        if (length === 0 || offset + RECORD_HEADER_LENGTH > segmentEnd) {
+            offset = segmentEnd;
+            continue;
+        }
+
+        const start = offset + RECORD_HEADER_LENGTH;
+
+        if (start + length > buffer.length) {
+            break;
+        }
+
+        records.push({
+            adapterId: buffer.readUInt16LE(offset + 2),
+            timestamp: buffer.readUInt32LE(offset + 4) + (buffer.readUInt32LE(offset + 8) * 0x100000000),
+            eventId: length >= 2 ? buffer.readUInt16LE(start) : undefined,
+            event: buffer.slice(start, start + length),
+        });
+        offset = start + length;
+    }
+
+    return { apiVersion, records };
+}
+
+module.exports = {
+    decode,
+};
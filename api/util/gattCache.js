@@ -0,0 +1,265 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+'use strict';
+
+const path = require('path');
+
+// Binary form of a discovered GATT database, all numbers little endian:
+//
+// header:         'GATC', version (1 byte), database hash length (1 byte), database hash, service count (2 bytes)
+// service:        start handle (2), end handle (2), uuid, characteristic count (2)
+// characteristic: declaration handle (2), value handle (2), properties (1), uuid, descriptor count (2)
+// descriptor:     handle (2), uuid
+// uuid:           length (1 byte, 0, 2 or 16), uuid bytes. Length 0 is an unknown uuid.
+
+const MAGIC = 'GATC';
+const VERSION = 1;
+const FILE_EXTENSION = '.gattcache';
+
+// Characteristic properties, in the order of the characteristic declaration
+const PROPERTIES = ['broadcast', 'read', 'write_wo_resp', 'write', 'notify', 'indicate', 'auth_signed_wr'];
+
+function propertiesToByte(properties) {
+    return PROPERTIES.reduce((byte, name, bit) => (properties && properties[name] ? byte | (1 << bit) : byte), 0);
+}
+
+function byteToProperties(byte) {
+    const properties = {};
+    PROPERTIES.forEach((name, bit) => { properties[name] = (byte & (1 << bit)) !== 0; });
+    return properties;
+}
+
+class Writer {
+    constructor() {
+        this.bytes = [];
+    }
+
+    uint8(value) {
+        this.bytes.push(value & 0xFF);
+    }
+
+    uint16(value) {
+        this.bytes.push(value & 0xFF, (value >> 8) & 0xFF);
+    }
+
+    array(values) {
+        for (let value of values) {
+            this.bytes.push(value);
+        }
+    }
+
+    uuid(uuid) {
+        // The uuid strings are big endian hex, as from HexConv
+        if (typeof uuid !== 'string' || !/^([0-9A-Fa-f]{4}|[0-9A-Fa-f]{32})$/.test(uuid)) {
+            this.uint8(0);
+            return;
+        }
+
+        const bytes = Buffer.from(uuid, 'hex').reverse();
+        this.uint8(bytes.length);
+        this.array(bytes);
+    }
+
+    toBuffer() {
+        return Buffer.from(this.bytes);
+    }
+}
+
+class Reader {
+    constructor(buffer) {
+        this.buffer = buffer;
+        this.offset = 0;
+    }
+
+    check(length) {
+        if (this.offset + length > this.buffer.length) {
+            throw new Error('GATT cache is truncated');
+        }
+    }
+
+    uint8() {
+        this.check(1);
+        return this.buffer.readUInt8(this.offset++);
+    }
+
+    uint16() {
+        this.check(2);
+        const value = this.buffer.readUInt16LE(this.offset);
+        this.offset += 2;
+        return value;
+    }
+
+    array(length) {
+        this.check(length);
+        const value = Array.from(this.buffer.slice(this.offset, this.offset + length));
+        this.offset += length;
+        return value;
+    }
+
+    uuid() {
+        const length = this.uint8();
+
+        if (length === 0) {
+            return null;
+        }
+
+        if (length !== 2 && length !== 16) {
+            throw new Error(`GATT cache has an invalid uuid length ${length}`);
+        }
+
+        this.check(length);
+        const bytes = Buffer.from(this.buffer.slice(this.offset, this.offset + length)).reverse();
+        this.offset += length;
+        return bytes.toString('hex').toUpperCase();
+    }
+}
+
+/**
+ * Encodes a GATT database.
+ *
+ * @param {Object[]} services The services, each `{ uuid, startHandle, endHandle, characteristics }`, with characteristics
+ *                            `{ uuid, declarationHandle, valueHandle, properties, descriptors }` and descriptors `{ uuid, handle }`.
+ * @param {array} [databaseHash] Value of the Database Hash characteristic, if the server has one.
+ * @returns {Buffer} The encoded database.
+ */
+function encode(services, databaseHash) {
+    const writer = new Writer();
+    const hash = databaseHash || [];
+
+    writer.array(Buffer.from(MAGIC));
+    writer.uint8(VERSION);
+    writer.uint8(hash.length);
+    writer.array(hash);
+    writer.uint16(services.length);
+
+    for (let service of services) {
+        writer.uint16(service.startHandle);
+        writer.uint16(service.endHandle);
+        writer.uuid(service.uuid);
+        writer.uint16(service.characteristics.length);
+
+        for (let characteristic of service.characteristics) {
+            writer.uint16(characteristic.declarationHandle);
+            writer.uint16(characteristic.valueHandle);
+            writer.uint8(propertiesToByte(characteristic.properties));
+            writer.uuid(characteristic.uuid);
+            writer.uint16(characteristic.descriptors.length);
+
+            for (let descriptor of characteristic.descriptors) {
+                writer.uint16(descriptor.handle);
+                writer.uuid(descriptor.uuid);
+            }
+        }
+    }
+
+    return writer.toBuffer();
+}
+
+/**
+ * Decodes a GATT database encoded by `encode`.
+ *
+ * @param {Buffer} buffer The encoded database.
+ * @returns {Object} `{ services, databaseHash }`, databaseHash is null if the server has none.
+ * @throws {Error} If the buffer is not a GATT cache of this version or is truncated.
+ */
+function decode(buffer) {
+    const reader = new Reader(buffer);
+
+    if (buffer.length < MAGIC.length || buffer.slice(0, MAGIC.length).toString() !== MAGIC) {
+        throw new Error('Not a GATT cache');
+    }
+
+    reader.offset = MAGIC.length;
+
+    const version = reader.uint8();
+    if (version !== VERSION) {
+        throw new Error(`GATT cache version ${version} is not supported`);
+    }
+
+    const hashLength = reader.uint8();
+    const databaseHash = hashLength > 0 ? reader.array(hashLength) : null;
+    const services = [];
+
+    for (let serviceCount = reader.uint16(); serviceCount > 0; serviceCount--) {
+        const service = {
+            startHandle: reader.uint16(),
+            endHandle: reader.uint16(),
+            uuid: reader.uuid(),
+            characteristics: [],
+        };
+
+        for (let characteristicCount = reader.uint16(); characteristicCount > 0; characteristicCount--) {
+            const characteristic = {
+                declarationHandle: reader.uint16(),
+                valueHandle: reader.uint16(),
+                properties: byteToProperties(reader.uint8()),
+                uuid: reader.uuid(),
+                descriptors: [],
+            };
+
+            for (let descriptorCount = reader.uint16(); descriptorCount > 0; descriptorCount--) {
+                characteristic.descriptors.push({ handle: reader.uint16(), uuid: reader.uuid() });
+            }
+
+            service.characteristics.push(characteristic);
+        }
+
+        services.push(service);
+    }
+
+    return { services, databaseHash };
+}
+
+/**
+ * Path of the GATT cache file of a peer.
+ *
+ * @param {string} directory Directory of the cache files.
+ * @param {string} address Identity address of the peer.
+ * @returns {string} The path.
+ */
+function filePath(directory, address) {
+    return path.join(directory, address.replace(/:/g, '').toUpperCase() + FILE_EXTENSION);
+}
+
+module.exports = {
+    encode,
+    decode,
+    filePath,
+    propertiesToByte,
+    byteToProperties,
+};
@@ -0,0 +1,90 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+'use strict';
+
+// Binary driver log written by the logFile option of Adapter.open, all numbers little endian:
+//
+// header: 'PBLG', version (1 byte)
+// record: timestamp (8 bytes, monotonic microseconds), severity (1 byte), message length (2 bytes), message
+//
+// A file may end with a truncated record if the process was stopped while writing it.
+
+const MAGIC = 'PBLG';
+const VERSION = 1;
+const HEADER_LENGTH = MAGIC.length + 1;
+const RECORD_HEADER_LENGTH = 11;
+
+/**
+ * Decodes a driver log file.
+ *
+ * @param {Buffer} buffer The content of the log file.
+ * @returns {Array} `[{ timestamp, severity, message }]`, timestamp is a Number of microseconds.
+ * @throws {Error} If the buffer is not a driver log of this version.
+ */
+function decode(buffer) {
+    if (buffer.length < HEADER_LENGTH || buffer.slice(0, MAGIC.length).toString() !== MAGIC) {
+        throw new Error('Not a driver log');
+    }
+
+    const version = buffer.readUInt8(MAGIC.length);
+    if (version !== VERSION) {
+        throw new Error(`Driver log version ${version} is not supported`);
+    }
+
+    const records = [];
+    let offset = HEADER_LENGTH;
+
+    while (offset + RECORD_HEADER_LENGTH <= buffer.length) {
+        const timestamp = buffer.readUInt32LE(offset) + (buffer.readUInt32LE(offset + 4) * 0x100000000);
+        const severity = buffer.readUInt8(offset + 8);
+        const length = buffer.readUInt16LE(offset + 9);
+        const start = offset + RECORD_HEADER_LENGTH;
+
+        if (start + length > buffer.length) {
+            break;
+        }
+
+        records.push({ timestamp, severity, message: buffer.toString('utf8', start, start + length) });
+        offset = start + length;
+    }
+
+    return records;
+}
+
+module.exports = {
+    decode,
+};
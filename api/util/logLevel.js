@@ -42,3 +42,16 @@ module.exports.INFO = 2;
 module.exports.WARNING = 3;
 module.exports.ERROR = 4;
 module.exports.FATAL = 5;
+
+const NAMES = ['trace', 'debug', 'info', 'warning', 'error', 'fatal'];
+
+/**
+ * Level of a logLevel option string, unknown names are debug like in the native driver.
+ *
+ * @param {string} name One of 'trace', 'debug', 'info', 'warning', 'error' or 'fatal'.
+ * @returns {number} The level.
+ */
+module.exports.fromString = name => {
+    const level = NAMES.indexOf(name);
+    return level === -1 ? module.exports.DEBUG : level;
+};
@@ -0,0 +1,215 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+'use strict';
+
+const fs = require('fs');
+
+// What Adapter.open reads from a connectivity device after enabling BLE, by serial number. The values only
+// depend on the firmware and the enableBLEParams, an entry is used while the enableBLEParams are the same.
+// Stored as JSON: { version, entries: [[serialNumber, { fingerprint, firmwareVersion, name, address }]] }
+
+const VERSION = 1;
+
+// Serial numbers are strings with leading zeros from the serial port list and numbers from pc-nrfjprog-js
+function entryKey(serialNumber) {
+    return String(serialNumber).replace(/^0+/, '');
+}
+
+class ProbeCache {
+    constructor() {
+        this._entries = new Map();
+        this._file = null;
+        this._writing = false;
+        this._writePending = false;
+    }
+
+    /**
+     * Gets the fingerprint of a configuration, entries are only used with the configuration they were probed with.
+     *
+     * @param {Object} enableBLEParams The enableBLEParams option of Adapter.open.
+     * @returns {string} The fingerprint.
+     */
+    static fingerprint(enableBLEParams) {
+        return JSON.stringify(enableBLEParams || null);
+    }
+
+    /**
+     * Gets the probed state of a device.
+     *
+     * @param {string|number} serialNumber Serial number of the device.
+     * @param {string} fingerprint Fingerprint of the configuration the device is opened with.
+     * @returns {Object|undefined} `{ firmwareVersion, name, address }`, undefined if the device is not probed
+     *                             with this configuration.
+     */
+    get(serialNumber, fingerprint) {
+        const entry = this._entries.get(entryKey(serialNumber));
+
+        if (entry === undefined || entry.fingerprint !== fingerprint) {
+            return undefined;
+        }
+
+        return { firmwareVersion: entry.firmwareVersion, name: entry.name, address: entry.address };
+    }
+
+    /**
+     * Stores the probed state of a device, replacing the state probed with another configuration.
+     *
+     * @param {string|number} serialNumber Serial number of the device.
+     * @param {string} fingerprint Fingerprint of the configuration the device is opened with.
+     * @param {Object} state `{ firmwareVersion, name, address }`.
+     * @returns {void}
+     */
+    set(serialNumber, fingerprint, state) {
+        this._entries.set(entryKey(serialNumber), {
+            fingerprint,
+            firmwareVersion: state.firmwareVersion,
+            name: state.name,
+            address: state.address,
+        });
+        this._save();
+    }
+
+    /**
+     * Removes the probed state of a device, for instance when it is programmed with other firmware.
+     *
+     * @param {string|number} serialNumber Serial number of the device.
+     * @returns {boolean} True if the device was probed.
+     */
+    invalidate(serialNumber) {
+        const removed = this._entries.delete(entryKey(serialNumber));
+
+        if (removed) {
+            this._save();
+        }
+
+        return removed;
+    }
+
+    clear() {
+        this._entries.clear();
+        this._save();
+    }
+
+    get size() {
+        return this._entries.size;
+    }
+
+    encode() {
+        return Buffer.from(JSON.stringify({ version: VERSION, entries: Array.from(this._entries) }));
+    }
+
+    /**
+     * Replaces the entries with entries encoded by `encode`.
+     *
+     * @param {Buffer} buffer The encoded entries.
+     * @returns {void}
+     * @throws {Error} If the buffer is not a probe cache of this version.
+     */
+    decode(buffer) {
+        const content = JSON.parse(buffer.toString());
+
+        if (content === null || content.version !== VERSION || !Array.isArray(content.entries)) {
+            throw new Error('Not a probe cache');
+        }
+
+        this._entries = new Map(content.entries);
+    }
+
+    /**
+     * Reads the entries from a file and writes them to it when they change, so devices are probed only once
+     * across runs. A file that does not exist yet is created on the first change.
+     *
+     * @param {string} file The file, null stops writing the entries.
+     * @param {function(Error)} [callback] Callback signature: err => {}.
+     * @returns {void}
+     */
+    setFile(file, callback) {
+        this._file = file || null;
+
+        if (!this._file) {
+            if (callback) callback();
+            return;
+        }
+
+        fs.readFile(this._file, (err, buffer) => {
+            if (err && err.code !== 'ENOENT') {
+                if (callback) callback(err);
+                return;
+            }
+
+            try {
+                if (!err) this.decode(buffer);
+            } catch (error) {
+                if (callback) callback(error);
+                return;
+            }
+
+            if (callback) callback();
+        });
+    }
+
+    // Adapters opened at once change the entries at once. Only one write is made at a time, and the changes
+    // made during a write are written together when it is done, so the writes never overlap.
+    _save() {
+        if (!this._file) {
+            return;
+        }
+
+        if (this._writing) {
+            this._writePending = true;
+            return;
+        }
+
+        this._writing = true;
+        this._writePending = false;
+
+        // Not written entries are only probed again
+        fs.writeFile(this._file, this.encode(), () => {
+            this._writing = false;
+
+            if (this._writePending) {
+                this._save();
+            }
+        });
+    }
+}
+
+// Shared by all adapters, so the state probed by one Adapter instance is used by the next one of the device
+ProbeCache.shared = new ProbeCache();
+
+module.exports = ProbeCache;
@@ -10,6 +10,6 @@ add_compile_options(
 )
 
 add_compile_options(
-    -std=c++11
+    -std=c++14
     -Wlogical-op
 )
@@ -0,0 +1,152 @@
+
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+'use strict';
+
+/*
+ * Measures the cost of converting BLE driver events to JavaScript, without a serial port.
+ *
+ * Synthetic or recorded event streams are replayed through Adapter::appendEvent and
+ * Adapter::onRpcEvent with adapter.replayEvents(). For each stream it reports events per second,
+ * JavaScript heap allocated per event and the conversion time per event type from getStats().
+ *
+ * Usage: node --expose-gc scripts/benchmark-events.js [options] [stream files...]
+ *   --api <v2|v5>       SoftDevice API version of the addon to use, defaults to v5
+ *   --count <n>         Number of events in each synthetic stream, defaults to 100000
+ *   --valueFormat <f>   'array' or 'buffer', defaults to 'array'
+ *   --queueSize <n>     Event queue size used for the replay, defaults to 64
+ *
+ * Stream files are replay streams as described in src/driver_replay.h, or event captures written
+ * with the eventCaptureFile option of Adapter.open.
+ */
+
+const fs = require('fs');
+const path = require('path');
+
+const SYNTHETIC_TYPES = ['advReport', 'hvx', 'readRsp', 'authStatus'];
+
+function parseArguments(argv) {
+    const options = {
+        api: 'v5',
+        count: 100000,
+        valueFormat: 'array',
+        queueSize: 64,
+        files: [],
+    };
+
+    for (let i = 0; i < argv.length; i += 1) {
+        const arg = argv[i];
+
+        if (arg === '--api') {
+            options.api = argv[i += 1];
+        } else if (arg === '--count') {
+            options.count = parseInt(argv[i += 1], 10);
+        } else if (arg === '--valueFormat') {
+            options.valueFormat = argv[i += 1];
+        } else if (arg === '--queueSize') {
+            options.queueSize = parseInt(argv[i += 1], 10);
+        } else {
+            options.files.push(arg);
+        }
+    }
+
+    return options;
+}
+
+function collectGarbage() {
+    if (global.gc) {
+        global.gc();
+    }
+}
+
+function runStream(driver, name, stream, options) {
+    const adapter = new driver.Adapter();
+    let converted = 0;
+
+    const eventCallback = events => {
+        converted += events.length;
+    };
+
+    collectGarbage();
+    const heapBefore = process.memoryUsage().heapUsed;
+    const start = process.hrtime();
+
+    const replayed = adapter.replayEvents(stream, {
+        eventCallback,
+        eventQueueSize: options.queueSize,
+        valueFormat: options.valueFormat,
+    });
+
+    const elapsed = process.hrtime(start);
+    const heapAfter = process.memoryUsage().heapUsed;
+    const seconds = elapsed[0] + (elapsed[1] / 1e9);
+    const stats = adapter.getStats();
+
+    console.log(`${name}: ${replayed} events, ${converted} delivered`);
+    console.log(`  ${Math.round(replayed / seconds)} events/s`);
+
+    if (global.gc) {
+        console.log(`  ${Math.round((heapAfter - heapBefore) / replayed)} heap bytes/event (garbage collections during the run are not included)`);
+    } else {
+        console.log('  run with --expose-gc to measure heap bytes/event');
+    }
+
+    Object.keys(stats.eventConversionTime).forEach(id => {
+        const time = stats.eventConversionTime[id];
+        console.log(`  event id ${id}: ${time.count} conversions, p50 ${time.p50} us, p99 ${time.p99} us, max ${time.max} us`);
+    });
+
+    const callbackTime = stats.eventCallbackTime;
+    console.log(`  callback: ${callbackTime.count} batches, p50 ${callbackTime.p50} us, p99 ${callbackTime.p99} us`);
+}
+
+function main() {
+    const options = parseArguments(process.argv.slice(2));
+    // eslint-disable-next-line global-require, import/no-dynamic-require
+    const driver = require('bindings')(`pc-ble-driver-js-sd_api_${options.api}`);
+
+    if (options.files.length === 0) {
+        SYNTHETIC_TYPES.forEach(type => {
+            runStream(driver, type, driver.createSyntheticEvents(type, options.count), options);
+        });
+    } else {
+        options.files.forEach(file => {
+            runStream(driver, path.basename(file), fs.readFileSync(file), options);
+        });
+    }
+}
+
+main();
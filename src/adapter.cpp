@@ -37,12 +37,66 @@
 #include "adapter.h"
 #include "common.h"
 
-#include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <unordered_map>
 
-Nan::Persistent<v8::Function> Adapter::constructor;
+thread_local Nan::Persistent<v8::Function> Adapter::constructor;
+thread_local std::set<Adapter *> Adapter::environmentAdapters;
 
-std::vector<Adapter *> adapters;
+namespace {
+    // Adapters by adapter_t::internal. Looked up from the driver threads on every event, log and
+    // status callback, so lookups only take the read side of the lock.
+    class AdapterRegistry
+    {
+      public:
+        AdapterRegistry()
+        {
+            if (uv_rwlock_init(&lock) != 0)
+            {
+                std::cerr << "Not able to create the adapter registry lock! Terminating." << std::endl;
+                std::terminate();
+            }
+        }
+
+        ~AdapterRegistry()
+        {
+            uv_rwlock_destroy(&lock);
+        }
+
+        void add(void *internal, Adapter *adapter)
+        {
+            uv_rwlock_wrlock(&lock);
+            adapters[internal] = adapter;
+            uv_rwlock_wrunlock(&lock);
+        }
+
+        void remove(void *internal)
+        {
+            uv_rwlock_wrlock(&lock);
+            adapters.erase(internal);
+            uv_rwlock_wrunlock(&lock);
+        }
+
+        Adapter *find(void *internal)
+        {
+            uv_rwlock_rdlock(&lock);
+            auto it = adapters.find(internal);
+            auto adapter = it != adapters.end() ? it->second : nullptr;
+            uv_rwlock_rdunlock(&lock);
+            return adapter;
+        }
+
+      private:
+        std::unordered_map<void *, Adapter *> adapters;
+        uv_rwlock_t lock;
+    };
+
+    AdapterRegistry adapterRegistry;
+
+    // Adapters may be created from more than one NodeJS thread, see EventCapture for the use of the id
+    std::atomic<uint16_t> lastAdapterId(0);
+}
 
 NAN_MODULE_INIT(Adapter::Init)
 {
@@ -56,6 +110,21 @@ NAN_MODULE_INIT(Adapter::Init)
     initGattS(tpl);
 
     constructor.Reset(Nan::GetFunction(tpl).ToLocalChecked());
+
+#if NODE_MAJOR_VERSION >= 10
+    // Close the adapters a worker thread left open and release the function before its isolate is
+    // disposed. The driver threads of an open adapter would otherwise keep waking a loop that is gone.
+    node::AddEnvironmentCleanupHook(v8::Isolate::GetCurrent(), [](void *) {
+        const auto adapters = environmentAdapters;
+
+        for (auto adapter : adapters)
+        {
+            adapter->closeForEnvironmentCleanup();
+        }
+
+        constructor.Reset();
+    }, nullptr);
+#endif
     Nan::Set(target, Nan::New("Adapter").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
 }
 
@@ -66,20 +135,18 @@ Adapter *Adapter::getAdapter(adapter_t *adapter, Adapter *defaultAdapter)
         return defaultAdapter;
     }
 
-    for (auto value : adapters)
-    {
-        auto deviceAdapter = value->getInternalAdapter();
+    auto value = adapterRegistry.find(adapter->internal);
+    return value != nullptr ? value : defaultAdapter;
+}
 
-        if (deviceAdapter != nullptr)
-        {
-            if (value->getInternalAdapter()->internal == adapter->internal)
-            {
-                return value;
-            }
-        }
-    }
+void Adapter::registerAdapter(adapter_t *adapter, Adapter *value)
+{
+    adapterRegistry.add(adapter->internal, value);
+}
 
-    return defaultAdapter;
+void Adapter::unregisterAdapter(adapter_t *adapter)
+{
+    adapterRegistry.remove(adapter->internal);
 }
 
 adapter_t *Adapter::getInternalAdapter() const
@@ -87,6 +154,25 @@ adapter_t *Adapter::getInternalAdapter() const
     return adapter;
 }
 
+std::shared_ptr<Nan::Callback> Adapter::findHvxRoute(const ble_gattc_evt_t &event) const
+{
+    auto route = hvxRoutes.find(std::make_pair(event.conn_handle, event.params.hvx.handle));
+
+    if (route == hvxRoutes.end())
+    {
+        route = hvxRoutes.find(std::make_pair(event.conn_handle, static_cast<uint16_t>(BLE_GATT_HANDLE_INVALID)));
+    }
+
+    return route != hvxRoutes.end() ? route->second : nullptr;
+}
+
+void Adapter::removeHvxRoutes(const uint16_t connHandle)
+{
+    // The routes are ordered by connection handle first
+    hvxRoutes.erase(hvxRoutes.lower_bound(std::make_pair(connHandle, static_cast<uint16_t>(0))),
+                    hvxRoutes.upper_bound(std::make_pair(connHandle, static_cast<uint16_t>(UINT16_MAX))));
+}
+
 // This compilation unit will be linked several times. So
 // log_handler must not have external linkage. Otherwise, we get
 // problems like a v3 Adapter getting cast into a v2 Adapter.
@@ -130,31 +216,96 @@ namespace {
             std::terminate();
         }
     }
+
+    std::remove_pointer<uv_timer_cb>::type replay_handler;
+    void replay_handler(uv_timer_t *handle)
+    {
+        auto adapter = static_cast<Adapter *>(handle->data);
+
+        if (adapter != nullptr)
+        {
+            adapter->replayTimerCallback(handle);
+        }
+        else
+        {
+            std::cerr << "No AddOn adapter to process replay callback." << std::endl;
+            std::terminate();
+        }
+    }
+
+    std::remove_pointer<uv_timer_cb>::type event_batch_handler;
+    void event_batch_handler(uv_timer_t *handle)
+    {
+        auto adapter = static_cast<Adapter *>(handle->data);
+
+        if (adapter != nullptr)
+        {
+            adapter->eventBatchTimerCallback(handle);
+        }
+        else
+        {
+            std::cerr << "No AddOn adapter to process event batch callback." << std::endl;
+            std::terminate();
+        }
+    }
 }
 
-void Adapter::initEventHandling(std::unique_ptr<Nan::Callback> callback, uint32_t interval)
+void Adapter::initEventHandling(std::unique_ptr<Nan::Callback> callback, uint32_t interval,
+                                const uint32_t queueSize, const EventQueueOverflowPolicy overflowPolicy,
+                                const EventTimeFormat timeFormat, const ValueFormat valueFormat,
+                                const uint32_t batchSize, const uint32_t batchLatency,
+                                const uint32_t batchConnectionLimit)
 {
     eventInterval = interval;
     asyncEvent = std::make_unique<uv_async_t>();
 
+    // The driver is not started yet, so no events are produced or consumed while the queue is set up
+    eventQueueOverflowPolicy = overflowPolicy;
+    eventQueue.reset(queueSize);
+    // The events held back by the connection limit keep their slots, up to queueSize of them, see
+    // onRpcEvent. The pool has room for them too, so the pool only runs empty when the queue is full.
+    eventPool.reset(batchConnectionLimit != 0 ? 2 * queueSize : queueSize);
+    eventBatch.resize(queueSize);
+    eventBatchConnectionLimit = batchConnectionLimit;
+    eventDemux.reset(batchConnectionLimit);
+    eventDemuxBatch.reserve(queueSize);
+    advReportBatch.reserve(queueSize);
+    eventTimeFormat = timeFormat;
+    eventValueFormat = valueFormat;
+
+    // A batch can not hold more events than the queue
+    eventBatchSize = (batchSize == 0 || batchSize > queueSize) ? queueSize : batchSize;
+    eventBatchLatency = batchLatency;
+    eventBatchStart = 0;
+    eventBatchTimerActive = false;
+
     // Setup event related functionality
     eventCallback = std::move(callback);
     asyncEvent->data = static_cast<void *>(this);
 
-    if (uv_async_init(uv_default_loop(), asyncEvent.get(), event_handler) != 0)
+    if (uv_async_init(loop, asyncEvent.get(), event_handler) != 0)
     {
         std::cerr << "Not able to create a new async event handler." << std::endl;
         std::terminate();
     }
 
-    // Clear the statistics
-    eventCallbackCount = 0;
+    resetStatistics();
 
-    // Max number of events in queue before sending it to JavaScript
-    eventCallbackMaxCount = 0;
-    eventCallbackBatchEventCounter = 0;
-    eventCallbackBatchEventTotalCount = 0;
-    eventCallbackBatchNumber = 0;
+    if (eventBatchLatency != 0)
+    {
+        if (eventBatchTimer == nullptr)
+        {
+            eventBatchTimer = std::make_unique<uv_timer_t>();
+        }
+
+        eventBatchTimer->data = static_cast<void *>(this);
+
+        if (uv_timer_init(loop, eventBatchTimer.get()) != 0)
+        {
+            std::cerr << "Not able to create a new event batch timer." << std::endl;
+            std::terminate();
+        }
+    }
 
     if (eventInterval == 0)
     {
@@ -169,7 +320,7 @@ void Adapter::initEventHandling(std::unique_ptr<Nan::Callback> callback, uint32_
     // Setup event interval functionality
     eventIntervalTimer->data = static_cast<void *>(this);
 
-    if (uv_timer_init(uv_default_loop(), eventIntervalTimer.get()) != 0)
+    if (uv_timer_init(loop, eventIntervalTimer.get()) != 0)
     {
         std::cerr << "Not able to create a new async event interval timer." << std::endl;
         std::terminate();
@@ -182,6 +333,92 @@ void Adapter::initEventHandling(std::unique_ptr<Nan::Callback> callback, uint32_
     }
 }
 
+// The latency budget of the oldest queued event is used, runs in the NodeJS thread
+void Adapter::eventBatchTimerCallback(uv_timer_t *handle)
+{
+    eventBatchTimerActive = false;
+    onRpcEvent(nullptr);
+}
+
+// Returns true if the queued events shall wait for more events before they are sent to JavaScript,
+// and makes sure the batch timer is running. Runs in the NodeJS thread.
+bool Adapter::deferEventBatch()
+{
+    if (eventBatchLatency == 0 || eventBatchTimer == nullptr)
+    {
+        return false;
+    }
+
+    const auto pending = eventQueue.size();
+
+    if (pending == 0)
+    {
+        return false;
+    }
+
+    if (pending >= eventBatchSize)
+    {
+        if (eventBatchTimerActive)
+        {
+            uv_timer_stop(eventBatchTimer.get());
+            eventBatchTimerActive = false;
+        }
+
+        eventBatchFullCount++;
+        return false;
+    }
+
+    if (eventBatchTimerActive)
+    {
+        return true;
+    }
+
+    const uint64_t budget = static_cast<uint64_t>(eventBatchLatency) * 1000;
+    const uint64_t start = eventBatchStart;
+    const auto now = getMonotonicTimeInMicroseconds();
+    const auto age = now > start ? now - start : 0;
+
+    if (age >= budget)
+    {
+        eventBatchLatencyCount++;
+        return false;
+    }
+
+    // Round up, libuv timers have millisecond resolution
+    const auto remaining = (budget - age + 999) / 1000;
+
+    if (uv_timer_start(eventBatchTimer.get(), event_batch_handler, remaining, 0) != 0)
+    {
+        std::cerr << "Not able to start the event batch timer." << std::endl;
+        return false;
+    }
+
+    eventBatchTimerActive = true;
+    return true;
+}
+
+void Adapter::startTimedReplay(std::unique_ptr<TimedReplay> replay)
+{
+    timedReplay = std::move(replay);
+    timedReplay->timer = std::make_unique<uv_timer_t>();
+    timedReplay->timer->data = static_cast<void *>(this);
+
+    if (uv_timer_init(loop, timedReplay->timer.get()) != 0)
+    {
+        std::cerr << "Not able to create a new replay timer." << std::endl;
+        std::terminate();
+    }
+
+    timedReplay->start = uv_hrtime() / 1000;
+    scheduleTimedReplay(0);
+}
+
+// delay is in milliseconds
+void Adapter::scheduleTimedReplay(const uint64_t delay)
+{
+    uv_timer_start(timedReplay->timer.get(), replay_handler, delay, 0);
+}
+
 // This compilation unit will be linked several times. So
 // log_handler must not have external linkage. Otherwise, we get
 // problems like a v3 Adapter getting cast into a v2 Adapter.
@@ -211,14 +448,21 @@ namespace {
     }
 }
 
-void Adapter::initLogHandling(std::unique_ptr<Nan::Callback> callback)
+void Adapter::initLogHandling(std::unique_ptr<Nan::Callback> callback, const bool batch,
+                              const uint32_t burstLimit, const uint32_t burstInterval)
 {
+    // The driver is not running, entries left from an earlier session are given back to the pool
+    logQueue.reset(LOG_QUEUE_SIZE);
+    logPool.reset(LOG_QUEUE_SIZE);
+    logBatch = batch;
+    logRateLimiter.configure(burstLimit, burstInterval);
+
     // Setup event related functionality
     asyncLog = std::make_unique<uv_async_t>();
     logCallback = std::move(callback);
     asyncLog->data = static_cast<void *>(this);
 
-    if (uv_async_init(uv_default_loop(), asyncLog.get(), log_handler) != 0)
+    if (uv_async_init(loop, asyncLog.get(), log_handler) != 0)
     {
         std::cerr << "Not able to create a new event log handler." << std::endl;
         std::terminate();
@@ -261,7 +505,7 @@ void Adapter::initStatusHandling(std::unique_ptr<Nan::Callback> callback)
     statusCallback = std::move(callback);
     asyncStatus->data = static_cast<void *>(this);
 
-    if (uv_async_init(uv_default_loop(), asyncStatus.get(), status_handler) != 0)
+    if (uv_async_init(loop, asyncStatus.get(), status_handler) != 0)
     {
         std::cerr << "Not able to create a new status handler." << std::endl;
         std::terminate();
@@ -307,10 +551,18 @@ void Adapter::cleanUpV8Resources()
         close_uv_handle(std::move(eventIntervalTimer));
     }
 
+    if (eventBatchTimer != nullptr)
+    {
+        uv_timer_stop(eventBatchTimer.get());
+        close_uv_handle(std::move(eventBatchTimer));
+        eventBatchTimerActive = false;
+    }
+
     if (asyncEvent != nullptr)
     {
         close_uv_handle(std::move(asyncEvent));
         this->eventCallback.reset();
+        hvxRoutes.clear();
     }
 
     if (asyncLog != nullptr)
@@ -319,6 +571,28 @@ void Adapter::cleanUpV8Resources()
         this->logCallback.reset();
     }
 
+    // Write the messages still queued before the file is closed
+    LogEntry *logEntries[LOG_QUEUE_SIZE];
+    const auto logEntryCount = logQueue.pop_n(logEntries, LOG_QUEUE_SIZE);
+    writeLogFile(logEntries, logEntryCount);
+
+    for (size_t i = 0; i < logEntryCount; ++i)
+    {
+        logPool.release(logEntries[i]);
+    }
+
+    logFileOpen = false;
+    logFileSink.close();
+
+    eventCapture.close();
+
+    if (timedReplay != nullptr)
+    {
+        uv_timer_stop(timedReplay->timer.get());
+        close_uv_handle(std::move(timedReplay->timer));
+        timedReplay.reset();
+    }
+
     uv_mutex_unlock(&adapterCloseMutex);
 }
 
@@ -337,6 +611,13 @@ void Adapter::initGeneric(v8::Local<v8::FunctionTemplate> tpl)
     Nan::SetPrototypeMethod(tpl, "getBleOption", GetBleOption);
 
     Nan::SetPrototypeMethod(tpl, "getStats", GetStats);
+    Nan::SetPrototypeMethod(tpl, "resetStats", ResetStats);
+    Nan::SetPrototypeMethod(tpl, "setLogLevel", SetLogLevel);
+    Nan::SetPrototypeMethod(tpl, "setEventCapture", SetEventCapture);
+    Nan::SetPrototypeMethod(tpl, "setEventSubscription", SetEventSubscription);
+    Nan::SetPrototypeMethod(tpl, "setHvxRoute", SetHvxRoute);
+    Nan::SetPrototypeMethod(tpl, "getConnectionStats", GetConnectionStats);
+    Nan::SetPrototypeMethod(tpl, "replayEvents", ReplayEvents);
 
 #if NRF_SD_BLE_API_VERSION >= 5
     Nan::SetPrototypeMethod(tpl, "setBleConfig", SetBleConfig);
@@ -357,6 +638,12 @@ void Adapter::initGap(v8::Local<v8::FunctionTemplate> tpl)
     Nan::SetPrototypeMethod(tpl, "gapGetRSSI", GapGetRSSI);
     Nan::SetPrototypeMethod(tpl, "gapStartScan", GapStartScan);
     Nan::SetPrototypeMethod(tpl, "gapStopScan", GapStopScan);
+    Nan::SetPrototypeMethod(tpl, "gapSetScanFilter", GapSetScanFilter);
+    Nan::SetPrototypeMethod(tpl, "setAutoReplyPolicy", SetAutoReplyPolicy);
+    Nan::SetPrototypeMethod(tpl, "setBondStore", SetBondStore);
+    Nan::SetPrototypeMethod(tpl, "getBonds", GetBonds);
+    Nan::SetPrototypeMethod(tpl, "deleteBond", DeleteBond);
+    Nan::SetPrototypeMethod(tpl, "clearBonds", ClearBonds);
     Nan::SetPrototypeMethod(tpl, "gapConnect", GapConnect);
     Nan::SetPrototypeMethod(tpl, "gapCancelConnect", GapCancelConnect);
     Nan::SetPrototypeMethod(tpl, "gapStartAdvertising", GapStartAdvertising);
@@ -393,6 +680,11 @@ void Adapter::initGattC(v8::Local<v8::FunctionTemplate> tpl)
     Nan::SetPrototypeMethod(tpl, "gattcRead", GattcRead);
     Nan::SetPrototypeMethod(tpl, "gattcReadCharacteristicValues", GattcReadCharacteristicValues);
     Nan::SetPrototypeMethod(tpl, "gattcWrite", GattcWrite);
+    Nan::SetPrototypeMethod(tpl, "gattcWriteStream", GattcWriteStream);
+    Nan::SetPrototypeMethod(tpl, "gattcWriteDfuObject", GattcWriteDfuObject);
+    Nan::SetPrototypeMethod(tpl, "gattcDiscoverDatabase", GattcDiscoverDatabase);
+    Nan::SetPrototypeMethod(tpl, "gattcReadLong", GattcReadLong);
+    Nan::SetPrototypeMethod(tpl, "gattcWriteLong", GattcWriteLong);
     Nan::SetPrototypeMethod(tpl, "gattcConfirmHandleValue", GattcConfirmHandleValue);
 #if NRF_SD_BLE_API_VERSION >= 5
     Nan::SetPrototypeMethod(tpl, "gattcExchangeMtuRequest", GattcExchangeMtuRequest);
@@ -405,6 +697,7 @@ void Adapter::initGattS(v8::Local<v8::FunctionTemplate> tpl)
     Nan::SetPrototypeMethod(tpl, "gattsAddCharacteristic", GattsAddCharacteristic);
     Nan::SetPrototypeMethod(tpl, "gattsAddDescriptor", GattsAddDescriptor);
     Nan::SetPrototypeMethod(tpl, "gattsHVX", GattsHVX);
+    Nan::SetPrototypeMethod(tpl, "gattsHVXStream", GattsHVXStream);
     Nan::SetPrototypeMethod(tpl, "gattsSystemAttributeSet", GattsSystemAttributeSet);
     Nan::SetPrototypeMethod(tpl, "gattsSetValue", GattsSetValue);
     Nan::SetPrototypeMethod(tpl, "gattsGetValue", GattsGetValue);
@@ -414,14 +707,41 @@ void Adapter::initGattS(v8::Local<v8::FunctionTemplate> tpl)
 #endif
 }
 
-Adapter::Adapter()
+Adapter::Adapter() :
+    loop(Nan::GetCurrentEventLoop()),
+    commandQueue(loop),
+    adapterId(++lastAdapterId)
 {
     adapter = nullptr;
-
-    eventCallbackMaxCount = 0;
-    eventCallbackBatchEventCounter = 0;
-    eventCallbackBatchEventTotalCount = 0;
-    eventCallbackBatchNumber = 0;
+    environmentAdapters.insert(this);
+
+    resetStatistics();
+
+    eventQueueOverflowPolicy = EVENT_QUEUE_OVERFLOW_DROP_NEWEST;
+    eventTimeFormat = EVENT_TIME_FORMAT_ISO_STRING;
+    eventValueFormat = VALUE_FORMAT_ARRAY;
+    eventSubscription.set();
+    eventInterval = 0;
+    eventBatchSize = 0;
+    eventBatchLatency = 0;
+    eventBatchStart = 0;
+    eventBatchTimerActive = false;
+    eventBatchConnectionLimit = 0;
+
+    advReportFilterEnabled = false;
+    advReportBatchEnabled = false;
+    writeStreamCount = 0;
+    gattcProcedureCount = 0;
+    linkActiveCount = 0;
+
+    // The SoftDevice driver filters by the log level given to open, see setLogLevel
+    logSeverityFilter = SD_RPC_LOG_TRACE;
+    logBatch = false;
+    logFileOpen = false;
+
+    logPool.reset(LOG_QUEUE_SIZE);
+    logQueue.reset(LOG_QUEUE_SIZE);
+    statusQueue.reset(STATUS_QUEUE_SIZE);
 
     if (uv_mutex_init(&adapterCloseMutex) != 0)
     {
@@ -429,18 +749,91 @@ Adapter::Adapter()
         std::terminate();
     }
 
-    adapters.push_back(this);
+    if (uv_mutex_init(&logQueueMutex) != 0)
+    {
+        std::cerr << "Not able to create logQueueMutex! Terminating." << std::endl;
+        std::terminate();
+    }
+
+    if (uv_mutex_init(&statusQueueMutex) != 0)
+    {
+        std::cerr << "Not able to create statusQueueMutex! Terminating." << std::endl;
+        std::terminate();
+    }
+
+    if (uv_mutex_init(&advReportFilterMutex) != 0)
+    {
+        std::cerr << "Not able to create advReportFilterMutex! Terminating." << std::endl;
+        std::terminate();
+    }
+
+    if (uv_mutex_init(&writeStreamsMutex) != 0)
+    {
+        std::cerr << "Not able to create writeStreamsMutex! Terminating." << std::endl;
+        std::terminate();
+    }
+
+    if (uv_mutex_init(&gattcProceduresMutex) != 0)
+    {
+        std::cerr << "Not able to create gattcProceduresMutex! Terminating." << std::endl;
+        std::terminate();
+    }
+
+    if (uv_mutex_init(&autoReplyMutex) != 0)
+    {
+        std::cerr << "Not able to create autoReplyMutex! Terminating." << std::endl;
+        std::terminate();
+    }
+
+    if (uv_mutex_init(&keysetMutex) != 0)
+    {
+        std::cerr << "Not able to create keysetMutex! Terminating." << std::endl;
+        std::terminate();
+    }
 }
 
 Adapter::~Adapter()
 {
-    // Remove this adapter from the global container of adapters
-    adapters.erase(std::find(adapters.begin(), adapters.end(), this));
+    // A running command may still use the mutexes and state below, wait for the command thread first
+    commandQueue.stop();
+
+    environmentAdapters.erase(this);
+
+    // Stop routing driver callbacks to this adapter
+    if (adapter != nullptr)
+    {
+        unregisterAdapter(adapter);
+    }
 
     // Remove callbacks and cleanup uv_handle_t instances
     cleanUpV8Resources();
 
     uv_mutex_destroy(&adapterCloseMutex);
+    uv_mutex_destroy(&logQueueMutex);
+    uv_mutex_destroy(&statusQueueMutex);
+    uv_mutex_destroy(&advReportFilterMutex);
+    uv_mutex_destroy(&writeStreamsMutex);
+    uv_mutex_destroy(&gattcProceduresMutex);
+    uv_mutex_destroy(&autoReplyMutex);
+    uv_mutex_destroy(&keysetMutex);
+}
+
+void Adapter::closeForEnvironmentCleanup()
+{
+    // Commands handed to the command thread run to completion first. Their after callbacks only
+    // release the batons here, the environment no longer calls into JavaScript.
+    commandQueue.stop();
+
+    if (adapter != nullptr)
+    {
+        sd_rpc_close(adapter);
+        unregisterAdapter(adapter);
+        sd_rpc_adapter_delete(adapter);
+        free(adapter);
+        adapter = nullptr;
+    }
+
+    cleanUpV8Resources();
 }
 
 NAN_METHOD(Adapter::New)
@@ -460,7 +853,7 @@ NAN_METHOD(Adapter::New)
 
 int32_t Adapter::getEventCallbackTotalTime() const
 {
-    return static_cast<int32_t>(eventCallbackDuration.count());
+    return static_cast<int32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(eventCallbackDuration).count());
 }
 
 uint32_t Adapter::getEventCallbackCount() const
@@ -495,9 +888,189 @@ double Adapter::getAverageCallbackBatchCount() const
     return averageCallbackBatchCount;
 }
 
-void Adapter::addEventBatchStatistics(std::chrono::milliseconds duration)
+uint32_t Adapter::getEventQueueSize() const
+{
+    return static_cast<uint32_t>(eventQueue.capacity());
+}
+
+uint32_t Adapter::getEventQueueDroppedNewestCount() const
+{
+    return eventQueueDroppedNewestCount;
+}
+
+uint32_t Adapter::getEventQueueDroppedOldestCount() const
+{
+    return eventQueueDroppedOldestCount;
+}
+
+uint32_t Adapter::getEventQueueCoalescedCount() const
+{
+    return eventQueueCoalescedCount;
+}
+
+uint32_t Adapter::getEventQueueBlockedCount() const
+{
+    return eventQueueBlockedCount;
+}
+
+uint32_t Adapter::getEventBatchFullCount() const
+{
+    return eventBatchFullCount;
+}
+
+uint32_t Adapter::getEventBatchLatencyCount() const
+{
+    return eventBatchLatencyCount;
+}
+
+uint32_t Adapter::getEventUnsubscribedCount() const
+{
+    return eventUnsubscribedCount;
+}
+
+uint32_t Adapter::getEventRoutedCount() const
+{
+    return eventRoutedCount;
+}
+
+uint32_t Adapter::getAdvReportFilteredCount() const
+{
+    return advReportFilteredCount;
+}
+
+uint32_t Adapter::getAdvReportDedupHitCount() const
+{
+    return advReportDedupHitCount;
+}
+
+uint32_t Adapter::getAdvReportDedupMissCount() const
+{
+    return advReportDedupMissCount;
+}
+
+void Adapter::setAdvReportFilter(std::unique_ptr<AdvReportFilter> filter, std::unique_ptr<AdvReportDedup> dedup, const bool batch)
+{
+    uv_mutex_lock(&advReportFilterMutex);
+    advReportFilterEnabled = (filter != nullptr || dedup != nullptr);
+    advReportFilter.swap(filter);
+    advReportDedup.swap(dedup);
+    uv_mutex_unlock(&advReportFilterMutex);
+
+    advReportBatchEnabled = batch;
+}
+
+void Adapter::setAutoReplyPolicy(std::shared_ptr<const AutoReplyPolicy> policy)
+{
+    uv_mutex_lock(&autoReplyMutex);
+    autoReplyPolicy.swap(policy);
+    uv_mutex_unlock(&autoReplyMutex);
+}
+
+void Adapter::setBondStore(std::shared_ptr<BondStore> store)
+{
+    uv_mutex_lock(&autoReplyMutex);
+    bondStore.swap(store);
+    uv_mutex_unlock(&autoReplyMutex);
+}
+
+std::shared_ptr<BondStore> Adapter::getBondStore()
+{
+    uv_mutex_lock(&autoReplyMutex);
+    auto store = bondStore;
+    uv_mutex_unlock(&autoReplyMutex);
+    return store;
+}
+
+uint32_t Adapter::getEventQueueHighWaterMark() const
+{
+    return eventQueueHighWaterMark;
+}
+
+uint32_t Adapter::getLogQueueHighWaterMark() const
+{
+    return logQueueHighWaterMark;
+}
+
+uint32_t Adapter::getLogSuppressedCount() const
+{
+    return logSuppressedCount;
+}
+
+uint32_t Adapter::getLogDroppedCount() const
+{
+    return logDroppedCount;
+}
+
+uint32_t Adapter::getEventCaptureCount() const
+{
+    return eventCapture.getRecordCount();
+}
+
+uint32_t Adapter::getEventCaptureDroppedCount() const
+{
+    return eventCapture.getDroppedCount();
+}
+
+uint32_t Adapter::getStatusQueueHighWaterMark() const
+{
+    return statusQueueHighWaterMark;
+}
+
+const LatencyHistogram &Adapter::getEventLatencyHistogram() const
+{
+    return eventLatencyHistogram;
+}
+
+const std::map<uint16_t, LatencyHistogram> &Adapter::getEventConversionHistograms() const
+{
+    return eventConversionHistograms;
+}
+
+const LatencyHistogram &Adapter::getEventCallbackHistogram() const
+{
+    return eventCallbackHistogram;
+}
+
+void Adapter::resetStatistics()
+{
+    eventCallbackDuration = std::chrono::microseconds::zero();
+    eventCallbackCount = 0;
+
+    // Max number of events in queue before sending it to JavaScript
+    eventCallbackMaxCount = 0;
+    eventCallbackBatchEventCounter = 0;
+    eventCallbackBatchEventTotalCount = 0;
+    eventCallbackBatchNumber = 0;
+
+    eventQueueDroppedNewestCount = 0;
+    eventQueueDroppedOldestCount = 0;
+    eventQueueCoalescedCount = 0;
+    eventQueueBlockedCount = 0;
+    eventBatchFullCount = 0;
+    eventBatchLatencyCount = 0;
+    eventUnsubscribedCount = 0;
+    eventRoutedCount = 0;
+    advReportFilteredCount = 0;
+    advReportDedupHitCount = 0;
+    advReportDedupMissCount = 0;
+
+    eventQueueHighWaterMark = 0;
+    logQueueHighWaterMark = 0;
+    statusQueueHighWaterMark = 0;
+
+    logSuppressedCount = 0;
+    logDroppedCount = 0;
+
+    eventLatencyHistogram.reset();
+    eventConversionHistograms.clear();
+    eventCallbackHistogram.reset();
+    connectionStats.reset();
+}
+
+void Adapter::addEventBatchStatistics(std::chrono::microseconds duration)
 {
     eventCallbackDuration += duration;
+    eventCallbackHistogram.record(static_cast<uint64_t>(duration.count()));
 
     eventCallbackBatchEventTotalCount += eventCallbackBatchEventCounter;
     eventCallbackBatchEventCounter = 0;
@@ -509,15 +1082,19 @@ void Adapter::createSecurityKeyStorage(const uint16_t connHandle, ble_gap_sec_ke
     ble_gap_sec_keyset_t *set = new ble_gap_sec_keyset_t();
     std::memcpy(set, keyset, sizeof(ble_gap_sec_keyset_t));
 
+    uv_mutex_lock(&keysetMutex);
     keysetMap.insert(std::pair<uint16_t, ble_gap_sec_keyset_t *>(connHandle, set));
+    uv_mutex_unlock(&keysetMutex);
 }
 
 void Adapter::destroySecurityKeyStorage(const uint16_t connHandle)
 {
+    uv_mutex_lock(&keysetMutex);
     auto keys = keysetMap.find(connHandle);
 
     if (keys == keysetMap.end())
     {
+        uv_mutex_unlock(&keysetMutex);
         return;
     }
 
@@ -566,17 +1143,16 @@ void Adapter::destroySecurityKeyStorage(const uint16_t connHandle)
     delete keyset;
 
     keysetMap.erase(connHandle);
+    uv_mutex_unlock(&keysetMutex);
 }
 
 ble_gap_sec_keyset_t *Adapter::getSecurityKey(const uint16_t connHandle)
 {
+    uv_mutex_lock(&keysetMutex);
     auto keyset = keysetMap.find(connHandle);
+    auto result = keyset != keysetMap.end() ? keyset->second : nullptr;
+    uv_mutex_unlock(&keysetMutex);
 
-    if (keyset == keysetMap.end())
-    {
-        return 0;
-    }
-
-    return keyset->second;
+    return result;
 
 }
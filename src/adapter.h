@@ -38,18 +38,56 @@
 #define ADAPTER_H
 
 #include <nan.h>
+#include <atomic>
 #include <chrono>
+#include <cstring>
 #include <map>
 #include <memory>
+#include <set>
+#include <thread>
+#include <vector>
 
 #include "sd_rpc.h"
 
-#include "circular_fifo_unsafe.h"
+#include "adv_report.h"
+#include "auto_reply.h"
+#include "bond_store.h"
+#include "command_queue.h"
+#include "gattc_procedure.h"
+#include "common.h"
+#include "connection_stats.h"
+#include "driver_replay.h"
+#include "event_capture.h"
+#include "event_demux.h"
+#include "event_dispatch.h"
+#include "latency_histogram.h"
+#include "log_pipeline.h"
+#include "slot_pool.h"
+#include "spsc_queue.h"
+#include "write_stream.h"
 
 const auto EVENT_QUEUE_SIZE = 64;
+// The event queue and its slots are allocated when the adapter is opened and do not grow, as the
+// SoftDevice driver thread pushes events without a lock
+const auto EVENT_QUEUE_MAX_SIZE = 16384;
 const auto LOG_QUEUE_SIZE = 64;
 const auto STATUS_QUEUE_SIZE = 64;
 
+// Size of a decoded event including an unknown quantity of padding, use the same size as serialization_transport.cpp
+const auto EVENT_ENTRY_SIZE = 512;
+
+// Time a warm ConnReset waits for the data link to the rebooted connectivity device, in milliseconds
+const auto CONN_RESET_LINK_TIMEOUT = 5000;
+
+// What to do with an incoming event when the event queue is full
+enum EventQueueOverflowPolicy
+{
+    EVENT_QUEUE_OVERFLOW_BLOCK,                 // Wait in the driver thread until there is room in the queue
+    EVENT_QUEUE_OVERFLOW_DROP_OLDEST,           // Discard the oldest queued event
+    EVENT_QUEUE_OVERFLOW_DROP_NEWEST,           // Discard the incoming event
+    EVENT_QUEUE_OVERFLOW_COALESCE_ADV_REPORTS   // Replace a queued advertising report with the incoming one, wait for room for other events
+};
+
 #define ADAPTER_METHOD_DEFINITIONS(MainName) \
     static NAN_METHOD(MainName); \
     static void MainName(uv_work_t *req); \
@@ -86,15 +124,72 @@ struct LogEntry
 {
 public:
     sd_rpc_log_severity_t severity;
-    std::string message;
+    uint64_t timestamp; // Taken with getMonotonicTimeInMicroseconds() when the message is received
+    size_t length;
+    char message[LOG_ENTRY_MESSAGE_SIZE]; // Not terminated
+    bool toJs;   // Admitted by the rate limiter, passed on to logCallback
+    bool toFile; // Written to logFileSink by the NodeJS thread
+};
+
+// States of an EventEntry in the event queue, see EventEntry::overwrite
+enum EventEntryState : uint8_t
+{
+    EVENT_ENTRY_QUEUED,      // In the event queue, may be overwritten by the producer
+    EVENT_ENTRY_OVERWRITING, // Being overwritten by the producer in the SoftDevice driver thread
+    EVENT_ENTRY_TAKEN        // Popped by the NodeJS thread, only read from now on
 };
 
 struct EventEntry
 {
 public:
-    ble_evt_t *event;
-    std::string timestamp;
+    EventEntry() : event(reinterpret_cast<ble_evt_t *>(data)), timestamp(0), adapterID(0), autoReplied(false), state(EVENT_ENTRY_QUEUED) {}
+    EventEntry(const EventEntry &) = delete;
+    EventEntry &operator=(const EventEntry &) = delete;
+
+    // Called by the producer before the entry is pushed to the event queue
+    void queued()
+    {
+        state.store(EVENT_ENTRY_QUEUED, std::memory_order_relaxed);
+    }
+
+    // Called by the producer to replace the event of an entry that is still in the event queue.
+    // Returns false if the consumer has popped the entry, it is then left as it is.
+    bool overwrite(const ble_evt_t *newEvent, const uint64_t newTimestamp)
+    {
+        auto expected = EVENT_ENTRY_QUEUED;
+
+        if (!state.compare_exchange_strong(expected, EVENT_ENTRY_OVERWRITING, std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        memcpy(data, newEvent, EVENT_ENTRY_SIZE);
+        timestamp = newTimestamp;
+        state.store(EVENT_ENTRY_QUEUED, std::memory_order_release);
+        return true;
+    }
+
+    // Called by the consumer after popping the entry, before reading it. Waits for an overwrite in progress.
+    void take()
+    {
+        auto expected = EVENT_ENTRY_QUEUED;
+
+        while (!state.compare_exchange_weak(expected, EVENT_ENTRY_TAKEN, std::memory_order_acq_rel))
+        {
+            expected = EVENT_ENTRY_QUEUED;
+            std::this_thread::yield();
+        }
+    }
+
+    ble_evt_t *event; // Points into data
+    uint64_t timestamp; // Taken with getMonotonicTimeInMicroseconds() when the event is received
     int adapterID;
+    bool autoReplied; // The request was replied to by the auto reply policy
+
+    alignas(ble_evt_t) uint8_t data[EVENT_ENTRY_SIZE];
+
+private:
+    std::atomic<EventEntryState> state;
 };
 
 struct StatusEntry
@@ -102,15 +197,17 @@ struct StatusEntry
 public:
     sd_rpc_app_status_t id;
     std::string message;
-    std::string timestamp;
+    uint64_t timestamp;
 };
 
-//using namespace memory_relaxed_aquire_release;
-using namespace memory_sequential_unsafe;
+typedef SpscQueue<EventEntry *> EventQueue;
+typedef SlotPool<EventEntry> EventPool;
+typedef SpscQueue<LogEntry *> LogQueue;
+typedef SlotPool<LogEntry> LogPool;
+typedef SpscQueue<StatusEntry *> StatusQueue;
 
-typedef CircularFifo<EventEntry *, EVENT_QUEUE_SIZE> EventQueue;
-typedef CircularFifo<LogEntry *, LOG_QUEUE_SIZE> LogQueue;
-typedef CircularFifo<StatusEntry *, STATUS_QUEUE_SIZE> StatusQueue;
+struct GattcDiscoverDatabaseBaton;
+struct GattcLongBaton;
 
 class Adapter : public Nan::ObjectWrap
 {
@@ -119,16 +216,42 @@ public:
 
     static Adapter *getAdapter(adapter_t *adapter, Adapter *defaultAdapter = nullptr);
 
+    // Route the driver callbacks of adapter to value, must be done before sd_rpc_open
+    static void registerAdapter(adapter_t *adapter, Adapter *value);
+    static void unregisterAdapter(adapter_t *adapter);
+
     adapter_t *getInternalAdapter() const;
 
-    void initEventHandling(std::unique_ptr<Nan::Callback> callback, const uint32_t interval);
+    void initEventHandling(std::unique_ptr<Nan::Callback> callback, const uint32_t interval,
+                           const uint32_t queueSize, const EventQueueOverflowPolicy overflowPolicy,
+                           const EventTimeFormat timeFormat, const ValueFormat valueFormat,
+                           const uint32_t batchSize, const uint32_t batchLatency,
+                           const uint32_t batchConnectionLimit);
     void appendEvent(ble_evt_t *event);
+    // Stores the event in a queue slot and wakes the NodeJS thread, the tail of appendEvent
+    void pushEvent(const ble_evt_t *event, const uint64_t timestamp, const bool autoReplied);
 
     void onRpcEvent(uv_async_t *handle);
     void eventIntervalCallback(uv_timer_t *handle);
-
-    void initLogHandling(std::unique_ptr<Nan::Callback> callback);
-    void appendLog(LogEntry *log);
+    void eventBatchTimerCallback(uv_timer_t *handle);
+    void replayTimerCallback(uv_timer_t *handle);
+    // Replays one event of a replay stream or event capture, see ReplayEvents
+    void replayEvent(const uint8_t *event, const size_t length);
+    void startTimedReplay(std::unique_ptr<TimedReplay> replay);
+    void scheduleTimedReplay(const uint64_t delay);
+
+    void initLogHandling(std::unique_ptr<Nan::Callback> callback, const bool batch,
+                         const uint32_t burstLimit, const uint32_t burstInterval);
+    // Returns false if messages of the severity are filtered out, called before a message is copied
+    bool acceptsLog(const sd_rpc_log_severity_t severity) const;
+    void setLogSeverityFilter(const sd_rpc_log_severity_t severity);
+    void appendLog(const sd_rpc_log_severity_t severity, const char *message);
+    // Writes driver log messages to a binary file as well, see LogFileSink. An empty path closes
+    // the file. Throws std::string if the file can not be opened.
+    void setLogFile(const std::string &path);
+    // Appends the raw events to a capture file as well, see EventCapture. An empty path closes the
+    // file. Throws std::string if the file can not be opened.
+    void setEventCapture(const std::string &path, const size_t segmentSize);
 
     void onLogEvent(uv_async_t *handle);
 
@@ -137,8 +260,49 @@ public:
 
     void onStatusEvent(uv_async_t *handle);
 
+    // Waits in a command thread until the data link is active more than activations times, see linkActiveCount
+    bool waitForLinkActive(const uint32_t activations, const uint32_t timeout) const;
+    // Ends the procedures, write streams and auto reply state of the connections that are gone with a
+    // reset of the connectivity device. resetConnections runs in the command thread,
+    // resetConnectionEvents in the NodeJS thread.
+    void resetConnections();
+    void resetConnectionEvents();
+
     void cleanUpV8Resources();
 
+    // Replaces the scan report filter and de-duplication, nullptr removes them. Called from the NodeJS thread.
+    void setAdvReportFilter(std::unique_ptr<AdvReportFilter> filter, std::unique_ptr<AdvReportDedup> dedup, const bool batch);
+
+    // Replaces the auto reply policy, nullptr removes it. Called from the NodeJS thread.
+    void setAutoReplyPolicy(std::shared_ptr<const AutoReplyPolicy> policy);
+    // Replaces the bond store, nullptr removes it. Called from the NodeJS thread.
+    void setBondStore(std::shared_ptr<BondStore> store);
+    std::shared_ptr<BondStore> getBondStore();
+
+    // Makes a GATT client request with request(), which returns the result of the SoftDevice call.
+    // The request time of the connection statistics is taken just before the call, and cleared
+    // again if the call fails. Called from the command thread.
+    template <typename Request>
+    uint32_t makeGattcRequest(const uint16_t connHandle, Request request)
+    {
+        const auto requestTime = getMonotonicTimeInMicroseconds();
+        connectionStats.onGattcRequest(connHandle, requestTime);
+
+        const auto result = request();
+
+        if (result != NRF_SUCCESS)
+        {
+            connectionStats.onGattcRequestFailed(connHandle, requestTime);
+        }
+
+        return result;
+    }
+
+    // Calls the callback of a database discovery that is done. Called from the NodeJS thread.
+    static void finishDatabaseDiscovery(GattcDiscoverDatabaseBaton *baton);
+    // Calls the callback of a long read or write that is done. Called from the NodeJS thread.
+    static void finishLongOperation(GattcLongBaton *baton);
+
     // Statistics:
     int32_t getEventCallbackTotalTime() const;
     uint32_t getEventCallbackCount() const;
@@ -148,13 +312,48 @@ public:
 
     double getAverageCallbackBatchCount() const;
 
-    void addEventBatchStatistics(std::chrono::milliseconds duration);
+    uint32_t getEventQueueSize() const;
+    uint32_t getEventQueueDroppedNewestCount() const;
+    uint32_t getEventQueueDroppedOldestCount() const;
+    uint32_t getEventQueueCoalescedCount() const;
+    uint32_t getEventQueueBlockedCount() const;
+    uint32_t getEventBatchFullCount() const;
+    uint32_t getEventBatchLatencyCount() const;
+    uint32_t getEventUnsubscribedCount() const;
+    uint32_t getEventRoutedCount() const;
+    uint32_t getAdvReportFilteredCount() const;
+    uint32_t getAdvReportDedupHitCount() const;
+    uint32_t getAdvReportDedupMissCount() const;
+
+    uint32_t getEventQueueHighWaterMark() const;
+    uint32_t getLogQueueHighWaterMark() const;
+    uint32_t getLogSuppressedCount() const;
+    uint32_t getLogDroppedCount() const;
+    uint32_t getEventCaptureCount() const;
+    uint32_t getEventCaptureDroppedCount() const;
+    uint32_t getStatusQueueHighWaterMark() const;
+
+    const LatencyHistogram &getEventLatencyHistogram() const;
+    const std::map<uint16_t, LatencyHistogram> &getEventConversionHistograms() const;
+    const LatencyHistogram &getEventCallbackHistogram() const;
+
+    void addEventBatchStatistics(std::chrono::microseconds duration);
+
+    // Clears all statistics. Called from the NodeJS thread.
+    void resetStatistics();
 
 private:
     explicit Adapter();
     ~Adapter();
 
-    static Nan::Persistent<v8::Function> constructor;
+    // One per NodeJS thread loading the addon, a function can not be shared between isolates
+    static thread_local Nan::Persistent<v8::Function> constructor;
+
+    // The adapters created in this NodeJS thread, closed when its environment is cleaned up
+    static thread_local std::set<Adapter *> environmentAdapters;
+
+    // Closes the adapter without calling back, when the NodeJS thread that owns it exits
+    void closeForEnvironmentCleanup();
 
     static NAN_METHOD(New);
 
@@ -177,6 +376,21 @@ private:
 
     // General sync methods
     static NAN_METHOD(GetStats);
+    static NAN_METHOD(ResetStats);
+    static NAN_METHOD(SetLogLevel);
+    static NAN_METHOD(GetConnectionStats);
+    static NAN_METHOD(ReplayEvents);
+    static NAN_METHOD(SetEventCapture);
+    static NAN_METHOD(SetEventSubscription);
+    static NAN_METHOD(SetHvxRoute);
+
+    // Gap sync methods
+    static NAN_METHOD(GapSetScanFilter);
+    static NAN_METHOD(SetAutoReplyPolicy);
+    static NAN_METHOD(SetBondStore);
+    static NAN_METHOD(GetBonds);
+    static NAN_METHOD(DeleteBond);
+    static NAN_METHOD(ClearBonds);
 
     // Gap async mehtods
     ADAPTER_METHOD_DEFINITIONS(GapSetAddress);
@@ -226,6 +440,11 @@ private:
     ADAPTER_METHOD_DEFINITIONS(GattcRead);
     ADAPTER_METHOD_DEFINITIONS(GattcReadCharacteristicValues);
     ADAPTER_METHOD_DEFINITIONS(GattcWrite);
+    ADAPTER_METHOD_DEFINITIONS(GattcWriteStream);
+    ADAPTER_METHOD_DEFINITIONS(GattcWriteDfuObject);
+    ADAPTER_METHOD_DEFINITIONS(GattcDiscoverDatabase);
+    ADAPTER_METHOD_DEFINITIONS(GattcReadLong);
+    ADAPTER_METHOD_DEFINITIONS(GattcWriteLong);
     ADAPTER_METHOD_DEFINITIONS(GattcConfirmHandleValue);
 #if NRF_SD_BLE_API_VERSION >= 5
     ADAPTER_METHOD_DEFINITIONS(GattcExchangeMtuRequest);
@@ -236,6 +455,7 @@ private:
     ADAPTER_METHOD_DEFINITIONS(GattsAddCharacteristic);
     ADAPTER_METHOD_DEFINITIONS(GattsAddDescriptor);
     ADAPTER_METHOD_DEFINITIONS(GattsHVX);
+    ADAPTER_METHOD_DEFINITIONS(GattsHVXStream);
     ADAPTER_METHOD_DEFINITIONS(GattsSystemAttributeSet);
     ADAPTER_METHOD_DEFINITIONS(GattsSetValue);
     ADAPTER_METHOD_DEFINITIONS(GattsGetValue);
@@ -250,6 +470,15 @@ private:
     static void initGattS(v8::Local<v8::FunctionTemplate> tpl);
 
     void dispatchEvents();
+    bool deferEventBatch();
+    // Returns nullptr if the HVX event goes to the event callback
+    std::shared_ptr<Nan::Callback> findHvxRoute(const ble_gattc_evt_t &event) const;
+    void removeHvxRoutes(const uint16_t connHandle);
+
+    EventEntry *acquireEventEntry(const ble_evt_t *event, const uint64_t timestamp);
+    EventEntry *waitForEventEntry();
+    bool coalesceAdvReport(const ble_evt_t *event, const uint64_t timestamp, const bool samePeer);
+    static void updateHighWaterMark(std::atomic<uint32_t> &mark, const size_t depth);
 
     static uint32_t enableBLE(adapter_t *adapter, enable_ble_params_t *enable_params);
 
@@ -257,13 +486,97 @@ private:
     void destroySecurityKeyStorage(const uint16_t connHandle);
     ble_gap_sec_keyset_t *getSecurityKey(const uint16_t connHandle);
 
+    bool isAdvReportAccepted(const ble_gap_evt_adv_report_t &report, const uint64_t timestamp);
+
+    // Registers a write stream of a connection, returns nullptr if the connection already has one of the type.
+    // receipts, if set, are given the control point notifications of a DFU object write.
+    std::shared_ptr<WriteStreamCredits> startWriteStream(const uint16_t connHandle, const WriteStreamType type,
+                                                        const std::shared_ptr<DfuReceipts> &receipts = nullptr);
+    void stopWriteStream(const uint16_t connHandle, const WriteStreamType type);
+    bool updateWriteStreams(const ble_evt_t *event);
+
+    // Registers a GATT client procedure of a connection, returns false if the connection already has one.
+    // asyncDone is sent from the SoftDevice driver thread when the procedure is done.
+    bool startGattcProcedure(GattcProcedure *procedure, uv_async_t *asyncDone);
+    void stopGattcProcedure(const uint16_t connHandle);
+    // Returns true if the event is a response to a GATT client procedure. Called from the SoftDevice driver thread.
+    bool updateGattcProcedures(const ble_evt_t *event);
+    // Replies to the event if it is a request covered by the auto reply policy. Returns true if the
+    // reply succeeded. Called from the SoftDevice driver thread.
+    bool autoReply(const ble_evt_t *event);
+    // Queues a log message for the NodeJS thread, returns false if the log queue is full. Called
+    // while holding logQueueMutex.
+    bool queueLog(const sd_rpc_log_severity_t severity, const uint64_t timestamp, const char *message, const size_t length,
+                  const bool toJs, const bool toFile);
+    // Writes the entries marked toFile to logFileSink. Called from the NodeJS thread.
+    void writeLogFile(LogEntry *const *logEntries, const size_t count);
+    // Records bonds and replies to security information requests from the bond store, and encrypts
+    // reconnections to bonded peers. Returns true if a request was replied to. Called from the
+    // SoftDevice driver thread.
+    bool updateBondStore(const ble_evt_t *event);
+    // Registers the procedure of a long read or write. Throws a JavaScript error and deletes the baton
+    // if the connection already has a GATT client procedure.
+    static bool startLongOperation(Adapter *obj, GattcLongBaton *baton);
+
     std::map<uint16_t, ble_gap_sec_keyset_t *> keysetMap;
 
     adapter_t *adapter;
+
+    // Loop of the NodeJS thread that created the adapter, the main thread or a worker thread.
+    // All handles of the adapter belong to it, so adapters in different workers run in parallel.
+    uv_loop_t *loop;
+
+    // Runs the work of the asynchronous methods in FIFO order, in a thread owned by this adapter
+    CommandQueue commandQueue;
+
+    // Preallocated storage for events in eventQueue. Slots are acquired in the
+    // SoftDevice driver thread and released in the NodeJS thread.
+    EventPool eventPool;
     EventQueue eventQueue;
+    EventQueueOverflowPolicy eventQueueOverflowPolicy;
+    EventTimeFormat eventTimeFormat;
+    ValueFormat eventValueFormat;
+    // Event ids JavaScript wants, other events are released in onRpcEvent without being converted.
+    // Ids from EVENT_DESCRIPTOR_COUNT and up are always passed on. Only used in the NodeJS thread.
+    EventSubscription eventSubscription;
+    // Preallocated storage for log messages in logQueue, acquired while holding logQueueMutex
+    // and released in the NodeJS thread
+    LogPool logPool;
     LogQueue logQueue;
     StatusQueue statusQueue;
 
+    // Driver log messages less severe than this are dropped before they are copied
+    std::atomic<int> logSeverityFilter;
+    // If set, logCallback is called once with an array of [severity, message] for all queued
+    // messages, instead of once for every message
+    bool logBatch;
+    // Used while holding logQueueMutex
+    LogRateLimiter logRateLimiter;
+    // Only used in the NodeJS thread, so file writes never block the SoftDevice driver thread.
+    // logFileOpen tells the driver thread to queue every message for the file.
+    LogFileSink logFileSink;
+    std::atomic<bool> logFileOpen;
+
+    // Entries popped from eventQueue in one pass of onRpcEvent, sized to the queue capacity
+    std::vector<EventEntry *> eventBatch;
+
+    // With a connection limit, the entries of eventBatch go through eventDemux, and the
+    // entries of each pass are taken from it to eventDemuxBatch
+    uint32_t eventBatchConnectionLimit;
+    EventDemux eventDemux;
+    std::vector<EventEntry *> eventDemuxBatch;
+
+    // Callbacks that GATTC HVX events are sent to instead of eventCallback, keyed by connection
+    // handle and attribute handle. BLE_GATT_HANDLE_INVALID as attribute handle takes the HVX
+    // events of the connection that have no route of their own. The routes of a connection
+    // are removed when it is disconnected. Only used in the NodeJS thread.
+    std::map<std::pair<uint16_t, uint16_t>, std::shared_ptr<Nan::Callback>> hvxRoutes;
+
+    // Log and status entries may be produced by more than one SoftDevice driver thread,
+    // the mutexes make sure there is only one producer for each queue at a time.
+    uv_mutex_t logQueueMutex;
+    uv_mutex_t statusQueueMutex;
+
     std::unique_ptr<Nan::Callback> eventCallback;
     std::unique_ptr<Nan::Callback> logCallback;
     std::unique_ptr<Nan::Callback> statusCallback;
@@ -273,14 +586,80 @@ private:
     std::unique_ptr<uv_timer_t> eventIntervalTimer;
     std::unique_ptr<uv_async_t> asyncEvent;
 
+    // Adaptive batching, used instead of eventInterval when eventBatchLatency is not 0. Events are sent
+    // to JavaScript when eventBatchSize events are queued, or when the oldest queued event has waited
+    // eventBatchLatency ms, whichever comes first.
+    uint32_t eventBatchSize;
+    uint32_t eventBatchLatency;
+    // Time the first event of the current batch was queued, see getMonotonicTimeInMicroseconds()
+    std::atomic<uint64_t> eventBatchStart;
+    // One shot timer for the latency budget, only started and stopped in the NodeJS thread
+    std::unique_ptr<uv_timer_t> eventBatchTimer;
+    bool eventBatchTimerActive;
+
     std::unique_ptr<uv_async_t> asyncLog;
     std::unique_ptr<uv_async_t> asyncStatus;
 
+    // Times the data link became active, counted in the SoftDevice driver thread. A warm ConnReset
+    // waits for it to change before enabling BLE on the rebooted connectivity device.
+    std::atomic<uint32_t> linkActiveCount;
+
     uv_mutex_t adapterCloseMutex;
 
+    // Raw events received from the SoftDevice, captured in appendEvent when a capture file is open.
+    // The id tells the adapters of the process apart in the records.
+    EventCapture eventCapture;
+    const uint16_t adapterId;
+
+    // A replay at the recorded speed in progress, see ReplayEvents. Only used in the NodeJS thread.
+    std::unique_ptr<TimedReplay> timedReplay;
+
+    // Scan reports are filtered in the SoftDevice driver thread before they take an event slot.
+    // The flag makes the common case of no filter lock free, the mutex guards replacing the filter
+    // and the de-duplication table.
+    std::unique_ptr<AdvReportFilter> advReportFilter;
+    std::unique_ptr<AdvReportDedup> advReportDedup;
+    std::atomic<bool> advReportFilterEnabled;
+    uv_mutex_t advReportFilterMutex;
+
+    // Accepted scan reports are collected into one batch event per pass of onRpcEvent when enabled.
+    // Only used in the NodeJS thread.
+    bool advReportBatchEnabled;
+    AdvReportBatch advReportBatch;
+
+    // TX credits of the active write streams by connection, see gattcWriteStream and gattsHVXStream.
+    // The count makes the common case of no stream lock free in the SoftDevice driver thread.
+    std::map<std::pair<uint16_t, WriteStreamType>, std::shared_ptr<WriteStreamCredits>> writeStreams;
+    // Packet receipts of the write streams that are DFU object writes, see gattcWriteDfuObject
+    std::map<uint16_t, std::shared_ptr<DfuReceipts>> dfuReceipts;
+    std::atomic<uint32_t> writeStreamCount;
+    uv_mutex_t writeStreamsMutex;
+
+    // Policy for replying to peer requests in the SoftDevice driver thread, see setAutoReplyPolicy.
+    // Security parameters are only replied to in the peripheral role, so the connections in that
+    // role are tracked. The bond store replies to security information requests, see setBondStore.
+    // The mutex guards all three.
+    std::shared_ptr<const AutoReplyPolicy> autoReplyPolicy;
+    std::set<uint16_t> peripheralConnections;
+    std::shared_ptr<BondStore> bondStore;
+    uv_mutex_t autoReplyMutex;
+
+    // Guards keysetMap, keysets are also stored by the auto reply in the SoftDevice driver thread
+    uv_mutex_t keysetMutex;
+
+    // Traffic by connection, see getConnectionStats
+    ConnectionStatsTable connectionStats;
+
+    // Active GATT client procedures by connection, with the handle that wakes the NodeJS thread when
+    // they are done. See gattcDiscoverDatabase, gattcReadLong and gattcWriteLong. Their responses are
+    // handled in the SoftDevice driver thread and not queued as events.
+    std::map<uint16_t, std::pair<GattcProcedure *, uv_async_t *>> gattcProcedures;
+    std::atomic<uint32_t> gattcProcedureCount;
+    uv_mutex_t gattcProceduresMutex;
+
     // Statistics:
     // Accumulated deltas for event callbacks done to the driver
-    std::chrono::milliseconds eventCallbackDuration;
+    std::chrono::microseconds eventCallbackDuration;
     uint32_t eventCallbackCount;
 
     // Max number of events in queue before sending it to JavaScript
@@ -288,5 +667,45 @@ private:
     uint32_t eventCallbackBatchEventCounter;
     uint32_t eventCallbackBatchEventTotalCount;
     uint32_t eventCallbackBatchNumber;
+
+    // Number of events handled by each overflow policy, updated in the driver thread
+    std::atomic<uint32_t> eventQueueDroppedNewestCount;
+    std::atomic<uint32_t> eventQueueDroppedOldestCount;
+    std::atomic<uint32_t> eventQueueCoalescedCount;
+    std::atomic<uint32_t> eventQueueBlockedCount;
+
+    // Deepest the queues have been since the statistics were reset, updated by the producers
+    std::atomic<uint32_t> eventQueueHighWaterMark;
+    std::atomic<uint32_t> logQueueHighWaterMark;
+    std::atomic<uint32_t> statusQueueHighWaterMark;
+
+    // Number of log messages suppressed by the rate limit, and dropped because the log queue was full
+    std::atomic<uint32_t> logSuppressedCount;
+    std::atomic<uint32_t> logDroppedCount;
+
+    // Durations in microseconds, only used in the NodeJS thread:
+    // from an event is received from the SoftDevice until it is converted in onRpcEvent
+    LatencyHistogram eventLatencyHistogram;
+    // converting an event to JavaScript, for each event id
+    std::map<uint16_t, LatencyHistogram> eventConversionHistograms;
+    // calling the JavaScript event callback with a batch of events
+    LatencyHistogram eventCallbackHistogram;
+
+    // Number of adaptive batches sent because they were full and because their latency budget was used
+    uint32_t eventBatchFullCount;
+    uint32_t eventBatchLatencyCount;
+
+    // Number of events released without conversion because they are not in eventSubscription
+    uint32_t eventUnsubscribedCount;
+
+    // Number of events sent to a callback in hvxRoutes
+    uint32_t eventRoutedCount;
+
+    // Number of scan reports rejected by advReportFilter
+    std::atomic<uint32_t> advReportFilteredCount;
+
+    // Number of scan reports suppressed (hit) and passed on (miss) by advReportDedup
+    std::atomic<uint32_t> advReportDedupHitCount;
+    std::atomic<uint32_t> advReportDedupMissCount;
 };
 #endif
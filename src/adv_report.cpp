@@ -0,0 +1,371 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "adv_report.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "common.h"
+
+AdvReportFilter::AdvReportFilter() : hasMinRssi(false), minRssi(0) {}
+
+void AdvReportFilter::addAddress(const ble_gap_addr_t &address, const bool matchType)
+{
+    Address entry;
+    std::copy(address.addr, address.addr + BLE_GAP_ADDR_LEN, entry.addr.begin());
+    entry.addrType = address.addr_type;
+    entry.matchType = matchType;
+    addresses.push_back(entry);
+}
+
+void AdvReportFilter::setMinRssi(const int8_t rssi)
+{
+    hasMinRssi = true;
+    minRssi = rssi;
+}
+
+void AdvReportFilter::addServiceUuid(const std::vector<uint8_t> &uuid)
+{
+    serviceUuids.push_back(uuid);
+}
+
+void AdvReportFilter::addManufacturerId(const uint16_t companyId)
+{
+    manufacturerIds.push_back(companyId);
+}
+
+void AdvReportFilter::setNamePrefix(const std::string &prefix)
+{
+    namePrefix = prefix;
+}
+
+bool AdvReportFilter::accepts(const ble_gap_evt_adv_report_t &report) const
+{
+    // Cheapest criteria first
+    if (hasMinRssi && report.rssi < minRssi)
+    {
+        return false;
+    }
+
+    if (!addresses.empty() && !matchesAddress(report.peer_addr))
+    {
+        return false;
+    }
+
+    return matchesData(report.data, report.dlen);
+}
+
+bool AdvReportFilter::matchesAddress(const ble_gap_addr_t &address) const
+{
+    return std::any_of(addresses.begin(), addresses.end(), [&address](const Address &entry) {
+        return (!entry.matchType || entry.addrType == address.addr_type) &&
+               memcmp(entry.addr.data(), address.addr, BLE_GAP_ADDR_LEN) == 0;
+    });
+}
+
+bool AdvReportFilter::matchesData(const uint8_t *data, const uint8_t dlen) const
+{
+    auto uuidFound = serviceUuids.empty();
+    auto manufacturerFound = manufacturerIds.empty();
+    auto nameFound = namePrefix.empty();
+
+    if (uuidFound && manufacturerFound && nameFound)
+    {
+        return true;
+    }
+
+    forEachAdStructure(data, dlen, [&](const uint8_t ad_type, const uint8_t *ad_data, const uint8_t ad_data_len) {
+        size_t uuidSize = 0;
+
+        switch (ad_type)
+        {
+            case BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_MORE_AVAILABLE:
+            case BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE:
+                uuidSize = 2;
+                break;
+            case BLE_GAP_AD_TYPE_32BIT_SERVICE_UUID_MORE_AVAILABLE:
+            case BLE_GAP_AD_TYPE_32BIT_SERVICE_UUID_COMPLETE:
+                uuidSize = 4;
+                break;
+            case BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_MORE_AVAILABLE:
+            case BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE:
+                uuidSize = 16;
+                break;
+            case BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA:
+                if (!manufacturerFound && ad_data_len >= 2)
+                {
+                    const auto companyId = uint16_decode(ad_data);
+                    manufacturerFound = std::find(manufacturerIds.begin(), manufacturerIds.end(), companyId) != manufacturerIds.end();
+                }
+                break;
+            case BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME:
+            case BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME:
+                if (!nameFound && ad_data_len >= namePrefix.size())
+                {
+                    nameFound = memcmp(ad_data, namePrefix.data(), namePrefix.size()) == 0;
+                }
+                break;
+            default:
+                break;
+        }
+
+        if (!uuidFound && uuidSize > 0)
+        {
+            for (size_t i = 0; i + uuidSize <= ad_data_len && !uuidFound; i += uuidSize)
+            {
+                uuidFound = std::any_of(serviceUuids.begin(), serviceUuids.end(), [&](const std::vector<uint8_t> &uuid) {
+                    return uuid.size() == uuidSize && memcmp(uuid.data(), ad_data + i, uuidSize) == 0;
+                });
+            }
+        }
+
+        // No need to look any further when all criteria are met
+        return uuidFound && manufacturerFound && nameFound;
+    });
+
+    return uuidFound && manufacturerFound && nameFound;
+}
+
+AdvReportDedup::AdvReportDedup(const size_t maxDevices) :
+    used(0),
+    maxUsed(std::max<size_t>(maxDevices, 1)),
+    payloadChange(false),
+    rssiDelta(0),
+    intervalUs(0)
+{
+    // Keep the load factor at or below one half so probe sequences stay short
+    size_t capacity = 2;
+
+    while (capacity < maxUsed * 2)
+    {
+        capacity *= 2;
+    }
+
+    entries.resize(capacity, Entry{0, 0, 0, 0, 0});
+}
+
+void AdvReportDedup::setPayloadChange(const bool enable)
+{
+    payloadChange = enable;
+}
+
+void AdvReportDedup::setRssiDelta(const uint8_t delta)
+{
+    rssiDelta = delta;
+}
+
+void AdvReportDedup::setInterval(const uint32_t intervalMs)
+{
+    intervalUs = static_cast<uint64_t>(intervalMs) * 1000;
+}
+
+bool AdvReportDedup::accepts(const ble_gap_evt_adv_report_t &report, const uint64_t timestamp)
+{
+    const auto key = makeKey(report);
+    const auto payloadHash = hashPayload(report.data, report.dlen);
+    auto *entry = &find(key);
+
+    if (entry->key == 0)
+    {
+        if (used == maxUsed)
+        {
+            // Evicting moves entries, the slot of the new device is looked up again
+            evict(key);
+            entry = &find(key);
+        }
+
+        *entry = Entry{key, timestamp, timestamp, payloadHash, report.rssi};
+        used++;
+        return true;
+    }
+
+    entry->lastSeen = timestamp;
+
+    auto changed = !payloadChange && rssiDelta == 0;
+
+    if (payloadChange && entry->payloadHash != payloadHash)
+    {
+        changed = true;
+    }
+
+    if (rssiDelta != 0 && std::abs(report.rssi - entry->rssi) >= rssiDelta)
+    {
+        changed = true;
+    }
+
+    if (!changed || (intervalUs != 0 && timestamp - entry->lastTimestamp < intervalUs))
+    {
+        return false;
+    }
+
+    entry->lastTimestamp = timestamp;
+    entry->payloadHash = payloadHash;
+    entry->rssi = report.rssi;
+    return true;
+}
+
+uint64_t AdvReportDedup::makeKey(const ble_gap_evt_adv_report_t &report)
+{
+    uint64_t key = 0;
+
+    for (auto i = 0; i < BLE_GAP_ADDR_LEN; i++)
+    {
+        key |= static_cast<uint64_t>(report.peer_addr.addr[i]) << (i * 8);
+    }
+
+    key |= static_cast<uint64_t>(report.peer_addr.addr_type & 0x7F) << 48;
+    key |= static_cast<uint64_t>(report.scan_rsp ? 1 : 0) << 55;
+
+    // Never 0, as 0 marks an unused entry
+    return key | (static_cast<uint64_t>(1) << 63);
+}
+
+// 32 bit FNV-1a
+uint32_t AdvReportDedup::hashPayload(const uint8_t *data, const uint8_t dlen)
+{
+    uint32_t hash = 2166136261u;
+
+    for (uint8_t i = 0; i < dlen; i++)
+    {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+size_t AdvReportDedup::home(const uint64_t key) const
+{
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & (entries.size() - 1);
+}
+
+AdvReportDedup::Entry &AdvReportDedup::find(const uint64_t key)
+{
+    const auto mask = entries.size() - 1;
+    auto index = home(key);
+
+    while (entries[index].key != 0 && entries[index].key != key)
+    {
+        index = (index + 1) & mask;
+    }
+
+    return entries[index];
+}
+
+void AdvReportDedup::evict(const uint64_t key)
+{
+    const auto mask = entries.size() - 1;
+    auto victim = entries.size();
+    auto index = home(key);
+
+    // The table is at most half full, so the window nearly always holds a few entries to
+    // choose from. The scan goes on past it until an entry is found.
+    for (size_t scanned = 0; scanned < entries.size(); ++scanned, index = (index + 1) & mask)
+    {
+        if (entries[index].key != 0 && (victim == entries.size() || entries[index].lastSeen < entries[victim].lastSeen))
+        {
+            victim = index;
+        }
+
+        if (scanned + 1 >= ADV_REPORT_DEDUP_EVICTION_WINDOW && victim != entries.size())
+        {
+            break;
+        }
+    }
+
+    // Backward shift deletion, so that no probe sequence is broken by the emptied slot
+    auto hole = victim;
+
+    for (auto next = (hole + 1) & mask; entries[next].key != 0; next = (next + 1) & mask)
+    {
+        // The entry may only move back if the hole is not before its home slot
+        if (((next - home(entries[next].key)) & mask) >= ((next - hole) & mask))
+        {
+            entries[hole] = entries[next];
+            hole = next;
+        }
+    }
+
+    entries[hole] = Entry{0, 0, 0, 0, 0};
+    used--;
+}
+
+void AdvReportBatch::reserve(const size_t count)
+{
+    timestamps.reserve(count);
+    dataOffsets.reserve(count + 1);
+    addresses.reserve(count * BLE_GAP_ADDR_LEN);
+    addressTypes.reserve(count);
+    rssi.reserve(count);
+    types.reserve(count);
+    scanRsp.reserve(count);
+    data.reserve(count * sizeof(ble_gap_evt_adv_report_t::data));
+}
+
+void AdvReportBatch::clear()
+{
+    timestamps.clear();
+    dataOffsets.clear();
+    addresses.clear();
+    addressTypes.clear();
+    rssi.clear();
+    types.clear();
+    scanRsp.clear();
+    data.clear();
+}
+
+void AdvReportBatch::add(const ble_gap_evt_adv_report_t &report, const uint64_t timestamp)
+{
+    if (dataOffsets.empty())
+    {
+        dataOffsets.push_back(0);
+    }
+
+    timestamps.push_back(static_cast<double>(timestamp));
+    addresses.insert(addresses.end(), report.peer_addr.addr, report.peer_addr.addr + BLE_GAP_ADDR_LEN);
+    addressTypes.push_back(report.peer_addr.addr_type);
+    rssi.push_back(report.rssi);
+    types.push_back(report.type);
+    scanRsp.push_back(report.scan_rsp);
+    data.insert(data.end(), report.data, report.data + report.dlen);
+    dataOffsets.push_back(static_cast<uint32_t>(data.size()));
+}
+
+size_t AdvReportBatch::size() const
+{
+    return timestamps.size();
+}
@@ -0,0 +1,195 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ADV_REPORT_H
+#define ADV_REPORT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ble.h"
+
+// Default number of devices tracked by AdvReportDedup
+#define ADV_REPORT_DEDUP_MAX_DEVICES 1024
+// Number of slots AdvReportDedup looks through for an entry to evict when it is full
+#define ADV_REPORT_DEDUP_EVICTION_WINDOW 16
+
+// Calls handler(ad_type, ad_data, ad_data_len) for each AD structure in advertising or scan
+// response data until the handler returns true. Parsing stops at the first malformed AD
+// structure, as in GapAdvReport::ToJs.
+template<typename Handler>
+void forEachAdStructure(const uint8_t *data, const uint8_t dlen, Handler handler)
+{
+    uint8_t pos = 0;
+
+    while (pos < dlen)
+    {
+        const uint8_t ad_len = data[pos];
+        pos++;
+
+        if (ad_len == 0 || pos + ad_len > dlen)
+        {
+            return;
+        }
+
+        if (handler(data[pos], &data[pos + 1], static_cast<uint8_t>(ad_len - 1)))
+        {
+            return;
+        }
+
+        pos += ad_len;
+    }
+}
+
+// Advertising report filter, evaluated in the SoftDevice driver thread before a report is queued.
+//
+// A report is accepted if it matches every criterion that is set. A criterion with several
+// values matches if any of the values match. Each report is evaluated on its own, a scan
+// response is not combined with the advertising report it belongs to.
+class AdvReportFilter
+{
+public:
+    AdvReportFilter();
+
+    // If matchType is false the address matches reports with any address type
+    void addAddress(const ble_gap_addr_t &address, const bool matchType);
+    void setMinRssi(const int8_t rssi);
+
+    // uuid is 2, 4 or 16 bytes, little endian as in the advertising data
+    void addServiceUuid(const std::vector<uint8_t> &uuid);
+    void addManufacturerId(const uint16_t companyId);
+    void setNamePrefix(const std::string &prefix);
+
+    bool accepts(const ble_gap_evt_adv_report_t &report) const;
+
+private:
+    bool matchesAddress(const ble_gap_addr_t &address) const;
+    bool matchesData(const uint8_t *data, const uint8_t dlen) const;
+
+    struct Address
+    {
+        std::array<uint8_t, BLE_GAP_ADDR_LEN> addr;
+        uint8_t addrType;
+        bool matchType;
+    };
+
+    std::vector<Address> addresses;
+    bool hasMinRssi;
+    int8_t minRssi;
+    std::vector<std::vector<uint8_t>> serviceUuids;
+    std::vector<uint16_t> manufacturerIds;
+    std::string namePrefix;
+};
+
+// Per device suppression of repeated advertising reports, evaluated in the SoftDevice driver
+// thread after AdvReportFilter.
+//
+// Devices are keyed by peer address, address type and scan response flag, so that advertising
+// data and scan response data of one device are tracked separately. A report is passed on if
+// the device is new or if one of the enabled change criteria is met. If neither criterion is
+// enabled, every report counts as changed. A minimum interval further limits how often one
+// device is passed on.
+//
+// The table is allocated up front. When it is full, the device seen least recently among the
+// entries next to the new device's slot is evicted to make room, and is reported as new when it
+// is seen again.
+class AdvReportDedup
+{
+public:
+    explicit AdvReportDedup(const size_t maxDevices = ADV_REPORT_DEDUP_MAX_DEVICES);
+
+    // Pass on the report if its advertising data differs from the last report passed on
+    void setPayloadChange(const bool enable);
+    // Pass on the report if its RSSI differs by at least delta dB from the last report passed on, 0 disables
+    void setRssiDelta(const uint8_t delta);
+    // Minimum time in milliseconds between two reports passed on for one device, 0 disables
+    void setInterval(const uint32_t intervalMs);
+
+    // Returns true if the report shall be passed on, and updates the table. Not thread safe.
+    bool accepts(const ble_gap_evt_adv_report_t &report, const uint64_t timestamp);
+
+private:
+    struct Entry
+    {
+        uint64_t key;            // 0 is an unused entry
+        uint64_t lastTimestamp;  // Last report passed on, microseconds, see getMonotonicTimeInMicroseconds()
+        uint64_t lastSeen;       // Last report received, used to pick the entry to evict
+        uint32_t payloadHash;
+        int8_t rssi;
+    };
+
+    static uint64_t makeKey(const ble_gap_evt_adv_report_t &report);
+    static uint32_t hashPayload(const uint8_t *data, const uint8_t dlen);
+
+    size_t home(const uint64_t key) const;
+    Entry &find(const uint64_t key);
+    // Removes the least recently seen entry of the slots from the home slot of key on
+    void evict(const uint64_t key);
+
+    std::vector<Entry> entries; // Open addressing with linear probing, size is a power of two
+    size_t used;
+    size_t maxUsed;
+
+    bool payloadChange;
+    uint8_t rssiDelta;
+    uint64_t intervalUs;
+};
+
+// Advertising reports stored as a struct of arrays, so that a batch of reports can be handed
+// to JavaScript as a handful of typed arrays instead of one object per report.
+class AdvReportBatch
+{
+public:
+    void reserve(const size_t count);
+    void clear();
+    void add(const ble_gap_evt_adv_report_t &report, const uint64_t timestamp);
+
+    size_t size() const;
+
+    std::vector<double> timestamps;    // See getMonotonicTimeInMicroseconds()
+    std::vector<uint32_t> dataOffsets; // Report i has its data in [dataOffsets[i], dataOffsets[i + 1])
+    std::vector<uint8_t> addresses;    // BLE_GAP_ADDR_LEN bytes for each report, little endian
+    std::vector<uint8_t> addressTypes;
+    std::vector<int8_t> rssi;
+    std::vector<uint8_t> types;        // BLE_GAP_ADV_TYPES
+    std::vector<uint8_t> scanRsp;
+    std::vector<uint8_t> data;         // Advertising and scan response data of all reports
+};
+
+#endif // ADV_REPORT_H
@@ -0,0 +1,219 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "auto_reply.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    uint16_t clamp(const uint16_t value, const uint16_t min, const uint16_t max)
+    {
+        if (min != 0 && value < min)
+        {
+            return min;
+        }
+
+        if (max != 0 && value > max)
+        {
+            return max;
+        }
+
+        return value;
+    }
+}
+
+AutoReplyPolicy::AutoReplyPolicy() :
+    hasConnParams(false),
+    connParamsReject(false),
+    minConnInterval(0),
+    maxConnInterval(0),
+    maxSlaveLatency(0),
+    minConnSupTimeout(0),
+    maxConnSupTimeout(0),
+    hasSecParams(false),
+    hasLescKeys(false)
+#if NRF_SD_BLE_API_VERSION >= 5
+    , hasAttMtu(false),
+    attMtu(0),
+    hasMaxDataLength(false),
+    maxDataLength(0),
+    hasPhys(false)
+#endif
+{
+    std::memset(&secParams, 0, sizeof(secParams));
+    std::memset(lescPrivateKey, 0, sizeof(lescPrivateKey));
+    std::memset(&lescPublicKey, 0, sizeof(lescPublicKey));
+#if NRF_SD_BLE_API_VERSION >= 5
+    std::memset(&phys, 0, sizeof(phys));
+#endif
+}
+
+void AutoReplyPolicy::setConnParamsLimits(const uint16_t minInterval, const uint16_t maxInterval,
+                                          const uint16_t maxLatency, const uint16_t minTimeout,
+                                          const uint16_t maxTimeout)
+{
+    hasConnParams = true;
+    connParamsReject = false;
+    minConnInterval = minInterval;
+    maxConnInterval = maxInterval;
+    maxSlaveLatency = maxLatency;
+    minConnSupTimeout = minTimeout;
+    maxConnSupTimeout = maxTimeout;
+}
+
+void AutoReplyPolicy::setConnParamsReject()
+{
+    hasConnParams = true;
+    connParamsReject = true;
+}
+
+void AutoReplyPolicy::setSecParams(const ble_gap_sec_params_t &params)
+{
+    hasSecParams = true;
+    secParams = params;
+}
+
+void AutoReplyPolicy::setLescKeys(const uint8_t *sk, const uint8_t *pk)
+{
+    hasLescKeys = true;
+    std::memcpy(lescPrivateKey, sk, sizeof(lescPrivateKey));
+    std::memcpy(lescPublicKey.pk, pk, sizeof(lescPublicKey.pk));
+}
+
+bool AutoReplyPolicy::repliesConnParams() const
+{
+    return hasConnParams;
+}
+
+bool AutoReplyPolicy::rejectsConnParams() const
+{
+    return connParamsReject;
+}
+
+ble_gap_conn_params_t AutoReplyPolicy::clampConnParams(const ble_gap_conn_params_t &requested) const
+{
+    ble_gap_conn_params_t params = requested;
+
+    params.min_conn_interval = clamp(requested.min_conn_interval, minConnInterval, maxConnInterval);
+    params.max_conn_interval = clamp(requested.max_conn_interval, minConnInterval, maxConnInterval);
+    params.max_conn_interval = std::max(params.min_conn_interval, params.max_conn_interval);
+    params.slave_latency = std::min(requested.slave_latency, maxSlaveLatency);
+    params.conn_sup_timeout = clamp(requested.conn_sup_timeout, minConnSupTimeout, maxConnSupTimeout);
+
+    return params;
+}
+
+bool AutoReplyPolicy::repliesSecParams() const
+{
+    return hasSecParams;
+}
+
+const ble_gap_sec_params_t &AutoReplyPolicy::getSecParams() const
+{
+    return secParams;
+}
+
+bool AutoReplyPolicy::repliesLescDhkey() const
+{
+    return hasLescKeys;
+}
+
+const uint8_t *AutoReplyPolicy::getLescPrivateKey() const
+{
+    return lescPrivateKey;
+}
+
+const ble_gap_lesc_p256_pk_t &AutoReplyPolicy::getLescPublicKey() const
+{
+    return lescPublicKey;
+}
+
+#if NRF_SD_BLE_API_VERSION >= 5
+void AutoReplyPolicy::setAttMtu(const uint16_t mtu)
+{
+    hasAttMtu = true;
+    attMtu = mtu;
+}
+
+void AutoReplyPolicy::setMaxDataLength(const uint16_t octets)
+{
+    hasMaxDataLength = true;
+    maxDataLength = octets;
+}
+
+void AutoReplyPolicy::setPhys(const ble_gap_phys_t &preferred)
+{
+    hasPhys = true;
+    phys = preferred;
+}
+
+bool AutoReplyPolicy::repliesAttMtu() const
+{
+    return hasAttMtu;
+}
+
+uint16_t AutoReplyPolicy::getAttMtu() const
+{
+    return attMtu;
+}
+
+bool AutoReplyPolicy::repliesDataLength() const
+{
+    return hasMaxDataLength;
+}
+
+ble_gap_data_length_params_t AutoReplyPolicy::getDataLengthParams() const
+{
+    // The SoftDevice picks the time limits matching the octets and the PHY in use
+    ble_gap_data_length_params_t params;
+    params.max_tx_octets = maxDataLength;
+    params.max_rx_octets = maxDataLength;
+    params.max_tx_time_us = BLE_GAP_DATA_LENGTH_AUTO;
+    params.max_rx_time_us = BLE_GAP_DATA_LENGTH_AUTO;
+    return params;
+}
+
+bool AutoReplyPolicy::repliesPhys() const
+{
+    return hasPhys;
+}
+
+const ble_gap_phys_t &AutoReplyPolicy::getPhys() const
+{
+    return phys;
+}
+#endif
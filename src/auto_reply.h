@@ -0,0 +1,130 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef AUTO_REPLY_H
+#define AUTO_REPLY_H
+
+#include <cstdint>
+
+#include "ble.h"
+
+// Replies to time critical requests from peers, made in the SoftDevice driver thread when the
+// request event is received so the reply does not wait for the NodeJS thread. A request type
+// is only replied to if its policy is set. The request event is still passed on to JavaScript,
+// marked as replied if the reply succeeded. If the reply failed the event is passed on as a
+// normal request, so the application may reply itself.
+class AutoReplyPolicy
+{
+public:
+    AutoReplyPolicy();
+
+    // BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST. The requested parameters are accepted after being
+    // clamped to the limits, in SoftDevice units. Interval and timeout limits left at 0 are not
+    // applied, the slave latency is always limited.
+    void setConnParamsLimits(const uint16_t minInterval, const uint16_t maxInterval,
+                             const uint16_t maxLatency, const uint16_t minTimeout,
+                             const uint16_t maxTimeout);
+    // BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST is rejected
+    void setConnParamsReject();
+
+    // BLE_GAP_EVT_SEC_PARAMS_REQUEST in the peripheral role is replied with these parameters
+    void setSecParams(const ble_gap_sec_params_t &params);
+
+    // BLE_GAP_EVT_LESC_DHKEY_REQUEST is replied with the DHKey computed from this little endian
+    // private key. The public key is also given in the keyset of secParams replies with lesc.
+    void setLescKeys(const uint8_t *sk, const uint8_t *pk);
+
+#if NRF_SD_BLE_API_VERSION >= 5
+    // BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST is replied with this server RX MTU
+    void setAttMtu(const uint16_t mtu);
+    // BLE_GAP_EVT_DATA_LENGTH_UPDATE_REQUEST is replied with at most this many octets
+    void setMaxDataLength(const uint16_t octets);
+    // BLE_GAP_EVT_PHY_UPDATE_REQUEST is replied with these preferred PHYs
+    void setPhys(const ble_gap_phys_t &phys);
+#endif
+
+    bool repliesConnParams() const;
+    bool rejectsConnParams() const;
+    // Returns the parameters to reply to a request with
+    ble_gap_conn_params_t clampConnParams(const ble_gap_conn_params_t &requested) const;
+
+    bool repliesSecParams() const;
+    const ble_gap_sec_params_t &getSecParams() const;
+
+    bool repliesLescDhkey() const;
+    const uint8_t *getLescPrivateKey() const;
+    const ble_gap_lesc_p256_pk_t &getLescPublicKey() const;
+
+#if NRF_SD_BLE_API_VERSION >= 5
+    bool repliesAttMtu() const;
+    uint16_t getAttMtu() const;
+
+    bool repliesDataLength() const;
+    ble_gap_data_length_params_t getDataLengthParams() const;
+
+    bool repliesPhys() const;
+    const ble_gap_phys_t &getPhys() const;
+#endif
+
+private:
+    bool hasConnParams;
+    bool connParamsReject;
+    uint16_t minConnInterval;
+    uint16_t maxConnInterval;
+    uint16_t maxSlaveLatency;
+    uint16_t minConnSupTimeout;
+    uint16_t maxConnSupTimeout;
+
+    bool hasSecParams;
+    ble_gap_sec_params_t secParams;
+
+    bool hasLescKeys;
+    uint8_t lescPrivateKey[32];
+    ble_gap_lesc_p256_pk_t lescPublicKey;
+
+#if NRF_SD_BLE_API_VERSION >= 5
+    bool hasAttMtu;
+    uint16_t attMtu;
+
+    bool hasMaxDataLength;
+    uint16_t maxDataLength;
+
+    bool hasPhys;
+    ble_gap_phys_t phys;
+#endif
+};
+
+#endif // AUTO_REPLY_H
@@ -0,0 +1,456 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "bond_store.h"
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+// File format, all values little endian:
+//
+//   magic "PBBS", version (1 byte), bond count (2 bytes), then per bond:
+//   address type (1), address (6), flags (1, bit 0 own key, bit 1 peer key),
+//   own key (KEY_RECORD_SIZE), peer key (KEY_RECORD_SIZE)
+//
+// A key is the LTK (16), a byte with lesc in bit 0, auth in bit 1 and the LTK length above,
+// the EDIV (2) and Rand (8). Keys that are not present are written as zero.
+namespace {
+    const char FILE_MAGIC[4] = {'P', 'B', 'B', 'S'};
+    const uint8_t FILE_VERSION = 1;
+    const size_t FILE_HEADER_SIZE = 7;
+    const size_t KEY_RECORD_SIZE = BLE_GAP_SEC_KEY_LEN + 1 + 2 + BLE_GAP_SEC_RAND_LEN;
+    const size_t BOND_RECORD_SIZE = 1 + BLE_GAP_ADDR_LEN + 1 + 2 * KEY_RECORD_SIZE;
+
+    const uint8_t FLAG_OWN_KEY = 0x01;
+    const uint8_t FLAG_PEER_KEY = 0x02;
+
+    uint8_t *writeKey(uint8_t *out, const ble_gap_enc_key_t &key)
+    {
+        std::memcpy(out, key.enc_info.ltk, BLE_GAP_SEC_KEY_LEN);
+        out += BLE_GAP_SEC_KEY_LEN;
+        *out++ = static_cast<uint8_t>(key.enc_info.lesc | (key.enc_info.auth << 1) | (key.enc_info.ltk_len << 2));
+        *out++ = static_cast<uint8_t>(key.master_id.ediv & 0xFF);
+        *out++ = static_cast<uint8_t>(key.master_id.ediv >> 8);
+        std::memcpy(out, key.master_id.rand, BLE_GAP_SEC_RAND_LEN);
+        return out + BLE_GAP_SEC_RAND_LEN;
+    }
+
+    const uint8_t *readKey(const uint8_t *in, ble_gap_enc_key_t &key)
+    {
+        std::memcpy(key.enc_info.ltk, in, BLE_GAP_SEC_KEY_LEN);
+        in += BLE_GAP_SEC_KEY_LEN;
+        key.enc_info.lesc = *in & 0x01;
+        key.enc_info.auth = (*in >> 1) & 0x01;
+        key.enc_info.ltk_len = *in >> 2;
+        in++;
+        key.master_id.ediv = static_cast<uint16_t>(in[0] | (in[1] << 8));
+        in += 2;
+        std::memcpy(key.master_id.rand, in, BLE_GAP_SEC_RAND_LEN);
+        return in + BLE_GAP_SEC_RAND_LEN;
+    }
+}
+
+BondStore::BondStore() : encryptOnConnect(false)
+{
+    if (uv_mutex_init(&mutex) != 0)
+    {
+        std::cerr << "Not able to create the bond store mutex! Terminating." << std::endl;
+        std::terminate();
+    }
+}
+
+BondStore::~BondStore()
+{
+    uv_mutex_destroy(&mutex);
+}
+
+void BondStore::setPath(const std::string &bondPath)
+{
+    uv_mutex_lock(&mutex);
+    path = bondPath;
+    bondsByAddress.clear();
+    addressByMasterId.clear();
+
+    try
+    {
+        load();
+    }
+    catch (std::string)
+    {
+        path.clear();
+        uv_mutex_unlock(&mutex);
+        throw;
+    }
+
+    uv_mutex_unlock(&mutex);
+}
+
+void BondStore::setEncryptOnConnect(const bool enable)
+{
+    encryptOnConnect = enable;
+}
+
+bool BondStore::encryptsOnConnect() const
+{
+    return encryptOnConnect;
+}
+
+void BondStore::onConnected(const uint16_t connHandle, const ble_gap_addr_t &peerAddress)
+{
+    uv_mutex_lock(&mutex);
+    connections[connHandle] = peerAddress;
+    uv_mutex_unlock(&mutex);
+}
+
+void BondStore::onDisconnected(const uint16_t connHandle)
+{
+    uv_mutex_lock(&mutex);
+    connections.erase(connHandle);
+    uv_mutex_unlock(&mutex);
+}
+
+void BondStore::addBond(const uint16_t connHandle, const ble_gap_sec_keyset_t &keyset, const ble_gap_addr_t *identity)
+{
+    uv_mutex_lock(&mutex);
+
+    auto connection = connections.find(connHandle);
+
+    if (connection == connections.end())
+    {
+        uv_mutex_unlock(&mutex);
+        return;
+    }
+
+    Bond bond;
+    std::memset(&bond, 0, sizeof(bond));
+    bond.address = identity != nullptr ? *identity : connection->second;
+
+    // Keys that were not distributed are left zero by the SoftDevice
+    if (keyset.keys_own.p_enc_key != nullptr && isValid(*keyset.keys_own.p_enc_key))
+    {
+        bond.hasOwnKey = true;
+        bond.ownKey = *keyset.keys_own.p_enc_key;
+    }
+
+    if (keyset.keys_peer.p_enc_key != nullptr && isValid(*keyset.keys_peer.p_enc_key))
+    {
+        bond.hasPeerKey = true;
+        bond.peerKey = *keyset.keys_peer.p_enc_key;
+    }
+
+    if (bond.hasOwnKey || bond.hasPeerKey)
+    {
+        erase(addressKey(connection->second));
+        erase(addressKey(bond.address));
+        insert(bond);
+        save();
+    }
+
+    uv_mutex_unlock(&mutex);
+}
+
+bool BondStore::findSecInfo(const ble_gap_evt_sec_info_request_t &request, ble_gap_enc_info_t &encInfo)
+{
+    uv_mutex_lock(&mutex);
+
+    auto bond = bondsByAddress.end();
+    auto masterId = addressByMasterId.find(masterIdKey(request.master_id));
+
+    if (masterId != addressByMasterId.end())
+    {
+        bond = bondsByAddress.find(masterId->second);
+    }
+    else
+    {
+        // LE Secure Connections keys have no EDIV and Rand
+        bond = bondsByAddress.find(addressKey(request.peer_addr));
+    }
+
+    auto found = false;
+
+    if (bond != bondsByAddress.end())
+    {
+        const auto &key = bond->second.hasOwnKey ? bond->second.ownKey : bond->second.peerKey;
+
+        if (std::memcmp(&key.master_id, &request.master_id, sizeof(ble_gap_master_id_t)) == 0 &&
+            (bond->second.hasOwnKey || key.enc_info.lesc))
+        {
+            encInfo = key.enc_info;
+            found = true;
+        }
+    }
+
+    uv_mutex_unlock(&mutex);
+    return found;
+}
+
+bool BondStore::findEncryptionKey(const uint16_t connHandle, ble_gap_enc_key_t &key)
+{
+    uv_mutex_lock(&mutex);
+
+    auto found = false;
+    auto connection = connections.find(connHandle);
+
+    if (connection != connections.end())
+    {
+        auto bond = bondsByAddress.find(addressKey(connection->second));
+
+        if (bond != bondsByAddress.end())
+        {
+            if (bond->second.hasPeerKey)
+            {
+                key = bond->second.peerKey;
+                found = true;
+            }
+            else if (bond->second.ownKey.enc_info.lesc)
+            {
+                key = bond->second.ownKey;
+                found = true;
+            }
+        }
+    }
+
+    uv_mutex_unlock(&mutex);
+    return found;
+}
+
+std::vector<BondStore::Bond> BondStore::getBonds()
+{
+    uv_mutex_lock(&mutex);
+
+    std::vector<Bond> bonds;
+    bonds.reserve(bondsByAddress.size());
+
+    for (const auto &entry : bondsByAddress)
+    {
+        bonds.push_back(entry.second);
+    }
+
+    uv_mutex_unlock(&mutex);
+    return bonds;
+}
+
+bool BondStore::removeBond(const ble_gap_addr_t &address)
+{
+    uv_mutex_lock(&mutex);
+
+    const auto key = addressKey(address);
+    const auto found = bondsByAddress.count(key) > 0;
+
+    if (found)
+    {
+        erase(key);
+        save();
+    }
+
+    uv_mutex_unlock(&mutex);
+    return found;
+}
+
+void BondStore::clear()
+{
+    uv_mutex_lock(&mutex);
+    bondsByAddress.clear();
+    addressByMasterId.clear();
+    save();
+    uv_mutex_unlock(&mutex);
+}
+
+uint64_t BondStore::addressKey(const ble_gap_addr_t &address)
+{
+    uint64_t key = address.addr_type;
+
+    for (auto i = 0; i < BLE_GAP_ADDR_LEN; i++)
+    {
+        key = (key << 8) | address.addr[i];
+    }
+
+    return key;
+}
+
+uint64_t BondStore::masterIdKey(const ble_gap_master_id_t &masterId)
+{
+    uint64_t key = masterId.ediv;
+
+    for (auto i = 0; i < BLE_GAP_SEC_RAND_LEN; i++)
+    {
+        key = (key * 31) ^ masterId.rand[i];
+    }
+
+    return key;
+}
+
+bool BondStore::isValid(const ble_gap_enc_key_t &key)
+{
+    return key.enc_info.ltk_len != 0;
+}
+
+void BondStore::insert(const Bond &bond)
+{
+    const auto key = addressKey(bond.address);
+    bondsByAddress[key] = bond;
+
+    // Only keys from legacy pairing are looked up by EDIV and Rand
+    if (bond.hasOwnKey && !bond.ownKey.enc_info.lesc)
+    {
+        addressByMasterId[masterIdKey(bond.ownKey.master_id)] = key;
+    }
+}
+
+void BondStore::erase(const uint64_t key)
+{
+    auto bond = bondsByAddress.find(key);
+
+    if (bond == bondsByAddress.end())
+    {
+        return;
+    }
+
+    if (bond->second.hasOwnKey && !bond->second.ownKey.enc_info.lesc)
+    {
+        auto masterId = addressByMasterId.find(masterIdKey(bond->second.ownKey.master_id));
+
+        if (masterId != addressByMasterId.end() && masterId->second == key)
+        {
+            addressByMasterId.erase(masterId);
+        }
+    }
+
+    bondsByAddress.erase(bond);
+}
+
+void BondStore::load()
+{
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file.is_open())
+    {
+        // Created on the first bond
+        return;
+    }
+
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (data.size() < FILE_HEADER_SIZE || std::memcmp(data.data(), FILE_MAGIC, sizeof(FILE_MAGIC)) != 0)
+    {
+        throw std::string("not a bond store file");
+    }
+
+    if (data[4] != FILE_VERSION)
+    {
+        throw std::string("unsupported bond store version");
+    }
+
+    const size_t count = data[5] | (data[6] << 8);
+
+    if (data.size() != FILE_HEADER_SIZE + count * BOND_RECORD_SIZE)
+    {
+        throw std::string("truncated bond store file");
+    }
+
+    const uint8_t *in = data.data() + FILE_HEADER_SIZE;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        Bond bond;
+        std::memset(&bond, 0, sizeof(bond));
+
+        bond.address.addr_type = *in++;
+        std::memcpy(bond.address.addr, in, BLE_GAP_ADDR_LEN);
+        in += BLE_GAP_ADDR_LEN;
+
+        const auto flags = *in++;
+        bond.hasOwnKey = (flags & FLAG_OWN_KEY) != 0;
+        bond.hasPeerKey = (flags & FLAG_PEER_KEY) != 0;
+
+        in = readKey(in, bond.ownKey);
+        in = readKey(in, bond.peerKey);
+
+        insert(bond);
+    }
+}
+
+void BondStore::save()
+{
+    if (path.empty())
+    {
+        return;
+    }
+
+    std::vector<uint8_t> data(FILE_HEADER_SIZE + bondsByAddress.size() * BOND_RECORD_SIZE);
+    std::memcpy(data.data(), FILE_MAGIC, sizeof(FILE_MAGIC));
+    data[4] = FILE_VERSION;
+    data[5] = static_cast<uint8_t>(bondsByAddress.size() & 0xFF);
+    data[6] = static_cast<uint8_t>(bondsByAddress.size() >> 8);
+
+    auto out = data.data() + FILE_HEADER_SIZE;
+
+    for (const auto &entry : bondsByAddress)
+    {
+        const auto &bond = entry.second;
+        *out++ = bond.address.addr_type;
+        std::memcpy(out, bond.address.addr, BLE_GAP_ADDR_LEN);
+        out += BLE_GAP_ADDR_LEN;
+        *out++ = static_cast<uint8_t>((bond.hasOwnKey ? FLAG_OWN_KEY : 0) | (bond.hasPeerKey ? FLAG_PEER_KEY : 0));
+        out = writeKey(out, bond.ownKey);
+        out = writeKey(out, bond.peerKey);
+    }
+
+    // Written next to the file and renamed, so a crash never leaves a partial file
+    const auto temporaryPath = path + ".tmp";
+
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+
+        if (!file.good())
+        {
+            std::cerr << "Not able to write the bond store " << temporaryPath << "." << std::endl;
+            return;
+        }
+    }
+
+    // Replacing an existing file fails on Windows
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0 &&
+        (std::remove(path.c_str()) != 0 || std::rename(temporaryPath.c_str(), path.c_str()) != 0))
+    {
+        std::cerr << "Not able to replace the bond store " << path << "." << std::endl;
+    }
+}
@@ -0,0 +1,120 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BOND_STORE_H
+#define BOND_STORE_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <uv.h>
+
+#include "ble.h"
+
+// Bonding keys by peer, used in the SoftDevice driver thread to reply to security information
+// requests and to encrypt reconnections without a trip to JavaScript.
+//
+// Bonds are indexed by peer address, the identity address if the peer distributed one, and by
+// the EDIV and Rand of the keys this device distributed. When a path is set the bonds are read
+// from it and every change is written back, see the format in bond_store.cpp. All methods are
+// thread safe.
+class BondStore
+{
+public:
+    struct Bond
+    {
+        ble_gap_addr_t address;
+        bool hasOwnKey;  // Distributed by this device, used in the peripheral role
+        ble_gap_enc_key_t ownKey;
+        bool hasPeerKey; // Distributed by the peer, used in the central role
+        ble_gap_enc_key_t peerKey;
+    };
+
+    BondStore();
+    ~BondStore();
+
+    BondStore(const BondStore &) = delete;
+    BondStore &operator=(const BondStore &) = delete;
+
+    // Reads the bonds in the file, if it exists, and saves every change to it.
+    // Throws std::string if the file can not be read.
+    void setPath(const std::string &path);
+
+    // Connections in the central role to a bonded peer are encrypted when they are established
+    void setEncryptOnConnect(const bool enable);
+    bool encryptsOnConnect() const;
+
+    void onConnected(const uint16_t connHandle, const ble_gap_addr_t &peerAddress);
+    void onDisconnected(const uint16_t connHandle);
+
+    // Stores the keys of a completed bonding, replacing an earlier bond of the peer.
+    // identity is the identity address distributed by the peer, or nullptr.
+    void addBond(const uint16_t connHandle, const ble_gap_sec_keyset_t &keyset, const ble_gap_addr_t *identity);
+
+    // Finds the key to reply to BLE_GAP_EVT_SEC_INFO_REQUEST with
+    bool findSecInfo(const ble_gap_evt_sec_info_request_t &request, ble_gap_enc_info_t &encInfo);
+    // Finds the key to encrypt a connection in the central role with
+    bool findEncryptionKey(const uint16_t connHandle, ble_gap_enc_key_t &key);
+
+    std::vector<Bond> getBonds();
+    // Returns false if there is no bond with the peer
+    bool removeBond(const ble_gap_addr_t &address);
+    void clear();
+
+private:
+    static uint64_t addressKey(const ble_gap_addr_t &address);
+    static uint64_t masterIdKey(const ble_gap_master_id_t &masterId);
+    static bool isValid(const ble_gap_enc_key_t &key);
+
+    void insert(const Bond &bond);
+    void erase(const uint64_t key);
+    void load();
+    void save();
+
+    std::unordered_map<uint64_t, Bond> bondsByAddress;
+    std::unordered_map<uint64_t, uint64_t> addressByMasterId;
+    std::map<uint16_t, ble_gap_addr_t> connections;
+
+    std::string path;
+    std::atomic<bool> encryptOnConnect;
+    uv_mutex_t mutex;
+};
+
+#endif // BOND_STORE_H
@@ -0,0 +1,246 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "command_queue.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <type_traits>
+
+namespace {
+    std::remove_pointer<uv_async_cb>::type command_completed_handler;
+    void command_completed_handler(uv_async_t *handle)
+    {
+        auto commandQueue = static_cast<CommandQueue *>(handle->data);
+
+        if (commandQueue != nullptr)
+        {
+            commandQueue->onCompleted();
+        }
+    }
+
+    void command_thread_main(void *arg);
+}
+
+CommandQueue::CommandQueue(uv_loop_t *loop) :
+    inFlight(0),
+    submissions(COMMAND_QUEUE_SIZE),
+    completions(COMMAND_QUEUE_SIZE),
+    running(false),
+    stopping(false),
+    referenced(false),
+    loop(loop)
+{
+    if (uv_sem_init(&submitted, 0) != 0)
+    {
+        std::cerr << "Not able to create command queue semaphore! Terminating." << std::endl;
+        std::terminate();
+    }
+}
+
+CommandQueue::~CommandQueue()
+{
+    stop();
+    uv_sem_destroy(&submitted);
+}
+
+void CommandQueue::submit(uv_work_t *req, uv_work_cb work, uv_after_work_cb after)
+{
+    if (stopping)
+    {
+        backlog.push_back(new Command{req, work, after});
+        return;
+    }
+
+    if (!running)
+    {
+        start();
+    }
+
+    backlog.push_back(new Command{req, work, after});
+    handOver();
+    updateRef();
+}
+
+void CommandQueue::stop()
+{
+    if (!running)
+    {
+        return;
+    }
+
+    stopping = true;
+
+    // There is room for the stop request when the command thread has taken a command
+    while (!submissions.push(nullptr))
+    {
+        std::this_thread::yield();
+    }
+
+    uv_sem_post(&submitted);
+    uv_thread_join(&thread);
+    running = false;
+    inFlight = 0;
+
+    // The callbacks own the batons and the JavaScript callbacks, call them so that neither leaks
+    Command *command;
+
+    while (completions.pop(command))
+    {
+        command->after(command->req, 0);
+        delete command;
+    }
+
+    while (!backlog.empty())
+    {
+        command = backlog.front();
+        backlog.pop_front();
+        command->after(command->req, UV_ECANCELED);
+        delete command;
+    }
+
+    stopping = false;
+
+    asyncCompleted->data = nullptr;
+    auto handle = reinterpret_cast<uv_handle_t *>(asyncCompleted.release());
+    uv_close(handle, [](uv_handle_t *handle) {
+        delete reinterpret_cast<uv_async_t *>(handle);
+    });
+}
+
+void CommandQueue::onCompleted()
+{
+    Command *batch[COMMAND_QUEUE_SIZE];
+    const auto count = completions.pop_n(batch, COMMAND_QUEUE_SIZE);
+
+    inFlight -= count;
+
+    // Room has been made, hand over waiting commands before the callbacks submit new ones
+    handOver();
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        batch[i]->after(batch[i]->req, 0);
+        delete batch[i];
+    }
+
+    updateRef();
+}
+
+void CommandQueue::start()
+{
+    asyncCompleted = std::make_unique<uv_async_t>();
+    asyncCompleted->data = static_cast<void *>(this);
+
+    if (uv_async_init(loop, asyncCompleted.get(), command_completed_handler) != 0)
+    {
+        std::cerr << "Not able to create a new async command completion handler." << std::endl;
+        std::terminate();
+    }
+
+    // Only keep the event loop alive while there are commands, as uv_queue_work does
+    uv_unref(reinterpret_cast<uv_handle_t *>(asyncCompleted.get()));
+    referenced = false;
+
+    if (uv_thread_create(&thread, command_thread_main, this) != 0)
+    {
+        std::cerr << "Not able to create a command thread." << std::endl;
+        std::terminate();
+    }
+
+    running = true;
+}
+
+void CommandQueue::run()
+{
+    for (;;)
+    {
+        uv_sem_wait(&submitted);
+
+        Command *command = nullptr;
+        submissions.pop(command);
+
+        if (command == nullptr)
+        {
+            return;
+        }
+
+        command->work(command->req);
+
+        completions.push(command);
+        uv_async_send(asyncCompleted.get());
+    }
+}
+
+void CommandQueue::handOver()
+{
+    while (!backlog.empty() && inFlight < COMMAND_QUEUE_SIZE)
+    {
+        submissions.push(backlog.front());
+        backlog.pop_front();
+        inFlight++;
+        uv_sem_post(&submitted);
+    }
+}
+
+void CommandQueue::updateRef()
+{
+    const auto pending = inFlight > 0 || !backlog.empty();
+
+    if (asyncCompleted == nullptr || pending == referenced)
+    {
+        return;
+    }
+
+    if (pending)
+    {
+        uv_ref(reinterpret_cast<uv_handle_t *>(asyncCompleted.get()));
+    }
+    else
+    {
+        uv_unref(reinterpret_cast<uv_handle_t *>(asyncCompleted.get()));
+    }
+
+    referenced = pending;
+}
+
+namespace {
+    void command_thread_main(void *arg)
+    {
+        static_cast<CommandQueue *>(arg)->run();
+    }
+}
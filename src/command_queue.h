@@ -0,0 +1,116 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <deque>
+#include <memory>
+
+#include <uv.h>
+
+#include "spsc_queue.h"
+
+// Number of commands that can be handed to the command thread at once. More commands wait in
+// the NodeJS thread until earlier commands have completed.
+const auto COMMAND_QUEUE_SIZE = 256;
+
+// Runs the work of asynchronous adapter methods in a thread owned by one adapter, in the order
+// the methods were called. It replaces uv_queue_work, so that SoftDevice calls do not wait for
+// the libuv thread pool and adapters do not wait for each other.
+//
+// Commands are handed to the command thread through a lock free queue, and the completed
+// commands are handed back through another. The after callbacks are called in the NodeJS thread
+// from one uv_async_t, several completed commands may be handled per wake up.
+//
+// submit() and stop() must be called from the NodeJS thread that runs loop.
+class CommandQueue
+{
+public:
+    explicit CommandQueue(uv_loop_t *loop);
+    ~CommandQueue();
+
+    CommandQueue(const CommandQueue &) = delete;
+    CommandQueue &operator=(const CommandQueue &) = delete;
+
+    // Same contract as uv_queue_work, work runs in the command thread and after is called with
+    // status 0 in the NodeJS thread. The command thread is started on the first call.
+    void submit(uv_work_t *req, uv_work_cb work, uv_after_work_cb after);
+
+    // Stops the command thread when the commands it has been handed have run, and calls their
+    // after callbacks with status 0. Commands that have not been handed to the command thread,
+    // also those submitted from these callbacks, do not run and after is called with UV_ECANCELED.
+    void stop();
+
+    // Called from the NodeJS thread when commands have completed
+    void onCompleted();
+
+    // The loop of the command thread
+    void run();
+
+private:
+    struct Command
+    {
+        uv_work_t *req;
+        uv_work_cb work;
+        uv_after_work_cb after;
+    };
+
+    void start();
+    void handOver();
+    void updateRef();
+
+    // Commands not handed to the command thread yet, only used in the NodeJS thread
+    std::deque<Command *> backlog;
+    // Commands handed to the command thread and not completed in the NodeJS thread yet.
+    // Never more than COMMAND_QUEUE_SIZE, so pushing to completions never fails.
+    size_t inFlight;
+
+    // nullptr tells the command thread to stop
+    SpscQueue<Command *> submissions;
+    SpscQueue<Command *> completions;
+
+    uv_sem_t submitted;
+    uv_thread_t thread;
+    bool running;
+    // Set while stop() calls the after callbacks, commands submitted meanwhile are cancelled
+    bool stopping;
+    bool referenced;
+    uv_loop_t *loop;
+    std::unique_ptr<uv_async_t> asyncCompleted;
+};
+
+#endif // COMMAND_QUEUE_H
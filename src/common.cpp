@@ -39,6 +39,10 @@
 #include <sstream>
 #include <iostream>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
 
 #include "common.h"
 #include "ble_hci.h"
@@ -158,28 +162,81 @@ static name_map_t hci_status_map =
     NAME_MAP_ENTRY(BLE_HCI_CONN_FAILED_TO_BE_ESTABLISHED)
 };
 
-const std::string getCurrentTimeInMilliseconds()
+namespace
 {
-    auto current_time = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(current_time);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(current_time.time_since_epoch());
+    // Pair of wall clock and steady clock readings taken at the same time, used to map
+    // monotonic timestamps to wall clock time.
+    struct ClockReference
+    {
+        ClockReference() :
+            systemTime(std::chrono::system_clock::now()),
+            monotonicTime(getMonotonicTimeInMicroseconds())
+        {}
+
+        std::chrono::system_clock::time_point systemTime;
+        uint64_t monotonicTime;
+    };
+
+    const ClockReference &clockReference()
+    {
+        static const ClockReference reference;
+        return reference;
+    }
+
+    std::chrono::system_clock::time_point toSystemTime(const uint64_t monotonicTime)
+    {
+        const auto &reference = clockReference();
+        const auto delta = static_cast<int64_t>(monotonicTime - reference.monotonicTime);
 
-    auto ttm = gmtime(&time);
+        return reference.systemTime + std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::microseconds(delta));
+    }
 
-    char date_time_format[] = "%Y-%m-%dT%H:%M:%S";
-    char time_str[20] = "";
+    void formatTime(const std::chrono::system_clock::time_point &timePoint, char *buffer, const size_t size)
+    {
+        auto time = std::chrono::system_clock::to_time_t(timePoint);
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(timePoint.time_since_epoch());
 
-    strftime(time_str, 20, date_time_format, ttm);
+        // gmtime() returns a shared buffer, and this is called from the driver, command and NodeJS threads
+        struct tm ttm;
+#ifdef _WIN32
+        gmtime_s(&ttm, &time);
+#else
+        gmtime_r(&time, &ttm);
+#endif
 
-    std::string result(time_str);
-    result.append(".");
+        char date_time_format[] = "%Y-%m-%dT%H:%M:%S";
+        char time_str[20] = "";
 
-    auto millisecond_str = std::to_string(static_cast<int>(ms.count() % 1000));
-    result.append(std::max(0, static_cast<int>(3 - millisecond_str.length())), '0');
-    result.append(millisecond_str);
-    result.append("Z");
+        strftime(time_str, 20, date_time_format, &ttm);
 
-    return result;
+        snprintf(buffer, size, "%s.%03dZ", time_str, static_cast<int>(ms.count() % 1000));
+    }
+}
+
+const std::string getCurrentTimeInMilliseconds()
+{
+    char time_str[TIMESTAMP_STRING_SIZE];
+    formatTime(std::chrono::system_clock::now(), time_str, sizeof(time_str));
+    return std::string(time_str);
+}
+
+uint64_t getMonotonicTimeInMicroseconds()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+double toWallClockMilliseconds(const uint64_t monotonicTime)
+{
+    const auto systemTime = toSystemTime(monotonicTime);
+    return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(systemTime.time_since_epoch()).count();
+}
+
+const std::string formatMonotonicTime(const uint64_t monotonicTime)
+{
+    char time_str[TIMESTAMP_STRING_SIZE];
+    formatTime(toSystemTime(monotonicTime), time_str, sizeof(time_str));
+    return std::string(time_str);
 }
 
 uint16_t uint16_decode(const uint8_t *p_encoded_data)
@@ -313,6 +370,19 @@ uint8_t *ConversionUtility::getNativePointerToUint8(v8::Local<v8::Object>js, con
 
 uint8_t *ConversionUtility::getNativePointerToUint8(v8::Local<v8::Value> js)
 {
+    // Buffer and Uint8Array are copied with a single memcpy
+    if (js->IsArrayBufferView())
+    {
+        Nan::TypedArrayContents<uint8_t> contents(js);
+        auto string = static_cast<uint8_t *>(malloc(sizeof(uint8_t) * contents.length()));
+
+        assert(string != nullptr);
+
+        memcpy(string, *contents, contents.length());
+
+        return string;
+    }
+
     if (!js->IsArray())
     {
         throw std::string("array");
@@ -517,6 +587,31 @@ v8::Handle<v8::Value> ConversionUtility::toJsValueArray(const uint8_t *nativeDat
     return ConversionUtility::toJsValueArray(const_cast<uint8_t *>(nativeData), length);
 }
 
+v8::Handle<v8::Value> ConversionUtility::toJsValueBuffer(const uint8_t *nativeData, uint16_t length)
+{
+    Nan::EscapableHandleScope scope;
+    return scope.Escape(Nan::CopyBuffer(reinterpret_cast<const char *>(nativeData), length).ToLocalChecked());
+}
+
+// Format used by toJsValue(), all conversion to JavaScript is done in the NodeJS thread of the adapter.
+// Adapters may live in different worker threads, so each thread has its own format.
+static thread_local ValueFormat currentValueFormat = VALUE_FORMAT_ARRAY;
+
+v8::Handle<v8::Value> ConversionUtility::toJsValue(const uint8_t *nativeData, uint16_t length)
+{
+    if (currentValueFormat == VALUE_FORMAT_BUFFER)
+    {
+        return ConversionUtility::toJsValueBuffer(nativeData, length);
+    }
+
+    return ConversionUtility::toJsValueArray(nativeData, length);
+}
+
+void ConversionUtility::setValueFormat(const ValueFormat format)
+{
+    currentValueFormat = format;
+}
+
 v8::Handle<v8::Value> ConversionUtility::toJsString(const char *cString)
 {
     return ConversionUtility::toJsString(cString, static_cast<uint16_t>(strlen(cString)));
@@ -655,10 +750,160 @@ v8::Handle<v8::Value> ConversionUtility::encodeHex(const char *text, int length)
     return ConversionUtility::toJsString(encoded.str());
 }
 
+namespace
+{
+    // Names of the properties BleDriverEvent::ToJs(obj) sets, in the order it sets them
+    const char *eventHeaderKeys[] = { "id", "name", "timestamp", "time", "conn_handle" };
+
+    // Keys are looked up by the content of the name, so names built in temporary buffers find
+    // their key as well and do not take a new entry each time. The number of keys is bounded, so
+    // callers with unbounded sets of names can not grow the cache without limit.
+    const size_t JS_CACHE_MAX_KEYS = 1024;
+
+    struct JsCacheKey
+    {
+        std::string name;
+        Nan::Persistent<v8::String> key;
+    };
+
+    // 32 bit FNV-1a of a terminated string, as AdvReportDedup::hashPayload
+    struct NameHash
+    {
+        size_t operator()(const char *name) const
+        {
+            uint32_t hash = 2166136261u;
+
+            for (; *name != '\0'; ++name)
+            {
+                hash = (hash ^ static_cast<uint8_t>(*name)) * 16777619u;
+            }
+
+            return hash;
+        }
+    };
+
+    struct NameEqual
+    {
+        bool operator()(const char *a, const char *b) const
+        {
+            return std::strcmp(a, b) == 0;
+        }
+    };
+
+    struct JsCacheState
+    {
+        v8::Isolate *isolate = nullptr;
+        // Keyed by JsCacheKey::name, which the entry owns
+        std::unordered_map<const char *, std::unique_ptr<JsCacheKey>, NameHash, NameEqual> keys;
+        std::map<uint16_t, std::unique_ptr<Nan::Persistent<v8::ObjectTemplate>>> eventTemplates;
+    };
+
+    // One cache per NodeJS thread, as the Adapter constructor. A thread runs one isolate at a time.
+    thread_local JsCacheState jsCacheState;
+
+    // Releases the handles before the isolate is disposed, a later isolate of the thread binds the cache again
+    void resetJsCache(void *)
+    {
+        for (auto &key : jsCacheState.keys)
+        {
+            key.second->key.Reset();
+        }
+
+        for (auto &eventTemplate : jsCacheState.eventTemplates)
+        {
+            eventTemplate.second->Reset();
+        }
+
+        jsCacheState.keys.clear();
+        jsCacheState.eventTemplates.clear();
+        jsCacheState.isolate = nullptr;
+    }
+
+    // Returns the cache of the current thread, binding it to the current isolate on first use
+    JsCacheState *currentJsCache()
+    {
+        auto &state = jsCacheState;
+        auto isolate = v8::Isolate::GetCurrent();
+
+        if (state.isolate == nullptr)
+        {
+            state.isolate = isolate;
+#if NODE_MAJOR_VERSION >= 10
+            node::AddEnvironmentCleanupHook(isolate, resetJsCache, nullptr);
+#endif
+        }
+
+        return state.isolate == isolate ? &state : nullptr;
+    }
+
+    v8::Local<v8::String> newInternalizedString(const char *name)
+    {
+        return v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), name, v8::NewStringType::kInternalized).ToLocalChecked();
+    }
+}
+
+v8::Local<v8::String> JsCache::getKey(const char *name)
+{
+    Nan::EscapableHandleScope scope;
+    auto cache = currentJsCache();
+
+    if (cache == nullptr)
+    {
+        return scope.Escape(Nan::New(name).ToLocalChecked());
+    }
+
+    auto it = cache->keys.find(name);
+
+    if (it != cache->keys.end())
+    {
+        return scope.Escape(Nan::New(it->second->key));
+    }
+
+    auto key = newInternalizedString(name);
+
+    if (cache->keys.size() < JS_CACHE_MAX_KEYS)
+    {
+        std::unique_ptr<JsCacheKey> entry(new JsCacheKey());
+        entry->name = name;
+        entry->key.Reset(key);
+        const auto entryName = entry->name.c_str();
+        cache->keys.emplace(entryName, std::move(entry));
+    }
+
+    return scope.Escape(key);
+}
+
+v8::Local<v8::Object> JsCache::newEventObject(const uint16_t eventId)
+{
+    Nan::EscapableHandleScope scope;
+    auto cache = currentJsCache();
+
+    if (cache == nullptr)
+    {
+        return scope.Escape(Nan::New<v8::Object>());
+    }
+
+    auto &eventTemplate = cache->eventTemplates[eventId];
+
+    if (!eventTemplate)
+    {
+        auto objectTemplate = Nan::New<v8::ObjectTemplate>();
+
+        for (auto name : eventHeaderKeys)
+        {
+            Nan::SetTemplate(objectTemplate, getKey(name), Nan::Undefined());
+        }
+
+        eventTemplate.reset(new Nan::Persistent<v8::ObjectTemplate>(objectTemplate));
+    }
+
+    return scope.Escape(Nan::NewInstance(Nan::New(*eventTemplate)).ToLocalChecked());
+}
+
 v8::Local<v8::Value> Utility::Get(v8::Local<v8::Object> jsobj, const char *name)
 {
     Nan::EscapableHandleScope scope;
-    return scope.Escape(Nan::Get(jsobj, Nan::New(name).ToLocalChecked()).ToLocalChecked());
+    return scope.Escape(Nan::Get(jsobj, JsCache::getKey(name)).ToLocalChecked());
 }
 
 v8::Local<v8::Value> Utility::Get(v8::Local<v8::Object> jsobj, const int index)
@@ -726,12 +971,12 @@ bool Utility::Set(v8::Handle<v8::Object> target, const char *name, std::string v
 
 bool Utility::Set(v8::Handle<v8::Object> target, const char *name, v8::Local<v8::Value> value)
 {
-    return Nan::Set(target, Nan::New(name).ToLocalChecked(), value).FromMaybe(false);
+    return Nan::Set(target, JsCache::getKey(name), value).FromMaybe(false);
 }
 
 bool Utility::Has(v8::Handle<v8::Object> target, const char *name)
 {
-    return target->Has(target->CreationContext(), Nan::New(name).ToLocalChecked()).FromMaybe(false);
+    return target->Has(target->CreationContext(), JsCache::getKey(name)).FromMaybe(false);
 }
 
 void Utility::SetReturnValue(Nan::NAN_METHOD_ARGS_TYPE info, v8::Local<v8::Object> value)
@@ -846,7 +1091,7 @@ v8::Local<v8::Value> ErrorMessage::getErrorMessage(const int errorCode, const st
 }
 
 
-v8::Local<v8::Value> StatusMessage::getStatus(const int status, const std::string message, const std::string timestamp)
+v8::Local<v8::Value> StatusMessage::getStatus(const int status, const std::string message, const EventTime &timestamp)
 {
     Nan::EscapableHandleScope scope;
 
@@ -855,7 +1100,17 @@ v8::Local<v8::Value> StatusMessage::getStatus(const int status, const std::strin
     Utility::Set(obj, "id", ConversionUtility::toJsNumber(status));
     Utility::Set(obj, "name", ConversionUtility::valueToJsString(status, sd_rpc_app_status_map));
     Utility::Set(obj, "message", ConversionUtility::toJsString(message));
-    Utility::Set(obj, "time", ConversionUtility::toJsString(timestamp));
+    // Presented as the time of events, see BleDriverEvent::ToJs
+    if (timestamp.format == EVENT_TIME_FORMAT_ISO_STRING)
+    {
+        Utility::Set(obj, "time", ConversionUtility::toJsString(formatMonotonicTime(timestamp.timestamp)));
+    }
+    else
+    {
+        Utility::Set(obj, "time", toWallClockMilliseconds(timestamp.timestamp));
+    }
+
+    Utility::Set(obj, "timestamp", static_cast<double>(timestamp.timestamp));
 
     return scope.Escape(obj);
 }
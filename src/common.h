@@ -52,6 +52,7 @@
 
 #define NAME_MAP_ENTRY(EXP) { EXP, ""#EXP"" }
 #define ERROR_STRING_SIZE 1024
+#define TIMESTAMP_STRING_SIZE 25 // 2017-01-01T00:00:00.000Z including the terminating zero
 #define BATON_CONSTRUCTOR(BatonType) BatonType(v8::Local<v8::Function> callback) : Baton(callback) {}
 #define BATON_DESTRUCTOR(BatonType) ~BatonType()
 
@@ -139,6 +140,42 @@ public:
     static int WriteUtf8(v8::Local<v8::String>& v8Str, char *buffer, int length = -1);
 };
 
+// Persistent property keys and object templates for the conversion of native structures to
+// JavaScript, created the first time they are used. The keys are internalized strings, and all
+// objects for an event type are created from the same template, so they share hidden class.
+// There is one cache per Node.js thread, the main thread and each worker thread, released when
+// the environment of the thread is cleaned up.
+class JsCache
+{
+public:
+    static v8::Local<v8::String> getKey(const char *name);
+    static v8::Local<v8::Object> newEventObject(const uint16_t eventId);
+};
+
+// Microseconds from the steady clock, cheap enough to take for every event. Only useful for
+// measuring time between two timestamps, or converted with the functions below.
+uint64_t getMonotonicTimeInMicroseconds();
+double toWallClockMilliseconds(const uint64_t monotonicTime);
+const std::string formatMonotonicTime(const uint64_t monotonicTime);
+
+enum EventTimeFormat
+{
+    EVENT_TIME_FORMAT_NUMBER,    // Milliseconds since epoch, as accepted by the JavaScript Date constructor
+    EVENT_TIME_FORMAT_ISO_STRING // ISO 8601 string, 2017-01-01T00:00:00.000Z
+};
+
+// Time an event was received, together with how the time shall be presented in JavaScript
+struct EventTime
+{
+    EventTime(const uint64_t timestamp, const EventTimeFormat format) : timestamp(timestamp), format(format) {}
+
+    uint64_t timestamp; // Microseconds, see getMonotonicTimeInMicroseconds()
+    EventTimeFormat format;
+};
+
+// Name of a SoftDevice event from the dispatch table, nullptr if the id is not known. See event_dispatch.h.
+const char *findEventName(const uint16_t id);
+
 template<typename EventType>
 class BleDriverEvent : public BleToJs<EventType>
 {
@@ -151,12 +188,12 @@ protected:
     }
 
     uint16_t evt_id;
-    std::string timestamp;
+    EventTime timestamp;
     uint16_t conn_handle;
     EventType *evt;
 
 public:
-    BleDriverEvent(uint16_t evt_id, std::string timestamp, uint16_t conn_handle, EventType *evt)
+    BleDriverEvent(uint16_t evt_id, const EventTime timestamp, uint16_t conn_handle, EventType *evt)
         : BleToJs<EventType>(0),
         evt_id(evt_id),
         timestamp(timestamp),
@@ -165,11 +202,40 @@ public:
     {
     }
 
+    // Object for ToJs(obj) to fill in, with the properties common to all events in place
+    v8::Local<v8::Object> createJsObject() const
+    {
+        return JsCache::newEventObject(evt_id);
+    }
+
     virtual void ToJs(v8::Local<v8::Object> obj)
     {
         Utility::Set(obj, "id", evt_id);
-        Utility::Set(obj, "name", getEventName());
-        Utility::Set(obj, "time", timestamp);
+
+        // The names in the dispatch table are string literals, cached as internalized strings
+        const auto name = findEventName(evt_id);
+
+        if (name != nullptr)
+        {
+            Utility::Set(obj, "name", v8::Local<v8::Value>(JsCache::getKey(name)));
+        }
+        else
+        {
+            Utility::Set(obj, "name", getEventName());
+        }
+
+        Utility::Set(obj, "timestamp", static_cast<double>(timestamp.timestamp));
+
+        // The string is only formatted when asked for, it is expensive compared to the rest of the conversion
+        if (timestamp.format == EVENT_TIME_FORMAT_ISO_STRING)
+        {
+            Utility::Set(obj, "time", formatMonotonicTime(timestamp.timestamp));
+        }
+        else
+        {
+            Utility::Set(obj, "time", toWallClockMilliseconds(timestamp.timestamp));
+        }
+
         Utility::Set(obj, "conn_handle", conn_handle);
     }
 
@@ -186,6 +252,8 @@ public:
         req = new uv_work_t();
         callback = new Nan::Callback(cb);
         req->data = static_cast<void*>(this);
+        // Reported by commands the command queue cancels before they run
+        result = NRF_ERROR_INVALID_STATE;
     }
 
     ~Baton()
@@ -273,6 +341,13 @@ public:
     }
 };
 
+// How characteristic and descriptor values in events are converted to JavaScript
+enum ValueFormat
+{
+    VALUE_FORMAT_ARRAY, // Array of numbers
+    VALUE_FORMAT_BUFFER // Buffer, copied with one memcpy
+};
+
 class ConversionUtility
 {
 public:
@@ -328,6 +403,12 @@ public:
     static v8::Handle<v8::Value> toJsBool(uint8_t nativeValue);
     static v8::Handle<v8::Value> toJsValueArray(uint8_t *nativeValue, uint16_t length);
     static v8::Handle<v8::Value> toJsValueArray(const uint8_t *nativeValue, uint16_t length);
+    static v8::Handle<v8::Value> toJsValueBuffer(const uint8_t *nativeValue, uint16_t length);
+
+    // Converts a characteristic or descriptor value with the format set by setValueFormat().
+    // Only to be used in the NodeJS thread, the format is set by the adapter before it converts its events.
+    static v8::Handle<v8::Value> toJsValue(const uint8_t *nativeValue, uint16_t length);
+    static void setValueFormat(const ValueFormat format);
     static v8::Handle<v8::Value> toJsString(const char *cString);
     static v8::Handle<v8::Value> toJsString(const char *cString, uint16_t length);
     static v8::Handle<v8::Value> toJsString(uint8_t *cString, uint16_t length);
@@ -354,7 +435,7 @@ public:
 class StatusMessage
 {
 public:
-    static v8::Local<v8::Value> getStatus(const int status, const std::string message, const std::string timestamp);
+    static v8::Local<v8::Value> getStatus(const int status, const std::string message, const EventTime &timestamp);
 };
 
 class HciStatus
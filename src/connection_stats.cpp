@@ -0,0 +1,330 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "connection_stats.h"
+
+#include <exception>
+#include <iostream>
+
+ConnectionStats::ConnectionStats() :
+    rxPackets(0),
+    rxBytes(0),
+    txPackets(0),
+    txBytes(0),
+    txPendingPackets(0),
+    gattcTimeoutCount(0),
+    gattsTimeoutCount(0),
+    droppedEventCount(0),
+    gattcRequestTime(0)
+{}
+
+ConnectionStatsTable::ConnectionStatsTable()
+{
+    if (uv_mutex_init(&mutex) != 0)
+    {
+        std::cerr << "Not able to create connection statistics mutex! Terminating." << std::endl;
+        std::terminate();
+    }
+}
+
+ConnectionStatsTable::~ConnectionStatsTable()
+{
+    uv_mutex_destroy(&mutex);
+}
+
+void ConnectionStatsTable::onEvent(const ble_evt_t *event, const uint64_t timestamp)
+{
+    const auto id = event->header.evt_id;
+    const auto connHandle = getConnHandle(event);
+
+    if (connHandle == BLE_CONN_HANDLE_INVALID)
+    {
+        return;
+    }
+
+    uv_mutex_lock(&mutex);
+
+    if (id == BLE_GAP_EVT_CONNECTED)
+    {
+        connections[connHandle] = ConnectionStats();
+        uv_mutex_unlock(&mutex);
+        return;
+    }
+
+    if (id == BLE_GAP_EVT_DISCONNECTED)
+    {
+        connections.erase(connHandle);
+        uv_mutex_unlock(&mutex);
+        return;
+    }
+
+    auto entry = connections.find(connHandle);
+
+    if (entry == connections.end())
+    {
+        uv_mutex_unlock(&mutex);
+        return;
+    }
+
+    auto &stats = entry->second;
+    auto packet = false;
+    uint32_t received = 0;
+
+    switch (id)
+    {
+        case BLE_GATTC_EVT_HVX:
+            packet = true;
+            received = event->evt.gattc_evt.params.hvx.len;
+            break;
+
+        case BLE_GATTC_EVT_READ_RSP:
+            packet = true;
+            received = event->evt.gattc_evt.params.read_rsp.len;
+            break;
+
+        case BLE_GATTC_EVT_CHAR_VALS_READ_RSP:
+            packet = true;
+            received = event->evt.gattc_evt.params.char_vals_read_rsp.len;
+            break;
+
+        case BLE_GATTS_EVT_WRITE:
+            packet = true;
+            received = event->evt.gatts_evt.params.write.len;
+            break;
+
+        case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+            if (event->evt.gatts_evt.params.authorize_request.type == BLE_GATTS_AUTHORIZE_TYPE_WRITE)
+            {
+                packet = true;
+                received = event->evt.gatts_evt.params.authorize_request.request.write.len;
+            }
+            break;
+
+        case BLE_GATTC_EVT_TIMEOUT:
+            stats.gattcTimeoutCount++;
+            stats.gattcRequestTime = 0;
+            break;
+
+        case BLE_GATTS_EVT_TIMEOUT:
+            stats.gattsTimeoutCount++;
+            break;
+
+#if NRF_SD_BLE_API_VERSION >= 5
+        case BLE_GATTC_EVT_WRITE_CMD_TX_COMPLETE:
+            onTxComplete(stats, event->evt.gattc_evt.params.write_cmd_tx_complete.count);
+            break;
+
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+            onTxComplete(stats, event->evt.gatts_evt.params.hvn_tx_complete.count);
+            break;
+#else
+        case BLE_EVT_TX_COMPLETE:
+            onTxComplete(stats, event->evt.common_evt.params.tx_complete.count);
+            break;
+#endif
+
+        default:
+            break;
+    }
+
+    if (packet)
+    {
+        stats.rxPackets++;
+        stats.rxBytes += received;
+    }
+
+    // The GATT client has one request outstanding at a time, any other GATTC event is its response
+    const auto gattcResponse = id >= BLE_GATTC_EVT_BASE && id <= BLE_GATTC_EVT_LAST &&
+        id != BLE_GATTC_EVT_HVX && id != BLE_GATTC_EVT_TIMEOUT
+#if NRF_SD_BLE_API_VERSION >= 5
+        && id != BLE_GATTC_EVT_WRITE_CMD_TX_COMPLETE
+#endif
+        ;
+
+    if (gattcResponse && stats.gattcRequestTime != 0)
+    {
+        stats.gattcLatency.record(timestamp > stats.gattcRequestTime ? timestamp - stats.gattcRequestTime : 0);
+        stats.gattcRequestTime = 0;
+    }
+
+    uv_mutex_unlock(&mutex);
+}
+
+void ConnectionStatsTable::onEventDropped(const ble_evt_t *event)
+{
+    const auto connHandle = getConnHandle(event);
+
+    if (connHandle == BLE_CONN_HANDLE_INVALID)
+    {
+        return;
+    }
+
+    uv_mutex_lock(&mutex);
+
+    auto entry = connections.find(connHandle);
+
+    if (entry != connections.end())
+    {
+        entry->second.droppedEventCount++;
+    }
+
+    uv_mutex_unlock(&mutex);
+}
+
+void ConnectionStatsTable::onGattcRequest(const uint16_t connHandle, const uint64_t timestamp)
+{
+    uv_mutex_lock(&mutex);
+
+    auto entry = connections.find(connHandle);
+
+    if (entry != connections.end())
+    {
+        entry->second.gattcRequestTime = timestamp;
+    }
+
+    uv_mutex_unlock(&mutex);
+}
+
+void ConnectionStatsTable::onGattcRequestFailed(const uint16_t connHandle, const uint64_t timestamp)
+{
+    uv_mutex_lock(&mutex);
+
+    auto entry = connections.find(connHandle);
+
+    // A response of the connection may already have completed the request time
+    if (entry != connections.end() && entry->second.gattcRequestTime == timestamp)
+    {
+        entry->second.gattcRequestTime = 0;
+    }
+
+    uv_mutex_unlock(&mutex);
+}
+
+void ConnectionStatsTable::onTx(const uint16_t connHandle, const uint32_t packets, const size_t bytes, const bool unacknowledged)
+{
+    uv_mutex_lock(&mutex);
+
+    auto entry = connections.find(connHandle);
+
+    if (entry != connections.end())
+    {
+        auto &stats = entry->second;
+        stats.txPackets += packets;
+        stats.txBytes += bytes;
+
+        if (unacknowledged)
+        {
+            stats.txPendingPackets += packets;
+        }
+    }
+
+    uv_mutex_unlock(&mutex);
+}
+
+std::vector<std::pair<uint16_t, ConnectionStats>> ConnectionStatsTable::getSnapshot() const
+{
+    std::vector<std::pair<uint16_t, ConnectionStats>> snapshot;
+
+    uv_mutex_lock(&mutex);
+    snapshot.reserve(connections.size());
+
+    for (const auto &entry : connections)
+    {
+        snapshot.push_back(entry);
+    }
+
+    uv_mutex_unlock(&mutex);
+
+    return snapshot;
+}
+
+void ConnectionStatsTable::clear()
+{
+    uv_mutex_lock(&mutex);
+    connections.clear();
+    uv_mutex_unlock(&mutex);
+}
+
+void ConnectionStatsTable::reset()
+{
+    uv_mutex_lock(&mutex);
+
+    for (auto &entry : connections)
+    {
+        auto &stats = entry.second;
+        const auto txPendingPackets = stats.txPendingPackets;
+        const auto gattcRequestTime = stats.gattcRequestTime;
+
+        stats = ConnectionStats();
+        stats.txPendingPackets = txPendingPackets;
+        stats.gattcRequestTime = gattcRequestTime;
+    }
+
+    uv_mutex_unlock(&mutex);
+}
+
+uint16_t ConnectionStatsTable::getConnHandle(const ble_evt_t *event)
+{
+    const auto id = event->header.evt_id;
+
+    if (id >= BLE_GAP_EVT_BASE && id <= BLE_GAP_EVT_LAST)
+    {
+        return event->evt.gap_evt.conn_handle;
+    }
+
+    if (id >= BLE_GATTC_EVT_BASE && id <= BLE_GATTC_EVT_LAST)
+    {
+        return event->evt.gattc_evt.conn_handle;
+    }
+
+    if (id >= BLE_GATTS_EVT_BASE && id <= BLE_GATTS_EVT_LAST)
+    {
+        return event->evt.gatts_evt.conn_handle;
+    }
+
+    if (id >= BLE_EVT_BASE && id <= BLE_EVT_LAST)
+    {
+        return event->evt.common_evt.conn_handle;
+    }
+
+    return BLE_CONN_HANDLE_INVALID;
+}
+
+void ConnectionStatsTable::onTxComplete(ConnectionStats &stats, const uint16_t count)
+{
+    // The TX complete event of SoftDevice API v2 may also count acknowledged packets
+    stats.txPendingPackets = count < stats.txPendingPackets ? stats.txPendingPackets - count : 0;
+}
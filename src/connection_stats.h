@@ -0,0 +1,114 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONNECTION_STATS_H
+#define CONNECTION_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <uv.h>
+
+#include "sd_rpc.h"
+
+#include "latency_histogram.h"
+
+// Traffic of one connection since it was established or the statistics were reset
+struct ConnectionStats
+{
+    ConnectionStats();
+
+    // Notifications, indications, read responses and writes received
+    uint64_t rxPackets;
+    uint64_t rxBytes;
+    // Writes, notifications and indications accepted by the SoftDevice
+    uint64_t txPackets;
+    uint64_t txBytes;
+    // Write commands and notifications accepted by the SoftDevice, not yet reported transmitted
+    uint32_t txPendingPackets;
+    uint32_t gattcTimeoutCount;
+    uint32_t gattsTimeoutCount;
+    // Events of the connection dropped by the event queue overflow policy
+    uint32_t droppedEventCount;
+    // Time from a GATT client request is made until its response is received, in microseconds
+    LatencyHistogram gattcLatency;
+
+    // Time the outstanding GATT client request was made, 0 if there is none
+    uint64_t gattcRequestTime;
+};
+
+// Statistics of the connections of an adapter, by connection handle. Events are counted in the
+// SoftDevice driver thread, requests and transmitted packets in the thread that makes them, so
+// all methods lock.
+class ConnectionStatsTable
+{
+public:
+    ConnectionStatsTable();
+    ~ConnectionStatsTable();
+
+    ConnectionStatsTable(const ConnectionStatsTable &) = delete;
+    ConnectionStatsTable &operator=(const ConnectionStatsTable &) = delete;
+
+    // Called for every event from the SoftDevice, before it is queued or handled by a GATT client procedure
+    void onEvent(const ble_evt_t *event, const uint64_t timestamp);
+    void onEventDropped(const ble_evt_t *event);
+    // A GATT client request has been made, the next response of the connection completes it
+    void onGattcRequest(const uint16_t connHandle, const uint64_t timestamp);
+    // The GATT client request made at timestamp failed, no response will complete it
+    void onGattcRequestFailed(const uint16_t connHandle, const uint64_t timestamp);
+    // Packets accepted by the SoftDevice, unacknowledged packets are pending until a TX complete event
+    void onTx(const uint16_t connHandle, const uint32_t packets, const size_t bytes, const bool unacknowledged);
+
+    std::vector<std::pair<uint16_t, ConnectionStats>> getSnapshot() const;
+    // Clears the statistics of the connections, but keeps the connections and their pending packets
+    void reset();
+    // Drops all connections, they are gone without disconnect events when the connectivity device is reset
+    void clear();
+
+    // Connection handle of an event, BLE_CONN_HANDLE_INVALID if the event is not for a connection
+    static uint16_t getConnHandle(const ble_evt_t *event);
+
+private:
+    void onTxComplete(ConnectionStats &stats, const uint16_t count);
+
+    std::map<uint16_t, ConnectionStats> connections;
+    mutable uv_mutex_t mutex;
+};
+
+#endif // CONNECTION_STATS_H
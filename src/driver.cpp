@@ -38,6 +38,10 @@
 #include <mutex>
 #include <sstream>
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
 
 #include "sd_rpc.h"
 #include "adapter.h"
@@ -49,61 +53,11 @@
 #include "driver_gattc.h"
 #include "driver_gatts.h"
 #include "driver_uecc.h"
+#include "driver_replay.h"
+#include "event_dispatch.h"
 
 using namespace std;
 
-// Variable to use to handle callbacks while device is opened and the corresponding callbacks is not fully operational
-Adapter *adapterBeingOpened = nullptr;
-
-// Macro for keeping sanity in event switch case below
-#define COMMON_EVT_CASE(evt_enum, evt_to_js, params_name, event_array, event_array_idx, eventEntry) \
-    case BLE_EVT_##evt_enum:                                                                                         \
-    {                                                                                                                \
-        ble_common_evt_t common_event = eventEntry->event->evt.common_evt;                                           \
-        std::string timestamp = eventEntry->timestamp;                                                               \
-        v8::Local<v8::Value> js_event =                                                                              \
-            Common##evt_to_js##Event(timestamp, common_event.conn_handle, &(common_event.params.params_name)).ToJs();\
-        Nan::Set(event_array, event_array_idx, js_event);                                                            \
-        break;                                                                                                       \
-    }
-
-
-// Macro for keeping sanity in event switch case below
-#define GAP_EVT_CASE(evt_enum, evt_to_js, params_name, event_array, event_array_idx, eventEntry) \
-    case BLE_GAP_EVT_##evt_enum:                                                                                     \
-    {                                                                                                                \
-        ble_gap_evt_t gap_event = eventEntry->event->evt.gap_evt;                                                    \
-        std::string timestamp = eventEntry->timestamp;                                                               \
-        v8::Local<v8::Object> js_event =                                                                             \
-            Gap##evt_to_js(timestamp, gap_event.conn_handle, &(gap_event.params.params_name)).ToJs();                \
-        Nan::Set(event_array, event_array_idx, js_event);                                                            \
-        break;                                                                                                       \
-    }
-
-// Macro for keeping sanity in event switch case below
-#define GATTC_EVT_CASE(evt_enum, evt_to_js, params_name, event_array, event_array_idx, eventEntry) \
-    case BLE_GATTC_EVT_##evt_enum:                                                                                   \
-    {                                                                                                                \
-        ble_gattc_evt_t *gattc_event = &(eventEntry->event->evt.gattc_evt);                                          \
-        std::string timestamp = eventEntry->timestamp;                                                               \
-        v8::Local<v8::Value> js_event =                                                                              \
-            Gattc##evt_to_js##Event(timestamp, gattc_event->conn_handle, gattc_event->gatt_status, gattc_event->error_handle, &(gattc_event->params.params_name)).ToJs(); \
-        Nan::Set(event_array, event_array_idx, js_event);                                                            \
-        break;                                                                                                       \
-    }
-
-// Macro for keeping sanity in event switch case below
-#define GATTS_EVT_CASE(evt_enum, evt_to_js, params_name, event_array, event_array_idx, eventEntry)                   \
-    case BLE_GATTS_EVT_##evt_enum:                                                                                   \
-    {                                                                                                                \
-        ble_gatts_evt_t *gatts_event = &(eventEntry->event->evt.gatts_evt);                                          \
-        std::string timestamp = eventEntry->timestamp;                                                               \
-        v8::Local<v8::Value> js_event =                                                                              \
-            Gatts##evt_to_js##Event(timestamp, gatts_event->conn_handle, &(gatts_event->params.params_name)).ToJs(); \
-        Nan::Set(event_array, event_array_idx, js_event);                                                            \
-        break;                                                                                                       \
-    }
-
 static name_map_t uuid_type_name_map = {
     NAME_MAP_ENTRY(BLE_UUID_TYPE_UNKNOWN),
     NAME_MAP_ENTRY(BLE_UUID_TYPE_BLE),
@@ -113,15 +67,14 @@ static name_map_t uuid_type_name_map = {
 // This function is ran by the thread that the SoftDevice Driver has initiated
 void sd_rpc_on_log_event(adapter_t *adapter, sd_rpc_log_severity_t severity, const char *log_message)
 {
-    auto logEntry = new LogEntry();
-    logEntry->message = std::string(log_message);
-    logEntry->severity = severity;
-
-    auto jsAdapter = Adapter::getAdapter(adapter, adapterBeingOpened);
+    auto jsAdapter = Adapter::getAdapter(adapter);
 
     if (jsAdapter != nullptr)
     {
-        jsAdapter->appendLog(logEntry);
+        if (jsAdapter->acceptsLog(severity))
+        {
+            jsAdapter->appendLog(severity, log_message);
+        }
     }
     else
     {
@@ -130,40 +83,190 @@ void sd_rpc_on_log_event(adapter_t *adapter, sd_rpc_log_severity_t severity, con
     }
 }
 
-void Adapter::appendLog(LogEntry *log)
+bool Adapter::acceptsLog(const sd_rpc_log_severity_t severity) const
+{
+    return static_cast<int>(severity) >= logSeverityFilter.load(std::memory_order_relaxed);
+}
+
+void Adapter::setLogSeverityFilter(const sd_rpc_log_severity_t severity)
+{
+    logSeverityFilter = static_cast<int>(severity);
+}
+
+void Adapter::setLogFile(const std::string &path)
+{
+    logFileOpen = false;
+
+    if (path.empty())
+    {
+        logFileSink.close();
+    }
+    else
+    {
+        logFileSink.open(path);
+        logFileOpen = true;
+    }
+}
+
+void Adapter::setEventCapture(const std::string &path, const size_t segmentSize)
+{
+    if (path.empty())
+    {
+        eventCapture.close();
+    }
+    else
+    {
+        eventCapture.open(path, segmentSize, NRF_SD_BLE_API_VERSION);
+    }
+}
+
+bool Adapter::queueLog(const sd_rpc_log_severity_t severity, const uint64_t timestamp, const char *message, const size_t length,
+                       const bool toJs, const bool toFile)
+{
+    auto logEntry = logPool.acquire();
+
+    if (logEntry == nullptr)
+    {
+        ++logDroppedCount;
+        return false;
+    }
+
+    logEntry->severity = severity;
+    logEntry->timestamp = timestamp;
+    logEntry->length = std::min(length, LOG_ENTRY_MESSAGE_SIZE);
+    std::memcpy(logEntry->message, message, logEntry->length);
+    logEntry->toJs = toJs;
+    logEntry->toFile = toFile;
+
+    // The pool and the queue have the same size, a slot taken from the pool always fits
+    logQueue.push(logEntry);
+    updateHighWaterMark(logQueueHighWaterMark, logQueue.size());
+
+    return true;
+}
+
+void Adapter::appendLog(const sd_rpc_log_severity_t severity, const char *message)
 {
-    if (asyncLog != nullptr)
+    if (asyncLog == nullptr)
+    {
+        return;
+    }
+
+    const auto timestamp = getMonotonicTimeInMicroseconds();
+    const auto length = std::strlen(message);
+    // The file gets every message, the rate limit only applies to JavaScript
+    const auto toFile = logFileOpen.load(std::memory_order_relaxed);
+    auto toJs = false;
+    auto queued = false;
+    uint32_t suppressed;
+
+    uv_mutex_lock(&logQueueMutex);
+
+    if (logRateLimiter.admit(timestamp, suppressed))
+    {
+        if (suppressed > 0)
+        {
+            char summary[64];
+            const auto summaryLength = std::snprintf(summary, sizeof(summary), "%u log messages suppressed", suppressed);
+            queued = queueLog(SD_RPC_LOG_WARNING, timestamp, summary, static_cast<size_t>(summaryLength), true, false);
+        }
+
+        toJs = true;
+    }
+    else
+    {
+        ++logSuppressedCount;
+    }
+
+    if (toJs || toFile)
+    {
+        queued = queueLog(severity, timestamp, message, length, toJs, toFile) || queued;
+    }
+
+    uv_mutex_unlock(&logQueueMutex);
+
+    if (queued)
     {
-        logQueue.push(log);
         uv_async_send(asyncLog.get());
     }
 }
 
+void Adapter::writeLogFile(LogEntry *const *logEntries, const size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (logEntries[i]->toFile)
+        {
+            logFileSink.write(logEntries[i]->timestamp, static_cast<uint8_t>(logEntries[i]->severity),
+                              logEntries[i]->message, logEntries[i]->length);
+        }
+    }
+}
+
 // Now we are in the NodeJS thread. Call callbacks.
 void Adapter::onLogEvent(uv_async_t *handle)
 {
     Nan::HandleScope scope;
 
-    while (!logQueue.wasEmpty())
+    LogEntry *logEntries[LOG_QUEUE_SIZE];
+    const auto logEntryCount = logQueue.pop_n(logEntries, LOG_QUEUE_SIZE);
+
+    if (logEntryCount == 0)
     {
-        LogEntry *logEntry;
-        logQueue.pop(logEntry);
+        return;
+    }
 
-        if (logCallback != nullptr)
+    writeLogFile(logEntries, logEntryCount);
+
+    LogEntry *jsEntries[LOG_QUEUE_SIZE];
+    size_t jsEntryCount = 0;
+
+    for (size_t i = 0; i < logEntryCount; ++i)
+    {
+        if (logEntries[i]->toJs)
         {
-            v8::Local<v8::Value> argv[2];
-            argv[0] = ConversionUtility::toJsNumber(static_cast<int>(logEntry->severity));
-            argv[1] = ConversionUtility::toJsString(logEntry->message);
-            Nan::AsyncResource resource("pc-ble-driver-js:callback");
-            logCallback->Call(2, argv, &resource);
+            jsEntries[jsEntryCount++] = logEntries[i];
         }
-        else
+    }
+
+    if (logCallback == nullptr)
+    {
+        if (jsEntryCount > 0)
         {
             std::cerr << "Log event received, but no callback is registered." << std::endl;
         }
+    }
+    else if (logBatch && jsEntryCount > 0)
+    {
+        v8::Local<v8::Array> batch = Nan::New<v8::Array>(static_cast<uint32_t>(jsEntryCount));
+
+        for (size_t i = 0; i < jsEntryCount; ++i)
+        {
+            v8::Local<v8::Array> entry = Nan::New<v8::Array>(2);
+            Nan::Set(entry, 0, ConversionUtility::toJsNumber(static_cast<int>(jsEntries[i]->severity)));
+            Nan::Set(entry, 1, Nan::New<v8::String>(jsEntries[i]->message, static_cast<int>(jsEntries[i]->length)).ToLocalChecked());
+            Nan::Set(batch, static_cast<uint32_t>(i), entry);
+        }
+
+        v8::Local<v8::Value> argv[1] = { batch };
+        Nan::AsyncResource resource("pc-ble-driver-js:callback");
+        logCallback->Call(1, argv, &resource);
+    }
+    else
+    {
+        for (size_t i = 0; i < jsEntryCount; ++i)
+        {
+            v8::Local<v8::Value> argv[2];
+            argv[0] = ConversionUtility::toJsNumber(static_cast<int>(jsEntries[i]->severity));
+            argv[1] = Nan::New<v8::String>(jsEntries[i]->message, static_cast<int>(jsEntries[i]->length)).ToLocalChecked();
+            Nan::AsyncResource resource("pc-ble-driver-js:callback");
+            logCallback->Call(2, argv, &resource);
+        }
+    }
 
-        // Free memory for current entry, we remove the element from the deque when the iteration is done
-        delete logEntry;
+    for (size_t i = 0; i < logEntryCount; ++i)
+    {
+        logPool.release(logEntries[i]);
     }
 }
 
@@ -178,7 +281,8 @@ void Adapter::dispatchEvents()
     else
     {
         // Adapter::cleanUpV8Resources() sets the Adapter::asyncEvent object to null.
-        // Adapter::cleanUpV8Resources() is called from both Adapter::AfterClose and Adapter::AfterConnReset
+        // Adapter::cleanUpV8Resources() is called from Adapter::AfterClose, Adapter::AfterConnReset keeps
+        // the event handling, see Adapter::ConnReset
         //
         // If Adapter::eventInterval is 0, this method, Adapter::dispatchEvents, will be called directly without being
         // invoked from eventIntervalTimer.
@@ -219,7 +323,7 @@ static void sd_rpc_on_event(adapter_t *adapter, ble_evt_t *event)
         return;
     }
 
-    auto jsAdapter = Adapter::getAdapter(adapter, adapterBeingOpened);
+    auto jsAdapter = Adapter::getAdapter(adapter);
 
     if (jsAdapter != nullptr)
     {
@@ -234,346 +338,1975 @@ static void sd_rpc_on_event(adapter_t *adapter, ble_evt_t *event)
 
 void Adapter::appendEvent(ble_evt_t *event)
 {
-    eventCallbackCount += 1;
-    eventCallbackBatchEventCounter += 1;
+    // Taken before waiting for a slot, so the timestamp is the time the event was received
+    const auto timestamp = getMonotonicTimeInMicroseconds();
 
-    if (eventCallbackBatchEventCounter > eventCallbackMaxCount)
+    if (eventCapture.isOpen())
     {
-        eventCallbackMaxCount = eventCallbackBatchEventCounter;
+        if (event->header.evt_id == BLE_GAP_EVT_LESC_DHKEY_REQUEST)
+        {
+            // The peer key is only pointed to by the event, it is captured inline after it, see EventCapture
+            static_assert(sizeof(ble_evt_t) + sizeof(ble_gap_lesc_p256_pk_t) <= EVENT_ENTRY_SIZE,
+                          "A LESC DHKey request and its peer key must fit in an event entry");
+            alignas(ble_evt_t) uint8_t record[sizeof(ble_evt_t) + sizeof(ble_gap_lesc_p256_pk_t)];
+            memcpy(record, event, sizeof(ble_evt_t));
+            memcpy(record + sizeof(ble_evt_t), event->evt.gap_evt.params.lesc_dhkey_request.p_pk_peer,
+                   sizeof(ble_gap_lesc_p256_pk_t));
+            eventCapture.write(adapterId, timestamp, record, static_cast<uint16_t>(sizeof(record)));
+        }
+        else
+        {
+            // The fixed part of the event is captured even if the driver reports a shorter length
+            const auto length = std::min<size_t>(std::max<size_t>(event->header.evt_len, sizeof(ble_evt_t)), EVENT_ENTRY_SIZE);
+            eventCapture.write(adapterId, timestamp, event, static_cast<uint16_t>(length));
+        }
     }
 
-    // Allocate memory to store decoded event including an unkown quantity of padding, use the same size as serialization_transport.cpp
-    const int size = 512;
+    connectionStats.onEvent(event, timestamp);
 
-    auto evt = malloc(size);
-    memset(evt, 0, size);
-    memcpy(evt, event, size);
+    // Packet receipts of a DFU object write are checked in this thread and not passed on
+    if (writeStreamCount > 0 && updateWriteStreams(event))
+    {
+        return;
+    }
 
-    auto eventEntry = new EventEntry();
-    eventEntry->event = static_cast<ble_evt_t*>(evt);
-    eventEntry->timestamp = getCurrentTimeInMilliseconds();
+    // Responses to a GATT client procedure are handled in this thread and not passed on
+    if (gattcProcedureCount > 0 && updateGattcProcedures(event))
+    {
+        return;
+    }
 
-    eventQueue.push(eventEntry);
+    // Time critical requests are replied to here when a policy is set, JavaScript is only informed
+    const auto autoReplied = autoReply(event) || updateBondStore(event);
 
-    // If the event interval is not set, send the events to NodeJS as soon as possible.
-    if (eventInterval == 0)
+    // Scan reports rejected by the filter or de-duplication never take a slot in the event queue
+    if (event->header.evt_id == BLE_GAP_EVT_ADV_REPORT && !isAdvReportAccepted(event->evt.gap_evt.params.adv_report, timestamp))
     {
-        dispatchEvents();
+        return;
     }
+
+    pushEvent(event, timestamp, autoReplied);
 }
 
-// Now we are in the NodeJS thread. Call callbacks.
-void Adapter::onRpcEvent(uv_async_t *handle)
+void Adapter::pushEvent(const ble_evt_t *event, const uint64_t timestamp, const bool autoReplied)
 {
-    Nan::HandleScope scope;
+    eventCallbackCount += 1;
+    eventCallbackBatchEventCounter += 1;
+
+    if (eventCallbackBatchEventCounter > eventCallbackMaxCount)
+    {
+        eventCallbackMaxCount = eventCallbackBatchEventCounter;
+    }
 
-    if (eventQueue.wasEmpty())
+    // Store the decoded event in a preallocated slot. The slots are returned to the pool in onRpcEvent.
+    auto eventEntry = acquireEventEntry(event, timestamp);
+
+    if (eventEntry == nullptr)
     {
+        // Event dropped by the overflow policy
         return;
     }
 
-    auto array = Nan::New<v8::Array>();
-    auto arrayIndex = 0;
+    memcpy(eventEntry->data, event, EVENT_ENTRY_SIZE);
+    eventEntry->timestamp = timestamp;
 
-    while (!eventQueue.wasEmpty())
+    if (event->header.evt_id == BLE_GAP_EVT_LESC_DHKEY_REQUEST)
     {
-        EventEntry *eventEntry = nullptr;
-        eventQueue.pop(eventEntry);
+        // A peer key carried inside the event, as by a replay, is moved with it
+        const auto base = reinterpret_cast<uintptr_t>(event);
+        const auto key = reinterpret_cast<uintptr_t>(event->evt.gap_evt.params.lesc_dhkey_request.p_pk_peer);
 
-        if (eventEntry == nullptr)
+        if (key >= base && key < base + EVENT_ENTRY_SIZE)
         {
-            std::cerr << "eventEntry from queue is null. Illegal state, terminating." << std::endl;
-            std::terminate();
+            eventEntry->event->evt.gap_evt.params.lesc_dhkey_request.p_pk_peer =
+                reinterpret_cast<ble_gap_lesc_p256_pk_t *>(eventEntry->data + (key - base));
         }
+    }
+    eventEntry->autoReplied = autoReplied;
+    eventEntry->queued();
 
-        auto event = eventEntry->event;
-        if (eventEntry == nullptr)
+    eventQueue.push(eventEntry);
+
+    const auto pending = eventQueue.size();
+    updateHighWaterMark(eventQueueHighWaterMark, pending);
+
+    if (eventBatchLatency != 0)
+    {
+        // Adaptive batching, wake the NodeJS thread for the first event of a batch to start the
+        // latency timer, and when the batch is full. Events in between do not need a wake up.
+
+        if (pending == 1)
         {
-            std::cerr << "event from eventEntry is null. Illegal state, terminating." << std::endl;
-            std::terminate();
+            eventBatchStart = timestamp;
+            dispatchEvents();
         }
+        else if (pending >= eventBatchSize)
+        {
+            dispatchEvents();
+        }
+    }
+    else if (eventInterval == 0)
+    {
+        // If the event interval is not set, send the events to NodeJS as soon as possible.
+        dispatchEvents();
+    }
+}
 
-        if (eventCallback != nullptr)
+bool Adapter::autoReply(const ble_evt_t *event)
+{
+    const auto evtId = event->header.evt_id;
+
+    if (evtId == BLE_GAP_EVT_CONNECTED || evtId == BLE_GAP_EVT_DISCONNECTED)
+    {
+        const auto connHandle = event->evt.gap_evt.conn_handle;
+
+        uv_mutex_lock(&autoReplyMutex);
+
+        if (evtId == BLE_GAP_EVT_DISCONNECTED)
         {
-            switch (event->header.evt_id)
-            {
-                COMMON_EVT_CASE(USER_MEM_REQUEST,       MemRequest,         user_mem_request,       array, arrayIndex, eventEntry);
-                COMMON_EVT_CASE(USER_MEM_RELEASE,       MemRelease,         user_mem_release,       array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(CONNECTED,                 Connected,              connected,                  array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(DISCONNECTED,              Disconnected,           disconnected,               array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(CONN_PARAM_UPDATE,         ConnParamUpdate,        conn_param_update,          array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(SEC_PARAMS_REQUEST,        SecParamsRequest,       sec_params_request,         array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(SEC_INFO_REQUEST,          SecInfoRequest,         sec_info_request,           array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(PASSKEY_DISPLAY,           PasskeyDisplay,         passkey_display,            array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(KEY_PRESSED,               KeyPressed,             key_pressed,                array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(AUTH_KEY_REQUEST,          AuthKeyRequest,         auth_key_request,           array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(LESC_DHKEY_REQUEST,        LESCDHKeyRequest,       lesc_dhkey_request,         array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(AUTH_STATUS,               AuthStatus,             auth_status,                array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(CONN_SEC_UPDATE,           ConnSecUpdate,          conn_sec_update,            array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(TIMEOUT,                   Timeout,                timeout,                    array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(RSSI_CHANGED,              RssiChanged,            rssi_changed,               array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(ADV_REPORT,                AdvReport,              adv_report,                 array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(SEC_REQUEST,               SecRequest,             sec_request,                array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(CONN_PARAM_UPDATE_REQUEST, ConnParamUpdateRequest, conn_param_update_request,  array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(SCAN_REQ_REPORT,           ScanReqReport,          scan_req_report,            array, arrayIndex, eventEntry);
-#if NRF_SD_BLE_API_VERSION <= 3
-                COMMON_EVT_CASE(TX_COMPLETE, TXComplete, tx_complete, array, arrayIndex, eventEntry);
-#endif
+            peripheralConnections.erase(connHandle);
+        }
+        else if (event->evt.gap_evt.params.connected.role == BLE_GAP_ROLE_PERIPH)
+        {
+            peripheralConnections.insert(connHandle);
+        }
 
-#if NRF_SD_BLE_API_VERSION >= 5
-                GAP_EVT_CASE(DATA_LENGTH_UPDATE_REQUEST, DataLengthUpdateRequest, data_length_update_request, array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(DATA_LENGTH_UPDATE,         DataLengthUpdateEvt,     data_length_update,         array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(PHY_UPDATE_REQUEST,         PhyUpdateRequest,        phy_update_request,         array, arrayIndex, eventEntry);
-                GAP_EVT_CASE(PHY_UPDATE,                 PhyUpdateEvt,            phy_update,                 array, arrayIndex, eventEntry);
-#endif
+        uv_mutex_unlock(&autoReplyMutex);
+        return false;
+    }
 
-                GATTC_EVT_CASE(PRIM_SRVC_DISC_RSP,          PrimaryServiceDiscovery,       prim_srvc_disc_rsp,         array, arrayIndex, eventEntry);
-                GATTC_EVT_CASE(REL_DISC_RSP,                RelationshipDiscovery,         rel_disc_rsp,               array, arrayIndex, eventEntry);
-                GATTC_EVT_CASE(CHAR_DISC_RSP,               CharacteristicDiscovery,       char_disc_rsp,              array, arrayIndex, eventEntry);
-                GATTC_EVT_CASE(DESC_DISC_RSP,               DescriptorDiscovery,           desc_disc_rsp,              array, arrayIndex, eventEntry);
-                GATTC_EVT_CASE(CHAR_VAL_BY_UUID_READ_RSP,   CharacteristicValueReadByUUID, char_val_by_uuid_read_rsp,  array, arrayIndex, eventEntry);
-                GATTC_EVT_CASE(READ_RSP,                    Read,                          read_rsp,                   array, arrayIndex, eventEntry);
-                GATTC_EVT_CASE(CHAR_VALS_READ_RSP,          CharacteristicValueRead,       char_vals_read_rsp,         array, arrayIndex, eventEntry);
-                GATTC_EVT_CASE(WRITE_RSP,                   Write,                         write_rsp,                  array, arrayIndex, eventEntry);
-                GATTC_EVT_CASE(HVX,                         HandleValueNotification,       hvx,                        array, arrayIndex, eventEntry);
-                GATTC_EVT_CASE(TIMEOUT,                     Timeout,                       timeout,                    array, arrayIndex, eventEntry);
+    switch (evtId)
+    {
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST:
+        case BLE_GAP_EVT_SEC_PARAMS_REQUEST:
+        case BLE_GAP_EVT_LESC_DHKEY_REQUEST:
 #if NRF_SD_BLE_API_VERSION >= 5
-                GATTC_EVT_CASE(EXCHANGE_MTU_RSP,        ExchangeMtuResponse,    exchange_mtu_rsp,      array, arrayIndex, eventEntry);
-                GATTC_EVT_CASE(WRITE_CMD_TX_COMPLETE,   WriteCmdTxComplete,     write_cmd_tx_complete, array, arrayIndex, eventEntry);
+        case BLE_GAP_EVT_DATA_LENGTH_UPDATE_REQUEST:
+        case BLE_GAP_EVT_PHY_UPDATE_REQUEST:
+        case BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST:
 #endif
+            break;
+        default:
+            return false;
+    }
+
+    auto connHandle = event->evt.gap_evt.conn_handle;
 
-                GATTS_EVT_CASE(WRITE,                   Write,                  write,              array, arrayIndex, eventEntry);
-                GATTS_EVT_CASE(RW_AUTHORIZE_REQUEST,    RWAuthorizeRequest,     authorize_request,  array, arrayIndex, eventEntry);
-                GATTS_EVT_CASE(SYS_ATTR_MISSING,        SystemAttributeMissing, sys_attr_missing,   array, arrayIndex, eventEntry);
-                GATTS_EVT_CASE(HVC,                     HVC,                    hvc,                array, arrayIndex, eventEntry);
-                GATTS_EVT_CASE(TIMEOUT,                 Timeout,                timeout,            array, arrayIndex, eventEntry);
 #if NRF_SD_BLE_API_VERSION >= 5
-                GATTS_EVT_CASE(EXCHANGE_MTU_REQUEST,    ExchangeMtuRequest,     exchange_mtu_request, array, arrayIndex, eventEntry);
-                GATTS_EVT_CASE(HVN_TX_COMPLETE,         HvnTxComplete,          hvn_tx_complete,      array, arrayIndex, eventEntry);
+    if (evtId == BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST)
+    {
+        connHandle = event->evt.gatts_evt.conn_handle;
+    }
 #endif
 
-                // Handled special as there is no parameter for this in the event struct.
-                GATTS_EVT_CASE(SC_CONFIRM, SCConfirm, timeout, array, arrayIndex, eventEntry);
-            default:
-                std::cerr << "Event " << event->header.evt_id << " unknown to me." << std::endl;
-                break;
+    uv_mutex_lock(&autoReplyMutex);
+    const auto policy = autoReplyPolicy;
+    const auto isPeripheral = peripheralConnections.count(connHandle) > 0;
+    uv_mutex_unlock(&autoReplyMutex);
+
+    if (policy == nullptr)
+    {
+        return false;
+    }
+
+    uint32_t result;
+
+    switch (evtId)
+    {
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST:
+        {
+            if (!policy->repliesConnParams())
+            {
+                return false;
             }
 
-            //Special extra handling of some events:
-            if (event->header.evt_id == BLE_GAP_EVT_AUTH_STATUS)
+            if (policy->rejectsConnParams())
             {
-                auto keyset = getSecurityKey(event->evt.gap_evt.conn_handle);
+                result = sd_ble_gap_conn_param_update(adapter, connHandle, nullptr);
+            }
+            else
+            {
+                auto params = policy->clampConnParams(event->evt.gap_evt.params.conn_param_update_request.conn_params);
+                result = sd_ble_gap_conn_param_update(adapter, connHandle, &params);
+            }
 
-                v8::Local<v8::Object> obj = Nan::To<v8::Object>(Utility::Get(array, arrayIndex)).ToLocalChecked();
+            break;
+        }
+        case BLE_GAP_EVT_SEC_PARAMS_REQUEST:
+        {
+            // In the central role the parameters were given when pairing was started
+            if (!policy->repliesSecParams() || !isPeripheral)
+            {
+                return false;
+            }
 
-                if (keyset != 0)
-                {
-                    Utility::Set(obj, "keyset", static_cast<v8::Handle<v8::Value>>(GapSecKeyset(keyset)));
-                }
-                else
-                {
-                    Utility::Set(obj, "keyset", Nan::Null());
-                }
+            // Same storage as the keysets given to gapReplySecurityParameters, read at BLE_GAP_EVT_AUTH_STATUS
+            ble_gap_sec_keyset_t keyset;
+            keyset.keys_own.p_enc_key = new ble_gap_enc_key_t();
+            keyset.keys_own.p_id_key = new ble_gap_id_key_t();
+            keyset.keys_own.p_sign_key = new ble_gap_sign_info_t();
+            keyset.keys_own.p_pk = new ble_gap_lesc_p256_pk_t();
+            keyset.keys_peer.p_enc_key = new ble_gap_enc_key_t();
+            keyset.keys_peer.p_id_key = new ble_gap_id_key_t();
+            keyset.keys_peer.p_sign_key = new ble_gap_sign_info_t();
+            keyset.keys_peer.p_pk = new ble_gap_lesc_p256_pk_t();
 
-                destroySecurityKeyStorage(event->evt.gap_evt.conn_handle);
+            auto params = policy->getSecParams();
+
+            if (params.lesc)
+            {
+                *keyset.keys_own.p_pk = policy->getLescPublicKey();
             }
-        }
 
-        arrayIndex++;
+            destroySecurityKeyStorage(connHandle);
+            createSecurityKeyStorage(connHandle, &keyset);
 
-        // Free memory for current entry
-        free(eventEntry->event);
-        delete eventEntry;
-    }
+            result = sd_ble_gap_sec_params_reply(adapter, connHandle, BLE_GAP_SEC_STATUS_SUCCESS, &params, getSecurityKey(connHandle));
 
-    v8::Local<v8::Value> callback_value[1];
-    callback_value[0] = array;
+            if (result != NRF_SUCCESS)
+            {
+                destroySecurityKeyStorage(connHandle);
+            }
 
-    auto start = chrono::high_resolution_clock::now();
+            break;
+        }
+        case BLE_GAP_EVT_LESC_DHKEY_REQUEST:
+        {
+            if (!policy->repliesLescDhkey())
+            {
+                return false;
+            }
 
-    if (eventCallback != nullptr)
-    {
-        Nan::AsyncResource resource("pc-ble-driver-js:callback");
-        eventCallback->Call(1, callback_value, &resource);
-    }
-    else
-    {
-        std::cerr << "BLE event received, but no callback is registered." << std::endl;
-    }
+            // The peer public key is only valid while the event is handled
+            ble_gap_lesc_dhkey_t dhkey;
 
-    auto end = chrono::high_resolution_clock::now();
+            if (!eccComputeSharedSecret(policy->getLescPrivateKey(),
+                                        event->evt.gap_evt.params.lesc_dhkey_request.p_pk_peer->pk,
+                                        dhkey.key))
+            {
+                std::cerr << "Auto reply to event " << evtId << " failed, not able to compute the DHKey" << std::endl;
+                return false;
+            }
 
-    auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
-    addEventBatchStatistics(duration);
-}
+            result = sd_ble_gap_lesc_dhkey_reply(adapter, connHandle, &dhkey);
+            break;
+        }
+#if NRF_SD_BLE_API_VERSION >= 5
+        case BLE_GAP_EVT_DATA_LENGTH_UPDATE_REQUEST:
+        {
+            if (!policy->repliesDataLength())
+            {
+                return false;
+            }
 
-static void sd_rpc_on_status(adapter_t *adapter, sd_rpc_app_status_t id, const char * message)
-{
-    auto statusEntry = new StatusEntry();
-    statusEntry->timestamp = getCurrentTimeInMilliseconds();
-    statusEntry->id = id;
-    statusEntry->message = std::string(message);
+            auto params = policy->getDataLengthParams();
+            result = sd_ble_gap_data_length_update(adapter, connHandle, &params, nullptr);
+            break;
+        }
+        case BLE_GAP_EVT_PHY_UPDATE_REQUEST:
+        {
+            if (!policy->repliesPhys())
+            {
+                return false;
+            }
 
-    auto jsAdapter = Adapter::getAdapter(adapter, adapterBeingOpened);
+            auto phys = policy->getPhys();
+            result = sd_ble_gap_phy_update(adapter, connHandle, &phys);
+            break;
+        }
+        case BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST:
+        {
+            if (!policy->repliesAttMtu())
+            {
+                return false;
+            }
 
-    if (jsAdapter != nullptr)
-    {
-        jsAdapter->appendStatus(statusEntry);
+            result = sd_ble_gatts_exchange_mtu_reply(adapter, connHandle, policy->getAttMtu());
+            break;
+        }
+#endif
+        default:
+            return false;
     }
-    else
+
+    if (result != NRF_SUCCESS)
     {
-        std::cerr << "No AddOn adapter to process BLE status event." << std::endl;
-        std::terminate();
+        std::cerr << "Auto reply to event " << evtId << " failed with error " << result << ", passing it on as a request." << std::endl;
+        return false;
     }
+
+    return true;
 }
 
-void Adapter::appendStatus(StatusEntry *status)
+bool Adapter::updateBondStore(const ble_evt_t *event)
 {
-    if (asyncStatus != nullptr)
+    const auto evtId = event->header.evt_id;
+
+    switch (evtId)
     {
-        statusQueue.push(status);
-        uv_async_send(asyncStatus.get());
+        case BLE_GAP_EVT_CONNECTED:
+        case BLE_GAP_EVT_DISCONNECTED:
+        case BLE_GAP_EVT_AUTH_STATUS:
+        case BLE_GAP_EVT_SEC_INFO_REQUEST:
+            break;
+        default:
+            return false;
     }
-}
 
-// Now we are in the NodeJS thread. Call callbacks.
-void Adapter::onStatusEvent(uv_async_t *handle)
-{
-    Nan::HandleScope scope;
+    const auto store = getBondStore();
 
-    while (!statusQueue.wasEmpty())
+    if (store == nullptr)
     {
-        StatusEntry *statusEntry;
-        statusQueue.pop(statusEntry);
+        return false;
+    }
 
-        if (statusCallback != nullptr)
+    const auto &gapEvent = event->evt.gap_evt;
+    const auto connHandle = gapEvent.conn_handle;
+
+    switch (evtId)
+    {
+        case BLE_GAP_EVT_CONNECTED:
         {
-            v8::Local<v8::Value> argv[1];
-            argv[0] = StatusMessage::getStatus(statusEntry->id, statusEntry->message, statusEntry->timestamp);
-            Nan::AsyncResource resource("pc-ble-driver-js:callback");
-            statusCallback->Call(1, argv, &resource);
+            store->onConnected(connHandle, gapEvent.params.connected.peer_addr);
+
+            ble_gap_enc_key_t key;
+
+            if (gapEvent.params.connected.role == BLE_GAP_ROLE_CENTRAL && store->encryptsOnConnect() &&
+                store->findEncryptionKey(connHandle, key))
+            {
+                const auto result = sd_ble_gap_encrypt(adapter, connHandle, &key.master_id, &key.enc_info);
+
+                if (result != NRF_SUCCESS)
+                {
+                    std::cerr << "Encrypting the connection to a bonded peer failed with error " << result << "." << std::endl;
+                }
+            }
+
+            return false;
         }
+        case BLE_GAP_EVT_DISCONNECTED:
+            store->onDisconnected(connHandle);
+            return false;
+        case BLE_GAP_EVT_AUTH_STATUS:
+        {
+            // The keys were written to the keyset given in the security parameters reply
+            const auto &status = gapEvent.params.auth_status;
+            auto keyset = getSecurityKey(connHandle);
 
-        // Free memory for current entry, we remove the element from the deque when the iteration is done
-        delete statusEntry;
+            if (status.auth_status == BLE_GAP_SEC_STATUS_SUCCESS && status.bonded && keyset != nullptr)
+            {
+                const ble_gap_addr_t *identity = nullptr;
+
+                if (status.kdist_peer.id && keyset->keys_peer.p_id_key != nullptr)
+                {
+                    identity = &keyset->keys_peer.p_id_key->id_addr_info;
+                }
+
+                store->addBond(connHandle, *keyset, identity);
+            }
+
+            return false;
+        }
+        default:
+        {
+            ble_gap_enc_info_t encInfo;
+
+            if (!store->findSecInfo(gapEvent.params.sec_info_request, encInfo))
+            {
+                return false;
+            }
+
+            const auto result = sd_ble_gap_sec_info_reply(adapter, connHandle, &encInfo, nullptr, nullptr);
+
+            if (result != NRF_SUCCESS)
+            {
+                std::cerr << "Reply from the bond store failed with error " << result << ", passing it on as a request." << std::endl;
+                return false;
+            }
+
+            return true;
+        }
     }
 }
 
-#if NRF_SD_BLE_API_VERSION <= 3
-v8::Local<v8::Object> CommonTXCompleteEvent::ToJs()
+std::shared_ptr<WriteStreamCredits> Adapter::startWriteStream(const uint16_t connHandle, const WriteStreamType type,
+                                                             const std::shared_ptr<DfuReceipts> &receipts)
 {
-    Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
-    BleDriverCommonEvent::ToJs(obj);
+    std::shared_ptr<WriteStreamCredits> credits;
 
-    Utility::Set(obj, "count", ConversionUtility::toJsNumber(evt->count));
+    uv_mutex_lock(&writeStreamsMutex);
 
-    return scope.Escape(obj);
+    const auto key = std::make_pair(connHandle, type);
+
+    if (writeStreams.find(key) == writeStreams.end())
+    {
+        credits = std::make_shared<WriteStreamCredits>();
+        writeStreams[key] = credits;
+
+        if (receipts != nullptr)
+        {
+            dfuReceipts[connHandle] = receipts;
+        }
+
+        writeStreamCount = static_cast<uint32_t>(writeStreams.size());
+    }
+
+    uv_mutex_unlock(&writeStreamsMutex);
+
+    return credits;
+}
+
+void Adapter::stopWriteStream(const uint16_t connHandle, const WriteStreamType type)
+{
+    uv_mutex_lock(&writeStreamsMutex);
+    writeStreams.erase(std::make_pair(connHandle, type));
+
+    if (type == WRITE_STREAM_GATTC_WRITE)
+    {
+        dfuReceipts.erase(connHandle);
+    }
+
+    writeStreamCount = static_cast<uint32_t>(writeStreams.size());
+    uv_mutex_unlock(&writeStreamsMutex);
 }
+
+// Hands TX complete and disconnect events to the write streams of the connection, and notifications
+// to the packet receipts of a DFU object write. Returns true if the event is a receipt that is due,
+// which is not passed on to JavaScript. This runs in the SoftDevice driver thread.
+bool Adapter::updateWriteStreams(const ble_evt_t *event)
+{
+    uint16_t connHandle;
+    uint16_t count = 0;
+    // Stream types the credits are for, the SoftDevice API v2 shares the TX queue between them
+    auto gattcWrite = false;
+    auto gattsHvx = false;
+
+    switch (event->header.evt_id)
+    {
+#if NRF_SD_BLE_API_VERSION >= 5
+        case BLE_GATTC_EVT_WRITE_CMD_TX_COMPLETE:
+            connHandle = event->evt.gattc_evt.conn_handle;
+            count = event->evt.gattc_evt.params.write_cmd_tx_complete.count;
+            gattcWrite = true;
+            break;
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+            connHandle = event->evt.gatts_evt.conn_handle;
+            count = event->evt.gatts_evt.params.hvn_tx_complete.count;
+            gattsHvx = true;
+            break;
+#else
+        case BLE_EVT_TX_COMPLETE:
+            connHandle = event->evt.common_evt.conn_handle;
+            count = event->evt.common_evt.params.tx_complete.count;
+            gattcWrite = true;
+            gattsHvx = true;
+            break;
 #endif
+        case BLE_GAP_EVT_DISCONNECTED:
+            connHandle = event->evt.gap_evt.conn_handle;
+            break;
+        case BLE_GATTC_EVT_HVX:
+            connHandle = event->evt.gattc_evt.conn_handle;
+            break;
+        default:
+            return false;
+    }
 
-v8::Local<v8::Object> CommonMemRequestEvent::ToJs()
+    auto consumed = false;
+
+    uv_mutex_lock(&writeStreamsMutex);
+
+    const auto receipts = dfuReceipts.find(connHandle);
+
+    if (receipts != dfuReceipts.end())
+    {
+        if (event->header.evt_id == BLE_GAP_EVT_DISCONNECTED)
+        {
+            receipts->second->abort();
+        }
+        else if (event->header.evt_id == BLE_GATTC_EVT_HVX)
+        {
+            const auto &hvx = event->evt.gattc_evt.params.hvx;
+
+            if (hvx.handle == receipts->second->getControlPointHandle())
+            {
+                consumed = receipts->second->add(hvx.data, hvx.len);
+            }
+        }
+    }
+
+    for (auto type : { WRITE_STREAM_GATTC_WRITE, WRITE_STREAM_GATTS_HVX })
+    {
+        auto stream = writeStreams.find(std::make_pair(connHandle, type));
+
+        if (stream == writeStreams.end())
+        {
+            continue;
+        }
+
+        if (event->header.evt_id == BLE_GAP_EVT_DISCONNECTED)
+        {
+            stream->second->abort();
+        }
+        else if ((type == WRITE_STREAM_GATTC_WRITE && gattcWrite) || (type == WRITE_STREAM_GATTS_HVX && gattsHvx))
+        {
+            stream->second->add(count);
+        }
+    }
+
+    uv_mutex_unlock(&writeStreamsMutex);
+
+    return consumed;
+}
+
+bool Adapter::startGattcProcedure(GattcProcedure *procedure, uv_async_t *asyncDone)
 {
-    Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
-    BleDriverCommonEvent::ToJs(obj);
+    const auto connHandle = procedure->getConnHandle();
+    auto started = false;
 
-    Utility::Set(obj, "type", ConversionUtility::toJsNumber(evt->type));
+    uv_mutex_lock(&gattcProceduresMutex);
 
-    return scope.Escape(obj);
+    if (gattcProcedures.find(connHandle) == gattcProcedures.end())
+    {
+        gattcProcedures[connHandle] = std::make_pair(procedure, asyncDone);
+        gattcProcedureCount = static_cast<uint32_t>(gattcProcedures.size());
+        started = true;
+    }
+
+    uv_mutex_unlock(&gattcProceduresMutex);
+
+    return started;
 }
 
+void Adapter::stopGattcProcedure(const uint16_t connHandle)
+{
+    uv_mutex_lock(&gattcProceduresMutex);
+    gattcProcedures.erase(connHandle);
+    gattcProcedureCount = static_cast<uint32_t>(gattcProcedures.size());
+    uv_mutex_unlock(&gattcProceduresMutex);
+}
 
-v8::Local<v8::Object> CommonMemReleaseEvent::ToJs()
+// This runs in the SoftDevice driver thread
+bool Adapter::updateGattcProcedures(const ble_evt_t *event)
 {
-    Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
-    BleDriverCommonEvent::ToJs(obj);
+    const auto id = event->header.evt_id;
+    uint16_t connHandle;
 
-    Utility::Set(obj, "type", ConversionUtility::toJsNumber(evt->type));
-    Utility::Set(obj, "mem_block", UserMemBlock(&evt->mem_block).ToJs());
+    if (id == BLE_GAP_EVT_DISCONNECTED)
+    {
+        connHandle = event->evt.gap_evt.conn_handle;
+    }
+    else if (id >= BLE_GATTC_EVT_BASE && id <= BLE_GATTC_EVT_LAST)
+    {
+        connHandle = event->evt.gattc_evt.conn_handle;
+    }
+    else
+    {
+        return false;
+    }
 
-    return scope.Escape(obj);
+    auto consumed = false;
+
+    uv_mutex_lock(&gattcProceduresMutex);
+
+    auto entry = gattcProcedures.find(connHandle);
+
+    if (entry != gattcProcedures.end())
+    {
+        auto procedure = entry->second.first;
+        const auto wasDone = procedure->isDone();
+
+        consumed = procedure->onEvent(event);
+
+        // The handle is only closed after the procedure is removed from gattcProcedures
+        if (!wasDone && procedure->isDone())
+        {
+            uv_async_send(entry->second.second);
+        }
+        else if (consumed)
+        {
+            // The procedure has made its next request
+            connectionStats.onGattcRequest(connHandle, getMonotonicTimeInMicroseconds());
+        }
+    }
+
+    uv_mutex_unlock(&gattcProceduresMutex);
+
+    return consumed;
 }
 
-// Class private method that is only used by the class to activate the SoftDevice in the Adapter
-uint32_t Adapter::enableBLE(adapter_t *adapter, enable_ble_params_t *enable_params)
+// This runs in the command thread, after the connectivity device has been reset
+void Adapter::resetConnections()
 {
-    // If the this->adapter has not been set yet it is because the Adapter::Open call has not set
-    // an adapter_t instance. The SoftDevice is started in Adapter::Open call and we do not have to
-    // take care of it here.
-    if (adapter == nullptr)
+    uv_mutex_lock(&gattcProceduresMutex);
+
+    // The procedures are removed from gattcProcedures when the NodeJS thread has handled them
+    for (auto &entry : gattcProcedures)
     {
-        return NRF_ERROR_INVALID_PARAM;
+        auto procedure = entry.second.first;
+
+        if (!procedure->isDone())
+        {
+            procedure->abort(BLE_ERROR_INVALID_CONN_HANDLE);
+            uv_async_send(entry.second.second);
+        }
     }
 
-#if NRF_SD_BLE_API_VERSION < 5
-    return sd_ble_enable(adapter, &enable_params->ble_enable_params, 0);
-#else
-    uint32_t result = NRF_SUCCESS;
-    const uint32_t app_ram_base = 0;
-    const uint8_t conn_cfg_tag = 1;
+    uv_mutex_unlock(&gattcProceduresMutex);
 
-    if (result == NRF_SUCCESS && enable_params->gap_conn_cfg)
+    // The streams are removed from writeStreams when their commands complete
+    uv_mutex_lock(&writeStreamsMutex);
+
+    for (auto &receipts : dfuReceipts)
     {
-        enable_params->gap_conn_cfg->conn_cfg.conn_cfg_tag = conn_cfg_tag;
-        result = sd_ble_cfg_set(adapter, BLE_CONN_CFG_GAP, enable_params->gap_conn_cfg, app_ram_base);
+        receipts.second->abort();
     }
-    if (result == NRF_SUCCESS && enable_params->gatt_conn_cfg)
+
+    for (auto &stream : writeStreams)
     {
-        enable_params->gatt_conn_cfg->conn_cfg.conn_cfg_tag = conn_cfg_tag;
-        result = sd_ble_cfg_set(adapter, BLE_CONN_CFG_GATT, enable_params->gatt_conn_cfg, app_ram_base);
+        stream.second->abort();
     }
-    if (result == NRF_SUCCESS && enable_params->gattc_conn_cfg)
+
+    uv_mutex_unlock(&writeStreamsMutex);
+
+    uv_mutex_lock(&autoReplyMutex);
+    peripheralConnections.clear();
+    uv_mutex_unlock(&autoReplyMutex);
+
+    connectionStats.clear();
+}
+
+// This runs in the NodeJS thread, after Adapter::resetConnections
+void Adapter::resetConnectionEvents()
+{
+    // The peers' notifications are gone with their connections
+    hvxRoutes.clear();
+
+    // Events of the connections held back by the connection limit, see Adapter::onRpcEvent
+    std::vector<EventEntry *> removed;
+    eventDemux.removeConnections(removed);
+
+    for (auto eventEntry : removed)
     {
-        enable_params->gattc_conn_cfg->conn_cfg.conn_cfg_tag = conn_cfg_tag;
-        result = sd_ble_cfg_set(adapter, BLE_CONN_CFG_GATTC, enable_params->gattc_conn_cfg, app_ram_base);
+        if (eventEntry->event->header.evt_id == BLE_GAP_EVT_AUTH_STATUS)
+        {
+            destroySecurityKeyStorage(eventEntry->event->evt.gap_evt.conn_handle);
+        }
+
+        eventPool.release(eventEntry);
     }
-    if (result == NRF_SUCCESS && enable_params->gatts_conn_cfg)
+}
+
+// Checks a scan report against the filter and de-duplication set by gapSetScanFilter.
+// This runs in the SoftDevice driver thread.
+bool Adapter::isAdvReportAccepted(const ble_gap_evt_adv_report_t &report, const uint64_t timestamp)
+{
+    if (!advReportFilterEnabled)
     {
-        enable_params->gatts_conn_cfg->conn_cfg.conn_cfg_tag = conn_cfg_tag;
-        result = sd_ble_cfg_set(adapter, BLE_CONN_CFG_GATTS, enable_params->gatts_conn_cfg, app_ram_base);
+        return true;
     }
-    if (result == NRF_SUCCESS && enable_params->l2cap_conn_cfg)
+
+    auto accepted = true;
+
+    uv_mutex_lock(&advReportFilterMutex);
+
+    if (advReportFilter != nullptr && !advReportFilter->accepts(report))
     {
-        enable_params->l2cap_conn_cfg->conn_cfg.conn_cfg_tag = conn_cfg_tag;
-        result = sd_ble_cfg_set(adapter, BLE_CONN_CFG_L2CAP, enable_params->l2cap_conn_cfg, app_ram_base);
+        advReportFilteredCount += 1;
+        accepted = false;
     }
-    if (result == NRF_SUCCESS && enable_params->common_cfg)
+    else if (advReportDedup != nullptr)
     {
-        result = sd_ble_cfg_set(adapter, BLE_COMMON_CFG_VS_UUID, enable_params->common_cfg, app_ram_base);
+        accepted = advReportDedup->accepts(report, timestamp);
+
+        if (accepted)
+        {
+            advReportDedupMissCount += 1;
+        }
+        else
+        {
+            advReportDedupHitCount += 1;
+        }
     }
-    if (result == NRF_SUCCESS && enable_params->gap_cfg)
+
+    uv_mutex_unlock(&advReportFilterMutex);
+
+    return accepted;
+}
+
+// Called by the producer of a queue, there is only one producer of each queue at a time
+void Adapter::updateHighWaterMark(std::atomic<uint32_t> &mark, const size_t depth)
+{
+    if (depth > mark.load(std::memory_order_relaxed))
     {
-        result = sd_ble_cfg_set(adapter, BLE_GAP_CFG_ROLE_COUNT, enable_params->gap_cfg, app_ram_base);
+        mark.store(static_cast<uint32_t>(depth), std::memory_order_relaxed);
     }
-    if (result == NRF_SUCCESS && enable_params->gatts_cfg_service_changed)
+}
+
+// Get a free slot for the event. If all slots are in the event queue, the queue is full and the
+// overflow policy decides what happens. The slots of events held back by the connection limit have
+// room of their own in the pool, see initEventHandling. Returns nullptr if the event shall be dropped, or is
+// already stored in a queued entry. This runs in the SoftDevice driver thread.
+EventEntry *Adapter::acquireEventEntry(const ble_evt_t *event, const uint64_t timestamp)
+{
+    auto eventEntry = eventPool.acquire();
+
+    if (eventEntry != nullptr)
     {
-        result = sd_ble_cfg_set(adapter, BLE_GATTS_CFG_SERVICE_CHANGED, enable_params->gatts_cfg_service_changed, app_ram_base);
+        return eventEntry;
     }
-    if (result == NRF_SUCCESS && enable_params->gatts_cfg_attr_tab_size)
+
+    switch (eventQueueOverflowPolicy)
+    {
+        case EVENT_QUEUE_OVERFLOW_BLOCK:
+            return waitForEventEntry();
+
+        case EVENT_QUEUE_OVERFLOW_DROP_OLDEST:
+            // Reuse the slot of the oldest event. If the queue was emptied in the meantime,
+            // the NodeJS thread is about to release its slots, wake it and wait for them.
+            while (!eventQueue.evict(eventEntry))
+            {
+                eventEntry = eventPool.acquire();
+
+                if (eventEntry != nullptr)
+                {
+                    return eventEntry;
+                }
+
+                // The queue is not drained anymore after the adapter is closed
+                if (asyncEvent == nullptr)
+                {
+                    eventQueueDroppedNewestCount++;
+                    connectionStats.onEventDropped(event);
+                    return nullptr;
+                }
+
+                dispatchEvents();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            eventQueueDroppedOldestCount++;
+            connectionStats.onEventDropped(eventEntry->event);
+            return eventEntry;
+
+        case EVENT_QUEUE_OVERFLOW_COALESCE_ADV_REPORTS:
+            if (event->header.evt_id != BLE_GAP_EVT_ADV_REPORT)
+            {
+                return waitForEventEntry();
+            }
+
+            // The newer report of a peer replaces its queued report. A report of a peer without
+            // one in the queue replaces the oldest queued report of another peer.
+            if (coalesceAdvReport(event, timestamp, true))
+            {
+                eventQueueCoalescedCount++;
+            }
+            else if (coalesceAdvReport(event, timestamp, false))
+            {
+                eventQueueDroppedOldestCount++;
+            }
+            else
+            {
+                eventQueueDroppedNewestCount++;
+            }
+
+            return nullptr;
+
+        case EVENT_QUEUE_OVERFLOW_DROP_NEWEST:
+        default:
+            eventQueueDroppedNewestCount++;
+            connectionStats.onEventDropped(event);
+            return nullptr;
+    }
+}
+
+// Block the SoftDevice driver thread until the NodeJS thread has released a slot
+EventEntry *Adapter::waitForEventEntry()
+{
+    eventQueueBlockedCount++;
+
+    // Make sure the NodeJS thread drains the queue also when an event interval is used
+    if (asyncEvent != nullptr)
+    {
+        dispatchEvents();
+    }
+
+    // Adapter::cleanUpV8Resources() sets asyncEvent to nullptr when the adapter is closed,
+    // after that the queue is not drained anymore.
+    while (asyncEvent != nullptr)
+    {
+        auto eventEntry = eventPool.acquire();
+
+        if (eventEntry != nullptr)
+        {
+            return eventEntry;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    eventQueueDroppedNewestCount++;
+    return nullptr;
+}
+
+// Overwrite a queued advertising report with event. If samePeer is set, the newest one from the same
+// peer as event, which keeps the order of the reports of the peer. Otherwise the oldest one, which is
+// only used when the peer has no report in the queue. Entries popped by the NodeJS thread meanwhile
+// are not overwritten, the next one is tried. Returns false if no report was overwritten.
+bool Adapter::coalesceAdvReport(const ble_evt_t *event, const uint64_t timestamp, const bool samePeer)
+{
+    const auto &report = event->evt.gap_evt.params.adv_report;
+    EventEntry *eventEntry;
+
+    // Entries are only found once, as they can not be queued again while this thread is here
+    std::set<const EventEntry *> popped;
+
+    const auto isCandidate = [&report, samePeer, &popped](const EventEntry *eventEntry) {
+        if (eventEntry->event->header.evt_id != BLE_GAP_EVT_ADV_REPORT || popped.count(eventEntry) != 0)
+        {
+            return false;
+        }
+
+        if (!samePeer)
+        {
+            return true;
+        }
+
+        const auto &pendingReport = eventEntry->event->evt.gap_evt.params.adv_report;
+
+#if NRF_SD_BLE_API_VERSION <= 5
+        if (pendingReport.scan_rsp != report.scan_rsp)
+        {
+            return false;
+        }
+#endif
+
+        return pendingReport.peer_addr.addr_type == report.peer_addr.addr_type
+            && memcmp(pendingReport.peer_addr.addr, report.peer_addr.addr, BLE_GAP_ADDR_LEN) == 0;
+    };
+
+    while (samePeer ? eventQueue.findLastPending(isCandidate, eventEntry) : eventQueue.findPending(isCandidate, eventEntry))
+    {
+        if (eventEntry->overwrite(event, timestamp))
+        {
+            return true;
+        }
+
+        popped.insert(eventEntry);
+    }
+
+    return false;
+}
+
+// Now we are in the NodeJS thread. Call callbacks.
+void Adapter::onRpcEvent(uv_async_t *handle)
+{
+    Nan::HandleScope scope;
+
+    // Events held back by the connection limit are not deferred again
+    if (eventDemux.size() == 0 && deferEventBatch())
+    {
+        return;
+    }
+
+    // Take all events available now in one pass, events appended after this are handled by the next async callback.
+    // The events held back by the connection limit count against the queue size, see initEventHandling.
+    const auto held = std::min(eventDemux.size(), eventBatch.size());
+    auto eventCount = eventQueue.pop_n(eventBatch.data(), eventBatch.size() - held);
+    auto events = eventBatch.data();
+
+    for (size_t i = 0; i < eventCount; ++i)
+    {
+        eventBatch[i]->take();
+    }
+
+    if (eventBatchConnectionLimit != 0)
+    {
+        for (size_t i = 0; i < eventCount; ++i)
+        {
+            eventDemux.add(eventBatch[i], ConnectionStatsTable::getConnHandle(eventBatch[i]->event));
+        }
+
+        eventDemux.take(eventDemuxBatch);
+        eventCount = eventDemuxBatch.size();
+        events = eventDemuxBatch.data();
+    }
+
+    if (eventCount == 0)
+    {
+        return;
+    }
+
+    // Several adapters share the NodeJS thread, use the value format of this adapter for the events below
+    ConversionUtility::setValueFormat(eventValueFormat);
+
+    // Not presized, batched scan reports take less than one element each
+    auto array = Nan::New<v8::Array>();
+    auto arrayIndex = 0;
+
+    // Arrays of routed HVX events, one for each route used in this pass
+    std::vector<std::pair<std::shared_ptr<Nan::Callback>, v8::Local<v8::Array>>> routedArrays;
+
+    for (size_t i = 0; i < eventCount; ++i)
+    {
+        auto eventEntry = events[i];
+        auto event = eventEntry->event;
+
+        const auto conversionStart = getMonotonicTimeInMicroseconds();
+        eventLatencyHistogram.record(conversionStart - eventEntry->timestamp);
+
+        if (event->header.evt_id == BLE_GAP_EVT_DISCONNECTED && !hvxRoutes.empty())
+        {
+            removeHvxRoutes(event->evt.gap_evt.conn_handle);
+        }
+
+        // Skipped before any conversion, only the key storage kept for the event must be freed
+        if (event->header.evt_id < EVENT_DESCRIPTOR_COUNT && !eventSubscription.test(event->header.evt_id))
+        {
+            if (event->header.evt_id == BLE_GAP_EVT_AUTH_STATUS)
+            {
+                destroySecurityKeyStorage(event->evt.gap_evt.conn_handle);
+            }
+
+            eventUnsubscribedCount++;
+            eventPool.release(eventEntry);
+            continue;
+        }
+
+        if (advReportBatchEnabled && event->header.evt_id == BLE_GAP_EVT_ADV_REPORT)
+        {
+            advReportBatch.add(event->evt.gap_evt.params.adv_report, eventEntry->timestamp);
+            eventPool.release(eventEntry);
+            continue;
+        }
+
+        if (event->header.evt_id == BLE_GATTC_EVT_HVX && !hvxRoutes.empty())
+        {
+            auto route = findHvxRoute(event->evt.gattc_evt);
+
+            if (route != nullptr)
+            {
+                auto routed = std::find_if(routedArrays.begin(), routedArrays.end(),
+                    [&route](const std::pair<std::shared_ptr<Nan::Callback>, v8::Local<v8::Array>> &candidate) {
+                        return candidate.first == route;
+                    });
+
+                if (routed == routedArrays.end())
+                {
+                    routedArrays.push_back(std::make_pair(route, Nan::New<v8::Array>()));
+                    routed = routedArrays.end() - 1;
+                }
+
+                const EventTime timestamp(eventEntry->timestamp, eventTimeFormat);
+                Nan::Set(routed->second, routed->second->Length(), findEventDescriptor(BLE_GATTC_EVT_HVX)->convert(event, timestamp));
+
+                eventConversionHistograms[BLE_GATTC_EVT_HVX].record(getMonotonicTimeInMicroseconds() - conversionStart);
+                eventRoutedCount++;
+                eventPool.release(eventEntry);
+                continue;
+            }
+        }
+
+        if (eventCallback != nullptr)
+        {
+            const auto descriptor = findEventDescriptor(event->header.evt_id);
+
+            if (descriptor != nullptr)
+            {
+                const EventTime timestamp(eventEntry->timestamp, eventTimeFormat);
+                Nan::Set(array, arrayIndex, descriptor->convert(event, timestamp));
+            }
+            else
+            {
+                std::cerr << "Event " << event->header.evt_id << " unknown to me." << std::endl;
+            }
+
+            //Special extra handling of some events:
+            if (event->header.evt_id == BLE_GAP_EVT_AUTH_STATUS)
+            {
+                auto keyset = getSecurityKey(event->evt.gap_evt.conn_handle);
+
+                v8::Local<v8::Object> obj = Nan::To<v8::Object>(Utility::Get(array, arrayIndex)).ToLocalChecked();
+
+                if (keyset != 0)
+                {
+                    Utility::Set(obj, "keyset", static_cast<v8::Handle<v8::Value>>(GapSecKeyset(keyset)));
+                }
+                else
+                {
+                    Utility::Set(obj, "keyset", Nan::Null());
+                }
+
+                destroySecurityKeyStorage(event->evt.gap_evt.conn_handle);
+            }
+
+            if (eventEntry->autoReplied)
+            {
+                v8::Local<v8::Object> obj = Nan::To<v8::Object>(Utility::Get(array, arrayIndex)).ToLocalChecked();
+                Utility::Set(obj, "auto_replied", true);
+            }
+        }
+
+        eventConversionHistograms[event->header.evt_id].record(getMonotonicTimeInMicroseconds() - conversionStart);
+        arrayIndex++;
+
+        // Give the slot back so it can be reused for later events
+        eventPool.release(eventEntry);
+    }
+
+    // All scan reports of this pass are sent as one event after the other events
+    if (advReportBatch.size() > 0)
+    {
+        const auto conversionStart = getMonotonicTimeInMicroseconds();
+        Nan::Set(array, arrayIndex++, GapAdvReportBatch(&advReportBatch).ToJs());
+        advReportBatch.clear();
+        eventConversionHistograms[BLE_GAP_EVT_ADV_REPORT_BATCH].record(getMonotonicTimeInMicroseconds() - conversionStart);
+    }
+
+    // The routed events go first, a route callback may remove its route, so the callback is kept alive by routedArrays
+    for (auto &routed : routedArrays)
+    {
+        v8::Local<v8::Value> argv[1];
+        argv[0] = routed.second;
+        Nan::AsyncResource resource("pc-ble-driver-js:callback");
+        routed.first->Call(1, argv, &resource);
+    }
+
+    // There is nothing left for the event callback when all events of the pass were routed or skipped
+    if (arrayIndex > 0)
+    {
+        v8::Local<v8::Value> callback_value[1];
+        callback_value[0] = array;
+
+        auto start = chrono::high_resolution_clock::now();
+
+        if (eventCallback != nullptr)
+        {
+            Nan::AsyncResource resource("pc-ble-driver-js:callback");
+            eventCallback->Call(1, callback_value, &resource);
+        }
+        else
+        {
+            std::cerr << "BLE event received, but no callback is registered." << std::endl;
+        }
+
+        auto end = chrono::high_resolution_clock::now();
+
+        auto duration = chrono::duration_cast<chrono::microseconds>(end - start);
+        addEventBatchStatistics(duration);
+    }
+
+    // Events queued while this batch was sent may not have woken the NodeJS thread, see appendEvent.
+    // Events held back by the connection limit are sent in the next pass.
+    if (asyncEvent != nullptr && (eventDemux.size() > 0 || (eventBatchLatency != 0 && !eventQueue.wasEmpty())))
+    {
+        uv_async_send(asyncEvent.get());
+    }
+}
+
+static void sd_rpc_on_status(adapter_t *adapter, sd_rpc_app_status_t id, const char * message)
+{
+    auto statusEntry = new StatusEntry();
+    statusEntry->timestamp = getMonotonicTimeInMicroseconds();
+    statusEntry->id = id;
+    statusEntry->message = std::string(message);
+
+    auto jsAdapter = Adapter::getAdapter(adapter);
+
+    if (jsAdapter != nullptr)
+    {
+        jsAdapter->appendStatus(statusEntry);
+    }
+    else
+    {
+        std::cerr << "No AddOn adapter to process BLE status event." << std::endl;
+        std::terminate();
+    }
+}
+
+void Adapter::appendStatus(StatusEntry *status)
+{
+    if (status->id == CONNECTION_ACTIVE)
+    {
+        linkActiveCount++;
+    }
+
+    if (asyncStatus != nullptr)
+    {
+        uv_mutex_lock(&statusQueueMutex);
+        const auto pushed = statusQueue.push(status);
+        updateHighWaterMark(statusQueueHighWaterMark, statusQueue.size());
+        uv_mutex_unlock(&statusQueueMutex);
+
+        if (pushed)
+        {
+            uv_async_send(asyncStatus.get());
+            return;
+        }
+    }
+
+    // The entry is not queued, there is no one else to free it
+    delete status;
+}
+
+// Now we are in the NodeJS thread. Call callbacks.
+void Adapter::onStatusEvent(uv_async_t *handle)
+{
+    Nan::HandleScope scope;
+
+    StatusEntry *statusEntries[STATUS_QUEUE_SIZE];
+    const auto statusEntryCount = statusQueue.pop_n(statusEntries, STATUS_QUEUE_SIZE);
+
+    for (size_t i = 0; i < statusEntryCount; ++i)
+    {
+        auto statusEntry = statusEntries[i];
+
+        if (statusCallback != nullptr)
+        {
+            v8::Local<v8::Value> argv[1];
+            argv[0] = StatusMessage::getStatus(statusEntry->id, statusEntry->message, EventTime(statusEntry->timestamp, eventTimeFormat));
+            Nan::AsyncResource resource("pc-ble-driver-js:callback");
+            statusCallback->Call(1, argv, &resource);
+        }
+
+        // Free memory for current entry
+        delete statusEntry;
+    }
+}
+
+bool Adapter::waitForLinkActive(const uint32_t activations, const uint32_t timeout) const
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+    while (linkActiveCount.load() == activations)
+    {
+        if (std::chrono::steady_clock::now() >= deadline)
+        {
+            return false;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return true;
+}
+
+#if NRF_SD_BLE_API_VERSION <= 3
+v8::Local<v8::Object> CommonTXCompleteEvent::ToJs()
+{
+    Nan::EscapableHandleScope scope;
+    v8::Local<v8::Object> obj = BleDriverCommonEvent::createJsObject();
+    BleDriverCommonEvent::ToJs(obj);
+
+    Utility::Set(obj, "count", ConversionUtility::toJsNumber(evt->count));
+
+    return scope.Escape(obj);
+}
+#endif
+
+v8::Local<v8::Object> CommonMemRequestEvent::ToJs()
+{
+    Nan::EscapableHandleScope scope;
+    v8::Local<v8::Object> obj = BleDriverCommonEvent::createJsObject();
+    BleDriverCommonEvent::ToJs(obj);
+
+    Utility::Set(obj, "type", ConversionUtility::toJsNumber(evt->type));
+
+    return scope.Escape(obj);
+}
+
+
+v8::Local<v8::Object> CommonMemReleaseEvent::ToJs()
+{
+    Nan::EscapableHandleScope scope;
+    v8::Local<v8::Object> obj = BleDriverCommonEvent::createJsObject();
+    BleDriverCommonEvent::ToJs(obj);
+
+    Utility::Set(obj, "type", ConversionUtility::toJsNumber(evt->type));
+    Utility::Set(obj, "mem_block", UserMemBlock(&evt->mem_block).ToJs());
+
+    return scope.Escape(obj);
+}
+
+// Class private method that is only used by the class to activate the SoftDevice in the Adapter
+uint32_t Adapter::enableBLE(adapter_t *adapter, enable_ble_params_t *enable_params)
+{
+    // If the this->adapter has not been set yet it is because the Adapter::Open call has not set
+    // an adapter_t instance. The SoftDevice is started in Adapter::Open call and we do not have to
+    // take care of it here.
+    if (adapter == nullptr)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+#if NRF_SD_BLE_API_VERSION < 5
+    return sd_ble_enable(adapter, &enable_params->ble_enable_params, 0);
+#else
+    uint32_t result = NRF_SUCCESS;
+    const uint32_t app_ram_base = 0;
+    const uint8_t conn_cfg_tag = 1;
+
+    if (result == NRF_SUCCESS && enable_params->gap_conn_cfg)
+    {
+        enable_params->gap_conn_cfg->conn_cfg.conn_cfg_tag = conn_cfg_tag;
+        result = sd_ble_cfg_set(adapter, BLE_CONN_CFG_GAP, enable_params->gap_conn_cfg, app_ram_base);
+    }
+    if (result == NRF_SUCCESS && enable_params->gatt_conn_cfg)
+    {
+        enable_params->gatt_conn_cfg->conn_cfg.conn_cfg_tag = conn_cfg_tag;
+        result = sd_ble_cfg_set(adapter, BLE_CONN_CFG_GATT, enable_params->gatt_conn_cfg, app_ram_base);
+    }
+    if (result == NRF_SUCCESS && enable_params->gattc_conn_cfg)
+    {
+        enable_params->gattc_conn_cfg->conn_cfg.conn_cfg_tag = conn_cfg_tag;
+        result = sd_ble_cfg_set(adapter, BLE_CONN_CFG_GATTC, enable_params->gattc_conn_cfg, app_ram_base);
+    }
+    if (result == NRF_SUCCESS && enable_params->gatts_conn_cfg)
+    {
+        enable_params->gatts_conn_cfg->conn_cfg.conn_cfg_tag = conn_cfg_tag;
+        result = sd_ble_cfg_set(adapter, BLE_CONN_CFG_GATTS, enable_params->gatts_conn_cfg, app_ram_base);
+    }
+    if (result == NRF_SUCCESS && enable_params->l2cap_conn_cfg)
+    {
+        enable_params->l2cap_conn_cfg->conn_cfg.conn_cfg_tag = conn_cfg_tag;
+        result = sd_ble_cfg_set(adapter, BLE_CONN_CFG_L2CAP, enable_params->l2cap_conn_cfg, app_ram_base);
+    }
+    if (result == NRF_SUCCESS && enable_params->common_cfg)
+    {
+        result = sd_ble_cfg_set(adapter, BLE_COMMON_CFG_VS_UUID, enable_params->common_cfg, app_ram_base);
+    }
+    if (result == NRF_SUCCESS && enable_params->gap_cfg)
+    {
+        result = sd_ble_cfg_set(adapter, BLE_GAP_CFG_ROLE_COUNT, enable_params->gap_cfg, app_ram_base);
+    }
+    if (result == NRF_SUCCESS && enable_params->gatts_cfg_service_changed)
+    {
+        result = sd_ble_cfg_set(adapter, BLE_GATTS_CFG_SERVICE_CHANGED, enable_params->gatts_cfg_service_changed, app_ram_base);
+    }
+    if (result == NRF_SUCCESS && enable_params->gatts_cfg_attr_tab_size)
+    {
+        result = sd_ble_cfg_set(adapter, BLE_GATTS_CFG_ATTR_TAB_SIZE, enable_params->gatts_cfg_attr_tab_size, app_ram_base);
+    }
+    if (result == NRF_SUCCESS)
+    {
+        result = sd_ble_enable(adapter, 0);
+    }
+    return result;
+#endif
+}
+
+// This function runs in the Main Thread
+NAN_METHOD(Adapter::EnableBLE)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    v8::Local<v8::Object> enableObject;
+    v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
+
+    try
+    {
+        enableObject = ConversionUtility::getJsObject(info[argumentcount]);
+        argumentcount++;
+
+        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto baton = new EnableBLEBaton(callback);
+    baton->adapter = obj->adapter;
+
+    try
+    {
+        baton->enable_ble_params = EnableParameters(enableObject);
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getStructErrorMessage("enable parameters", error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    obj->commandQueue.submit(baton->req, EnableBLE, reinterpret_cast<uv_after_work_cb>(AfterEnableBLE));
+}
+
+// This runs in a worker thread (not Main Thread)
+void Adapter::EnableBLE(uv_work_t *req)
+{
+    auto baton = static_cast<EnableBLEBaton *>(req->data);
+    baton->result = Adapter::enableBLE(baton->adapter, baton->enable_ble_params);
+}
+
+// This runs in  Main Thread
+void Adapter::AfterEnableBLE(uv_work_t *req)
+{
+    Nan::HandleScope scope;
+    auto baton = static_cast<EnableBLEBaton *>(req->data);
+
+    v8::Local<v8::Value> argv[1];
+
+    if (baton->result != NRF_SUCCESS)
+    {
+        argv[0] = ErrorMessage::getErrorMessage(baton->result, "enabling SoftDevice");
+    }
+    else
+    {
+        argv[0] = Nan::Undefined();
+    }
+
+    Nan::AsyncResource resource("pc-ble-driver-js:callback");
+    baton->callback->Call(1, argv, &resource);
+
+    delete baton;
+}
+
+// This function runs in the Main Thread
+NAN_METHOD(Adapter::Open)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    std::string path;
+    v8::Local<v8::Object> options;
+    v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
+
+    try
+    {
+        path = ConversionUtility::getNativeString(info[argumentcount]);
+        argumentcount++;
+
+        options = ConversionUtility::getJsObject(info[argumentcount]);
+        argumentcount++;
+
+        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto baton = new OpenBaton(callback);
+    baton->mainObject = obj;
+    baton->path = path;
+
+    auto parameter = 0;
+
+    try
+    {
+        baton->baud_rate = ConversionUtility::getNativeUint32(options, "baudRate"); parameter++;
+        baton->parity = ToParityEnum(ConversionUtility::getNativeString(options, "parity")); parameter++;
+        baton->flow_control = ToFlowControlEnum(ConversionUtility::getNativeString(options, "flowControl")); parameter++;
+        baton->evt_interval = ConversionUtility::getNativeUint32(options, "eventInterval"); parameter++;
+        baton->log_level = ToLogSeverityEnum(ConversionUtility::getNativeString(options, "logLevel")); parameter++;
+        baton->retransmission_interval = ConversionUtility::getNativeUint32(options, "retransmissionInterval"); parameter++;
+        baton->response_timeout = ConversionUtility::getNativeUint32(options, "responseTimeout"); parameter++;
+        baton->enable_ble = ConversionUtility::getBool(options, "enableBLE"); parameter++;
+        baton->enable_ble_params = EnableParameters(ConversionUtility::getJsObject(options, "enableBLEParams")); parameter++;
+    }
+    catch (std::string error)
+    {
+        std::stringstream errormessage;
+        errormessage << "A setup option was wrong. Option: ";
+        const char *_options[] = {
+            "baudrate",
+            "parity",
+            "flowcontrol",
+            "eventInterval",
+            "logLevel",
+            "retransmissionInterval",
+            "responseTimeout",
+            "enableBLE",
+            "enableBLEParams"
+        };
+        errormessage << _options[parameter] << ". Reason: " << error;
+        Nan::ThrowTypeError(errormessage.str().c_str());
+        return;
+    }
+
+    // Optional options, the defaults keep the behaviour of earlier versions
+    baton->evt_queue_size = EVENT_QUEUE_SIZE;
+    baton->evt_queue_overflow_policy = EVENT_QUEUE_OVERFLOW_DROP_NEWEST;
+    baton->evt_time_format = EVENT_TIME_FORMAT_ISO_STRING;
+    baton->evt_value_format = VALUE_FORMAT_ARRAY;
+    baton->evt_batch_size = 0;
+    baton->evt_batch_latency = 0;
+    baton->evt_batch_connection_limit = 0;
+    baton->log_batch = false;
+    baton->log_burst_limit = 0;
+    baton->log_burst_interval = 1000;
+
+    try
+    {
+        if (Utility::Has(options, "eventQueueSize"))
+        {
+            baton->evt_queue_size = ConversionUtility::getNativeUint32(options, "eventQueueSize");
+
+            if (baton->evt_queue_size == 0 || baton->evt_queue_size > EVENT_QUEUE_MAX_SIZE)
+            {
+                std::stringstream range;
+                range << "number between 1 and " << EVENT_QUEUE_MAX_SIZE;
+                throw range.str();
+            }
+        }
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getStructErrorMessage("eventQueueSize", error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    try
+    {
+        if (Utility::Has(options, "eventQueueOverflowPolicy"))
+        {
+            baton->evt_queue_overflow_policy = ToEventQueueOverflowPolicyEnum(ConversionUtility::getNativeString(options, "eventQueueOverflowPolicy"));
+        }
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getStructErrorMessage("eventQueueOverflowPolicy", error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    try
+    {
+        if (Utility::Has(options, "eventTimeFormat"))
+        {
+            baton->evt_time_format = ToEventTimeFormatEnum(ConversionUtility::getNativeString(options, "eventTimeFormat"));
+        }
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getStructErrorMessage("eventTimeFormat", error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    try
+    {
+        if (Utility::Has(options, "valueFormat"))
+        {
+            baton->evt_value_format = ToValueFormatEnum(ConversionUtility::getNativeString(options, "valueFormat"));
+        }
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getStructErrorMessage("valueFormat", error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    try
+    {
+        if (Utility::Has(options, "eventBatchLatency"))
+        {
+            baton->evt_batch_latency = ConversionUtility::getNativeUint32(options, "eventBatchLatency");
+
+            if (baton->evt_batch_latency != 0 && baton->evt_interval != 0)
+            {
+                throw std::string("Must be 0 when eventInterval is used, adaptive batching replaces the event interval");
+            }
+        }
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getStructErrorMessage("eventBatchLatency", error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    try
+    {
+        if (Utility::Has(options, "eventBatchSize"))
+        {
+            baton->evt_batch_size = ConversionUtility::getNativeUint32(options, "eventBatchSize");
+
+            if (baton->evt_batch_size != 0 && baton->evt_batch_latency == 0)
+            {
+                throw std::string("Only used together with eventBatchLatency");
+            }
+        }
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getStructErrorMessage("eventBatchSize", error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    try
+    {
+        if (Utility::Has(options, "eventBatchConnectionLimit"))
+        {
+            baton->evt_batch_connection_limit = ConversionUtility::getNativeUint32(options, "eventBatchConnectionLimit");
+        }
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getStructErrorMessage("eventBatchConnectionLimit", error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    try
+    {
+        if (Utility::Has(options, "logBatch"))
+        {
+            baton->log_batch = ConversionUtility::getBool(options, "logBatch");
+        }
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getStructErrorMessage("logBatch", error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    try
+    {
+        if (Utility::Has(options, "logBurstLimit"))
+        {
+            baton->log_burst_limit = ConversionUtility::getNativeUint32(options, "logBurstLimit");
+        }
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getStructErrorMessage("logBurstLimit", error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    try
+    {
+        if (Utility::Has(options, "logBurstInterval"))
+        {
+            baton->log_burst_interval = ConversionUtility::getNativeUint32(options, "logBurstInterval");
+
+            if (baton->log_burst_interval == 0)
+            {
+                throw std::string("number of milliseconds larger than 0");
+            }
+        }
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getStructErrorMessage("logBurstInterval", error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    try
+    {
+        baton->log_callback = std::make_unique<Nan::Callback>(ConversionUtility::getCallbackFunction(options, "logCallback"));
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getStructErrorMessage("logCallback", error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    try
+    {
+        baton->event_callback = std::make_unique<Nan::Callback>(ConversionUtility::getCallbackFunction(options, "eventCallback"));
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getStructErrorMessage("eventCallback", error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    try
+    {
+        baton->status_callback = std::unique_ptr<Nan::Callback>(new Nan::Callback(ConversionUtility::getCallbackFunction(options, "statusCallback")));
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getStructErrorMessage("statusCallback", error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    size_t event_capture_segment_size = EVENT_CAPTURE_SEGMENT_SIZE;
+
+    try
+    {
+        if (Utility::Has(options, "eventCaptureSegmentSize"))
+        {
+            event_capture_segment_size = ConversionUtility::getNativeUint32(options, "eventCaptureSegmentSize");
+        }
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getStructErrorMessage("eventCaptureSegmentSize", error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    if (obj->timedReplay != nullptr)
+    {
+        Nan::ThrowError("The adapter can not be opened while events are replayed");
+        return;
+    }
+
+    if (obj->asyncEvent != nullptr)
+    {
+        Nan::ThrowError("The adapter is already open");
+        return;
+    }
+
+    // Opened last, so a later option error does not leave the files open. The driver is not running yet.
+    try
+    {
+        obj->setLogFile(Utility::Has(options, "logFile") ? ConversionUtility::getNativeString(options, "logFile") : "");
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getStructErrorMessage("logFile", error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    try
+    {
+        obj->setEventCapture(Utility::Has(options, "eventCaptureFile") ? ConversionUtility::getNativeString(options, "eventCaptureFile") : "",
+                             event_capture_segment_size);
+    }
+    catch (std::string error)
+    {
+        obj->setLogFile("");
+        auto message = ErrorMessage::getStructErrorMessage("eventCaptureFile", error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    // The libuv handles belong to the loop of this thread and are only initialised here. The command
+    // thread may run while the loop runs, other adapters are opened concurrently. The driver is not
+    // running yet, so no events, log entries or status entries are queued until sd_rpc_open.
+    obj->initEventHandling(std::move(baton->event_callback), baton->evt_interval,
+                           baton->evt_queue_size, baton->evt_queue_overflow_policy,
+                           baton->evt_time_format, baton->evt_value_format,
+                           baton->evt_batch_size, baton->evt_batch_latency,
+                           baton->evt_batch_connection_limit);
+    obj->initLogHandling(std::move(baton->log_callback), baton->log_batch,
+                         baton->log_burst_limit, baton->log_burst_interval);
+    obj->setLogSeverityFilter(baton->log_level);
+    obj->initStatusHandling(std::move(baton->status_callback));
+
+    obj->commandQueue.submit(baton->req, Open, reinterpret_cast<uv_after_work_cb>(AfterOpen));
+}
+
+// This runs in a worker thread (not Main Thread)
+void Adapter::Open(uv_work_t *req)
+{
+    auto baton = static_cast<OpenBaton *>(req->data);
+
+    auto path = baton->path.c_str();
+
+    auto uart = sd_rpc_physical_layer_create_uart(path, baton->baud_rate, baton->flow_control, baton->parity);
+    auto h5 = sd_rpc_data_link_layer_create_bt_three_wire(uart, baton->retransmission_interval);
+    auto serialization = sd_rpc_transport_layer_create(h5, baton->response_timeout);
+    auto adapter = sd_rpc_adapter_create(serialization);
+
+    // Free memory malloc'ed by the sd_rpc_create* functions
+    free(uart);
+    free(h5);
+    free(serialization);
+
+    baton->adapter = adapter;
+    baton->mainObject->adapter = adapter;
+
+    // The driver calls back from its own threads already during sd_rpc_open. Registering the adapter
+    // before opening routes those callbacks without a global, so several adapters may open at once.
+    Adapter::registerAdapter(adapter, baton->mainObject);
+
+    // Set the log level
+    auto error_code = sd_rpc_log_handler_severity_filter_set(adapter, baton->log_level);
+
+    if (error_code != NRF_SUCCESS)
+    {
+        std::cerr << std::endl << "Failed to set log severity filter." << std::endl;
+        baton->result = error_code;
+        return;
+    }
+
+    error_code = sd_rpc_open(adapter, sd_rpc_on_status, sd_rpc_on_event, sd_rpc_on_log_event);
+
+    if (error_code != NRF_SUCCESS)
+    {
+        std::cerr << std::endl << "Failed to open the nRF5 BLE driver." << std::endl;
+        baton->result = error_code;
+
+        // Delete the adapter layer and all layers below
+        Adapter::unregisterAdapter(adapter);
+        baton->mainObject->adapter = nullptr;
+        sd_rpc_adapter_delete(adapter);
+        free(adapter);
+
+        return;
+    }
+
+    if (baton->enable_ble) {
+        error_code = Adapter::enableBLE(adapter, baton->enable_ble_params);
+
+        if (error_code == NRF_SUCCESS)
+        {
+            baton->result = error_code;
+            return;
+        }
+
+        if (error_code == NRF_ERROR_INVALID_STATE)
+        {
+            std::cerr << "BLE stack already enabled" << std::endl;
+            return;
+        }
+    }
+
+    baton->result = error_code;
+}
+
+// This runs in  Main Thread
+void Adapter::AfterOpen(uv_work_t *req)
+{
+    Nan::HandleScope scope;
+    auto baton = static_cast<OpenBaton *>(req->data);
+
+    v8::Local<v8::Value> argv[1];
+
+    if (baton->result != NRF_SUCCESS)
+    {
+        argv[0] = ErrorMessage::getErrorMessage(baton->result, "opening port");
+    }
+    else
+    {
+        argv[0] = Nan::Undefined();
+    }
+
+    if (baton->result != NRF_SUCCESS)
+    {
+        baton->mainObject->cleanUpV8Resources();
+    }
+
+
+    Nan::AsyncResource resource("pc-ble-driver-js:callback");
+    baton->callback->Call(1, argv, &resource);
+    delete baton;
+}
+
+NAN_METHOD(Adapter::Close)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    v8::Local<v8::Function> callback;
+
+    try
+    {
+        callback = ConversionUtility::getCallbackFunction(info[0]);
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getTypeErrorMessage(0, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto baton = new CloseBaton(callback);
+    baton->adapter = obj->adapter;
+    baton->mainObject = obj;
+
+    obj->commandQueue.submit(baton->req, Close, reinterpret_cast<uv_after_work_cb>(AfterClose));
+}
+
+void Adapter::Close(uv_work_t *req)
+{
+    auto baton = static_cast<CloseBaton *>(req->data);
+    baton->result = sd_rpc_close(baton->adapter);
+}
+
+void Adapter::AfterClose(uv_work_t *req)
+{
+    Nan::HandleScope scope;
+    auto baton = static_cast<CloseBaton *>(req->data);
+
+    baton->mainObject->cleanUpV8Resources();
+
+    if (baton->callback != nullptr)
+    {
+        v8::Local<v8::Value> argv[1];
+
+        if (baton->result != NRF_SUCCESS)
+        {
+            argv[0] = ErrorMessage::getErrorMessage(baton->result, "closing connection");
+        }
+        else
+        {
+            argv[0] = Nan::Undefined();
+
+            Adapter::unregisterAdapter(baton->adapter);
+
+            if (baton->mainObject->adapter == baton->adapter)
+            {
+                baton->mainObject->adapter = nullptr;
+            }
+
+            sd_rpc_adapter_delete(baton->adapter);
+            free(baton->adapter);
+            baton->adapter = nullptr;
+        }
+
+        Nan::AsyncResource resource("pc-ble-driver-js:callback");
+        baton->callback->Call(1, argv, &resource);
+    }
+
+    delete baton;
+}
+
+NAN_METHOD(Adapter::ConnReset)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    v8::Local<v8::Object> options;
+    v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
+
+    try
+    {
+        // connReset(callback) is the reset of earlier versions, connReset(options, callback) may be warm
+        if (info.Length() > 1)
+        {
+            options = ConversionUtility::getJsObject(info[argumentcount]);
+            argumentcount++;
+        }
+
+        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    enable_ble_params_t *enable_ble_params = nullptr;
+
+    if (!options.IsEmpty() && Utility::Has(options, "enableBLEParams"))
+    {
+        try
+        {
+            enable_ble_params = EnableParameters(ConversionUtility::getJsObject(options, "enableBLEParams"));
+        }
+        catch (std::string error)
+        {
+            v8::Local<v8::String> message = ErrorMessage::getStructErrorMessage("enableBLEParams", error);
+            Nan::ThrowTypeError(message);
+            return;
+        }
+    }
+
+    auto baton = new ConnResetBaton(callback);
+    baton->adapter = obj->adapter;
+    baton->mainObject = obj;
+    baton->enable_ble_params = enable_ble_params;
+    baton->connections_reset = false;
+    /* Hardcoding the reset mode. Consider adding argument for letting user choose reset mode. */
+    baton->reset = SOFT_RESET;
+
+    obj->commandQueue.submit(baton->req, ConnReset, reinterpret_cast<uv_after_work_cb>(AfterConnReset));
+}
+
+// A warm reset enables BLE again in the same command, on the adapter that stays open. The event,
+// log and status handling, their queues and pools and the command queue are kept as they are,
+// instead of closing and opening the adapter to get an enabled SoftDevice after a reset.
+void Adapter::ConnReset(uv_work_t *req)
+{
+    auto baton = static_cast<ConnResetBaton *>(req->data);
+    const auto activations = baton->mainObject->linkActiveCount.load();
+
+    baton->result = sd_rpc_conn_reset(baton->adapter, baton->reset);
+
+    if (baton->result != NRF_SUCCESS)
+    {
+        return;
+    }
+
+    // There are no disconnect events for the connections that are gone with the reset
+    baton->mainObject->resetConnections();
+    baton->connections_reset = true;
+
+    if (baton->enable_ble_params == nullptr)
+    {
+        return;
+    }
+
+    // The data link is established again by the SoftDevice driver when the connectivity device has rebooted
+    if (!baton->mainObject->waitForLinkActive(activations, CONN_RESET_LINK_TIMEOUT))
+    {
+        baton->result = NRF_ERROR_TIMEOUT;
+        return;
+    }
+
+    baton->result = Adapter::enableBLE(baton->adapter, baton->enable_ble_params);
+
+    if (baton->result == NRF_ERROR_INVALID_STATE)
+    {
+        std::cerr << "BLE stack already enabled" << std::endl;
+        baton->result = NRF_SUCCESS;
+    }
+}
+
+void Adapter::AfterConnReset(uv_work_t *req)
+{
+    Nan::HandleScope scope;
+    auto baton = static_cast<ConnResetBaton *>(req->data);
+
+    if (baton->connections_reset)
     {
-        result = sd_ble_cfg_set(adapter, BLE_GATTS_CFG_ATTR_TAB_SIZE, enable_params->gatts_cfg_attr_tab_size, app_ram_base);
+        baton->mainObject->resetConnectionEvents();
     }
-    if (result == NRF_SUCCESS)
+
+    // Deliver the status of the reset before the callback, so the callback sees the state after the reset
+    baton->mainObject->onStatusEvent(baton->mainObject->asyncStatus.get());
+
+    if (baton->callback != nullptr)
     {
-        result = sd_ble_enable(adapter, 0);
+        v8::Local<v8::Value> argv[1];
+
+        if (baton->result != NRF_SUCCESS)
+        {
+            argv[0] = ErrorMessage::getErrorMessage(baton->result, "resetting connectivity device");
+        }
+        else
+        {
+            argv[0] = Nan::Undefined();
+        }
+
+        Nan::AsyncResource resource("pc-ble-driver-js:callback");
+        baton->callback->Call(1, argv, &resource);
     }
-    return result;
-#endif
+
+    delete baton;
 }
 
-// This function runs in the Main Thread
-NAN_METHOD(Adapter::EnableBLE)
+NAN_METHOD(Adapter::AddVendorSpecificUUID)
 {
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
-    v8::Local<v8::Object> enableObject;
+    v8::Local<v8::Object> uuid;
     v8::Local<v8::Function> callback;
+
     auto argumentcount = 0;
 
     try
     {
-        enableObject = ConversionUtility::getJsObject(info[argumentcount]);
+        uuid = ConversionUtility::getJsObject(info[argumentcount]);
         argumentcount++;
 
         callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
@@ -586,257 +2319,157 @@ NAN_METHOD(Adapter::EnableBLE)
         return;
     }
 
-    auto baton = new EnableBLEBaton(callback);
+    auto baton = new BleAddVendorSpcificUUIDBaton(callback);
+    baton->p_vs_uuid = BleUUID128(uuid);
     baton->adapter = obj->adapter;
 
-    try
-    {
-        baton->enable_ble_params = EnableParameters(enableObject);
-    }
-    catch (std::string error)
-    {
-        v8::Local<v8::String> message = ErrorMessage::getStructErrorMessage("enable parameters", error);
-        Nan::ThrowTypeError(message);
-        return;
-    }
-
-    uv_queue_work(uv_default_loop(), baton->req, EnableBLE, reinterpret_cast<uv_after_work_cb>(AfterEnableBLE));
+    obj->commandQueue.submit(baton->req, AddVendorSpecificUUID, reinterpret_cast<uv_after_work_cb>(AfterAddVendorSpecificUUID));
 }
 
-// This runs in a worker thread (not Main Thread)
-void Adapter::EnableBLE(uv_work_t *req)
+void Adapter::AddVendorSpecificUUID(uv_work_t *req)
 {
-    auto baton = static_cast<EnableBLEBaton *>(req->data);
-    baton->result = Adapter::enableBLE(baton->adapter, baton->enable_ble_params);
+    auto baton = static_cast<BleAddVendorSpcificUUIDBaton *>(req->data);
+    baton->result = sd_ble_uuid_vs_add(baton->adapter, baton->p_vs_uuid, &baton->p_uuid_type);
 }
 
-// This runs in  Main Thread
-void Adapter::AfterEnableBLE(uv_work_t *req)
+void Adapter::AfterAddVendorSpecificUUID(uv_work_t *req)
 {
     Nan::HandleScope scope;
-    auto baton = static_cast<EnableBLEBaton *>(req->data);
+    auto baton = static_cast<BleAddVendorSpcificUUIDBaton *>(req->data);
 
-    v8::Local<v8::Value> argv[1];
+    v8::Local<v8::Value> argv[2];
 
     if (baton->result != NRF_SUCCESS)
     {
-        argv[0] = ErrorMessage::getErrorMessage(baton->result, "enabling SoftDevice");
+        argv[0] = ErrorMessage::getErrorMessage(baton->result, "adding vendor specific 128-bit UUID");
+        argv[1] = Nan::Undefined();
     }
     else
     {
         argv[0] = Nan::Undefined();
+        argv[1] = ConversionUtility::toJsNumber(baton->p_uuid_type);
     }
 
     Nan::AsyncResource resource("pc-ble-driver-js:callback");
-    baton->callback->Call(1, argv, &resource);
-
+    baton->callback->Call(2, argv, &resource);
     delete baton;
 }
 
-// This function runs in the Main Thread
-NAN_METHOD(Adapter::Open)
+NAN_INLINE sd_rpc_parity_t ToParityEnum(const std::string& str)
 {
-    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
-    std::string path;
-    v8::Local<v8::Object> options;
-    v8::Local<v8::Function> callback;
-    auto argumentcount = 0;
+    sd_rpc_parity_t parity = SD_RPC_PARITY_NONE;
 
-    try
+    if (str == "none")
     {
-        path = ConversionUtility::getNativeString(info[argumentcount]);
-        argumentcount++;
-
-        options = ConversionUtility::getJsObject(info[argumentcount]);
-        argumentcount++;
-
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
-        argumentcount++;
+        parity = SD_RPC_PARITY_NONE;
     }
-    catch (std::string error)
+    else if (str == "even")
     {
-        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
-        Nan::ThrowTypeError(message);
-        return;
+        parity = SD_RPC_PARITY_EVEN;
     }
 
-    auto baton = new OpenBaton(callback);
-    baton->mainObject = obj;
-    baton->path = path;
+    return parity;
+}
 
-    auto parameter = 0;
+NAN_INLINE sd_rpc_flow_control_t ToFlowControlEnum(const std::string &str)
+{
+    sd_rpc_flow_control_t flow_control = SD_RPC_FLOW_CONTROL_NONE;
 
-    try
+    if (str == "none")
     {
-        baton->baud_rate = ConversionUtility::getNativeUint32(options, "baudRate"); parameter++;
-        baton->parity = ToParityEnum(ConversionUtility::getNativeString(options, "parity")); parameter++;
-        baton->flow_control = ToFlowControlEnum(ConversionUtility::getNativeString(options, "flowControl")); parameter++;
-        baton->evt_interval = ConversionUtility::getNativeUint32(options, "eventInterval"); parameter++;
-        baton->log_level = ToLogSeverityEnum(ConversionUtility::getNativeString(options, "logLevel")); parameter++;
-        baton->retransmission_interval = ConversionUtility::getNativeUint32(options, "retransmissionInterval"); parameter++;
-        baton->response_timeout = ConversionUtility::getNativeUint32(options, "responseTimeout"); parameter++;
-        baton->enable_ble = ConversionUtility::getBool(options, "enableBLE"); parameter++;
-        baton->enable_ble_params = EnableParameters(ConversionUtility::getJsObject(options, "enableBLEParams")); parameter++;
+        flow_control = SD_RPC_FLOW_CONTROL_NONE;
     }
-    catch (std::string error)
+    else if (str == "hw")
     {
-        std::stringstream errormessage;
-        errormessage << "A setup option was wrong. Option: ";
-        const char *_options[] = {
-            "baudrate",
-            "parity",
-            "flowcontrol",
-            "eventInterval",
-            "logLevel",
-            "retransmissionInterval",
-            "responseTimeout",
-            "enableBLE",
-            "enableBLEParams"
-        };
-        errormessage << _options[parameter] << ". Reason: " << error;
-        Nan::ThrowTypeError(errormessage.str().c_str());
-        return;
+        flow_control = SD_RPC_FLOW_CONTROL_HARDWARE;
     }
 
-    try
+    return flow_control;
+}
+
+NAN_INLINE EventQueueOverflowPolicy ToEventQueueOverflowPolicyEnum(const std::string &str)
+{
+    if (str == "block")
     {
-        baton->log_callback = std::make_unique<Nan::Callback>(ConversionUtility::getCallbackFunction(options, "logCallback"));
+        return EVENT_QUEUE_OVERFLOW_BLOCK;
     }
-    catch (std::string error)
+    else if (str == "dropOldest")
     {
-        auto message = ErrorMessage::getStructErrorMessage("logCallback", error);
-        Nan::ThrowTypeError(message);
-        return;
+        return EVENT_QUEUE_OVERFLOW_DROP_OLDEST;
     }
-
-    try
+    else if (str == "dropNewest")
     {
-        baton->event_callback = std::make_unique<Nan::Callback>(ConversionUtility::getCallbackFunction(options, "eventCallback"));
+        return EVENT_QUEUE_OVERFLOW_DROP_NEWEST;
     }
-    catch (std::string error)
+    else if (str == "coalesceAdvReports")
     {
-        auto message = ErrorMessage::getStructErrorMessage("eventCallback", error);
-        Nan::ThrowTypeError(message);
-        return;
+        return EVENT_QUEUE_OVERFLOW_COALESCE_ADV_REPORTS;
     }
 
-    try
+    throw std::string("one of 'block', 'dropOldest', 'dropNewest' or 'coalesceAdvReports'");
+}
+
+NAN_INLINE EventTimeFormat ToEventTimeFormatEnum(const std::string &str)
+{
+    if (str == "number")
     {
-        baton->status_callback = std::unique_ptr<Nan::Callback>(new Nan::Callback(ConversionUtility::getCallbackFunction(options, "statusCallback")));
+        return EVENT_TIME_FORMAT_NUMBER;
     }
-    catch (std::string error)
+    else if (str == "string")
     {
-        auto message = ErrorMessage::getStructErrorMessage("statusCallback", error);
-        Nan::ThrowTypeError(message);
-        return;
+        return EVENT_TIME_FORMAT_ISO_STRING;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, Open, reinterpret_cast<uv_after_work_cb>(AfterOpen));
+    throw std::string("one of 'number' or 'string'");
 }
 
-// This runs in a worker thread (not Main Thread)
-void Adapter::Open(uv_work_t *req)
+NAN_INLINE ValueFormat ToValueFormatEnum(const std::string &str)
 {
-    auto baton = static_cast<OpenBaton *>(req->data);
-
-    baton->mainObject->initEventHandling(std::move(baton->event_callback), baton->evt_interval);
-    baton->mainObject->initLogHandling(std::move(baton->log_callback));
-    baton->mainObject->initStatusHandling(std::move(baton->status_callback));
-
-    // Ensure that the correct adapter gets the callbacks as long as we have no reference to
-    // the driver adapter until after sd_rpc_open is called
-    adapterBeingOpened = baton->mainObject;
-
-    auto path = baton->path.c_str();
-
-    auto uart = sd_rpc_physical_layer_create_uart(path, baton->baud_rate, baton->flow_control, baton->parity);
-    auto h5 = sd_rpc_data_link_layer_create_bt_three_wire(uart, baton->retransmission_interval);
-    auto serialization = sd_rpc_transport_layer_create(h5, baton->response_timeout);
-    auto adapter = sd_rpc_adapter_create(serialization);
-
-    // Free memory malloc'ed by the sd_rpc_create* functions
-    free(uart);
-    free(h5);
-    free(serialization);
-
-    baton->adapter = adapter;
-    baton->mainObject->adapter = adapter;
-
-    // Set the log level
-    auto error_code = sd_rpc_log_handler_severity_filter_set(adapter, baton->log_level);
-
-    if (error_code != NRF_SUCCESS)
+    if (str == "array")
     {
-        std::cerr << std::endl << "Failed to set log severity filter." << std::endl;
-        baton->result = error_code;
-        return;
+        return VALUE_FORMAT_ARRAY;
     }
-
-    error_code = sd_rpc_open(adapter, sd_rpc_on_status, sd_rpc_on_event, sd_rpc_on_log_event);
-
-    // Let the normal log handling handle the rest of the log calls
-    adapterBeingOpened = nullptr;
-
-    if (error_code != NRF_SUCCESS)
+    else if (str == "buffer")
     {
-        std::cerr << std::endl << "Failed to open the nRF5 BLE driver." << std::endl;
-        baton->result = error_code;
-
-        // Delete the adapter layer and all layers below
-        sd_rpc_adapter_delete(adapter);
-        free(adapter);
-
-        return;
-    }
-
-    if (baton->enable_ble) {
-        error_code = Adapter::enableBLE(adapter, baton->enable_ble_params);
-
-        if (error_code == NRF_SUCCESS)
-        {
-            baton->result = error_code;
-            return;
-        }
-
-        if (error_code == NRF_ERROR_INVALID_STATE)
-        {
-            std::cerr << "BLE stack already enabled" << std::endl;
-            return;
-        }
+        return VALUE_FORMAT_BUFFER;
     }
 
-    baton->result = error_code;
+    throw std::string("one of 'array' or 'buffer'");
 }
 
-// This runs in  Main Thread
-void Adapter::AfterOpen(uv_work_t *req)
+NAN_INLINE sd_rpc_log_severity_t ToLogSeverityEnum(const std::string &str)
 {
-    Nan::HandleScope scope;
-    auto baton = static_cast<OpenBaton *>(req->data);
-
-    v8::Local<v8::Value> argv[1];
+    sd_rpc_log_severity_t log_severity = SD_RPC_LOG_DEBUG;
 
-    if (baton->result != NRF_SUCCESS)
+    if (str == "trace")
     {
-        argv[0] = ErrorMessage::getErrorMessage(baton->result, "opening port");
+        log_severity = SD_RPC_LOG_TRACE;
     }
-    else
+    else if (str == "debug")
     {
-        argv[0] = Nan::Undefined();
+        log_severity = SD_RPC_LOG_DEBUG;
     }
-
-    if (baton->result != NRF_SUCCESS)
+    else if (str == "info")
     {
-        baton->mainObject->cleanUpV8Resources();
+        log_severity = SD_RPC_LOG_INFO;
+    }
+    else if (str == "warning")
+    {
+        log_severity = SD_RPC_LOG_WARNING;
+    }
+    else if (str == "error")
+    {
+        log_severity = SD_RPC_LOG_ERROR;
+    }
+    else if (str == "fatal")
+    {
+        log_severity = SD_RPC_LOG_FATAL;
     }
 
-
-    Nan::AsyncResource resource("pc-ble-driver-js:callback");
-    baton->callback->Call(1, argv, &resource);
-    delete baton;
+    return log_severity;
 }
 
-NAN_METHOD(Adapter::Close)
+NAN_METHOD(Adapter::GetVersion)
 {
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
     v8::Local<v8::Function> callback;
@@ -852,117 +2485,138 @@ NAN_METHOD(Adapter::Close)
         return;
     }
 
-    auto baton = new CloseBaton(callback);
+    auto version = new ble_version_t();
+    memset(version, 0, sizeof(ble_version_t));
+
+    auto baton = new GetVersionBaton(callback);
+    baton->version = version;
     baton->adapter = obj->adapter;
-    baton->mainObject = obj;
 
-    uv_queue_work(uv_default_loop(), baton->req, Close, reinterpret_cast<uv_after_work_cb>(AfterClose));
+    obj->commandQueue.submit(baton->req, GetVersion, reinterpret_cast<uv_after_work_cb>(AfterGetVersion));
+
+    return;
 }
 
-void Adapter::Close(uv_work_t *req)
+void Adapter::GetVersion(uv_work_t *req)
 {
-    auto baton = static_cast<CloseBaton *>(req->data);
-    baton->result = sd_rpc_close(baton->adapter);
+    auto baton = static_cast<GetVersionBaton *>(req->data);
+    baton->result = sd_ble_version_get(baton->adapter, baton->version);
 }
 
-void Adapter::AfterClose(uv_work_t *req)
+// This runs in Main Thread
+void Adapter::AfterGetVersion(uv_work_t *req)
 {
     Nan::HandleScope scope;
-    auto baton = static_cast<CloseBaton *>(req->data);
-
-    baton->mainObject->cleanUpV8Resources();
+    auto baton = static_cast<GetVersionBaton *>(req->data);
+    v8::Local<v8::Value> argv[2];
 
-    if (baton->callback != nullptr)
+    if (baton->result != NRF_SUCCESS)
     {
-        v8::Local<v8::Value> argv[1];
-
-        if (baton->result != NRF_SUCCESS)
-        {
-            argv[0] = ErrorMessage::getErrorMessage(baton->result, "closing connection");
-        }
-        else
-        {
-            argv[0] = Nan::Undefined();
-
-            sd_rpc_adapter_delete(baton->adapter);
-            free(baton->adapter);
-            baton->adapter = nullptr;
-        }
-
-        Nan::AsyncResource resource("pc-ble-driver-js:callback");
-        baton->callback->Call(1, argv, &resource);
+        argv[0] = Nan::Undefined();
+        argv[1] = ErrorMessage::getErrorMessage(baton->result, "getting version.");
+    }
+    else
+    {
+        argv[0] = Version(baton->version).ToJs();
+        argv[1] = Nan::Undefined();
     }
 
+    Nan::AsyncResource resource("pc-ble-driver-js:callback");
+    baton->callback->Call(2, argv, &resource);
     delete baton;
 }
 
-NAN_METHOD(Adapter::ConnReset)
+NAN_METHOD(Adapter::EncodeUUID)
 {
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    v8::Local<v8::Object> uuid;
     v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
 
     try
     {
-        callback = ConversionUtility::getCallbackFunction(info[0]);
+        uuid = ConversionUtility::getJsObject(info[argumentcount]);
+        argumentcount++;
+
+        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        argumentcount++;
     }
     catch (std::string error)
     {
-        auto message = ErrorMessage::getTypeErrorMessage(0, error);
+        auto message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
         Nan::ThrowTypeError(message);
         return;
     }
 
-    auto baton = new ConnResetBaton(callback);
+    auto baton = new BleUUIDEncodeBaton(callback);
+
+    try
+    {
+        baton->p_uuid = BleUUID(uuid);
+    }
+    catch (std::string error)
+    {
+        std::stringstream errormessage;
+        errormessage << "Could not process the UUID. Reason: " << error;
+        Nan::ThrowTypeError(errormessage.str().c_str());
+        return;
+    }
+
+    baton->uuid_le = new uint8_t[16];
     baton->adapter = obj->adapter;
-    baton->mainObject = obj;
-    /* Hardcoding the reset mode. Consider adding argument for letting user choose reset mode. */
-    baton->reset = SOFT_RESET;
 
-    uv_queue_work(uv_default_loop(), baton->req, ConnReset, reinterpret_cast<uv_after_work_cb>(AfterConnReset));
+    obj->commandQueue.submit(baton->req, EncodeUUID, reinterpret_cast<uv_after_work_cb>(AfterEncodeUUID));
+
+    return;
 }
 
-void Adapter::ConnReset(uv_work_t *req)
+void Adapter::EncodeUUID(uv_work_t *req)
 {
-    auto baton = static_cast<ConnResetBaton *>(req->data);
-    baton->result = sd_rpc_conn_reset(baton->adapter, baton->reset);
+    auto baton = static_cast<BleUUIDEncodeBaton *>(req->data);
+    baton->result = sd_ble_uuid_encode(baton->adapter, baton->p_uuid, &baton->uuid_le_len, baton->uuid_le);
 }
 
-void Adapter::AfterConnReset(uv_work_t *req)
+// This runs in Main Thread
+void Adapter::AfterEncodeUUID(uv_work_t *req)
 {
     Nan::HandleScope scope;
-    auto baton = static_cast<ConnResetBaton *>(req->data);
+    auto baton = static_cast<BleUUIDEncodeBaton *>(req->data);
+    v8::Local<v8::Value> argv[4];
 
-    if (baton->callback != nullptr)
+    if (baton->result != NRF_SUCCESS)
     {
-        v8::Local<v8::Value> argv[1];
-
-        if (baton->result != NRF_SUCCESS)
-        {
-            argv[0] = ErrorMessage::getErrorMessage(baton->result, "resetting connectivity device");
-        }
-        else
-        {
-            argv[0] = Nan::Undefined();
-        }
-
-        Nan::AsyncResource resource("pc-ble-driver-js:callback");
-        baton->callback->Call(1, argv, &resource);
+        argv[0] = ErrorMessage::getErrorMessage(baton->result, "encoding UUID.");
+        argv[1] = Nan::Undefined();
+        argv[2] = Nan::Undefined();
+        argv[3] = Nan::Undefined();
+    }
+    else
+    {
+        argv[0] = Nan::Undefined();
+        argv[1] = ConversionUtility::toJsNumber(baton->uuid_le_len);
+        argv[2] = ConversionUtility::toJsValueArray(baton->uuid_le, baton->uuid_le_len);
+        argv[3] = ConversionUtility::encodeHex(reinterpret_cast<char *>(baton->uuid_le), baton->uuid_le_len);
     }
 
+    Nan::AsyncResource resource("pc-ble-driver-js:callback");
+    baton->callback->Call(4, argv, &resource);
     delete baton;
 }
 
-NAN_METHOD(Adapter::AddVendorSpecificUUID)
+NAN_METHOD(Adapter::DecodeUUID)
 {
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
-    v8::Local<v8::Object> uuid;
+    uint8_t le_len;
+    v8::Local<v8::Value> uuid_le;
     v8::Local<v8::Function> callback;
-
     auto argumentcount = 0;
 
     try
     {
-        uuid = ConversionUtility::getJsObject(info[argumentcount]);
+        le_len = ConversionUtility::getNativeUint8(info[argumentcount]);
+        argumentcount++;
+
+        uuid_le = Nan::To<v8::String>(info[argumentcount]).ToLocalChecked();
         argumentcount++;
 
         callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
@@ -975,35 +2629,39 @@ NAN_METHOD(Adapter::AddVendorSpecificUUID)
         return;
     }
 
-    auto baton = new BleAddVendorSpcificUUIDBaton(callback);
-    baton->p_vs_uuid = BleUUID128(uuid);
+    auto baton = new BleUUIDDecodeBaton(callback);
+    baton->uuid_le_len = le_len;
+    baton->uuid_le = ConversionUtility::extractHex(uuid_le);
+    baton->p_uuid = new ble_uuid_t();
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, AddVendorSpecificUUID, reinterpret_cast<uv_after_work_cb>(AfterAddVendorSpecificUUID));
+    obj->commandQueue.submit(baton->req, DecodeUUID, reinterpret_cast<uv_after_work_cb>(AfterDecodeUUID));
+
+    return;
 }
 
-void Adapter::AddVendorSpecificUUID(uv_work_t *req)
+void Adapter::DecodeUUID(uv_work_t *req)
 {
-    auto baton = static_cast<BleAddVendorSpcificUUIDBaton *>(req->data);
-    baton->result = sd_ble_uuid_vs_add(baton->adapter, baton->p_vs_uuid, &baton->p_uuid_type);
+    auto baton = static_cast<BleUUIDDecodeBaton *>(req->data);
+    baton->result = sd_ble_uuid_decode(baton->adapter, baton->uuid_le_len, baton->uuid_le.data(), baton->p_uuid);
 }
 
-void Adapter::AfterAddVendorSpecificUUID(uv_work_t *req)
+// This runs in Main Thread
+void Adapter::AfterDecodeUUID(uv_work_t *req)
 {
     Nan::HandleScope scope;
-    auto baton = static_cast<BleAddVendorSpcificUUIDBaton *>(req->data);
-
+    auto baton = static_cast<BleUUIDDecodeBaton *>(req->data);
     v8::Local<v8::Value> argv[2];
 
     if (baton->result != NRF_SUCCESS)
     {
-        argv[0] = ErrorMessage::getErrorMessage(baton->result, "adding vendor specific 128-bit UUID");
+        argv[0] = ErrorMessage::getErrorMessage(baton->result, "decoding UUID.");
         argv[1] = Nan::Undefined();
     }
     else
     {
         argv[0] = Nan::Undefined();
-        argv[1] = ConversionUtility::toJsNumber(baton->p_uuid_type);
+        argv[1] = BleUUID(baton->p_uuid);
     }
 
     Nan::AsyncResource resource("pc-ble-driver-js:callback");
@@ -1011,217 +2669,323 @@ void Adapter::AfterAddVendorSpecificUUID(uv_work_t *req)
     delete baton;
 }
 
-NAN_INLINE sd_rpc_parity_t ToParityEnum(const std::string& str)
+// Percentiles of a histogram in microseconds, for getStats
+static v8::Local<v8::Object> histogramToJs(const LatencyHistogram &histogram)
 {
-    sd_rpc_parity_t parity = SD_RPC_PARITY_NONE;
+    Nan::EscapableHandleScope scope;
+    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
 
-    if (str == "none")
-    {
-        parity = SD_RPC_PARITY_NONE;
-    }
-    else if (str == "even")
-    {
-        parity = SD_RPC_PARITY_EVEN;
-    }
+    Utility::Set(obj, "count", static_cast<double>(histogram.count()));
+    Utility::Set(obj, "p50", static_cast<double>(histogram.percentile(50)));
+    Utility::Set(obj, "p99", static_cast<double>(histogram.percentile(99)));
+    Utility::Set(obj, "max", static_cast<double>(histogram.max()));
 
-    return parity;
+    return scope.Escape(obj);
 }
 
-NAN_INLINE sd_rpc_flow_control_t ToFlowControlEnum(const std::string &str)
+NAN_METHOD(Adapter::GetStats)
 {
-    sd_rpc_flow_control_t flow_control = SD_RPC_FLOW_CONTROL_NONE;
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    auto stats = Nan::New<v8::Object>();
 
-    if (str == "none")
-    {
-        flow_control = SD_RPC_FLOW_CONTROL_NONE;
-    }
-    else if (str == "hw")
+    Utility::Set(stats, "eventCallbackTotalTime", obj->getEventCallbackTotalTime());
+    Utility::Set(stats, "eventCallbackTotalCount", obj->getEventCallbackCount());
+    Utility::Set(stats, "eventCallbackBatchMaxCount", obj->getEventCallbackMaxCount());
+    Utility::Set(stats, "eventCallbackBatchAvgCount", obj->getAverageCallbackBatchCount());
+    Utility::Set(stats, "eventQueueSize", obj->getEventQueueSize());
+    Utility::Set(stats, "eventQueueDroppedNewestCount", obj->getEventQueueDroppedNewestCount());
+    Utility::Set(stats, "eventQueueDroppedOldestCount", obj->getEventQueueDroppedOldestCount());
+    Utility::Set(stats, "eventQueueCoalescedCount", obj->getEventQueueCoalescedCount());
+    Utility::Set(stats, "eventQueueBlockedCount", obj->getEventQueueBlockedCount());
+    Utility::Set(stats, "eventBatchFullCount", obj->getEventBatchFullCount());
+    Utility::Set(stats, "eventBatchLatencyCount", obj->getEventBatchLatencyCount());
+    Utility::Set(stats, "eventUnsubscribedCount", obj->getEventUnsubscribedCount());
+    Utility::Set(stats, "eventRoutedCount", obj->getEventRoutedCount());
+    Utility::Set(stats, "advReportFilteredCount", obj->getAdvReportFilteredCount());
+    Utility::Set(stats, "advReportDedupHitCount", obj->getAdvReportDedupHitCount());
+    Utility::Set(stats, "advReportDedupMissCount", obj->getAdvReportDedupMissCount());
+
+    Utility::Set(stats, "eventQueueHighWaterMark", obj->getEventQueueHighWaterMark());
+    Utility::Set(stats, "logQueueHighWaterMark", obj->getLogQueueHighWaterMark());
+    Utility::Set(stats, "logSuppressedCount", obj->getLogSuppressedCount());
+    Utility::Set(stats, "logDroppedCount", obj->getLogDroppedCount());
+    Utility::Set(stats, "eventCaptureCount", obj->getEventCaptureCount());
+    Utility::Set(stats, "eventCaptureDroppedCount", obj->getEventCaptureDroppedCount());
+    Utility::Set(stats, "statusQueueHighWaterMark", obj->getStatusQueueHighWaterMark());
+
+    Utility::Set(stats, "eventLatency", histogramToJs(obj->getEventLatencyHistogram()));
+    Utility::Set(stats, "eventCallbackTime", histogramToJs(obj->getEventCallbackHistogram()));
+
+    auto conversionTime = Nan::New<v8::Object>();
+
+    for (const auto &entry : obj->getEventConversionHistograms())
     {
-        flow_control = SD_RPC_FLOW_CONTROL_HARDWARE;
+        Nan::Set(conversionTime, entry.first, histogramToJs(entry.second));
     }
 
-    return flow_control;
+    Utility::Set(stats, "eventConversionTime", conversionTime);
+
+    Utility::SetReturnValue(info, stats);
 }
 
-NAN_INLINE sd_rpc_log_severity_t ToLogSeverityEnum(const std::string &str)
+NAN_METHOD(Adapter::ResetStats)
 {
-    sd_rpc_log_severity_t log_severity = SD_RPC_LOG_DEBUG;
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    obj->resetStatistics();
+}
 
-    if (str == "trace")
-    {
-        log_severity = SD_RPC_LOG_TRACE;
-    }
-    else if (str == "debug")
-    {
-        log_severity = SD_RPC_LOG_DEBUG;
-    }
-    else if (str == "info")
+// Changes the log level given to open, without reopening the adapter
+NAN_METHOD(Adapter::SetLogLevel)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    sd_rpc_log_severity_t severity;
+
+    try
     {
-        log_severity = SD_RPC_LOG_INFO;
+        severity = ToLogSeverityEnum(ConversionUtility::getNativeString(info[0]));
     }
-    else if (str == "error")
+    catch (std::string error)
     {
-        log_severity = SD_RPC_LOG_ERROR;
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(0, error);
+        Nan::ThrowTypeError(message);
+        return;
     }
-    else if (str == "fatal")
+
+    obj->setLogSeverityFilter(severity);
+
+    if (obj->adapter != nullptr)
     {
-        log_severity = SD_RPC_LOG_FATAL;
-    }
+        const auto error_code = sd_rpc_log_handler_severity_filter_set(obj->adapter, severity);
 
-    return log_severity;
+        if (error_code != NRF_SUCCESS)
+        {
+            std::stringstream message;
+            message << "Failed to set log severity filter, error " << error_code;
+            Nan::ThrowError(message.str().c_str());
+            return;
+        }
+    }
 }
 
-NAN_METHOD(Adapter::GetVersion)
+// Starts capturing the raw events to a file, see EventCapture, or stops it if the path is null.
+// An open capture is replaced. The capture is closed with the adapter.
+NAN_METHOD(Adapter::SetEventCapture)
 {
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
-    v8::Local<v8::Function> callback;
+    std::string path;
+    size_t segment_size = EVENT_CAPTURE_SEGMENT_SIZE;
+    auto argumentcount = 0;
+
+    try
+    {
+        if (!info[argumentcount]->IsNull())
+        {
+            path = ConversionUtility::getNativeString(info[argumentcount]);
+
+            if (path.empty())
+            {
+                throw std::string("path or null");
+            }
+        }
+
+        argumentcount++;
+
+        if (info.Length() > argumentcount && !info[argumentcount]->IsUndefined())
+        {
+            segment_size = ConversionUtility::getNativeUint32(info[argumentcount]);
+
+            if (segment_size == 0 || segment_size % EVENT_CAPTURE_SEGMENT_ALIGNMENT != 0)
+            {
+                throw std::string("multiple of 1048576 bytes");
+            }
+        }
+
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
 
     try
     {
-        callback = ConversionUtility::getCallbackFunction(info[0]);
+        obj->setEventCapture(path, segment_size);
     }
     catch (std::string error)
     {
-        auto message = ErrorMessage::getTypeErrorMessage(0, error);
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(0, error);
         Nan::ThrowTypeError(message);
         return;
     }
+}
 
-    auto version = new ble_version_t();
-    memset(version, 0, sizeof(ble_version_t));
+// Takes an array of event ids, only these events are converted and passed to the event callback.
+// null passes all events on again.
+NAN_METHOD(Adapter::SetEventSubscription)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    EventSubscription subscription;
+    auto argumentcount = 0;
 
-    auto baton = new GetVersionBaton(callback);
-    baton->version = version;
-    baton->adapter = obj->adapter;
+    try
+    {
+        if (info[argumentcount]->IsNull())
+        {
+            subscription.set();
+        }
+        else if (info[argumentcount]->IsArray())
+        {
+            auto ids = v8::Local<v8::Array>::Cast(info[argumentcount]);
 
-    uv_queue_work(uv_default_loop(), baton->req, GetVersion, reinterpret_cast<uv_after_work_cb>(AfterGetVersion));
+            for (uint32_t i = 0; i < ids->Length(); i++)
+            {
+                const auto id = ConversionUtility::getNativeUint16(Utility::Get(ids, i));
 
-    return;
-}
+                // Batched scan reports follow the subscription of the reports they are made of
+                if (id == BLE_GAP_EVT_ADV_REPORT_BATCH)
+                {
+                    subscription.set(BLE_GAP_EVT_ADV_REPORT);
+                    continue;
+                }
 
-void Adapter::GetVersion(uv_work_t *req)
-{
-    auto baton = static_cast<GetVersionBaton *>(req->data);
-    baton->result = sd_ble_version_get(baton->adapter, baton->version);
-}
+                if (findEventDescriptor(id) == nullptr)
+                {
+                    std::stringstream error;
+                    error << "array of known event ids, " << id << " is not known";
+                    throw error.str();
+                }
 
-// This runs in Main Thread
-void Adapter::AfterGetVersion(uv_work_t *req)
-{
-    Nan::HandleScope scope;
-    auto baton = static_cast<GetVersionBaton *>(req->data);
-    v8::Local<v8::Value> argv[2];
+                subscription.set(id);
+            }
+        }
+        else
+        {
+            throw std::string("array of event ids or null");
+        }
 
-    if (baton->result != NRF_SUCCESS)
-    {
-        argv[0] = Nan::Undefined();
-        argv[1] = ErrorMessage::getErrorMessage(baton->result, "getting version.");
+        argumentcount++;
     }
-    else
+    catch (std::string error)
     {
-        argv[0] = Version(baton->version).ToJs();
-        argv[1] = Nan::Undefined();
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
     }
 
-    Nan::AsyncResource resource("pc-ble-driver-js:callback");
-    baton->callback->Call(2, argv, &resource);
-    delete baton;
+    obj->eventSubscription = subscription;
 }
 
-NAN_METHOD(Adapter::EncodeUUID)
+// Sends the GATTC HVX events of a connection and attribute handle to a callback of their own,
+// instead of the event callback. A null attribute handle routes the HVX events of the connection
+// without a route of their own, a null callback removes the route.
+NAN_METHOD(Adapter::SetHvxRoute)
 {
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
-    v8::Local<v8::Object> uuid;
-    v8::Local<v8::Function> callback;
+    uint16_t conn_handle;
+    uint16_t handle = BLE_GATT_HANDLE_INVALID;
+    std::shared_ptr<Nan::Callback> callback;
     auto argumentcount = 0;
 
     try
     {
-        uuid = ConversionUtility::getJsObject(info[argumentcount]);
+        conn_handle = ConversionUtility::getNativeUint16(info[argumentcount]);
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        if (!info[argumentcount]->IsNull())
+        {
+            handle = ConversionUtility::getNativeUint16(info[argumentcount]);
+
+            if (handle == BLE_GATT_HANDLE_INVALID)
+            {
+                throw std::string("attribute handle or null");
+            }
+        }
+
+        argumentcount++;
+
+        if (info[argumentcount]->IsFunction())
+        {
+            callback = std::make_shared<Nan::Callback>(info[argumentcount].As<v8::Function>());
+        }
+        else if (!info[argumentcount]->IsNull())
+        {
+            throw std::string("function or null");
+        }
+
         argumentcount++;
     }
     catch (std::string error)
     {
-        auto message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
         Nan::ThrowTypeError(message);
         return;
     }
 
-    auto baton = new BleUUIDEncodeBaton(callback);
+    const auto key = std::make_pair(conn_handle, handle);
 
-    try
+    if (callback != nullptr)
     {
-        baton->p_uuid = BleUUID(uuid);
+        obj->hvxRoutes[key] = callback;
     }
-    catch (std::string error)
+    else
     {
-        std::stringstream errormessage;
-        errormessage << "Could not process the UUID. Reason: " << error;
-        Nan::ThrowTypeError(errormessage.str().c_str());
-        return;
+        obj->hvxRoutes.erase(key);
     }
-
-    baton->uuid_le = new uint8_t[16];
-    baton->adapter = obj->adapter;
-
-    uv_queue_work(uv_default_loop(), baton->req, EncodeUUID, reinterpret_cast<uv_after_work_cb>(AfterEncodeUUID));
-
-    return;
-}
-
-void Adapter::EncodeUUID(uv_work_t *req)
-{
-    auto baton = static_cast<BleUUIDEncodeBaton *>(req->data);
-    baton->result = sd_ble_uuid_encode(baton->adapter, baton->p_uuid, &baton->uuid_le_len, baton->uuid_le);
 }
 
-// This runs in Main Thread
-void Adapter::AfterEncodeUUID(uv_work_t *req)
+// Returns the statistics of the open connections, see ConnectionStats, as an array of objects
+NAN_METHOD(Adapter::GetConnectionStats)
 {
-    Nan::HandleScope scope;
-    auto baton = static_cast<BleUUIDEncodeBaton *>(req->data);
-    v8::Local<v8::Value> argv[4];
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    const auto snapshot = obj->connectionStats.getSnapshot();
+    auto connections = Nan::New<v8::Array>(static_cast<uint32_t>(snapshot.size()));
 
-    if (baton->result != NRF_SUCCESS)
+    for (uint32_t i = 0; i < snapshot.size(); i++)
     {
-        argv[0] = ErrorMessage::getErrorMessage(baton->result, "encoding UUID.");
-        argv[1] = Nan::Undefined();
-        argv[2] = Nan::Undefined();
-        argv[3] = Nan::Undefined();
-    }
-    else
-    {
-        argv[0] = Nan::Undefined();
-        argv[1] = ConversionUtility::toJsNumber(baton->uuid_le_len);
-        argv[2] = ConversionUtility::toJsValueArray(baton->uuid_le, baton->uuid_le_len);
-        argv[3] = ConversionUtility::encodeHex(reinterpret_cast<char *>(baton->uuid_le), baton->uuid_le_len);
+        const auto &stats = snapshot[i].second;
+        auto connection = Nan::New<v8::Object>();
+
+        Utility::Set(connection, "connHandle", snapshot[i].first);
+        Utility::Set(connection, "rxPackets", static_cast<double>(stats.rxPackets));
+        Utility::Set(connection, "rxBytes", static_cast<double>(stats.rxBytes));
+        Utility::Set(connection, "txPackets", static_cast<double>(stats.txPackets));
+        Utility::Set(connection, "txBytes", static_cast<double>(stats.txBytes));
+        Utility::Set(connection, "txPendingPackets", stats.txPendingPackets);
+        Utility::Set(connection, "gattcTimeoutCount", stats.gattcTimeoutCount);
+        Utility::Set(connection, "gattsTimeoutCount", stats.gattsTimeoutCount);
+        Utility::Set(connection, "droppedEventCount", stats.droppedEventCount);
+        Utility::Set(connection, "gattcLatency", histogramToJs(stats.gattcLatency));
+
+        Nan::Set(connections, i, connection);
     }
 
-    Nan::AsyncResource resource("pc-ble-driver-js:callback");
-    baton->callback->Call(4, argv, &resource);
-    delete baton;
+    Utility::SetReturnValue(info, connections);
 }
 
-NAN_METHOD(Adapter::DecodeUUID)
+// Feeds a replay stream or an event capture, see driver_replay.h, through pushEvent and onRpcEvent
+// in the NodeJS thread, without a serial port. At the default speed 'maximum' the events are replayed
+// back to back, eventCallback is called synchronously with the converted events, and the number of
+// events replayed is returned. At speed 'recorded' the events are replayed with the time between them
+// in the capture, from a timer, and doneCallback is called with the number of events replayed when
+// done. The statistics are reset before the replay starts.
+NAN_METHOD(Adapter::ReplayEvents)
 {
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
-    uint8_t le_len;
-    v8::Local<v8::Value> uuid_le;
-    v8::Local<v8::Function> callback;
+    v8::Local<v8::Object> options;
     auto argumentcount = 0;
 
     try
     {
-        le_len = ConversionUtility::getNativeUint8(info[argumentcount]);
-        argumentcount++;
+        if (!info[argumentcount]->IsArrayBufferView())
+        {
+            throw std::string("Buffer or Uint8Array");
+        }
 
-        uuid_le = Nan::To<v8::String>(info[argumentcount]).ToLocalChecked();
         argumentcount++;
 
-        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        options = ConversionUtility::getJsObject(info[argumentcount]);
         argumentcount++;
     }
     catch (std::string error)
@@ -1231,57 +2995,227 @@ NAN_METHOD(Adapter::DecodeUUID)
         return;
     }
 
-    auto baton = new BleUUIDDecodeBaton(callback);
-    baton->uuid_le_len = le_len;
-    baton->uuid_le = ConversionUtility::extractHex(uuid_le);
-    baton->p_uuid = new ble_uuid_t();
-    baton->adapter = obj->adapter;
+    if (obj->timedReplay != nullptr)
+    {
+        Nan::ThrowError("A replay is already running");
+        return;
+    }
 
-    uv_queue_work(uv_default_loop(), baton->req, DecodeUUID, reinterpret_cast<uv_after_work_cb>(AfterDecodeUUID));
+    if (obj->getInternalAdapter() != nullptr || obj->asyncEvent != nullptr)
+    {
+        Nan::ThrowError("Events can not be replayed while the adapter is open");
+        return;
+    }
 
-    return;
+    std::unique_ptr<Nan::Callback> callback;
+    std::unique_ptr<Nan::Callback> doneCallback;
+    uint32_t queueSize = EVENT_QUEUE_SIZE;
+    auto timeFormat = EVENT_TIME_FORMAT_ISO_STRING;
+    auto valueFormat = VALUE_FORMAT_ARRAY;
+    auto recorded = false;
+    auto parameter = 0;
+
+    try
+    {
+        callback = std::make_unique<Nan::Callback>(ConversionUtility::getCallbackFunction(options, "eventCallback")); parameter++;
+
+        if (Utility::Has(options, "eventQueueSize"))
+        {
+            queueSize = ConversionUtility::getNativeUint32(options, "eventQueueSize");
+
+            if (queueSize == 0 || queueSize > EVENT_QUEUE_MAX_SIZE)
+            {
+                std::stringstream range;
+                range << "number between 1 and " << EVENT_QUEUE_MAX_SIZE;
+                throw range.str();
+            }
+        }
+
+        parameter++;
+
+        if (Utility::Has(options, "eventTimeFormat"))
+        {
+            timeFormat = ToEventTimeFormatEnum(ConversionUtility::getNativeString(options, "eventTimeFormat"));
+        }
+
+        parameter++;
+
+        if (Utility::Has(options, "valueFormat"))
+        {
+            valueFormat = ToValueFormatEnum(ConversionUtility::getNativeString(options, "valueFormat"));
+        }
+
+        parameter++;
+
+        if (Utility::Has(options, "speed"))
+        {
+            const auto speed = ConversionUtility::getNativeString(options, "speed");
+
+            if (speed == "recorded")
+            {
+                recorded = true;
+            }
+            else if (speed != "maximum")
+            {
+                throw std::string("'maximum' or 'recorded'");
+            }
+        }
+
+        parameter++;
+
+        if (recorded)
+        {
+            doneCallback = std::make_unique<Nan::Callback>(ConversionUtility::getCallbackFunction(options, "doneCallback"));
+        }
+    }
+    catch (std::string error)
+    {
+        const char *_options[] = {
+            "eventCallback",
+            "eventQueueSize",
+            "eventTimeFormat",
+            "valueFormat",
+            "speed",
+            "doneCallback"
+        };
+        auto message = ErrorMessage::getStructErrorMessage(_options[parameter], error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    // The replay is the only producer and consumer, the overflow policy is never applied
+    obj->initEventHandling(std::move(callback), 0, queueSize, EVENT_QUEUE_OVERFLOW_DROP_NEWEST,
+                           timeFormat, valueFormat, 0, 0, 0);
+
+    Nan::TypedArrayContents<uint8_t> stream(info[0]);
+
+    if (recorded)
+    {
+        auto replay = std::make_unique<TimedReplay>(info[0].As<v8::Object>(), *stream, stream.length());
+        replay->doneCallback = std::move(doneCallback);
+        obj->startTimedReplay(std::move(replay));
+        return;
+    }
+
+    ReplayReader reader(*stream, stream.length());
+    const uint8_t *event;
+    size_t eventLength;
+    uint64_t timestamp;
+    uint32_t replayed = 0;
+    std::string error;
+
+    while (reader.next(event, eventLength, timestamp, error))
+    {
+        obj->replayEvent(event, eventLength);
+        replayed++;
+    }
+
+    obj->onRpcEvent(nullptr);
+    obj->cleanUpV8Resources();
+
+    if (!error.empty())
+    {
+        std::stringstream message;
+        message << error << " at offset " << reader.getOffset() << " of the replay stream";
+        Nan::ThrowError(message.str().c_str());
+        return;
+    }
+
+    info.GetReturnValue().Set(replayed);
 }
 
-void Adapter::DecodeUUID(uv_work_t *req)
+void Adapter::replayEvent(const uint8_t *event, const size_t length)
 {
-    auto baton = static_cast<BleUUIDDecodeBaton *>(req->data);
-    baton->result = sd_ble_uuid_decode(baton->adapter, baton->uuid_le_len, baton->uuid_le.data(), baton->p_uuid);
+    alignas(ble_evt_t) uint8_t eventData[EVENT_ENTRY_SIZE];
+
+    memset(eventData, 0, EVENT_ENTRY_SIZE);
+    memcpy(eventData, event, length);
+
+    auto replayed = reinterpret_cast<ble_evt_t *>(eventData);
+
+    // The peer key captured after the event, ReplayReader refuses the request without it
+    if (replayed->header.evt_id == BLE_GAP_EVT_LESC_DHKEY_REQUEST)
+    {
+        replayed->evt.gap_evt.params.lesc_dhkey_request.p_pk_peer =
+            reinterpret_cast<ble_gap_lesc_p256_pk_t *>(eventData + sizeof(ble_evt_t));
+    }
+
+    // Replayed events are only queued. The driver thread hooks, auto reply, bond store, connection
+    // statistics, write streams and GATT client procedures, would act on a closed adapter.
+    pushEvent(replayed, getMonotonicTimeInMicroseconds(), false);
+
+    // Nothing else drains the queue during the replay
+    if (eventQueue.size() == eventQueue.capacity())
+    {
+        onRpcEvent(nullptr);
+    }
 }
 
-// This runs in Main Thread
-void Adapter::AfterDecodeUUID(uv_work_t *req)
+// Replays the events that are due, and schedules the timer for the next one
+void Adapter::replayTimerCallback(uv_timer_t *handle)
 {
     Nan::HandleScope scope;
-    auto baton = static_cast<BleUUIDDecodeBaton *>(req->data);
+
+    auto &replay = *timedReplay;
+    const auto now = uv_hrtime() / 1000;
+    std::string error;
+
+    for (;;)
+    {
+        if (replay.event == nullptr)
+        {
+            if (!replay.reader.next(replay.event, replay.eventLength, replay.timestamp, error))
+            {
+                break;
+            }
+
+            if (replay.replayed == 0)
+            {
+                replay.firstTimestamp = replay.timestamp;
+            }
+        }
+
+        const auto elapsed = replay.timestamp > replay.firstTimestamp ? replay.timestamp - replay.firstTimestamp : 0;
+        const auto due = replay.start + elapsed;
+
+        if (due > now)
+        {
+            onRpcEvent(nullptr);
+            scheduleTimedReplay((due - now + 999) / 1000);
+            return;
+        }
+
+        replayEvent(replay.event, replay.eventLength);
+        replay.event = nullptr;
+        replay.replayed++;
+    }
+
+    onRpcEvent(nullptr);
+
+    const auto replayed = replay.replayed;
+    const auto offset = replay.reader.getOffset();
+    auto doneCallback = std::move(replay.doneCallback);
+
+    // Ends the replay
+    cleanUpV8Resources();
+
     v8::Local<v8::Value> argv[2];
 
-    if (baton->result != NRF_SUCCESS)
+    if (!error.empty())
     {
-        argv[0] = ErrorMessage::getErrorMessage(baton->result, "decoding UUID.");
-        argv[1] = Nan::Undefined();
+        std::stringstream message;
+        message << error << " at offset " << offset << " of the replay stream";
+        argv[0] = Nan::Error(message.str().c_str());
     }
     else
     {
         argv[0] = Nan::Undefined();
-        argv[1] = BleUUID(baton->p_uuid);
     }
 
-    Nan::AsyncResource resource("pc-ble-driver-js:callback");
-    baton->callback->Call(2, argv, &resource);
-    delete baton;
-}
-
-NAN_METHOD(Adapter::GetStats)
-{
-    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
-    auto stats = Nan::New<v8::Object>();
-
-    Utility::Set(stats, "eventCallbackTotalTime", obj->getEventCallbackTotalTime());
-    Utility::Set(stats, "eventCallbackTotalCount", obj->getEventCallbackCount());
-    Utility::Set(stats, "eventCallbackBatchMaxCount", obj->getEventCallbackMaxCount());
-    Utility::Set(stats, "eventCallbackBatchAvgCount", obj->getAverageCallbackBatchCount());
+    argv[1] = ConversionUtility::toJsNumber(replayed);
 
-    Utility::SetReturnValue(info, stats);
+    Nan::AsyncResource resource("pc-ble-driver-js:callback");
+    doneCallback->Call(2, argv, &resource);
 }
 
 NAN_METHOD(Adapter::ReplyUserMemory)
@@ -1325,7 +3259,7 @@ NAN_METHOD(Adapter::ReplyUserMemory)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, ReplyUserMemory, reinterpret_cast<uv_after_work_cb>(AfterReplyUserMemory));
+    obj->commandQueue.submit(baton->req, ReplyUserMemory, reinterpret_cast<uv_after_work_cb>(AfterReplyUserMemory));
 }
 
 void Adapter::ReplyUserMemory(uv_work_t *req)
@@ -1399,7 +3333,7 @@ NAN_METHOD(Adapter::SetBleOption)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, SetBleOption, reinterpret_cast<uv_after_work_cb>(AfterSetBleOption));
+    obj->commandQueue.submit(baton->req, SetBleOption, reinterpret_cast<uv_after_work_cb>(AfterSetBleOption));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1463,7 +3397,7 @@ NAN_METHOD(Adapter::GetBleOption)
     baton->opt_id = optionId;
     baton->p_opt = new ble_opt_t();
 
-    uv_queue_work(uv_default_loop(), baton->req, GetBleOption, reinterpret_cast<uv_after_work_cb>(AfterGetBleOption));
+    obj->commandQueue.submit(baton->req, GetBleOption, reinterpret_cast<uv_after_work_cb>(AfterGetBleOption));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1553,7 +3487,7 @@ NAN_METHOD(Adapter::SetBleConfig)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, SetBleConfig, reinterpret_cast<uv_after_work_cb>(AfterSetBleConfig));
+    obj->commandQueue.submit(baton->req, SetBleConfig, reinterpret_cast<uv_after_work_cb>(AfterSetBleConfig));
 }
 
 void Adapter::SetBleConfig(uv_work_t *req)
@@ -2459,11 +4393,14 @@ extern "C" {
         Adapter::Init(target);
 
         init_uecc(target);
+        init_replay(target);
     }
 
     void init_adapter_list(Nan::ADDON_REGISTER_FUNCTION_ARGS_TYPE target)
     {
         Utility::SetMethod(target, "getAdapters", GetAdapterList);
+        Utility::SetMethod(target, "startAdapterMonitor", StartAdapterMonitor);
+        Utility::SetMethod(target, "stopAdapterMonitor", StopAdapterMonitor);
     }
 
     void init_driver(Nan::ADDON_REGISTER_FUNCTION_ARGS_TYPE target)
@@ -2769,4 +4706,4 @@ extern "C" {
     }
 }
 
-NODE_MODULE(ble_driver, init)
+NAN_MODULE_WORKER_ENABLED(ble_driver, init)
@@ -62,6 +62,9 @@ static name_map_t common_event_name_map = {
 NAN_INLINE sd_rpc_parity_t ToParityEnum(const std::string& str);
 NAN_INLINE sd_rpc_flow_control_t ToFlowControlEnum(const std::string &str);
 NAN_INLINE sd_rpc_log_severity_t ToLogSeverityEnum(const std::string &str);
+NAN_INLINE EventQueueOverflowPolicy ToEventQueueOverflowPolicyEnum(const std::string &str);
+NAN_INLINE EventTimeFormat ToEventTimeFormatEnum(const std::string &str);
+NAN_INLINE ValueFormat ToValueFormatEnum(const std::string &str);
 
 #pragma region Struct conversions
 
@@ -351,7 +354,7 @@ private:
     BleDriverCommonEvent() {}
 
 public:
-    BleDriverCommonEvent(uint16_t evt_id, std::string timestamp, uint16_t conn_handle, EventType *evt)
+    BleDriverCommonEvent(uint16_t evt_id, const EventTime timestamp, uint16_t conn_handle, EventType *evt)
         : BleDriverEvent<EventType>(evt_id, timestamp, conn_handle, evt)
     {
     }
@@ -373,7 +376,7 @@ public:
 class CommonTXCompleteEvent : BleDriverCommonEvent<ble_evt_tx_complete_t>
 {
 public:
-    CommonTXCompleteEvent(std::string timestamp, uint16_t conn_handle, ble_evt_tx_complete_t *evt)
+    CommonTXCompleteEvent(const EventTime timestamp, uint16_t conn_handle, ble_evt_tx_complete_t *evt)
         : BleDriverCommonEvent<ble_evt_tx_complete_t>(BLE_EVT_TX_COMPLETE, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs() override;
@@ -383,7 +386,7 @@ public:
 class CommonMemRequestEvent : BleDriverCommonEvent<ble_evt_user_mem_request_t>
 {
 public:
-    CommonMemRequestEvent(std::string timestamp, uint16_t conn_handle, ble_evt_user_mem_request_t *evt)
+    CommonMemRequestEvent(const EventTime timestamp, uint16_t conn_handle, ble_evt_user_mem_request_t *evt)
         : BleDriverCommonEvent<ble_evt_user_mem_request_t>(BLE_EVT_USER_MEM_REQUEST, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -392,7 +395,7 @@ public:
 class CommonMemReleaseEvent : BleDriverCommonEvent<ble_evt_user_mem_release_t>
 {
 public:
-    CommonMemReleaseEvent(std::string timestamp, uint16_t conn_handle, ble_evt_user_mem_release_t *evt)
+    CommonMemReleaseEvent(const EventTime timestamp, uint16_t conn_handle, ble_evt_user_mem_release_t *evt)
         : BleDriverCommonEvent<ble_evt_user_mem_release_t>(BLE_EVT_USER_MEM_RELEASE, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -418,6 +421,9 @@ public:
 
     sd_rpc_log_severity_t log_level;
     sd_rpc_log_handler_t log_handler;
+    bool log_batch; // Log entries are sent to NodeJS as one array instead of one callback per entry
+    uint32_t log_burst_limit; // Max log entries sent to NodeJS in every log_burst_interval, 0 is no limit
+    uint32_t log_burst_interval; // Interval in ms of the log rate limit
     sd_rpc_evt_handler_t event_handler;
 
     uint32_t baud_rate;
@@ -425,6 +431,13 @@ public:
     sd_rpc_parity_t parity;
 
     uint32_t evt_interval; // The interval in ms that the event queue is sent to NodeJS
+    uint32_t evt_queue_size; // Number of events that can be queued before the overflow policy is applied
+    EventQueueOverflowPolicy evt_queue_overflow_policy; // What to do with events when the event queue is full
+    EventTimeFormat evt_time_format; // How the time of events is presented in JavaScript
+    ValueFormat evt_value_format; // How characteristic and descriptor values in events are presented in JavaScript
+    uint32_t evt_batch_size; // Number of queued events that are sent to NodeJS at once when adaptive batching is used
+    uint32_t evt_batch_latency; // Max time in ms an event waits before it is sent to NodeJS, 0 disables adaptive batching
+    uint32_t evt_batch_connection_limit; // Max events of one connection sent to NodeJS at once, 0 for no limit
     uint32_t retransmission_interval; // The interval between each retransmission of packet to target
     uint32_t response_timeout; // Duration to wait for reply on reliable packet sent to target
 
@@ -446,7 +459,12 @@ struct ConnResetBaton : public Baton
 {
 public:
     BATON_CONSTRUCTOR(ConnResetBaton);
+    BATON_DESTRUCTOR(ConnResetBaton) {
+        if (enable_ble_params) delete enable_ble_params;
+    }
     sd_rpc_reset_t reset;
+    enable_ble_params_t *enable_ble_params; // If set, BLE is enabled with these params after the reset, see Adapter::ConnReset
+    bool connections_reset; // Set when the connectivity device has been reset, even if BLE could not be enabled after it
     Adapter *mainObject;
 };
 
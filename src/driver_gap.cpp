@@ -37,15 +37,19 @@
 #include "common.h"
 #include "driver_gap.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 #include <mutex>
 #include <memory>
+#include <vector>
 
 // stdout for debugging
 #include <iostream>
 
 #include "adapter.h"
+#include "driver_uecc.h"
 
 extern adapter_t *connectedAdapters[];
 extern int adapterCount;
@@ -578,6 +582,315 @@ ble_gap_scan_params_t *GapScanParams::ToNative()
 
 #pragma endregion GapScanParams
 
+#pragma region GapAdvReportFilter
+
+static v8::Local<v8::Array> getFilterArray(v8::Local<v8::Object> js, const char *name, const char *description)
+{
+    auto value = Utility::Get(js, name);
+
+    if (!value->IsArray())
+    {
+        throw std::string(name) + " must be an array of " + description;
+    }
+
+    return v8::Local<v8::Array>::Cast(value);
+}
+
+// Parses a UUID as written by GapAdvReport::ToJs, e.g. 180D or 6E400001-B5A3-F393-E0A9-E50E24DCCA9E
+static std::vector<uint8_t> parseFilterUuid(std::string text)
+{
+    text.erase(std::remove(text.begin(), text.end(), '-'), text.end());
+
+    if ((text.size() != 4 && text.size() != 8 && text.size() != 32) ||
+        text.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+    {
+        throw std::string("serviceUuids must contain 16, 32 or 128 bit UUIDs given as hexadecimal strings");
+    }
+
+    // Text is big endian, advertising data is little endian
+    std::vector<uint8_t> uuid(text.size() / 2);
+
+    for (size_t i = 0; i < uuid.size(); ++i)
+    {
+        uuid[uuid.size() - 1 - i] = static_cast<uint8_t>(std::stoul(text.substr(i * 2, 2), nullptr, 16));
+    }
+
+    return uuid;
+}
+
+AdvReportFilter *GapAdvReportFilter::ToNative()
+{
+    if (Utility::IsNull(jsobj))
+    {
+        return nullptr;
+    }
+
+    auto filter = std::unique_ptr<AdvReportFilter>(new AdvReportFilter());
+
+    if (Utility::Has(jsobj, "addresses"))
+    {
+        const char *description = "strings formatted as 'AA:BB:CC:DD:EE:FF' or objects with address and type";
+        auto addresses = getFilterArray(jsobj, "addresses", description);
+
+        for (uint32_t i = 0; i < addresses->Length(); ++i)
+        {
+            auto js = Nan::Get(addresses, i).ToLocalChecked();
+            // A plain string matches the address with any address type
+            const auto matchType = js->IsObject();
+            std::string text;
+            ble_gap_addr_t address = {};
+
+            if (matchType)
+            {
+                auto entry = ConversionUtility::getJsObject(js);
+                text = ConversionUtility::getNativeString(entry, "address");
+                const auto type = ConversionUtility::getNativeString(entry, "type");
+                const auto addrType = fromNameToValue(gap_addr_type_map, type.c_str());
+
+                if (addrType == static_cast<uint16_t>(-1))
+                {
+                    throw std::string("addresses must have a type such as BLE_GAP_ADDR_TYPE_PUBLIC");
+                }
+
+                address.addr_type = static_cast<uint8_t>(addrType);
+            }
+            else
+            {
+                text = ConversionUtility::getNativeString(js);
+            }
+
+            unsigned int ptr[BLE_GAP_ADDR_LEN];
+
+            if (sscanf(text.c_str(), "%2x:%2x:%2x:%2x:%2x:%2x", &(ptr[5]), &(ptr[4]), &(ptr[3]), &(ptr[2]), &(ptr[1]), &(ptr[0])) != BLE_GAP_ADDR_LEN)
+            {
+                throw std::string("addresses must be an array of ") + description;
+            }
+
+            for (auto j = 0; j < BLE_GAP_ADDR_LEN; j++)
+            {
+                address.addr[j] = static_cast<uint8_t>(ptr[j]);
+            }
+
+            filter->addAddress(address, matchType);
+        }
+    }
+
+    if (Utility::Has(jsobj, "minRssi"))
+    {
+        filter->setMinRssi(ConversionUtility::getNativeInt8(jsobj, "minRssi"));
+    }
+
+    if (Utility::Has(jsobj, "serviceUuids"))
+    {
+        auto uuids = getFilterArray(jsobj, "serviceUuids", "strings");
+
+        for (uint32_t i = 0; i < uuids->Length(); ++i)
+        {
+            filter->addServiceUuid(parseFilterUuid(ConversionUtility::getNativeString(Nan::Get(uuids, i).ToLocalChecked())));
+        }
+    }
+
+    if (Utility::Has(jsobj, "manufacturerIds"))
+    {
+        auto ids = getFilterArray(jsobj, "manufacturerIds", "numbers");
+
+        for (uint32_t i = 0; i < ids->Length(); ++i)
+        {
+            filter->addManufacturerId(ConversionUtility::getNativeUint16(Nan::Get(ids, i).ToLocalChecked()));
+        }
+    }
+
+    if (Utility::Has(jsobj, "namePrefix"))
+    {
+        filter->setNamePrefix(ConversionUtility::getNativeString(jsobj, "namePrefix"));
+    }
+
+    return filter.release();
+}
+
+#pragma endregion GapAdvReportFilter
+
+#pragma region GapAdvReportDedup
+
+AdvReportDedup *GapAdvReportDedup::ToNative()
+{
+    if (Utility::IsNull(jsobj))
+    {
+        return nullptr;
+    }
+
+    size_t maxDevices = ADV_REPORT_DEDUP_MAX_DEVICES;
+
+    if (Utility::Has(jsobj, "maxDevices"))
+    {
+        maxDevices = ConversionUtility::getNativeUint32(jsobj, "maxDevices");
+
+        if (maxDevices == 0)
+        {
+            throw std::string("maxDevices must be larger than 0");
+        }
+    }
+
+    auto dedup = std::unique_ptr<AdvReportDedup>(new AdvReportDedup(maxDevices));
+
+    if (Utility::Has(jsobj, "payloadChange"))
+    {
+        dedup->setPayloadChange(ConversionUtility::getNativeBool(jsobj, "payloadChange") != 0);
+    }
+
+    if (Utility::Has(jsobj, "rssiDelta"))
+    {
+        dedup->setRssiDelta(ConversionUtility::getNativeUint8(jsobj, "rssiDelta"));
+    }
+
+    if (Utility::Has(jsobj, "interval"))
+    {
+        dedup->setInterval(ConversionUtility::getNativeUint32(jsobj, "interval"));
+    }
+
+    return dedup.release();
+}
+
+#pragma endregion GapAdvReportDedup
+
+#pragma region GapAdvReportBatch
+
+v8::Local<v8::Object> GapAdvReportBatch::ToJs()
+{
+    Nan::EscapableHandleScope scope;
+    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+
+    // All arrays share one ArrayBuffer. The 8 byte timestamps are first to keep every array aligned.
+    const size_t timestampsOffset = 0;
+    const size_t dataOffsetsOffset = timestampsOffset + native->timestamps.size() * sizeof(double);
+    const size_t addressesOffset = dataOffsetsOffset + native->dataOffsets.size() * sizeof(uint32_t);
+    const size_t addressTypesOffset = addressesOffset + native->addresses.size();
+    const size_t rssiOffset = addressTypesOffset + native->addressTypes.size();
+    const size_t typesOffset = rssiOffset + native->rssi.size();
+    const size_t scanRspOffset = typesOffset + native->types.size();
+    const size_t dataOffset = scanRspOffset + native->scanRsp.size();
+    const size_t totalSize = dataOffset + native->data.size();
+
+    auto buffer = v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), totalSize);
+    Nan::TypedArrayContents<uint8_t> contents(v8::Uint8Array::New(buffer, 0, totalSize));
+    auto base = *contents;
+
+    memcpy(base + timestampsOffset, native->timestamps.data(), native->timestamps.size() * sizeof(double));
+    memcpy(base + dataOffsetsOffset, native->dataOffsets.data(), native->dataOffsets.size() * sizeof(uint32_t));
+    memcpy(base + addressesOffset, native->addresses.data(), native->addresses.size());
+    memcpy(base + addressTypesOffset, native->addressTypes.data(), native->addressTypes.size());
+    memcpy(base + rssiOffset, native->rssi.data(), native->rssi.size());
+    memcpy(base + typesOffset, native->types.data(), native->types.size());
+    memcpy(base + scanRspOffset, native->scanRsp.data(), native->scanRsp.size());
+    memcpy(base + dataOffset, native->data.data(), native->data.size());
+
+    Utility::Set(obj, "id", static_cast<uint16_t>(BLE_GAP_EVT_ADV_REPORT_BATCH));
+    Utility::Set(obj, "name", "BLE_GAP_EVT_ADV_REPORT_BATCH");
+    Utility::Set(obj, "count", static_cast<uint32_t>(native->size()));
+    Utility::Set(obj, "timestamps", v8::Float64Array::New(buffer, timestampsOffset, native->timestamps.size()));
+    Utility::Set(obj, "dataOffsets", v8::Uint32Array::New(buffer, dataOffsetsOffset, native->dataOffsets.size()));
+    Utility::Set(obj, "addresses", v8::Uint8Array::New(buffer, addressesOffset, native->addresses.size()));
+    Utility::Set(obj, "addressTypes", v8::Uint8Array::New(buffer, addressTypesOffset, native->addressTypes.size()));
+    Utility::Set(obj, "rssi", v8::Int8Array::New(buffer, rssiOffset, native->rssi.size()));
+    Utility::Set(obj, "types", v8::Uint8Array::New(buffer, typesOffset, native->types.size()));
+    Utility::Set(obj, "scanRsp", v8::Uint8Array::New(buffer, scanRspOffset, native->scanRsp.size()));
+    Utility::Set(obj, "data", v8::Uint8Array::New(buffer, dataOffset, native->data.size()));
+
+    return scope.Escape(obj);
+}
+
+#pragma endregion GapAdvReportBatch
+
+#pragma region GapAutoReplyPolicy
+
+static uint16_t getOptionalUint16(v8::Local<v8::Object> js, const char *name, const uint16_t defaultValue)
+{
+    return Utility::Has(js, name) ? ConversionUtility::getNativeUint16(js, name) : defaultValue;
+}
+
+AutoReplyPolicy *GapAutoReplyPolicy::ToNative()
+{
+    auto policy = std::unique_ptr<AutoReplyPolicy>(new AutoReplyPolicy());
+
+    if (Utility::Has(jsobj, "connectionParameters"))
+    {
+        auto limits = ConversionUtility::getJsObject(jsobj, "connectionParameters");
+
+        if (Utility::Has(limits, "reject") && ConversionUtility::getNativeBool(limits, "reject"))
+        {
+            policy->setConnParamsReject();
+        }
+        else
+        {
+            policy->setConnParamsLimits(getOptionalUint16(limits, "minConnectionInterval", 0),
+                                        getOptionalUint16(limits, "maxConnectionInterval", 0),
+                                        getOptionalUint16(limits, "maxSlaveLatency", UINT16_MAX),
+                                        getOptionalUint16(limits, "minConnectionSupervisionTimeout", 0),
+                                        getOptionalUint16(limits, "maxConnectionSupervisionTimeout", 0));
+        }
+    }
+
+    if (Utility::Has(jsobj, "secParams"))
+    {
+        std::unique_ptr<ble_gap_sec_params_t> params(GapSecParams(ConversionUtility::getJsObject(jsobj, "secParams")).ToNative());
+
+        // LE Secure Connections needs the public key of this pairing in the keyset
+        if (params->lesc && !Utility::Has(jsobj, "lescPrivateKey"))
+        {
+            throw std::string("secParams with lesc require lescPrivateKey");
+        }
+
+        policy->setSecParams(*params);
+    }
+
+    if (Utility::Has(jsobj, "lescPrivateKey"))
+    {
+        auto js = Utility::Get(jsobj, "lescPrivateKey");
+
+        if (!js->IsArray() || v8::Local<v8::Array>::Cast(js)->Length() != ECC_P256_SK_LEN)
+        {
+            throw std::string("lescPrivateKey as an array of 32 bytes");
+        }
+
+        std::unique_ptr<uint8_t, decltype(&free)> sk(ConversionUtility::getNativePointerToUint8(jsobj, "lescPrivateKey"), &free);
+        uint8_t pk[ECC_P256_PK_LEN];
+
+        if (!eccComputePublicKey(sk.get(), pk))
+        {
+            throw std::string("lescPrivateKey as a valid P-256 private key");
+        }
+
+        policy->setLescKeys(sk.get(), pk);
+    }
+
+#if NRF_SD_BLE_API_VERSION >= 5
+    if (Utility::Has(jsobj, "attMtu"))
+    {
+        policy->setAttMtu(ConversionUtility::getNativeUint16(jsobj, "attMtu"));
+    }
+
+    if (Utility::Has(jsobj, "maxDataLength"))
+    {
+        policy->setMaxDataLength(ConversionUtility::getNativeUint16(jsobj, "maxDataLength"));
+    }
+
+    if (Utility::Has(jsobj, "phys"))
+    {
+        std::unique_ptr<ble_gap_phys_t> phys(GapPhys(ConversionUtility::getJsObject(jsobj, "phys")).ToNative());
+        policy->setPhys(*phys);
+    }
+#else
+    if (Utility::Has(jsobj, "attMtu") || Utility::Has(jsobj, "maxDataLength") || Utility::Has(jsobj, "phys"))
+    {
+        throw std::string("attMtu, maxDataLength and phys require SoftDevice API version 5");
+    }
+#endif
+
+    return policy.release();
+}
+
+#pragma endregion GapAutoReplyPolicy
+
 #pragma region GapSecKdist
 
 v8::Local<v8::Object> GapSecKdist::ToJs()
@@ -886,7 +1199,7 @@ ble_gap_lesc_oob_data_t *GapLescOobData::ToNative()
 v8::Local<v8::Object> GapConnected::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverEvent::createJsObject();
     BleDriverEvent::ToJs(obj);
 
     Utility::Set(obj, "peer_addr", GapAddr(&(evt->peer_addr)).ToJs());
@@ -911,7 +1224,7 @@ v8::Local<v8::Object> GapConnected::ToJs()
 v8::Local<v8::Object> GapDisconnected::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverEvent::createJsObject();
     BleDriverEvent::ToJs(obj);
     Utility::Set(obj, "reason", evt->reason);
     Utility::Set(obj, "reason_name", HciStatus::getHciStatus(evt->reason));
@@ -925,7 +1238,7 @@ v8::Local<v8::Object> GapDisconnected::ToJs()
 v8::Local<v8::Object> GapConnParamUpdate::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverEvent::createJsObject();
     BleDriverEvent::ToJs(obj);
     Utility::Set(obj, "conn_params", GapConnParams(&(this->evt->conn_params)).ToJs());
 
@@ -939,7 +1252,7 @@ v8::Local<v8::Object> GapConnParamUpdate::ToJs()
 v8::Local<v8::Object> GapSecParamsRequest::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverEvent::createJsObject();
     BleDriverEvent::ToJs(obj);
     Utility::Set(obj, "peer_params", GapSecParams(&(this->evt->peer_params)).ToJs());
     return scope.Escape(obj);
@@ -952,7 +1265,7 @@ v8::Local<v8::Object> GapSecParamsRequest::ToJs()
 v8::Local<v8::Object> GapSecInfoRequest::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverEvent::createJsObject();
     BleDriverEvent::ToJs(obj);
     Utility::Set(obj, "peer_addr", GapAddr(&(evt->peer_addr)).ToJs());
     Utility::Set(obj, "master_id", GapMasterId(&(evt->master_id)).ToJs());
@@ -970,7 +1283,7 @@ v8::Local<v8::Object> GapSecInfoRequest::ToJs()
 v8::Local<v8::Object> GapDataLengthUpdateRequest::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverEvent::createJsObject();
     BleDriverEvent::ToJs(obj);
     Utility::Set(obj, "peer_params", GapDataLengthParams(&(evt->peer_params)).ToJs());
     return scope.Escape(obj);
@@ -982,7 +1295,7 @@ v8::Local<v8::Object> GapDataLengthUpdateRequest::ToJs()
 v8::Local<v8::Object> GapDataLengthUpdateEvt::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverEvent::createJsObject();
     BleDriverEvent::ToJs(obj);
     Utility::Set(obj, "effective_params", GapDataLengthParams(&(evt->effective_params)).ToJs());
     return scope.Escape(obj);
@@ -1038,7 +1351,7 @@ v8::Local<v8::Object> GapDataLengthParams::ToJs()
 v8::Local<v8::Object> GapPhyUpdateRequest::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverEvent::createJsObject();
     BleDriverEvent::ToJs(obj);
     Utility::Set(obj, "peer_preferred_phys", GapPhys(&(evt->peer_preferred_phys)).ToJs());
     return scope.Escape(obj);
@@ -1050,7 +1363,7 @@ v8::Local<v8::Object> GapPhyUpdateRequest::ToJs()
 v8::Local<v8::Object> GapPhyUpdateEvt::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverEvent::createJsObject();
     BleDriverEvent::ToJs(obj);
     Utility::Set(obj, "status", evt->status);
     Utility::Set(obj, "tx_phy", evt->tx_phy);
@@ -1127,7 +1440,7 @@ v8::Local<v8::Object> GapPhys::ToJs()
 v8::Local<v8::Object> GapPasskeyDisplay::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverEvent::createJsObject();
     BleDriverEvent::ToJs(obj);
     Utility::Set(obj, "match_request", ConversionUtility::toJsBool(evt->match_request));
     Utility::Set(obj, "passkey", ConversionUtility::toJsString(reinterpret_cast<char *>(evt->passkey), BLE_GAP_PASSKEY_LEN));
@@ -1141,7 +1454,7 @@ v8::Local<v8::Object> GapPasskeyDisplay::ToJs()
 v8::Local<v8::Object> GapKeyPressed::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverEvent::createJsObject();
     BleDriverEvent::ToJs(obj);
     Utility::Set(obj, "kp_not", ConversionUtility::valueToJsString(evt->kp_not, gap_kp_not_types));
     return scope.Escape(obj);
@@ -1153,7 +1466,7 @@ v8::Local<v8::Object> GapKeyPressed::ToJs()
 v8::Local<v8::Object> GapAuthKeyRequest::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverEvent::createJsObject();
     BleDriverEvent::ToJs(obj);
     Utility::Set(obj, "key_type", ConversionUtility::valueToJsString(evt->key_type, gap_auth_key_types));
     return scope.Escape(obj);
@@ -1164,7 +1477,7 @@ v8::Local<v8::Object> GapAuthKeyRequest::ToJs()
 v8::Local<v8::Object> GapLESCDHKeyRequest::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverEvent::createJsObject();
     BleDriverEvent::ToJs(obj);
     Utility::Set(obj, "oobd_req", ConversionUtility::toJsBool(evt->oobd_req));
     Utility::Set(obj, "pk_peer", GapLescP256Pk(evt->p_pk_peer).ToJs());
@@ -1377,7 +1690,7 @@ ble_gap_sec_keyset_t *GapSecKeyset::ToNative()
 v8::Local<v8::Object> GapAuthStatus::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverEvent::createJsObject();
     BleDriverEvent::ToJs(obj);
     Utility::Set(obj, "auth_status", ConversionUtility::toJsNumber(evt->auth_status));
     Utility::Set(obj, "auth_status_name", ConversionUtility::valueToJsString(evt->auth_status, gap_sec_status_map));
@@ -1403,7 +1716,7 @@ v8::Local<v8::Object> GapAuthStatus::ToJs()
 v8::Local<v8::Object> GapConnSecUpdate::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverEvent::createJsObject();
     BleDriverEvent::ToJs(obj);
     Utility::Set(obj, "conn_sec", GapConnSec(&(evt->conn_sec)).ToJs());
     return scope.Escape(obj);
@@ -1415,7 +1728,7 @@ v8::Local<v8::Object> GapConnSecUpdate::ToJs()
 v8::Local<v8::Object> GapTimeout::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverEvent::createJsObject();
     BleDriverEvent::ToJs(obj);
     Utility::Set(obj, "src", evt->src);
     Utility::Set(obj, "src_name", ConversionUtility::valueToJsString(evt->src, gap_timeout_sources_map));
@@ -1429,7 +1742,7 @@ v8::Local<v8::Object> GapTimeout::ToJs()
 v8::Local<v8::Object> GapRssiChanged::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverEvent::createJsObject();
     BleDriverEvent::ToJs(obj);
     Utility::Set(obj, "rssi", evt->rssi);
 
@@ -1442,7 +1755,7 @@ v8::Local<v8::Object> GapRssiChanged::ToJs()
 v8::Local<v8::Object> GapAdvReport::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverEvent::createJsObject();
     BleDriverEvent::ToJs(obj);
     Utility::Set(obj, "rssi", evt->rssi);
     Utility::Set(obj, "peer_addr", GapAddr(&(this->evt->peer_addr)).ToJs());
@@ -1618,7 +1931,7 @@ v8::Local<v8::Object> GapAdvReport::ToJs()
 v8::Local<v8::Object> GapSecRequest::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverEvent::createJsObject();
     BleDriverEvent::ToJs(obj);
     Utility::Set(obj, "bond", ConversionUtility::toJsBool(evt->bond));
     Utility::Set(obj, "mitm", ConversionUtility::toJsBool(evt->mitm));
@@ -1633,7 +1946,7 @@ v8::Local<v8::Object> GapSecRequest::ToJs()
 v8::Local<v8::Object> GapScanReqReport::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverEvent::createJsObject();
     BleDriverEvent::ToJs(obj);
     Utility::Set(obj, "rssi", evt->rssi);
     Utility::Set(obj, "peer_addr", GapAddr(&(this->evt->peer_addr)).ToJs());
@@ -1647,7 +1960,7 @@ v8::Local<v8::Object> GapScanReqReport::ToJs()
 v8::Local<v8::Object> GapConnParamUpdateRequest::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverEvent::createJsObject();
     BleDriverEvent::ToJs(obj);
     Utility::Set(obj, "conn_params", GapConnParams(&(this->evt->conn_params)).ToJs());
     return scope.Escape(obj);
@@ -1707,7 +2020,7 @@ NAN_METHOD(Adapter::GapSetAddress)
     }
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapSetAddress, reinterpret_cast<uv_after_work_cb>(AfterGapSetAddress));
+    obj->commandQueue.submit(baton->req, GapSetAddress, reinterpret_cast<uv_after_work_cb>(AfterGapSetAddress));
 }
 
 void Adapter::GapSetAddress(uv_work_t *req)
@@ -1770,7 +2083,7 @@ NAN_METHOD(Adapter::GapGetAddress)
     baton->address = address;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapGetAddress, reinterpret_cast<uv_after_work_cb>(AfterGapGetAddress));
+    obj->commandQueue.submit(baton->req, GapGetAddress, reinterpret_cast<uv_after_work_cb>(AfterGapGetAddress));
 
     return;
 }
@@ -1855,7 +2168,7 @@ NAN_METHOD(Adapter::GapUpdateConnectionParameters)
     }
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapUpdateConnectionParameters, reinterpret_cast<uv_after_work_cb>(AfterGapUpdateConnectionParameters));
+    obj->commandQueue.submit(baton->req, GapUpdateConnectionParameters, reinterpret_cast<uv_after_work_cb>(AfterGapUpdateConnectionParameters));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1924,7 +2237,7 @@ NAN_METHOD(Adapter::GapDisconnect)
     baton->hci_status_code = hci_status_code;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapDisconnect, reinterpret_cast<uv_after_work_cb>(AfterGapDisconnect));
+    obj->commandQueue.submit(baton->req, GapDisconnect, reinterpret_cast<uv_after_work_cb>(AfterGapDisconnect));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1987,7 +2300,7 @@ NAN_METHOD(Adapter::GapSetTXPower)
     baton->tx_power = tx_power;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapSetTXPower, reinterpret_cast<uv_after_work_cb>(AfterGapSetTXPower));
+    obj->commandQueue.submit(baton->req, GapSetTXPower, reinterpret_cast<uv_after_work_cb>(AfterGapSetTXPower));
 
 }
 
@@ -2073,7 +2386,7 @@ NAN_METHOD(Adapter::GapSetDeviceName)
     baton->length = (uint16_t)length;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapSetDeviceName, reinterpret_cast<uv_after_work_cb>(AfterGapSetDeviceName));
+    obj->commandQueue.submit(baton->req, GapSetDeviceName, reinterpret_cast<uv_after_work_cb>(AfterGapSetDeviceName));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2134,7 +2447,7 @@ NAN_METHOD(Adapter::GapGetDeviceName)
     baton->dev_name.resize(baton->length);
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapGetDeviceName, reinterpret_cast<uv_after_work_cb>(AfterGapGetDeviceName));
+    obj->commandQueue.submit(baton->req, GapGetDeviceName, reinterpret_cast<uv_after_work_cb>(AfterGapGetDeviceName));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2213,7 +2526,7 @@ NAN_METHOD(Adapter::GapStartRSSI)
     baton->skip_count = skip_count;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapStartRSSI, reinterpret_cast<uv_after_work_cb>(AfterGapStartRSSI));
+    obj->commandQueue.submit(baton->req, GapStartRSSI, reinterpret_cast<uv_after_work_cb>(AfterGapStartRSSI));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2275,7 +2588,7 @@ NAN_METHOD(Adapter::GapStopRSSI)
     baton->conn_handle = conn_handle;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapStopRSSI, reinterpret_cast<uv_after_work_cb>(AfterGapStopRSSI));
+    obj->commandQueue.submit(baton->req, GapStopRSSI, reinterpret_cast<uv_after_work_cb>(AfterGapStopRSSI));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2353,7 +2666,7 @@ NAN_METHOD(Adapter::GapStartScan)
     baton->adapter = obj->adapter;
 
 
-    uv_queue_work(uv_default_loop(), baton->req, GapStartScan, reinterpret_cast<uv_after_work_cb>(AfterGapStartScan));
+    obj->commandQueue.submit(baton->req, GapStartScan, reinterpret_cast<uv_after_work_cb>(AfterGapStartScan));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2392,6 +2705,207 @@ void Adapter::AfterGapStartScan(uv_work_t *req)
 
 #pragma endregion GapStartScan
 
+#pragma region GapSetScanFilter
+
+NAN_METHOD(Adapter::GapSetScanFilter)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    std::unique_ptr<AdvReportFilter> filter;
+    std::unique_ptr<AdvReportDedup> dedup;
+    auto batch = false;
+
+    // Called with null or undefined to remove the filter
+    if (!info[0]->IsNullOrUndefined())
+    {
+        v8::Local<v8::Object> options;
+
+        try
+        {
+            options = ConversionUtility::getJsObject(info[0]);
+        }
+        catch (std::string error)
+        {
+            v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(0, error);
+            Nan::ThrowTypeError(message);
+            return;
+        }
+
+        try
+        {
+            filter.reset(GapAdvReportFilter(options).ToNative());
+
+            if (Utility::Has(options, "dedup"))
+            {
+                dedup.reset(GapAdvReportDedup(ConversionUtility::getJsObject(options, "dedup")).ToNative());
+            }
+
+            if (Utility::Has(options, "batch"))
+            {
+                batch = ConversionUtility::getNativeBool(options, "batch") != 0;
+            }
+        }
+        catch (std::string error)
+        {
+            auto message = ErrorMessage::getStructErrorMessage("filter", error);
+            Nan::ThrowTypeError(message);
+            return;
+        }
+    }
+
+    obj->setAdvReportFilter(std::move(filter), std::move(dedup), batch);
+}
+
+#pragma endregion GapSetScanFilter
+
+#pragma region SetAutoReplyPolicy
+
+NAN_METHOD(Adapter::SetAutoReplyPolicy)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    std::shared_ptr<const AutoReplyPolicy> policy;
+
+    // Called with null or undefined to remove the policy
+    if (!info[0]->IsNullOrUndefined())
+    {
+        v8::Local<v8::Object> options;
+
+        try
+        {
+            options = ConversionUtility::getJsObject(info[0]);
+        }
+        catch (std::string error)
+        {
+            v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(0, error);
+            Nan::ThrowTypeError(message);
+            return;
+        }
+
+        try
+        {
+            policy.reset(GapAutoReplyPolicy(options).ToNative());
+        }
+        catch (std::string error)
+        {
+            auto message = ErrorMessage::getStructErrorMessage("policy", error);
+            Nan::ThrowTypeError(message);
+            return;
+        }
+    }
+
+    obj->setAutoReplyPolicy(std::move(policy));
+}
+
+#pragma endregion SetAutoReplyPolicy
+
+#pragma region BondStore
+
+NAN_METHOD(Adapter::SetBondStore)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    std::shared_ptr<BondStore> store;
+
+    // Called with null or undefined to remove the bond store
+    if (!info[0]->IsNullOrUndefined())
+    {
+        v8::Local<v8::Object> options;
+
+        try
+        {
+            options = ConversionUtility::getJsObject(info[0]);
+        }
+        catch (std::string error)
+        {
+            v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(0, error);
+            Nan::ThrowTypeError(message);
+            return;
+        }
+
+        try
+        {
+            store = std::make_shared<BondStore>();
+
+            if (Utility::Has(options, "encryptOnConnect"))
+            {
+                store->setEncryptOnConnect(ConversionUtility::getNativeBool(options, "encryptOnConnect") != 0);
+            }
+
+            if (Utility::Has(options, "path"))
+            {
+                store->setPath(ConversionUtility::getNativeString(options, "path"));
+            }
+        }
+        catch (std::string error)
+        {
+            auto message = ErrorMessage::getStructErrorMessage("bondStore", error);
+            Nan::ThrowTypeError(message);
+            return;
+        }
+    }
+
+    obj->setBondStore(std::move(store));
+}
+
+NAN_METHOD(Adapter::GetBonds)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    auto store = obj->getBondStore();
+    auto bonds = Nan::New<v8::Array>();
+
+    if (store != nullptr)
+    {
+        auto index = 0;
+
+        for (auto bond : store->getBonds())
+        {
+            const auto &key = bond.hasOwnKey ? bond.ownKey : bond.peerKey;
+            auto js = Nan::New<v8::Object>();
+
+            Utility::Set(js, "peer_addr", GapAddr(&bond.address).ToJs());
+            Utility::Set(js, "own_key", bond.hasOwnKey);
+            Utility::Set(js, "peer_key", bond.hasPeerKey);
+            Utility::Set(js, "lesc", key.enc_info.lesc != 0);
+            Utility::Set(js, "auth", key.enc_info.auth != 0);
+
+            Nan::Set(bonds, index++, js);
+        }
+    }
+
+    info.GetReturnValue().Set(bonds);
+}
+
+NAN_METHOD(Adapter::DeleteBond)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    std::unique_ptr<ble_gap_addr_t> address;
+
+    try
+    {
+        address.reset(GapAddr(ConversionUtility::getJsObject(info[0])).ToNative());
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(0, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto store = obj->getBondStore();
+    info.GetReturnValue().Set(store != nullptr && store->removeBond(*address));
+}
+
+NAN_METHOD(Adapter::ClearBonds)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    auto store = obj->getBondStore();
+
+    if (store != nullptr)
+    {
+        store->clear();
+    }
+}
+
+#pragma endregion BondStore
+
 #pragma region GapStopScan
 
 NAN_METHOD(Adapter::GapStopScan)
@@ -2415,7 +2929,7 @@ NAN_METHOD(Adapter::GapStopScan)
     auto baton = new StopScanBaton(callback);
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapStopScan, reinterpret_cast<uv_after_work_cb>(AfterGapStopScan));
+    obj->commandQueue.submit(baton->req, GapStopScan, reinterpret_cast<uv_after_work_cb>(AfterGapStopScan));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2518,7 +3032,7 @@ NAN_METHOD(Adapter::GapConnect)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GapConnect, reinterpret_cast<uv_after_work_cb>(AfterGapConnect));
+    obj->commandQueue.submit(baton->req, GapConnect, reinterpret_cast<uv_after_work_cb>(AfterGapConnect));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2580,7 +3094,7 @@ NAN_METHOD(Adapter::GapCancelConnect)
     auto baton = new GapConnectCancelBaton(callback);
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapCancelConnect, reinterpret_cast<uv_after_work_cb>(AfterGapCancelConnect));
+    obj->commandQueue.submit(baton->req, GapCancelConnect, reinterpret_cast<uv_after_work_cb>(AfterGapCancelConnect));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2642,7 +3156,7 @@ NAN_METHOD(Adapter::GapGetRSSI)
     baton->rssi = 0;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapGetRSSI, reinterpret_cast<uv_after_work_cb>(AfterGapGetRSSI));
+    obj->commandQueue.submit(baton->req, GapGetRSSI, reinterpret_cast<uv_after_work_cb>(AfterGapGetRSSI));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2740,7 +3254,7 @@ NAN_METHOD(Adapter::GapStartAdvertising)
 
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapStartAdvertising, reinterpret_cast<uv_after_work_cb>(AfterGapStartAdvertising));
+    obj->commandQueue.submit(baton->req, GapStartAdvertising, reinterpret_cast<uv_after_work_cb>(AfterGapStartAdvertising));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2806,7 +3320,7 @@ NAN_METHOD(Adapter::GapStopAdvertising)
     auto baton = new GapStopAdvertisingBaton(callback);
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapStopAdvertising, reinterpret_cast<uv_after_work_cb>(AfterGapStopAdvertising));
+    obj->commandQueue.submit(baton->req, GapStopAdvertising, reinterpret_cast<uv_after_work_cb>(AfterGapStopAdvertising));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2869,7 +3383,7 @@ NAN_METHOD(Adapter::GapGetConnectionSecurity)
     baton->conn_sec = new ble_gap_conn_sec_t();
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapGetConnectionSecurity, reinterpret_cast<uv_after_work_cb>(AfterGapGetConnectionSecurity));
+    obj->commandQueue.submit(baton->req, GapGetConnectionSecurity, reinterpret_cast<uv_after_work_cb>(AfterGapGetConnectionSecurity));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -2963,7 +3477,7 @@ NAN_METHOD(Adapter::GapEncrypt)
     }
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapEncrypt, reinterpret_cast<uv_after_work_cb>(AfterGapEncrypt));
+    obj->commandQueue.submit(baton->req, GapEncrypt, reinterpret_cast<uv_after_work_cb>(AfterGapEncrypt));
 }
 
 void Adapter::GapEncrypt(uv_work_t *req)
@@ -3096,7 +3610,7 @@ NAN_METHOD(Adapter::GapReplySecurityParameters)
 
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapReplySecurityParameters, reinterpret_cast<uv_after_work_cb>(AfterGapReplySecurityParameters));
+    obj->commandQueue.submit(baton->req, GapReplySecurityParameters, reinterpret_cast<uv_after_work_cb>(AfterGapReplySecurityParameters));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3218,7 +3732,7 @@ NAN_METHOD(Adapter::GapReplySecurityInfo)
     }
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapReplySecurityInfo, reinterpret_cast<uv_after_work_cb>(AfterGapReplySecurityInfo));
+    obj->commandQueue.submit(baton->req, GapReplySecurityInfo, reinterpret_cast<uv_after_work_cb>(AfterGapReplySecurityInfo));
 }
 
 void Adapter::GapReplySecurityInfo(uv_work_t *req)
@@ -3293,7 +3807,7 @@ NAN_METHOD(Adapter::GapAuthenticate)
     }
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapAuthenticate, reinterpret_cast<uv_after_work_cb>(AfterGapAuthenticate));
+    obj->commandQueue.submit(baton->req, GapAuthenticate, reinterpret_cast<uv_after_work_cb>(AfterGapAuthenticate));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3387,7 +3901,7 @@ NAN_METHOD(Adapter::GapSetAdvertisingData)
     baton->srdlen = scan_response_length;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapSetAdvertisingData, reinterpret_cast<uv_after_work_cb>(AfterGapSetAdvertisingData));
+    obj->commandQueue.submit(baton->req, GapSetAdvertisingData, reinterpret_cast<uv_after_work_cb>(AfterGapSetAdvertisingData));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3460,7 +3974,7 @@ NAN_METHOD(Adapter::GapSetPPCP)
     }
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapSetPPCP, reinterpret_cast<uv_after_work_cb>(AfterGapSetPPCP));
+    obj->commandQueue.submit(baton->req, GapSetPPCP, reinterpret_cast<uv_after_work_cb>(AfterGapSetPPCP));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3518,7 +4032,7 @@ NAN_METHOD(Adapter::GapGetPPCP)
     baton->p_conn_params = new ble_gap_conn_params_t();
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapGetPPCP, reinterpret_cast<uv_after_work_cb>(AfterGapGetPPCP));
+    obj->commandQueue.submit(baton->req, GapGetPPCP, reinterpret_cast<uv_after_work_cb>(AfterGapGetPPCP));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3582,7 +4096,7 @@ NAN_METHOD(Adapter::GapSetAppearance)
     baton->appearance = appearance;
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapSetAppearance, reinterpret_cast<uv_after_work_cb>(AfterGapSetAppearance));
+    obj->commandQueue.submit(baton->req, GapSetAppearance, reinterpret_cast<uv_after_work_cb>(AfterGapSetAppearance));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3637,7 +4151,7 @@ NAN_METHOD(Adapter::GapGetAppearance)
     auto baton = new GapGetAppearanceBaton(callback);
     baton->adapter = obj->adapter;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapGetAppearance, reinterpret_cast<uv_after_work_cb>(AfterGapGetAppearance));
+    obj->commandQueue.submit(baton->req, GapGetAppearance, reinterpret_cast<uv_after_work_cb>(AfterGapGetAppearance));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3727,7 +4241,7 @@ NAN_METHOD(Adapter::GapReplyAuthKey)
     baton->key_type = key_type;
     baton->key = key;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapReplyAuthKey, reinterpret_cast<uv_after_work_cb>(AfterGapReplyAuthKey));
+    obj->commandQueue.submit(baton->req, GapReplyAuthKey, reinterpret_cast<uv_after_work_cb>(AfterGapReplyAuthKey));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3797,7 +4311,7 @@ NAN_METHOD(Adapter::GapReplyDHKeyLESC)
     baton->dhkey = dhkey;
     free(key);
 
-    uv_queue_work(uv_default_loop(), baton->req, GapReplyDHKeyLESC, reinterpret_cast<uv_after_work_cb>(AfterGapReplyDHKeyLESC));
+    obj->commandQueue.submit(baton->req, GapReplyDHKeyLESC, reinterpret_cast<uv_after_work_cb>(AfterGapReplyDHKeyLESC));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3863,7 +4377,7 @@ NAN_METHOD(Adapter::GapNotifyKeypress)
     baton->conn_handle = conn_handle;
     baton->kp_not = kp_not;
 
-    uv_queue_work(uv_default_loop(), baton->req, GapNotifyKeypress, reinterpret_cast<uv_after_work_cb>(AfterGapNotifyKeypress));
+    obj->commandQueue.submit(baton->req, GapNotifyKeypress, reinterpret_cast<uv_after_work_cb>(AfterGapNotifyKeypress));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -3934,7 +4448,7 @@ NAN_METHOD(Adapter::GapGetLESCOOBData)
     baton->p_pk_own = p_pk_own;
     baton->p_oobd_own = new ble_gap_lesc_oob_data_t();
 
-    uv_queue_work(uv_default_loop(), baton->req, GapGetLESCOOBData, reinterpret_cast<uv_after_work_cb>(AfterGapGetLESCOOBData));
+    obj->commandQueue.submit(baton->req, GapGetLESCOOBData, reinterpret_cast<uv_after_work_cb>(AfterGapGetLESCOOBData));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -4027,7 +4541,7 @@ NAN_METHOD(Adapter::GapSetLESCOOBData)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GapSetLESCOOBData, reinterpret_cast<uv_after_work_cb>(AfterGapSetLESCOOBData));
+    obj->commandQueue.submit(baton->req, GapSetLESCOOBData, reinterpret_cast<uv_after_work_cb>(AfterGapSetLESCOOBData));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -4107,7 +4621,7 @@ NAN_METHOD(Adapter::GapDataLengthUpdate)
 
     baton->p_dl_limitation = new ble_gap_data_length_limitation_t();
 
-    uv_queue_work(uv_default_loop(), baton->req, GapDataLengthUpdate, reinterpret_cast<uv_after_work_cb>(AfterGapDataLengthUpdate));
+    obj->commandQueue.submit(baton->req, GapDataLengthUpdate, reinterpret_cast<uv_after_work_cb>(AfterGapDataLengthUpdate));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -4188,7 +4702,7 @@ NAN_METHOD(Adapter::GapPhyUpdate)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GapPhyUpdate, reinterpret_cast<uv_after_work_cb>(AfterGapPhyUpdate));
+    obj->commandQueue.submit(baton->req, GapPhyUpdate, reinterpret_cast<uv_after_work_cb>(AfterGapPhyUpdate));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -4250,6 +4764,7 @@ extern "C" {
         NODE_DEFINE_CONSTANT(target, BLE_GAP_EVT_TIMEOUT);
         NODE_DEFINE_CONSTANT(target, BLE_GAP_EVT_RSSI_CHANGED);
         NODE_DEFINE_CONSTANT(target, BLE_GAP_EVT_ADV_REPORT);
+        NODE_DEFINE_CONSTANT(target, BLE_GAP_EVT_ADV_REPORT_BATCH);
         NODE_DEFINE_CONSTANT(target, BLE_GAP_EVT_SEC_REQUEST);
         NODE_DEFINE_CONSTANT(target, BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST);
         NODE_DEFINE_CONSTANT(target, BLE_GAP_EVT_SCAN_REQ_REPORT);
@@ -40,9 +40,15 @@
 #include "ble.h"
 #include "ble_hci.h"
 #include "common.h"
+#include "adv_report.h"
+#include "auto_reply.h"
 
 #include <string>
 
+// Not a SoftDevice event, used for advertising reports delivered in batches, see Adapter::GapSetScanFilter.
+// The id is outside of the event id ranges used by the SoftDevice.
+#define BLE_GAP_EVT_ADV_REPORT_BATCH 0x1000
+
 static name_map_t gap_event_name_map = {
     NAME_MAP_ENTRY(BLE_GAP_EVT_CONNECTED),
     NAME_MAP_ENTRY(BLE_GAP_EVT_DISCONNECTED),
@@ -79,7 +85,7 @@ private:
     BleDriverGapEvent() {}
 
 public:
-    BleDriverGapEvent(uint16_t evt_id, const std::string timestamp, uint16_t conn_handle, EventType *evt)
+    BleDriverGapEvent(uint16_t evt_id, const EventTime timestamp, uint16_t conn_handle, EventType *evt)
         : BleDriverEvent<EventType>(evt_id, timestamp, conn_handle, evt)
     {
     }
@@ -98,7 +104,7 @@ public:
 class GapAdvReport : public BleDriverGapEvent<ble_gap_evt_adv_report_t>
 {
 public:
-    GapAdvReport(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_adv_report_t *evt)
+    GapAdvReport(const EventTime timestamp, uint16_t conn_handle, ble_gap_evt_adv_report_t *evt)
         : BleDriverGapEvent<ble_gap_evt_adv_report_t>(BLE_GAP_EVT_ADV_REPORT, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -107,7 +113,7 @@ public:
 class GapScanReqReport : public BleDriverGapEvent<ble_gap_evt_scan_req_report_t>
 {
 public:
-    GapScanReqReport(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_scan_req_report_t *evt)
+    GapScanReqReport(const EventTime timestamp, uint16_t conn_handle, ble_gap_evt_scan_req_report_t *evt)
         : BleDriverGapEvent<ble_gap_evt_scan_req_report_t>(BLE_GAP_EVT_SCAN_REQ_REPORT, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -116,7 +122,7 @@ public:
 class GapConnected : public BleDriverGapEvent<ble_gap_evt_connected_t>
 {
 public:
-    GapConnected(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_connected_t *evt)
+    GapConnected(const EventTime timestamp, uint16_t conn_handle, ble_gap_evt_connected_t *evt)
         : BleDriverGapEvent<ble_gap_evt_connected_t>(BLE_GAP_EVT_CONNECTED, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -124,7 +130,7 @@ public:
 
 class GapDisconnected : public BleDriverGapEvent<ble_gap_evt_disconnected_t>
 {public:
-    GapDisconnected(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_disconnected_t *evt)
+    GapDisconnected(const EventTime timestamp, uint16_t conn_handle, ble_gap_evt_disconnected_t *evt)
         : BleDriverGapEvent<ble_gap_evt_disconnected_t>(BLE_GAP_EVT_DISCONNECTED, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -133,7 +139,7 @@ class GapDisconnected : public BleDriverGapEvent<ble_gap_evt_disconnected_t>
 class GapTimeout : public BleDriverGapEvent<ble_gap_evt_timeout_t>
 {
 public:
-    GapTimeout(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_timeout_t *evt)
+    GapTimeout(const EventTime timestamp, uint16_t conn_handle, ble_gap_evt_timeout_t *evt)
         : BleDriverGapEvent<ble_gap_evt_timeout_t>(BLE_GAP_EVT_TIMEOUT, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -142,7 +148,7 @@ public:
 class GapRssiChanged : public BleDriverGapEvent<ble_gap_evt_rssi_changed_t>
 {
 public:
-    GapRssiChanged(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_rssi_changed_t *evt)
+    GapRssiChanged(const EventTime timestamp, uint16_t conn_handle, ble_gap_evt_rssi_changed_t *evt)
         : BleDriverGapEvent<ble_gap_evt_rssi_changed_t>(BLE_GAP_EVT_RSSI_CHANGED, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -151,7 +157,7 @@ public:
 class GapConnParamUpdate : public BleDriverGapEvent<ble_gap_evt_conn_param_update_t>
 {
 public:
-    GapConnParamUpdate(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_conn_param_update_t *evt)
+    GapConnParamUpdate(const EventTime timestamp, uint16_t conn_handle, ble_gap_evt_conn_param_update_t *evt)
         : BleDriverGapEvent<ble_gap_evt_conn_param_update_t>(BLE_GAP_EVT_CONN_PARAM_UPDATE, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -160,7 +166,7 @@ public:
 class GapConnParamUpdateRequest : public BleDriverGapEvent<ble_gap_evt_conn_param_update_request_t>
 {
 public:
-    GapConnParamUpdateRequest(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_conn_param_update_request_t *evt)
+    GapConnParamUpdateRequest(const EventTime timestamp, uint16_t conn_handle, ble_gap_evt_conn_param_update_request_t *evt)
         : BleDriverGapEvent<ble_gap_evt_conn_param_update_request_t>(BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -169,7 +175,7 @@ public:
 class GapSecParamsRequest : public BleDriverGapEvent<ble_gap_evt_sec_params_request_t>
 {
 public:
-    GapSecParamsRequest(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_sec_params_request_t *evt)
+    GapSecParamsRequest(const EventTime timestamp, uint16_t conn_handle, ble_gap_evt_sec_params_request_t *evt)
         : BleDriverGapEvent<ble_gap_evt_sec_params_request_t>(BLE_GAP_EVT_SEC_PARAMS_REQUEST, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -178,7 +184,7 @@ public:
 class GapAuthStatus : public BleDriverGapEvent<ble_gap_evt_auth_status_t>
 {
 public:
-    GapAuthStatus(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_auth_status_t *evt)
+    GapAuthStatus(const EventTime timestamp, uint16_t conn_handle, ble_gap_evt_auth_status_t *evt)
         : BleDriverGapEvent<ble_gap_evt_auth_status_t>(BLE_GAP_EVT_AUTH_STATUS, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -187,7 +193,7 @@ public:
 class GapConnSecUpdate : public BleDriverGapEvent<ble_gap_evt_conn_sec_update_t>
 {
 public:
-    GapConnSecUpdate(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_conn_sec_update_t *evt)
+    GapConnSecUpdate(const EventTime timestamp, uint16_t conn_handle, ble_gap_evt_conn_sec_update_t *evt)
         : BleDriverGapEvent<ble_gap_evt_conn_sec_update_t>(BLE_GAP_EVT_CONN_SEC_UPDATE, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -196,7 +202,7 @@ public:
 class GapSecInfoRequest : public BleDriverGapEvent<ble_gap_evt_sec_info_request_t>
 {
 public:
-    GapSecInfoRequest(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_sec_info_request_t *evt)
+    GapSecInfoRequest(const EventTime timestamp, uint16_t conn_handle, ble_gap_evt_sec_info_request_t *evt)
         : BleDriverGapEvent<ble_gap_evt_sec_info_request_t>(BLE_GAP_EVT_SEC_INFO_REQUEST, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -205,7 +211,7 @@ public:
 class GapSecRequest : public BleDriverGapEvent<ble_gap_evt_sec_request_t>
 {
 public:
-    GapSecRequest(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_sec_request_t *evt)
+    GapSecRequest(const EventTime timestamp, uint16_t conn_handle, ble_gap_evt_sec_request_t *evt)
         : BleDriverGapEvent<ble_gap_evt_sec_request_t>(BLE_GAP_EVT_SEC_REQUEST, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -214,7 +220,7 @@ public:
 class GapPasskeyDisplay : public BleDriverGapEvent<ble_gap_evt_passkey_display_t>
 {
 public:
-    GapPasskeyDisplay(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_passkey_display_t *evt)
+    GapPasskeyDisplay(const EventTime timestamp, uint16_t conn_handle, ble_gap_evt_passkey_display_t *evt)
         : BleDriverGapEvent<ble_gap_evt_passkey_display_t>(BLE_GAP_EVT_PASSKEY_DISPLAY, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -223,7 +229,7 @@ public:
 class GapKeyPressed : public BleDriverGapEvent<ble_gap_evt_key_pressed_t>
 {
 public:
-    GapKeyPressed(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_key_pressed_t *evt)
+    GapKeyPressed(const EventTime timestamp, uint16_t conn_handle, ble_gap_evt_key_pressed_t *evt)
         : BleDriverGapEvent<ble_gap_evt_key_pressed_t>(BLE_GAP_EVT_KEY_PRESSED, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -232,7 +238,7 @@ public:
 class GapAuthKeyRequest : public BleDriverGapEvent<ble_gap_evt_auth_key_request_t>
 {
 public:
-    GapAuthKeyRequest(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_auth_key_request_t *evt)
+    GapAuthKeyRequest(const EventTime timestamp, uint16_t conn_handle, ble_gap_evt_auth_key_request_t *evt)
         : BleDriverGapEvent<ble_gap_evt_auth_key_request_t>(BLE_GAP_EVT_AUTH_KEY_REQUEST, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -241,7 +247,7 @@ public:
 class GapLESCDHKeyRequest : public BleDriverGapEvent<ble_gap_evt_lesc_dhkey_request_t>
 {
 public:
-    GapLESCDHKeyRequest(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_lesc_dhkey_request_t *evt)
+    GapLESCDHKeyRequest(const EventTime timestamp, uint16_t conn_handle, ble_gap_evt_lesc_dhkey_request_t *evt)
         : BleDriverGapEvent<ble_gap_evt_lesc_dhkey_request_t>(BLE_GAP_EVT_LESC_DHKEY_REQUEST, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -251,7 +257,7 @@ public:
 class GapDataLengthUpdateRequest: public BleDriverGapEvent<ble_gap_evt_data_length_update_request_t>
 {
 public:
-    GapDataLengthUpdateRequest(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_data_length_update_request_t *evt)
+    GapDataLengthUpdateRequest(const EventTime timestamp, uint16_t conn_handle, ble_gap_evt_data_length_update_request_t *evt)
         : BleDriverGapEvent<ble_gap_evt_data_length_update_request_t>(BLE_GAP_EVT_DATA_LENGTH_UPDATE_REQUEST, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -260,7 +266,7 @@ public:
 class GapDataLengthUpdateEvt : public BleDriverGapEvent<ble_gap_evt_data_length_update_t>
 {
 public:
-    GapDataLengthUpdateEvt(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_data_length_update_t *evt)
+    GapDataLengthUpdateEvt(const EventTime timestamp, uint16_t conn_handle, ble_gap_evt_data_length_update_t *evt)
         : BleDriverGapEvent<ble_gap_evt_data_length_update_t>(BLE_GAP_EVT_DATA_LENGTH_UPDATE, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -269,7 +275,7 @@ public:
 class GapPhyUpdateRequest : public BleDriverGapEvent<ble_gap_evt_phy_update_request_t>
 {
 public:
-    GapPhyUpdateRequest(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_phy_update_request_t *evt)
+    GapPhyUpdateRequest(const EventTime timestamp, uint16_t conn_handle, ble_gap_evt_phy_update_request_t *evt)
         : BleDriverGapEvent<ble_gap_evt_phy_update_request_t>(BLE_GAP_EVT_PHY_UPDATE_REQUEST, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -278,7 +284,7 @@ public:
 class GapPhyUpdateEvt : public BleDriverGapEvent<ble_gap_evt_phy_update_t>
 {
 public:
-    GapPhyUpdateEvt(const std::string timestamp, uint16_t conn_handle, ble_gap_evt_phy_update_t *evt)
+    GapPhyUpdateEvt(const EventTime timestamp, uint16_t conn_handle, ble_gap_evt_phy_update_t *evt)
         : BleDriverGapEvent<ble_gap_evt_phy_update_t>(BLE_GAP_EVT_PHY_UPDATE, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -540,6 +546,34 @@ public:
 
 #endif
 
+class GapAdvReportFilter : public BleToJs<AdvReportFilter>
+{
+public:
+    GapAdvReportFilter(v8::Local<v8::Object> js) : BleToJs<AdvReportFilter>(js) {}
+    AdvReportFilter *ToNative();
+};
+
+class GapAdvReportDedup : public BleToJs<AdvReportDedup>
+{
+public:
+    GapAdvReportDedup(v8::Local<v8::Object> js) : BleToJs<AdvReportDedup>(js) {}
+    AdvReportDedup *ToNative();
+};
+
+class GapAdvReportBatch : public BleToJs<AdvReportBatch>
+{
+public:
+    GapAdvReportBatch(AdvReportBatch *batch) : BleToJs<AdvReportBatch>(batch) {}
+    v8::Local<v8::Object> ToJs();
+};
+
+class GapAutoReplyPolicy : public BleToJs<AutoReplyPolicy>
+{
+public:
+    GapAutoReplyPolicy(v8::Local<v8::Object> js) : BleToJs<AutoReplyPolicy>(js) {}
+    AutoReplyPolicy *ToNative();
+};
+
 #pragma endregion Gap structs
 
 #pragma region Gap Batons
@@ -37,9 +37,39 @@
 #include "driver_gattc.h"
 #include "ble_err.h"
 
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <type_traits>
+
+#include "crc32.h"
 #include "driver.h"
 #include "driver_gatt.h"
 
+namespace {
+    std::remove_pointer<uv_async_cb>::type gattc_database_discovered_handler;
+    void gattc_database_discovered_handler(uv_async_t *handle)
+    {
+        auto baton = static_cast<GattcDiscoverDatabaseBaton *>(handle->data);
+
+        if (baton != nullptr)
+        {
+            Adapter::finishDatabaseDiscovery(baton);
+        }
+    }
+
+    std::remove_pointer<uv_async_cb>::type gattc_long_operation_done_handler;
+    void gattc_long_operation_done_handler(uv_async_t *handle)
+    {
+        auto baton = static_cast<GattcLongBaton *>(handle->data);
+
+        if (baton != nullptr)
+        {
+            Adapter::finishLongOperation(baton);
+        }
+    }
+}
+
 static name_map_t gattc_svcs_type_map =
 {
     NAME_MAP_ENTRY(SD_BLE_GATTC_PRIMARY_SERVICES_DISCOVER),
@@ -162,6 +192,66 @@ v8::Local<v8::Object> GattcDescriptor::ToJs()
 // GattcDescriptor -- END --
 //
 
+//
+// GattcDatabaseService -- START --
+//
+
+v8::Local<v8::Object> GattcDatabaseService::ToJs()
+{
+    Nan::EscapableHandleScope scope;
+    v8::Local<v8::Object> obj = GattcService(&native->service).ToJs();
+
+    if (native->hasUuid128)
+    {
+        Utility::Set(obj, "uuid128", ConversionUtility::toJsValueArray(native->uuid128, GATTC_DISCOVERY_UUID128_SIZE));
+    }
+
+    v8::Local<v8::Array> characteristics = Nan::New<v8::Array>(static_cast<uint32_t>(native->characteristics.size()));
+
+    for (uint32_t i = 0; i < native->characteristics.size(); i++)
+    {
+        Nan::Set(characteristics, Nan::New<v8::Integer>(i), GattcDatabaseCharacteristic(&native->characteristics[i]).ToJs());
+    }
+
+    Utility::Set(obj, "characteristics", characteristics);
+
+    return scope.Escape(obj);
+}
+
+//
+// GattcDatabaseService -- END --
+//
+
+//
+// GattcDatabaseCharacteristic -- START --
+//
+
+v8::Local<v8::Object> GattcDatabaseCharacteristic::ToJs()
+{
+    Nan::EscapableHandleScope scope;
+    v8::Local<v8::Object> obj = GattcCharacteristic(&native->characteristic).ToJs();
+
+    if (native->hasUuid128)
+    {
+        Utility::Set(obj, "uuid128", ConversionUtility::toJsValueArray(native->uuid128, GATTC_DISCOVERY_UUID128_SIZE));
+    }
+
+    v8::Local<v8::Array> descriptors = Nan::New<v8::Array>(static_cast<uint32_t>(native->descriptors.size()));
+
+    for (uint32_t i = 0; i < native->descriptors.size(); i++)
+    {
+        Nan::Set(descriptors, Nan::New<v8::Integer>(i), GattcDescriptor(&native->descriptors[i]).ToJs());
+    }
+
+    Utility::Set(obj, "descriptors", descriptors);
+
+    return scope.Escape(obj);
+}
+
+//
+// GattcDatabaseCharacteristic -- END --
+//
+
 //
 // GattcWriteParameters -- START --
 //
@@ -206,7 +296,7 @@ v8::Local<v8::Object> GattcWriteParameters::ToJs()
 v8::Local<v8::Object> GattcPrimaryServiceDiscoveryEvent::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverGattcEvent::createJsObject();
     BleDriverGattcEvent::ToJs(obj);
 
     Utility::Set(obj, "count", evt->count);
@@ -226,7 +316,7 @@ v8::Local<v8::Object> GattcPrimaryServiceDiscoveryEvent::ToJs()
 v8::Local<v8::Object> GattcRelationshipDiscoveryEvent::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverGattcEvent::createJsObject();
     BleDriverGattcEvent::ToJs(obj);
 
     Utility::Set(obj, "count", evt->count);
@@ -246,7 +336,7 @@ v8::Local<v8::Object> GattcRelationshipDiscoveryEvent::ToJs()
 v8::Local<v8::Object> GattcCharacteristicDiscoveryEvent::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverGattcEvent::createJsObject();
     BleDriverGattcEvent::ToJs(obj);
 
     Utility::Set(obj, "count", evt->count);
@@ -266,7 +356,7 @@ v8::Local<v8::Object> GattcCharacteristicDiscoveryEvent::ToJs()
 v8::Local<v8::Object> GattcDescriptorDiscoveryEvent::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverGattcEvent::createJsObject();
     BleDriverGattcEvent::ToJs(obj);
 
     Utility::Set(obj, "count", evt->count);
@@ -288,7 +378,7 @@ v8::Local<v8::Object> GattcHandleValue::ToJs()
     Nan::EscapableHandleScope scope;
     v8::Local<v8::Object> obj = Nan::New<v8::Object>();
     Utility::Set(obj, "handle", native->handle);
-    Utility::Set(obj, "value", ConversionUtility::toJsValueArray(native->p_value, valueLength));
+    Utility::Set(obj, "value", ConversionUtility::toJsValue(native->p_value, valueLength));
 
     return scope.Escape(obj);
 }
@@ -296,7 +386,7 @@ v8::Local<v8::Object> GattcHandleValue::ToJs()
 v8::Local<v8::Object> GattcCharacteristicValueReadByUUIDEvent::ToJs()
 {
 	Nan::EscapableHandleScope scope;
-	v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+	v8::Local<v8::Object> obj = BleDriverGattcEvent::createJsObject();
 	BleDriverGattcEvent::ToJs(obj);
 	Utility::Set(obj, "count", evt->count);
 	Utility::Set(obj, "value_len", evt->value_len);
@@ -321,13 +411,13 @@ v8::Local<v8::Object> GattcCharacteristicValueReadByUUIDEvent::ToJs()
 v8::Local<v8::Object> GattcReadEvent::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverGattcEvent::createJsObject();
     BleDriverGattcEvent::ToJs(obj);
 
     Utility::Set(obj, "handle", evt->handle);
     Utility::Set(obj, "offset", evt->offset);
     Utility::Set(obj, "len", evt->len);
-    Utility::Set(obj, "data", ConversionUtility::toJsValueArray(evt->data, evt->len));
+    Utility::Set(obj, "data", ConversionUtility::toJsValue(evt->data, evt->len));
 
     return scope.Escape(obj);
 }
@@ -335,11 +425,11 @@ v8::Local<v8::Object> GattcReadEvent::ToJs()
 v8::Local<v8::Object> GattcCharacteristicValueReadEvent::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverGattcEvent::createJsObject();
     BleDriverGattcEvent::ToJs(obj);
 
     Utility::Set(obj, "len", evt->len);
-    Utility::Set(obj, "values", ConversionUtility::toJsValueArray(evt->values, evt->len));
+    Utility::Set(obj, "values", ConversionUtility::toJsValue(evt->values, evt->len));
 
     return scope.Escape(obj);
 }
@@ -347,14 +437,14 @@ v8::Local<v8::Object> GattcCharacteristicValueReadEvent::ToJs()
 v8::Local<v8::Object> GattcWriteEvent::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverGattcEvent::createJsObject();
     BleDriverGattcEvent::ToJs(obj);
 
     Utility::Set(obj, "handle", evt->handle);
     Utility::Set(obj, "write_op", evt->write_op);
     Utility::Set(obj, "offset", evt->offset);
     Utility::Set(obj, "len", evt->len);
-    Utility::Set(obj, "data", ConversionUtility::toJsValueArray(evt->data, evt->len));
+    Utility::Set(obj, "data", ConversionUtility::toJsValue(evt->data, evt->len));
 
     return scope.Escape(obj);
 }
@@ -362,13 +452,13 @@ v8::Local<v8::Object> GattcWriteEvent::ToJs()
 v8::Local<v8::Object> GattcHandleValueNotificationEvent::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverGattcEvent::createJsObject();
     BleDriverGattcEvent::ToJs(obj);
 
     Utility::Set(obj, "handle", evt->handle);
     Utility::Set(obj, "type", evt->type);
     Utility::Set(obj, "len", evt->len);
-    Utility::Set(obj, "data", ConversionUtility::toJsValueArray(evt->data, evt->len));
+    Utility::Set(obj, "data", ConversionUtility::toJsValue(evt->data, evt->len));
 
     return scope.Escape(obj);
 }
@@ -376,7 +466,7 @@ v8::Local<v8::Object> GattcHandleValueNotificationEvent::ToJs()
 v8::Local<v8::Object> GattcTimeoutEvent::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverGattcEvent::createJsObject();
     BleDriverGattcEvent::ToJs(obj);
 
     Utility::Set(obj, "src", evt->src);
@@ -388,7 +478,7 @@ v8::Local<v8::Object> GattcTimeoutEvent::ToJs()
 v8::Local<v8::Object> GattcExchangeMtuResponseEvent::ToJs()
 {
 	Nan::EscapableHandleScope scope;
-	v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+	v8::Local<v8::Object> obj = BleDriverGattcEvent::createJsObject();
 	BleDriverGattcEvent::ToJs(obj);
 
 	Utility::Set(obj, "server_rx_mtu", evt->server_rx_mtu);
@@ -399,7 +489,7 @@ v8::Local<v8::Object> GattcExchangeMtuResponseEvent::ToJs()
 v8::Local<v8::Object> GattcWriteCmdTxCompleteEvent::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverGattcEvent::createJsObject();
     BleDriverGattcEvent::ToJs(obj);
 
     Utility::Set(obj, "count", ConversionUtility::toJsNumber(evt->count));
@@ -440,6 +530,7 @@ NAN_METHOD(Adapter::GattcDiscoverPrimaryServices)
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
     auto baton = new GattcDiscoverPrimaryServicesBaton(callback);
     baton->adapter = obj->adapter;
+    baton->mainObject = obj;
     baton->conn_handle = conn_handle;
     baton->start_handle = start_handle;
 
@@ -454,14 +545,16 @@ NAN_METHOD(Adapter::GattcDiscoverPrimaryServices)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcDiscoverPrimaryServices, reinterpret_cast<uv_after_work_cb>(AfterGattcDiscoverPrimaryServices));
+    obj->commandQueue.submit(baton->req, GattcDiscoverPrimaryServices, reinterpret_cast<uv_after_work_cb>(AfterGattcDiscoverPrimaryServices));
 }
 
 // This runs in a worker thread (not Main Thread)
 void Adapter::GattcDiscoverPrimaryServices(uv_work_t *req)
 {
     auto baton = static_cast<GattcDiscoverPrimaryServicesBaton *>(req->data);
-    baton->result = sd_ble_gattc_primary_services_discover(baton->adapter, baton->conn_handle, baton->start_handle, baton->p_srvc_uuid);
+    baton->result = baton->mainObject->makeGattcRequest(baton->conn_handle, [baton]() {
+        return sd_ble_gattc_primary_services_discover(baton->adapter, baton->conn_handle, baton->start_handle, baton->p_srvc_uuid);
+    });
 }
 
 // This runs in Main Thread
@@ -515,6 +608,7 @@ NAN_METHOD(Adapter::GattcDiscoverRelationship)
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
     auto baton = new GattcDiscoverRelationshipBaton(callback);
     baton->adapter = obj->adapter;
+    baton->mainObject = obj;
     baton->conn_handle = conn_handle;
 
     try
@@ -528,14 +622,16 @@ NAN_METHOD(Adapter::GattcDiscoverRelationship)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcDiscoverRelationship, reinterpret_cast<uv_after_work_cb>(AfterGattcDiscoverRelationship));
+    obj->commandQueue.submit(baton->req, GattcDiscoverRelationship, reinterpret_cast<uv_after_work_cb>(AfterGattcDiscoverRelationship));
 }
 
 // This runs in a worker thread (not Main Thread)
 void Adapter::GattcDiscoverRelationship(uv_work_t *req)
 {
     auto baton = static_cast<GattcDiscoverRelationshipBaton *>(req->data);
-    baton->result = sd_ble_gattc_relationships_discover(baton->adapter, baton->conn_handle, baton->p_handle_range);
+    baton->result = baton->mainObject->makeGattcRequest(baton->conn_handle, [baton]() {
+        return sd_ble_gattc_relationships_discover(baton->adapter, baton->conn_handle, baton->p_handle_range);
+    });
 }
 
 // This runs in Main Thread
@@ -589,6 +685,7 @@ NAN_METHOD(Adapter::GattcDiscoverCharacteristics)
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
     auto baton = new GattcDiscoverCharacteristicsBaton(callback);
     baton->adapter = obj->adapter;
+    baton->mainObject = obj;
     baton->conn_handle = conn_handle;
 
     try
@@ -602,14 +699,16 @@ NAN_METHOD(Adapter::GattcDiscoverCharacteristics)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcDiscoverCharacteristics, reinterpret_cast<uv_after_work_cb>(AfterGattcDiscoverCharacteristics));
+    obj->commandQueue.submit(baton->req, GattcDiscoverCharacteristics, reinterpret_cast<uv_after_work_cb>(AfterGattcDiscoverCharacteristics));
 }
 
 // This runs in a worker thread (not Main Thread)
 void Adapter::GattcDiscoverCharacteristics(uv_work_t *req)
 {
     auto baton = static_cast<GattcDiscoverCharacteristicsBaton *>(req->data);
-    baton->result = sd_ble_gattc_characteristics_discover(baton->adapter, baton->conn_handle, baton->p_handle_range);
+    baton->result = baton->mainObject->makeGattcRequest(baton->conn_handle, [baton]() {
+        return sd_ble_gattc_characteristics_discover(baton->adapter, baton->conn_handle, baton->p_handle_range);
+    });
 }
 
 // This runs in Main Thread
@@ -663,6 +762,7 @@ NAN_METHOD(Adapter::GattcDiscoverDescriptors)
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
     auto baton = new GattcDiscoverDescriptorsBaton(callback);
     baton->adapter = obj->adapter;
+    baton->mainObject = obj;
     baton->conn_handle = conn_handle;
 
     try
@@ -676,14 +776,16 @@ NAN_METHOD(Adapter::GattcDiscoverDescriptors)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcDiscoverDescriptors, reinterpret_cast<uv_after_work_cb>(AfterGattcDiscoverDescriptors));
+    obj->commandQueue.submit(baton->req, GattcDiscoverDescriptors, reinterpret_cast<uv_after_work_cb>(AfterGattcDiscoverDescriptors));
 }
 
 // This runs in a worker thread (not Main Thread)
 void Adapter::GattcDiscoverDescriptors(uv_work_t *req)
 {
     auto baton = static_cast<GattcDiscoverDescriptorsBaton *>(req->data);
-    baton->result = sd_ble_gattc_descriptors_discover(baton->adapter, baton->conn_handle, baton->p_handle_range);
+    baton->result = baton->mainObject->makeGattcRequest(baton->conn_handle, [baton]() {
+        return sd_ble_gattc_descriptors_discover(baton->adapter, baton->conn_handle, baton->p_handle_range);
+    });
 }
 
 // This runs in Main Thread
@@ -741,6 +843,7 @@ NAN_METHOD(Adapter::GattcReadCharacteristicValueByUUID)
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
     auto baton = new GattcCharacteristicByUUIDReadBaton(callback);
     baton->adapter = obj->adapter;
+    baton->mainObject = obj;
     baton->conn_handle = conn_handle;
 
     try
@@ -765,14 +868,16 @@ NAN_METHOD(Adapter::GattcReadCharacteristicValueByUUID)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcReadCharacteristicValueByUUID, reinterpret_cast<uv_after_work_cb>(AfterGattcReadCharacteristicValueByUUID));
+    obj->commandQueue.submit(baton->req, GattcReadCharacteristicValueByUUID, reinterpret_cast<uv_after_work_cb>(AfterGattcReadCharacteristicValueByUUID));
 }
 
 // This runs in a worker thread (not Main Thread)
 void Adapter::GattcReadCharacteristicValueByUUID(uv_work_t *req)
 {
     auto baton = static_cast<GattcCharacteristicByUUIDReadBaton *>(req->data);
-    baton->result = sd_ble_gattc_char_value_by_uuid_read(baton->adapter, baton->conn_handle, baton->p_uuid, baton->p_handle_range);
+    baton->result = baton->mainObject->makeGattcRequest(baton->conn_handle, [baton]() {
+        return sd_ble_gattc_char_value_by_uuid_read(baton->adapter, baton->conn_handle, baton->p_uuid, baton->p_handle_range);
+    });
 }
 
 // This runs in Main Thread
@@ -830,18 +935,21 @@ NAN_METHOD(Adapter::GattcRead)
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
     auto baton = new GattcReadBaton(callback);
     baton->adapter = obj->adapter;
+    baton->mainObject = obj;
     baton->conn_handle = conn_handle;
     baton->handle = handle;
     baton->offset = offset;
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcRead, reinterpret_cast<uv_after_work_cb>(AfterGattcRead));
+    obj->commandQueue.submit(baton->req, GattcRead, reinterpret_cast<uv_after_work_cb>(AfterGattcRead));
 }
 
 // This runs in a worker thread (not Main Thread)
 void Adapter::GattcRead(uv_work_t *req)
 {
     auto baton = static_cast<GattcReadBaton *>(req->data);
-    baton->result = sd_ble_gattc_read(baton->adapter, baton->conn_handle, baton->handle, baton->offset);
+    baton->result = baton->mainObject->makeGattcRequest(baton->conn_handle, [baton]() {
+        return sd_ble_gattc_read(baton->adapter, baton->conn_handle, baton->handle, baton->offset);
+    });
 }
 
 // This runs in Main Thread
@@ -914,18 +1022,21 @@ NAN_METHOD(Adapter::GattcReadCharacteristicValues)
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
     auto baton = new GattcReadCharacteristicValuesBaton(callback);
     baton->adapter = obj->adapter;
+    baton->mainObject = obj;
     baton->conn_handle = conn_handle;
     baton->p_handles = p_handles;
     baton->handle_count = handle_count;
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcReadCharacteristicValues, reinterpret_cast<uv_after_work_cb>(AfterGattcReadCharacteristicValues));
+    obj->commandQueue.submit(baton->req, GattcReadCharacteristicValues, reinterpret_cast<uv_after_work_cb>(AfterGattcReadCharacteristicValues));
 }
 
 // This runs in a worker thread (not Main Thread)
 void Adapter::GattcReadCharacteristicValues(uv_work_t *req)
 {
     auto baton = static_cast<GattcReadCharacteristicValuesBaton *>(req->data);
-    baton->result = sd_ble_gattc_char_values_read(baton->adapter, baton->conn_handle, baton->p_handles, baton->handle_count);
+    baton->result = baton->mainObject->makeGattcRequest(baton->conn_handle, [baton]() {
+        return sd_ble_gattc_char_values_read(baton->adapter, baton->conn_handle, baton->p_handles, baton->handle_count);
+    });
 }
 
 // This runs in Main Thread
@@ -979,6 +1090,7 @@ NAN_METHOD(Adapter::GattcWrite)
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
     auto baton = new GattcWriteBaton(callback);
     baton->adapter = obj->adapter;
+    baton->mainObject = obj;
     baton->conn_handle = conn_handle;
 
     try
@@ -992,14 +1104,32 @@ NAN_METHOD(Adapter::GattcWrite)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcWrite, reinterpret_cast<uv_after_work_cb>(AfterGattcWrite));
+    obj->commandQueue.submit(baton->req, GattcWrite, reinterpret_cast<uv_after_work_cb>(AfterGattcWrite));
 }
 
 // This runs in a worker thread (not Main Thread)
 void Adapter::GattcWrite(uv_work_t *req)
 {
     auto baton = static_cast<GattcWriteBaton *>(req->data);
-    baton->result = sd_ble_gattc_write(baton->adapter, baton->conn_handle, baton->p_write_params);
+    const auto params = baton->p_write_params;
+    const auto unacknowledged = params->write_op == BLE_GATT_OP_WRITE_CMD || params->write_op == BLE_GATT_OP_SIGN_WRITE_CMD;
+
+    // Write commands have no response to measure the latency to
+    if (unacknowledged)
+    {
+        baton->result = sd_ble_gattc_write(baton->adapter, baton->conn_handle, params);
+    }
+    else
+    {
+        baton->result = baton->mainObject->makeGattcRequest(baton->conn_handle, [baton, params]() {
+            return sd_ble_gattc_write(baton->adapter, baton->conn_handle, params);
+        });
+    }
+
+    if (baton->result == NRF_SUCCESS)
+    {
+        baton->mainObject->connectionStats.onTx(baton->conn_handle, 1, params->len, unacknowledged);
+    }
 }
 
 // This runs in Main Thread
@@ -1024,6 +1154,825 @@ void Adapter::AfterGattcWrite(uv_work_t *req)
     delete baton;
 }
 
+// Splits a buffer into write commands of chunk_size bytes and keeps the SoftDevice TX queue full
+// until all of them are transmitted. The callback is called once, with the number of bytes accepted
+// by the SoftDevice. Only one stream can be active per connection.
+NAN_METHOD(Adapter::GattcWriteStream)
+{
+    uint16_t conn_handle;
+    uint16_t handle;
+    uint16_t chunk_size;
+    v8::Local<v8::Value> value;
+    v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
+
+    try
+    {
+        conn_handle = ConversionUtility::getNativeUint16(info[argumentcount]);
+        argumentcount++;
+
+        handle = ConversionUtility::getNativeUint16(info[argumentcount]);
+        argumentcount++;
+
+        if (!info[argumentcount]->IsArrayBufferView())
+        {
+            throw std::string("Buffer or Uint8Array");
+        }
+
+        value = info[argumentcount];
+        argumentcount++;
+
+        chunk_size = ConversionUtility::getNativeUint16(info[argumentcount]);
+
+        if (chunk_size == 0)
+        {
+            throw std::string("number larger than 0");
+        }
+
+        argumentcount++;
+
+        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    auto credits = obj->startWriteStream(conn_handle, WRITE_STREAM_GATTC_WRITE);
+
+    if (credits == nullptr)
+    {
+        Nan::ThrowError("A write stream is already active on this connection");
+        return;
+    }
+
+    Nan::TypedArrayContents<uint8_t> contents(value);
+
+    auto baton = new GattcWriteStreamBaton(callback);
+    baton->adapter = obj->adapter;
+    baton->mainObject = obj;
+    baton->conn_handle = conn_handle;
+    baton->handle = handle;
+    baton->chunk_size = chunk_size;
+    baton->value.assign(*contents, *contents + contents.length());
+    baton->credits = credits;
+    baton->offset = 0;
+    baton->written = 0;
+    baton->done = false;
+    baton->result = NRF_SUCCESS;
+
+    obj->commandQueue.submit(baton->req, GattcWriteStream, reinterpret_cast<uv_after_work_cb>(AfterGattcWriteStream));
+}
+
+// This runs in a worker thread (not Main Thread)
+// Writes at most WRITE_STREAM_SLICE_PACKETS packets per run. AfterGattcWriteStream submits the stream
+// again until it is done, so other commands are run in between.
+void Adapter::GattcWriteStream(uv_work_t *req)
+{
+    auto baton = static_cast<GattcWriteStreamBaton *>(req->data);
+    auto &credits = *baton->credits;
+    const auto length = baton->value.size();
+    auto packets = 0;
+
+    while (baton->offset < length && packets < WRITE_STREAM_SLICE_PACKETS)
+    {
+        if (!credits.take(WRITE_STREAM_WAIT_TIMEOUT))
+        {
+            break;
+        }
+
+        ble_gattc_write_params_t write_params;
+        memset(&write_params, 0, sizeof(write_params));
+        write_params.write_op = BLE_GATT_OP_WRITE_CMD;
+        write_params.handle = baton->handle;
+        write_params.len = static_cast<uint16_t>(std::min<size_t>(length - baton->offset, baton->chunk_size));
+        write_params.p_value = baton->value.data() + baton->offset;
+
+        const auto err_code = sd_ble_gattc_write(baton->adapter, baton->conn_handle, &write_params);
+
+        if (err_code == WRITE_STREAM_TX_QUEUE_FULL)
+        {
+            credits.exhausted();
+            continue;
+        }
+
+        if (err_code != NRF_SUCCESS)
+        {
+            baton->result = err_code;
+            baton->done = true;
+            return;
+        }
+
+        baton->mainObject->connectionStats.onTx(baton->conn_handle, 1, write_params.len, true);
+        baton->offset += write_params.len;
+        baton->written++;
+        packets++;
+    }
+
+    if (baton->offset == length && credits.waitForTransmitted(baton->written, WRITE_STREAM_WAIT_TIMEOUT))
+    {
+        baton->done = true;
+        return;
+    }
+
+    if (credits.isAborted())
+    {
+        baton->result = BLE_ERROR_INVALID_CONN_HANDLE;
+        baton->done = true;
+        return;
+    }
+
+    if (!baton->progress.update(credits, packets > 0))
+    {
+        baton->result = NRF_ERROR_TIMEOUT;
+        baton->done = true;
+    }
+}
+
+// This runs in Main Thread
+void Adapter::AfterGattcWriteStream(uv_work_t *req)
+{
+    Nan::HandleScope scope;
+
+    auto baton = static_cast<GattcWriteStreamBaton *>(req->data);
+
+    if (!baton->done)
+    {
+        baton->mainObject->commandQueue.submit(baton->req, GattcWriteStream, reinterpret_cast<uv_after_work_cb>(AfterGattcWriteStream));
+        return;
+    }
+
+    baton->mainObject->stopWriteStream(baton->conn_handle, WRITE_STREAM_GATTC_WRITE);
+
+    v8::Local<v8::Value> argv[2];
+
+    if (baton->result != NRF_SUCCESS)
+    {
+        argv[0] = ErrorMessage::getErrorMessage(baton->result, "writing stream");
+    }
+    else
+    {
+        argv[0] = Nan::Undefined();
+    }
+
+    argv[1] = ConversionUtility::toJsNumber(static_cast<double>(baton->offset));
+
+    Nan::AsyncResource resource("pc-ble-driver-js:callback");
+    baton->callback->Call(2, argv, &resource);
+    delete baton;
+}
+
+// Writes one Secure DFU object (init packet or firmware) to the packet characteristic as write commands,
+// with the TX queue kept full like gattcWriteStream. The CRC32 of the DFU image is accumulated as the
+// packets are written, continuing from offset and crc32. With a PRN, the packet receipt notifications on
+// the control point are checked in the SoftDevice driver thread, and the write runs at most
+// DFU_RECEIPT_WINDOW receipts ahead of them. progress_callback, if not null, is called with the offset
+// after each run in the command thread. The callback is called once, with the offset and CRC32 written,
+// or if the write failed, the offset and CRC32 known to be received by the target.
+NAN_METHOD(Adapter::GattcWriteDfuObject)
+{
+    uint16_t conn_handle;
+    uint16_t handle;
+    uint16_t control_point_handle;
+    v8::Local<v8::Value> value;
+    uint16_t chunk_size;
+    uint16_t prn;
+    uint32_t offset;
+    uint32_t crc32;
+    v8::Local<v8::Function> progress_callback;
+    v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
+
+    try
+    {
+        conn_handle = ConversionUtility::getNativeUint16(info[argumentcount]);
+        argumentcount++;
+
+        handle = ConversionUtility::getNativeUint16(info[argumentcount]);
+        argumentcount++;
+
+        control_point_handle = ConversionUtility::getNativeUint16(info[argumentcount]);
+        argumentcount++;
+
+        if (!info[argumentcount]->IsArrayBufferView())
+        {
+            throw std::string("Buffer or Uint8Array");
+        }
+
+        value = info[argumentcount];
+        argumentcount++;
+
+        chunk_size = ConversionUtility::getNativeUint16(info[argumentcount]);
+
+        if (chunk_size == 0)
+        {
+            throw std::string("number larger than 0");
+        }
+
+        argumentcount++;
+
+        prn = ConversionUtility::getNativeUint16(info[argumentcount]);
+        argumentcount++;
+
+        offset = ConversionUtility::getNativeUint32(info[argumentcount]);
+        argumentcount++;
+
+        crc32 = ConversionUtility::getNativeUint32(info[argumentcount]);
+        argumentcount++;
+
+        if (!info[argumentcount]->IsNull())
+        {
+            progress_callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        }
+
+        argumentcount++;
+
+        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    auto receipts = std::make_shared<DfuReceipts>(control_point_handle, offset, crc32);
+    auto credits = obj->startWriteStream(conn_handle, WRITE_STREAM_GATTC_WRITE, receipts);
+
+    if (credits == nullptr)
+    {
+        Nan::ThrowError("A write stream is already active on this connection");
+        return;
+    }
+
+    Nan::TypedArrayContents<uint8_t> contents(value);
+
+    auto baton = new GattcWriteDfuObjectBaton(callback);
+    baton->adapter = obj->adapter;
+    baton->mainObject = obj;
+    baton->conn_handle = conn_handle;
+    baton->handle = handle;
+    baton->chunk_size = chunk_size;
+    baton->prn = prn;
+    baton->value.assign(*contents, *contents + contents.length());
+    baton->credits = credits;
+    baton->receipts = receipts;
+    baton->progress_callback = progress_callback.IsEmpty() ? nullptr : new Nan::Callback(progress_callback);
+    baton->start_offset = offset;
+    baton->offset = 0;
+    baton->crc32 = crc32;
+    baton->written = 0;
+    baton->unreceipted = 0;
+    baton->reported = 0;
+    baton->verified_offset = offset;
+    baton->done = false;
+    baton->result = NRF_SUCCESS;
+
+    obj->commandQueue.submit(baton->req, GattcWriteDfuObject, reinterpret_cast<uv_after_work_cb>(AfterGattcWriteDfuObject));
+}
+
+// This runs in a worker thread (not Main Thread)
+// Writes at most WRITE_STREAM_SLICE_PACKETS packets per run, like GattcWriteStream.
+void Adapter::GattcWriteDfuObject(uv_work_t *req)
+{
+    auto baton = static_cast<GattcWriteDfuObjectBaton *>(req->data);
+    auto &credits = *baton->credits;
+    auto &receipts = *baton->receipts;
+    const auto length = baton->value.size();
+    auto packets = 0;
+
+    while (baton->offset < length && packets < WRITE_STREAM_SLICE_PACKETS)
+    {
+        if (baton->prn > 0 && !receipts.waitForPending(DFU_RECEIPT_WINDOW - 1, WRITE_STREAM_WAIT_TIMEOUT))
+        {
+            break;
+        }
+
+        if (!credits.take(WRITE_STREAM_WAIT_TIMEOUT))
+        {
+            break;
+        }
+
+        ble_gattc_write_params_t write_params;
+        memset(&write_params, 0, sizeof(write_params));
+        write_params.write_op = BLE_GATT_OP_WRITE_CMD;
+        write_params.handle = baton->handle;
+        write_params.len = static_cast<uint16_t>(std::min<size_t>(length - baton->offset, baton->chunk_size));
+        write_params.p_value = baton->value.data() + baton->offset;
+
+        const auto err_code = sd_ble_gattc_write(baton->adapter, baton->conn_handle, &write_params);
+
+        if (err_code == WRITE_STREAM_TX_QUEUE_FULL)
+        {
+            credits.exhausted();
+            continue;
+        }
+
+        if (err_code != NRF_SUCCESS)
+        {
+            baton->result = err_code;
+            baton->done = true;
+            return;
+        }
+
+        baton->mainObject->connectionStats.onTx(baton->conn_handle, 1, write_params.len, true);
+        baton->crc32 = crc32Update(baton->crc32, write_params.p_value, write_params.len);
+        baton->offset += write_params.len;
+        baton->written++;
+        packets++;
+
+        if (baton->prn > 0 && ++baton->unreceipted == baton->prn)
+        {
+            baton->unreceipted = 0;
+            receipts.expect(baton->start_offset + static_cast<uint32_t>(baton->offset), baton->crc32);
+        }
+    }
+
+    if (baton->offset == length && credits.waitForTransmitted(baton->written, WRITE_STREAM_WAIT_TIMEOUT) &&
+        receipts.waitForPending(0, WRITE_STREAM_WAIT_TIMEOUT))
+    {
+        baton->done = true;
+        return;
+    }
+
+    if (credits.isAborted())
+    {
+        baton->result = BLE_ERROR_INVALID_CONN_HANDLE;
+        baton->done = true;
+        return;
+    }
+
+    if (receipts.getResult() != NRF_SUCCESS)
+    {
+        baton->result = receipts.getResult();
+        baton->done = true;
+        return;
+    }
+
+    // A matching receipt is progress too, the target may be slow to receipt while it writes to flash
+    uint32_t verified_offset;
+    uint32_t verified_crc32;
+    receipts.getVerified(verified_offset, verified_crc32);
+    const auto receipted = verified_offset != baton->verified_offset;
+    baton->verified_offset = verified_offset;
+
+    if (!baton->progress.update(credits, packets > 0 || receipted))
+    {
+        baton->result = NRF_ERROR_TIMEOUT;
+        baton->done = true;
+    }
+}
+
+// This runs in Main Thread
+void Adapter::AfterGattcWriteDfuObject(uv_work_t *req)
+{
+    Nan::HandleScope scope;
+
+    auto baton = static_cast<GattcWriteDfuObjectBaton *>(req->data);
+
+    if (!baton->done)
+    {
+        if (baton->progress_callback != nullptr && baton->offset != baton->reported)
+        {
+            baton->reported = baton->offset;
+
+            v8::Local<v8::Value> argv[1];
+            argv[0] = ConversionUtility::toJsNumber(static_cast<double>(baton->start_offset + baton->offset));
+
+            Nan::AsyncResource resource("pc-ble-driver-js:callback");
+            baton->progress_callback->Call(1, argv, &resource);
+        }
+
+        baton->mainObject->commandQueue.submit(baton->req, GattcWriteDfuObject, reinterpret_cast<uv_after_work_cb>(AfterGattcWriteDfuObject));
+        return;
+    }
+
+    baton->mainObject->stopWriteStream(baton->conn_handle, WRITE_STREAM_GATTC_WRITE);
+
+    auto offset = baton->start_offset + static_cast<uint32_t>(baton->offset);
+    auto crc32 = baton->crc32;
+
+    v8::Local<v8::Value> argv[2];
+
+    if (baton->result != NRF_SUCCESS)
+    {
+        argv[0] = ErrorMessage::getErrorMessage(baton->result, "writing DFU object");
+        baton->receipts->getVerified(offset, crc32);
+    }
+    else
+    {
+        argv[0] = Nan::Undefined();
+    }
+
+    v8::Local<v8::Object> progress = Nan::New<v8::Object>();
+    Utility::Set(progress, "offset", ConversionUtility::toJsNumber(offset));
+    Utility::Set(progress, "crc32", ConversionUtility::toJsNumber(crc32));
+    argv[1] = progress;
+
+    Nan::AsyncResource resource("pc-ble-driver-js:callback");
+    baton->callback->Call(2, argv, &resource);
+    delete baton;
+}
+
+// Discovers all primary services, characteristics and descriptors of a connection. The discovery
+// requests are issued from the SoftDevice driver thread, see GattcDatabaseDiscovery, and the
+// discovery responses are not passed on as events. The callback is called once, with the services.
+NAN_METHOD(Adapter::GattcDiscoverDatabase)
+{
+    uint16_t conn_handle;
+    v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
+
+    try
+    {
+        conn_handle = ConversionUtility::getNativeUint16(info[argumentcount]);
+        argumentcount++;
+
+        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    auto baton = new GattcDiscoverDatabaseBaton(callback);
+    baton->adapter = obj->adapter;
+    baton->mainObject = obj;
+    baton->discovery = std::make_unique<GattcDatabaseDiscovery>(obj->adapter, conn_handle);
+    baton->started = false;
+    baton->finished = false;
+    baton->async_done = new uv_async_t();
+    baton->async_done->data = static_cast<void *>(baton);
+
+    if (uv_async_init(obj->loop, baton->async_done, gattc_database_discovered_handler) != 0)
+    {
+        std::cerr << "Not able to create a new async database discovery handler." << std::endl;
+        std::terminate();
+    }
+
+    if (!obj->startGattcProcedure(baton->discovery.get(), baton->async_done))
+    {
+        baton->async_done->data = nullptr;
+        uv_close(reinterpret_cast<uv_handle_t *>(baton->async_done), [](uv_handle_t *handle) {
+            delete reinterpret_cast<uv_async_t *>(handle);
+        });
+
+        delete baton;
+        Nan::ThrowError("A GATT client procedure is already active on this connection");
+        return;
+    }
+
+    obj->commandQueue.submit(baton->req, GattcDiscoverDatabase, reinterpret_cast<uv_after_work_cb>(AfterGattcDiscoverDatabase));
+}
+
+// This runs in a worker thread (not Main Thread)
+void Adapter::GattcDiscoverDatabase(uv_work_t *req)
+{
+    auto baton = static_cast<GattcDiscoverDatabaseBaton *>(req->data);
+    auto discovery = baton->discovery.get();
+
+    baton->mainObject->makeGattcRequest(discovery->getConnHandle(), [discovery]() {
+        discovery->start();
+        return discovery->isDone() ? discovery->getResult() : static_cast<uint32_t>(NRF_SUCCESS);
+    });
+}
+
+// This runs in Main Thread
+void Adapter::AfterGattcDiscoverDatabase(uv_work_t *req)
+{
+    auto baton = static_cast<GattcDiscoverDatabaseBaton *>(req->data);
+    baton->started = true;
+
+    // The discovery may have failed to start, or be done before this command completed
+    if (baton->discovery->isDone())
+    {
+        finishDatabaseDiscovery(baton);
+    }
+}
+
+// This runs in Main Thread
+void Adapter::finishDatabaseDiscovery(GattcDiscoverDatabaseBaton *baton)
+{
+    // The baton is still used by the command queue until the start command has completed
+    if (!baton->started || baton->finished)
+    {
+        return;
+    }
+
+    baton->finished = true;
+
+    Nan::HandleScope scope;
+
+    const auto &discovery = *baton->discovery;
+    baton->mainObject->stopGattcProcedure(discovery.getConnHandle());
+
+    v8::Local<v8::Value> argv[2];
+
+    if (discovery.getResult() == NRF_ERROR_INVALID_DATA)
+    {
+        std::ostringstream message;
+        message << "discovering database, GATT status "
+            << ConversionUtility::valueToString(discovery.getGattStatus(), gatt_status_map)
+            << " at handle " << discovery.getErrorHandle();
+        argv[0] = ErrorMessage::getErrorMessage(discovery.getResult(), message.str());
+        argv[1] = Nan::Undefined();
+    }
+    else if (discovery.getResult() != NRF_SUCCESS)
+    {
+        argv[0] = ErrorMessage::getErrorMessage(discovery.getResult(), "discovering database");
+        argv[1] = Nan::Undefined();
+    }
+    else
+    {
+        auto &services = baton->discovery->getServices();
+        v8::Local<v8::Array> jsServices = Nan::New<v8::Array>(static_cast<uint32_t>(services.size()));
+
+        for (uint32_t i = 0; i < services.size(); i++)
+        {
+            auto service = const_cast<GattcDatabaseDiscovery::Service *>(&services[i]);
+            Nan::Set(jsServices, Nan::New<v8::Integer>(i), GattcDatabaseService(service).ToJs());
+        }
+
+        argv[0] = Nan::Undefined();
+        argv[1] = jsServices;
+    }
+
+    baton->async_done->data = nullptr;
+    uv_close(reinterpret_cast<uv_handle_t *>(baton->async_done), [](uv_handle_t *handle) {
+        delete reinterpret_cast<uv_async_t *>(handle);
+    });
+
+    Nan::AsyncResource resource("pc-ble-driver-js:callback");
+    baton->callback->Call(2, argv, &resource);
+    delete baton;
+}
+
+// Registers the procedure of a long read or write, the baton is deleted if it can not be registered
+bool Adapter::startLongOperation(Adapter *obj, GattcLongBaton *baton)
+{
+    baton->mainObject = obj;
+    baton->started = false;
+    baton->finished = false;
+    baton->async_done = new uv_async_t();
+    baton->async_done->data = static_cast<void *>(baton);
+
+    if (uv_async_init(obj->loop, baton->async_done, gattc_long_operation_done_handler) != 0)
+    {
+        std::cerr << "Not able to create a new async long operation handler." << std::endl;
+        std::terminate();
+    }
+
+    if (!obj->startGattcProcedure(baton->procedure, baton->async_done))
+    {
+        baton->async_done->data = nullptr;
+        uv_close(reinterpret_cast<uv_handle_t *>(baton->async_done), [](uv_handle_t *handle) {
+            delete reinterpret_cast<uv_async_t *>(handle);
+        });
+
+        delete baton;
+        Nan::ThrowError("A GATT client procedure is already active on this connection");
+        return false;
+    }
+
+    return true;
+}
+
+// Reads the whole value of an attribute, with read blob requests issued from the SoftDevice driver
+// thread, see GattcLongRead. The read responses are not passed on as events. The callback is called
+// once, with the value.
+NAN_METHOD(Adapter::GattcReadLong)
+{
+    uint16_t conn_handle;
+    uint16_t handle;
+    uint16_t att_mtu;
+    v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
+
+    try
+    {
+        conn_handle = ConversionUtility::getNativeUint16(info[argumentcount]);
+        argumentcount++;
+
+        handle = ConversionUtility::getNativeUint16(info[argumentcount]);
+        argumentcount++;
+
+        att_mtu = ConversionUtility::getNativeUint16(info[argumentcount]);
+        argumentcount++;
+
+        if (att_mtu < GATTC_LONG_MIN_ATT_MTU)
+        {
+            throw std::string("ATT MTU of at least 23");
+        }
+
+        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    auto baton = new GattcLongBaton(callback);
+    baton->adapter = obj->adapter;
+    baton->read = std::make_unique<GattcLongRead>(obj->adapter, conn_handle, handle, att_mtu);
+    baton->procedure = baton->read.get();
+
+    if (!startLongOperation(obj, baton))
+    {
+        return;
+    }
+
+    obj->commandQueue.submit(baton->req, GattcReadLong, reinterpret_cast<uv_after_work_cb>(AfterGattcReadLong));
+}
+
+// This runs in a worker thread (not Main Thread)
+void Adapter::GattcReadLong(uv_work_t *req)
+{
+    auto baton = static_cast<GattcLongBaton *>(req->data);
+    auto procedure = baton->procedure;
+
+    baton->mainObject->makeGattcRequest(procedure->getConnHandle(), [procedure]() {
+        procedure->start();
+        return procedure->isDone() ? procedure->getResult() : static_cast<uint32_t>(NRF_SUCCESS);
+    });
+}
+
+// This runs in Main Thread
+void Adapter::AfterGattcReadLong(uv_work_t *req)
+{
+    auto baton = static_cast<GattcLongBaton *>(req->data);
+    baton->started = true;
+
+    // The read may have failed to start, or be done before this command completed
+    if (baton->procedure->isDone())
+    {
+        finishLongOperation(baton);
+    }
+}
+
+// Writes a value of any length to an attribute, with prepare write requests and an execute write
+// request issued from the SoftDevice driver thread, see GattcLongWrite. The write responses are
+// not passed on as events. The callback is called once, when the value is written.
+NAN_METHOD(Adapter::GattcWriteLong)
+{
+    uint16_t conn_handle;
+    uint16_t handle;
+    std::vector<uint8_t> value;
+    uint16_t att_mtu;
+    v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
+
+    try
+    {
+        conn_handle = ConversionUtility::getNativeUint16(info[argumentcount]);
+        argumentcount++;
+
+        handle = ConversionUtility::getNativeUint16(info[argumentcount]);
+        argumentcount++;
+
+        if (!info[argumentcount]->IsArrayBufferView())
+        {
+            throw std::string("Buffer or Uint8Array");
+        }
+
+        Nan::TypedArrayContents<uint8_t> contents(info[argumentcount]);
+        value.assign(*contents, *contents + contents.length());
+        argumentcount++;
+
+        att_mtu = ConversionUtility::getNativeUint16(info[argumentcount]);
+        argumentcount++;
+
+        if (att_mtu < GATTC_LONG_MIN_ATT_MTU)
+        {
+            throw std::string("ATT MTU of at least 23");
+        }
+
+        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    auto baton = new GattcLongBaton(callback);
+    baton->adapter = obj->adapter;
+    baton->write = std::make_unique<GattcLongWrite>(obj->adapter, conn_handle, handle, std::move(value), att_mtu);
+    baton->procedure = baton->write.get();
+
+    if (!startLongOperation(obj, baton))
+    {
+        return;
+    }
+
+    obj->commandQueue.submit(baton->req, GattcWriteLong, reinterpret_cast<uv_after_work_cb>(AfterGattcWriteLong));
+}
+
+// This runs in a worker thread (not Main Thread)
+void Adapter::GattcWriteLong(uv_work_t *req)
+{
+    auto baton = static_cast<GattcLongBaton *>(req->data);
+    auto procedure = baton->procedure;
+
+    baton->mainObject->makeGattcRequest(procedure->getConnHandle(), [procedure]() {
+        procedure->start();
+        return procedure->isDone() ? procedure->getResult() : static_cast<uint32_t>(NRF_SUCCESS);
+    });
+}
+
+// This runs in Main Thread
+void Adapter::AfterGattcWriteLong(uv_work_t *req)
+{
+    auto baton = static_cast<GattcLongBaton *>(req->data);
+    baton->started = true;
+
+    if (baton->procedure->isDone())
+    {
+        finishLongOperation(baton);
+    }
+}
+
+// This runs in Main Thread
+void Adapter::finishLongOperation(GattcLongBaton *baton)
+{
+    // The baton is still used by the command queue until the start command has completed
+    if (!baton->started || baton->finished)
+    {
+        return;
+    }
+
+    baton->finished = true;
+
+    Nan::HandleScope scope;
+
+    const auto &procedure = *baton->procedure;
+    const auto operation = baton->read ? "reading long value" : "writing long value";
+    baton->mainObject->stopGattcProcedure(procedure.getConnHandle());
+
+    if (baton->write)
+    {
+        baton->mainObject->connectionStats.onTx(procedure.getConnHandle(), baton->write->getRequestCount(), baton->write->getPreparedLength(), false);
+    }
+
+    v8::Local<v8::Value> argv[2];
+
+    if (procedure.getResult() == NRF_ERROR_INVALID_DATA)
+    {
+        std::ostringstream message;
+        message << operation << ", GATT status "
+            << ConversionUtility::valueToString(procedure.getGattStatus(), gatt_status_map)
+            << " at handle " << procedure.getErrorHandle();
+        argv[0] = ErrorMessage::getErrorMessage(procedure.getResult(), message.str());
+        argv[1] = Nan::Undefined();
+    }
+    else if (procedure.getResult() != NRF_SUCCESS)
+    {
+        argv[0] = ErrorMessage::getErrorMessage(procedure.getResult(), operation);
+        argv[1] = Nan::Undefined();
+    }
+    else
+    {
+        argv[0] = Nan::Undefined();
+
+        if (baton->read)
+        {
+            const auto &value = baton->read->getValue();
+            // Several adapters share the NodeJS thread, use the value format of this adapter
+            ConversionUtility::setValueFormat(baton->mainObject->eventValueFormat);
+            argv[1] = ConversionUtility::toJsValue(value.data(), static_cast<uint16_t>(value.size()));
+        }
+        else
+        {
+            argv[1] = Nan::Undefined();
+        }
+    }
+
+    baton->async_done->data = nullptr;
+    uv_close(reinterpret_cast<uv_handle_t *>(baton->async_done), [](uv_handle_t *handle) {
+        delete reinterpret_cast<uv_async_t *>(handle);
+    });
+
+    Nan::AsyncResource resource("pc-ble-driver-js:callback");
+    baton->callback->Call(2, argv, &resource);
+    delete baton;
+}
+
 NAN_METHOD(Adapter::GattcConfirmHandleValue)
 {
     uint16_t conn_handle;
@@ -1055,7 +2004,7 @@ NAN_METHOD(Adapter::GattcConfirmHandleValue)
     baton->conn_handle = conn_handle;
     baton->handle = handle;
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcConfirmHandleValue, reinterpret_cast<uv_after_work_cb>(AfterGattcConfirmHandleValue));
+    obj->commandQueue.submit(baton->req, GattcConfirmHandleValue, reinterpret_cast<uv_after_work_cb>(AfterGattcConfirmHandleValue));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1116,17 +2065,20 @@ NAN_METHOD(Adapter::GattcExchangeMtuRequest)
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
     auto baton = new GattcExchangeMtuRequestBaton(callback);
     baton->adapter = obj->adapter;
+    baton->mainObject = obj;
     baton->conn_handle = conn_handle;
     baton->client_rx_mtu = client_rx_mtu;
 
-    uv_queue_work(uv_default_loop(), baton->req, GattcExchangeMtuRequest, reinterpret_cast<uv_after_work_cb>(AfterGattcExchangeMtuRequest));
+    obj->commandQueue.submit(baton->req, GattcExchangeMtuRequest, reinterpret_cast<uv_after_work_cb>(AfterGattcExchangeMtuRequest));
 }
 
 // This runs in a worker thread (not Main Thread)
 void Adapter::GattcExchangeMtuRequest(uv_work_t *req)
 {
     auto baton = static_cast<GattcExchangeMtuRequestBaton *>(req->data);
-    baton->result = sd_ble_gattc_exchange_mtu_request(baton->adapter, baton->conn_handle, baton->client_rx_mtu);
+    baton->result = baton->mainObject->makeGattcRequest(baton->conn_handle, [baton]() {
+        return sd_ble_gattc_exchange_mtu_request(baton->adapter, baton->conn_handle, baton->client_rx_mtu);
+    });
 }
 
 // This runs in Main Thread
@@ -37,8 +37,16 @@
 #ifndef DRIVER_GATTC_H
 #define DRIVER_GATTC_H
 
+#include <memory>
+#include <vector>
+
 #include "common.h"
 #include "ble_gattc.h"
+#include "gattc_discovery.h"
+#include "gattc_long.h"
+#include "write_stream.h"
+
+class Adapter;
 
 extern name_map_t gatt_status_map;
 
@@ -101,6 +109,21 @@ public:
     v8::Local<v8::Object> ToJs();
 };
 
+// A service found by GattcDatabaseDiscovery, with its characteristics and their descriptors
+class GattcDatabaseService : public BleToJs<GattcDatabaseDiscovery::Service>
+{
+public:
+    GattcDatabaseService(GattcDatabaseDiscovery::Service *service) : BleToJs<GattcDatabaseDiscovery::Service>(service) {}
+    v8::Local<v8::Object> ToJs();
+};
+
+class GattcDatabaseCharacteristic : public BleToJs<GattcDatabaseDiscovery::Characteristic>
+{
+public:
+    GattcDatabaseCharacteristic(GattcDatabaseDiscovery::Characteristic *characteristic) : BleToJs<GattcDatabaseDiscovery::Characteristic>(characteristic) {}
+    v8::Local<v8::Object> ToJs();
+};
+
 class GattcWriteParameters : public BleToJs<ble_gattc_write_params_t>
 {
 public:
@@ -120,7 +143,7 @@ private:
     uint16_t error_handle;
 
 public:
-    BleDriverGattcEvent(uint16_t evt_id, std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, EventType *evt)
+    BleDriverGattcEvent(uint16_t evt_id, const EventTime timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, EventType *evt)
         : BleDriverEvent<EventType>(evt_id, timestamp, conn_handle, evt),
         gatt_status(gatt_status),
         error_handle(error_handle)
@@ -144,7 +167,7 @@ public:
 class GattcPrimaryServiceDiscoveryEvent : BleDriverGattcEvent<ble_gattc_evt_prim_srvc_disc_rsp_t>
 {
 public:
-    GattcPrimaryServiceDiscoveryEvent(std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_prim_srvc_disc_rsp_t *evt)
+    GattcPrimaryServiceDiscoveryEvent(const EventTime timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_prim_srvc_disc_rsp_t *evt)
         : BleDriverGattcEvent<ble_gattc_evt_prim_srvc_disc_rsp_t>(BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP, timestamp, conn_handle, gatt_status, error_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -153,7 +176,7 @@ public:
 class GattcRelationshipDiscoveryEvent : BleDriverGattcEvent < ble_gattc_evt_rel_disc_rsp_t >
 {
 public:
-    GattcRelationshipDiscoveryEvent(std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_rel_disc_rsp_t *evt)
+    GattcRelationshipDiscoveryEvent(const EventTime timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_rel_disc_rsp_t *evt)
         : BleDriverGattcEvent<ble_gattc_evt_rel_disc_rsp_t>(BLE_GATTC_EVT_REL_DISC_RSP, timestamp, conn_handle, gatt_status, error_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -162,7 +185,7 @@ public:
 class GattcCharacteristicDiscoveryEvent : BleDriverGattcEvent < ble_gattc_evt_char_disc_rsp_t >
 {
 public:
-    GattcCharacteristicDiscoveryEvent(std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_char_disc_rsp_t *evt)
+    GattcCharacteristicDiscoveryEvent(const EventTime timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_char_disc_rsp_t *evt)
         : BleDriverGattcEvent<ble_gattc_evt_char_disc_rsp_t>(BLE_GATTC_EVT_CHAR_DISC_RSP, timestamp, conn_handle, gatt_status, error_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -171,7 +194,7 @@ public:
 class GattcDescriptorDiscoveryEvent : BleDriverGattcEvent < ble_gattc_evt_desc_disc_rsp_t >
 {
 public:
-    GattcDescriptorDiscoveryEvent(std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_desc_disc_rsp_t *evt)
+    GattcDescriptorDiscoveryEvent(const EventTime timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_desc_disc_rsp_t *evt)
         : BleDriverGattcEvent<ble_gattc_evt_desc_disc_rsp_t>(BLE_GATTC_EVT_DESC_DISC_RSP, timestamp, conn_handle, gatt_status, error_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -190,7 +213,7 @@ public:
 class GattcCharacteristicValueReadByUUIDEvent : BleDriverGattcEvent < ble_gattc_evt_char_val_by_uuid_read_rsp_t >
 {
 public:
-    GattcCharacteristicValueReadByUUIDEvent(std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_char_val_by_uuid_read_rsp_t *evt)
+    GattcCharacteristicValueReadByUUIDEvent(const EventTime timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_char_val_by_uuid_read_rsp_t *evt)
         : BleDriverGattcEvent<ble_gattc_evt_char_val_by_uuid_read_rsp_t>(BLE_GATTC_EVT_CHAR_VAL_BY_UUID_READ_RSP, timestamp, conn_handle, gatt_status, error_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -199,7 +222,7 @@ public:
 class GattcReadEvent : BleDriverGattcEvent < ble_gattc_evt_read_rsp_t >
 {
 public:
-    GattcReadEvent(std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_read_rsp_t *evt)
+    GattcReadEvent(const EventTime timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_read_rsp_t *evt)
         : BleDriverGattcEvent<ble_gattc_evt_read_rsp_t>(BLE_GATTC_EVT_READ_RSP, timestamp, conn_handle, gatt_status, error_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -208,7 +231,7 @@ public:
 class GattcCharacteristicValueReadEvent : BleDriverGattcEvent < ble_gattc_evt_char_vals_read_rsp_t >
 {
 public:
-    GattcCharacteristicValueReadEvent(std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_char_vals_read_rsp_t *evt)
+    GattcCharacteristicValueReadEvent(const EventTime timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_char_vals_read_rsp_t *evt)
         : BleDriverGattcEvent<ble_gattc_evt_char_vals_read_rsp_t>(BLE_GATTC_EVT_CHAR_VALS_READ_RSP, timestamp, conn_handle, gatt_status, error_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -217,7 +240,7 @@ public:
 class GattcWriteEvent : BleDriverGattcEvent < ble_gattc_evt_write_rsp_t >
 {
 public:
-    GattcWriteEvent(std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_write_rsp_t *evt)
+    GattcWriteEvent(const EventTime timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_write_rsp_t *evt)
         : BleDriverGattcEvent<ble_gattc_evt_write_rsp_t>(BLE_GATTC_EVT_WRITE_RSP, timestamp, conn_handle, gatt_status, error_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -226,7 +249,7 @@ public:
 class GattcHandleValueNotificationEvent : BleDriverGattcEvent < ble_gattc_evt_hvx_t >
 {
 public:
-    GattcHandleValueNotificationEvent(std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_hvx_t *evt)
+    GattcHandleValueNotificationEvent(const EventTime timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_hvx_t *evt)
         : BleDriverGattcEvent<ble_gattc_evt_hvx_t>(BLE_GATTC_EVT_HVX, timestamp, conn_handle, gatt_status, error_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -235,7 +258,7 @@ public:
 class GattcTimeoutEvent : BleDriverGattcEvent < ble_gattc_evt_timeout_t >
 {
 public:
-    GattcTimeoutEvent(std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_timeout_t *evt)
+    GattcTimeoutEvent(const EventTime timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_timeout_t *evt)
         : BleDriverGattcEvent<ble_gattc_evt_timeout_t>(BLE_GATTC_EVT_TIMEOUT, timestamp, conn_handle, gatt_status, error_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -245,7 +268,7 @@ public:
 class GattcExchangeMtuResponseEvent : BleDriverGattcEvent < ble_gattc_evt_exchange_mtu_rsp_t >
 {
 public:
-	GattcExchangeMtuResponseEvent(std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_exchange_mtu_rsp_t *evt)
+	GattcExchangeMtuResponseEvent(const EventTime timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_exchange_mtu_rsp_t *evt)
 		: BleDriverGattcEvent<ble_gattc_evt_exchange_mtu_rsp_t>(BLE_GATTC_EVT_EXCHANGE_MTU_RSP, timestamp, conn_handle, gatt_status, error_handle, evt) {}
 
 	v8::Local<v8::Object> ToJs();
@@ -254,7 +277,7 @@ public:
 class GattcWriteCmdTxCompleteEvent : BleDriverGattcEvent<ble_gattc_evt_write_cmd_tx_complete_t>
 {
 public:
-    GattcWriteCmdTxCompleteEvent(std::string timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_write_cmd_tx_complete_t *evt)
+    GattcWriteCmdTxCompleteEvent(const EventTime timestamp, uint16_t conn_handle, uint16_t gatt_status, uint16_t error_handle, ble_gattc_evt_write_cmd_tx_complete_t *evt)
         : BleDriverGattcEvent<ble_gattc_evt_write_cmd_tx_complete_t>(BLE_GATTC_EVT_WRITE_CMD_TX_COMPLETE, timestamp, conn_handle, gatt_status, error_handle, evt) {}
 
     v8::Local<v8::Object> ToJs() override;
@@ -269,6 +292,7 @@ struct GattcDiscoverPrimaryServicesBaton : public Baton
 public:
     BATON_CONSTRUCTOR(GattcDiscoverPrimaryServicesBaton);
     BATON_DESTRUCTOR(GattcDiscoverPrimaryServicesBaton) { delete p_srvc_uuid; }
+    Adapter *mainObject;
     uint16_t conn_handle;
     uint16_t start_handle;
     ble_uuid_t *p_srvc_uuid;
@@ -279,6 +303,7 @@ struct GattcDiscoverRelationshipBaton : public Baton
 public:
     BATON_CONSTRUCTOR(GattcDiscoverRelationshipBaton);
     BATON_DESTRUCTOR(GattcDiscoverRelationshipBaton) { delete p_handle_range; }
+    Adapter *mainObject;
     uint16_t conn_handle;
     ble_gattc_handle_range_t *p_handle_range;
 };
@@ -288,6 +313,7 @@ struct GattcDiscoverCharacteristicsBaton : public Baton
 public:
     BATON_CONSTRUCTOR(GattcDiscoverCharacteristicsBaton);
     BATON_DESTRUCTOR(GattcDiscoverCharacteristicsBaton) { delete p_handle_range; }
+    Adapter *mainObject;
     uint16_t conn_handle;
     ble_gattc_handle_range_t *p_handle_range;
 };
@@ -297,6 +323,7 @@ struct GattcDiscoverDescriptorsBaton : public Baton
 public:
     BATON_CONSTRUCTOR(GattcDiscoverDescriptorsBaton);
     BATON_DESTRUCTOR(GattcDiscoverDescriptorsBaton) { delete p_handle_range; }
+    Adapter *mainObject;
     uint16_t conn_handle;
     ble_gattc_handle_range_t *p_handle_range;
 };
@@ -310,6 +337,7 @@ public:
         delete p_uuid;
         delete p_handle_range;
     }
+    Adapter *mainObject;
     uint16_t conn_handle;
     ble_uuid_t *p_uuid;
     ble_gattc_handle_range_t *p_handle_range;
@@ -319,6 +347,7 @@ struct GattcReadBaton : public Baton
 {
 public:
     BATON_CONSTRUCTOR(GattcReadBaton);
+    Adapter *mainObject;
     uint16_t conn_handle;
     uint16_t handle;
     uint16_t offset;
@@ -329,6 +358,7 @@ struct GattcReadCharacteristicValuesBaton : public Baton
 public:
     BATON_CONSTRUCTOR(GattcReadCharacteristicValuesBaton);
     BATON_DESTRUCTOR(GattcReadCharacteristicValuesBaton) { free(p_handles); }
+    Adapter *mainObject;
     uint16_t conn_handle;
     uint16_t *p_handles;
     uint16_t handle_count;
@@ -343,10 +373,79 @@ public:
         free((char*)(p_write_params->p_value));
         delete p_write_params;
     }
+    Adapter *mainObject;
     uint16_t conn_handle;
     ble_gattc_write_params_t *p_write_params;
 };
 
+struct GattcWriteStreamBaton : public Baton
+{
+public:
+    BATON_CONSTRUCTOR(GattcWriteStreamBaton);
+    Adapter *mainObject;
+    uint16_t conn_handle;
+    uint16_t handle;
+    uint16_t chunk_size;
+    std::vector<uint8_t> value;
+    std::shared_ptr<WriteStreamCredits> credits;
+    size_t offset;              // Bytes accepted by the SoftDevice
+    uint32_t written;           // Packets accepted by the SoftDevice
+    WriteStreamProgress progress;
+    bool done;
+};
+
+struct GattcWriteDfuObjectBaton : public Baton
+{
+public:
+    BATON_CONSTRUCTOR(GattcWriteDfuObjectBaton);
+    BATON_DESTRUCTOR(GattcWriteDfuObjectBaton) { delete progress_callback; }
+    Adapter *mainObject;
+    uint16_t conn_handle;
+    uint16_t handle;
+    uint16_t chunk_size;
+    uint16_t prn;                       // Packets per receipt, 0 if the target sends none
+    std::vector<uint8_t> value;
+    std::shared_ptr<WriteStreamCredits> credits;
+    std::shared_ptr<DfuReceipts> receipts;
+    Nan::Callback *progress_callback;   // nullptr if progress is not reported
+    uint32_t start_offset;              // Offset of the object in the DFU image, as reported by the target
+    size_t offset;                      // Bytes accepted by the SoftDevice
+    uint32_t crc32;                     // CRC32 of the DFU image up to offset
+    uint32_t written;                   // Packets accepted by the SoftDevice
+    uint16_t unreceipted;               // Packets written since the last receipt was due
+    size_t reported;                    // offset when progress was last reported
+    uint32_t verified_offset;           // Offset of the last matching receipt when progress was last seen
+    WriteStreamProgress progress;
+    bool done;
+};
+
+struct GattcDiscoverDatabaseBaton : public Baton
+{
+public:
+    BATON_CONSTRUCTOR(GattcDiscoverDatabaseBaton);
+    Adapter *mainObject;
+    std::unique_ptr<GattcDatabaseDiscovery> discovery;
+    // Wakes the NodeJS thread when the discovery is done, closed by Adapter::finishDatabaseDiscovery
+    uv_async_t *async_done;
+    bool started;   // The command that started the discovery has completed
+    bool finished;
+};
+
+struct GattcLongBaton : public Baton
+{
+public:
+    BATON_CONSTRUCTOR(GattcLongBaton);
+    Adapter *mainObject;
+    // One of read and write is set, procedure points to it
+    std::unique_ptr<GattcLongRead> read;
+    std::unique_ptr<GattcLongWrite> write;
+    GattcProcedure *procedure;
+    // Wakes the NodeJS thread when the procedure is done, closed by Adapter::finishLongOperation
+    uv_async_t *async_done;
+    bool started;   // The command that started the procedure has completed
+    bool finished;
+};
+
 struct GattcConfirmHandleValueBaton : public Baton
 {
 public:
@@ -359,6 +458,7 @@ struct GattcExchangeMtuRequestBaton : public Baton
 {
 public:
     BATON_CONSTRUCTOR(GattcExchangeMtuRequestBaton);
+    Adapter *mainObject;
     uint16_t conn_handle;
     uint16_t client_rx_mtu;
 };
@@ -41,6 +41,7 @@
 #include "driver_gap.h"
 #include "driver_gatt.h"
 
+#include <algorithm>
 #include <iostream>
 
 static name_map_t gatts_op_map =
@@ -277,7 +278,7 @@ ble_gatts_rw_authorize_reply_params_t *GattGattsReplyReadWriteAuthorizeParams::T
 v8::Local<v8::Object> GattsWriteEvent::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverGattsEvent::createJsObject();
     BleDriverGattsEvent::ToJs(obj);
 
     Utility::Set(obj, "handle", ConversionUtility::toJsNumber(evt->handle));
@@ -287,7 +288,7 @@ v8::Local<v8::Object> GattsWriteEvent::ToJs()
     Utility::Set(obj, "uuid", BleUUID(&evt->uuid).ToJs());
     Utility::Set(obj, "offset", ConversionUtility::toJsNumber(evt->offset));
     Utility::Set(obj, "len", ConversionUtility::toJsNumber(evt->len));
-    Utility::Set(obj, "data", ConversionUtility::toJsValueArray(evt->data, evt->len));
+    Utility::Set(obj, "data", ConversionUtility::toJsValue(evt->data, evt->len));
 
     return scope.Escape(obj);
 }
@@ -307,7 +308,7 @@ v8::Local<v8::Object> GattsReadEvent::ToJs()
 v8::Local<v8::Object> GattsRWAuthorizeRequestEvent::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverGattsEvent::createJsObject();
     BleDriverGattsEvent::ToJs(obj);
 
     Utility::Set(obj, "type", ConversionUtility::toJsNumber(evt->type));
@@ -334,7 +335,7 @@ v8::Local<v8::Object> GattsRWAuthorizeRequestEvent::ToJs()
 v8::Local<v8::Object> GattsSystemAttributeMissingEvent::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverGattsEvent::createJsObject();
     BleDriverGattsEvent::ToJs(obj);
 
     Utility::Set(obj, "hint", ConversionUtility::toJsNumber(evt->hint));
@@ -345,7 +346,7 @@ v8::Local<v8::Object> GattsSystemAttributeMissingEvent::ToJs()
 v8::Local<v8::Object> GattsHVCEvent::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverGattsEvent::createJsObject();
     BleDriverGattsEvent::ToJs(obj);
 
     Utility::Set(obj, "handle", ConversionUtility::toJsNumber(evt->handle));
@@ -356,7 +357,7 @@ v8::Local<v8::Object> GattsHVCEvent::ToJs()
 v8::Local<v8::Object> GattsSCConfirmEvent::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverGattsEvent::createJsObject();
     BleDriverGattsEvent::ToJs(obj);
 
     return scope.Escape(obj);
@@ -365,7 +366,7 @@ v8::Local<v8::Object> GattsSCConfirmEvent::ToJs()
 v8::Local<v8::Object> GattsTimeoutEvent::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverGattsEvent::createJsObject();
     BleDriverGattsEvent::ToJs(obj);
 
     Utility::Set(obj, "src", ConversionUtility::toJsNumber(evt->src));
@@ -377,7 +378,7 @@ v8::Local<v8::Object> GattsTimeoutEvent::ToJs()
 v8::Local<v8::Object> GattsExchangeMtuRequestEvent::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverGattsEvent::createJsObject();
     BleDriverGattsEvent::ToJs(obj);
 
     Utility::Set(obj, "client_rx_mtu", ConversionUtility::toJsNumber(evt->client_rx_mtu));
@@ -388,7 +389,7 @@ v8::Local<v8::Object> GattsExchangeMtuRequestEvent::ToJs()
 v8::Local<v8::Object> GattsHvnTxCompleteEvent::ToJs()
 {
     Nan::EscapableHandleScope scope;
-    v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+    v8::Local<v8::Object> obj = BleDriverGattsEvent::createJsObject();
     BleDriverGattsEvent::ToJs(obj);
 
     Utility::Set(obj, "count", ConversionUtility::toJsNumber(evt->count));
@@ -439,7 +440,7 @@ NAN_METHOD(Adapter::GattsAddService)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsAddService, reinterpret_cast<uv_after_work_cb>(AfterGattsAddService));
+    obj->commandQueue.submit(baton->req, GattsAddService, reinterpret_cast<uv_after_work_cb>(AfterGattsAddService));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -529,7 +530,7 @@ NAN_METHOD(Adapter::GattsAddCharacteristic)
 
     baton->p_handles = new ble_gatts_char_handles_t();
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsAddCharacteristic, reinterpret_cast<uv_after_work_cb>(AfterGattsAddCharacteristic));
+    obj->commandQueue.submit(baton->req, GattsAddCharacteristic, reinterpret_cast<uv_after_work_cb>(AfterGattsAddCharacteristic));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -604,7 +605,7 @@ NAN_METHOD(Adapter::GattsAddDescriptor)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsAddDescriptor, reinterpret_cast<uv_after_work_cb>(AfterGattsAddDescriptor));
+    obj->commandQueue.submit(baton->req, GattsAddDescriptor, reinterpret_cast<uv_after_work_cb>(AfterGattsAddDescriptor));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -666,6 +667,7 @@ NAN_METHOD(Adapter::GattsHVX)
 
     auto baton = new GattsHVXBaton(callback);
     baton->adapter = obj->adapter;
+    baton->mainObject = obj;
     baton->conn_handle = conn_handle;
 
     try
@@ -679,14 +681,20 @@ NAN_METHOD(Adapter::GattsHVX)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsHVX, reinterpret_cast<uv_after_work_cb>(AfterGattsHVX));
+    obj->commandQueue.submit(baton->req, GattsHVX, reinterpret_cast<uv_after_work_cb>(AfterGattsHVX));
 }
 
 // This runs in a worker thread (not Main Thread)
 void Adapter::GattsHVX(uv_work_t *req)
 {
     auto baton = static_cast<GattsHVXBaton *>(req->data);
-    baton->result = sd_ble_gatts_hvx(baton->adapter, baton->conn_handle, baton->p_hvx_params);
+    const auto params = baton->p_hvx_params;
+    baton->result = sd_ble_gatts_hvx(baton->adapter, baton->conn_handle, params);
+
+    if (baton->result == NRF_SUCCESS)
+    {
+        baton->mainObject->connectionStats.onTx(baton->conn_handle, 1, *params->p_len, params->type == BLE_GATT_HVX_NOTIFICATION);
+    }
 }
 
 // This runs in Main Thread
@@ -713,6 +721,212 @@ void Adapter::AfterGattsHVX(uv_work_t *req)
     delete baton;
 }
 
+// Sends a buffer of samples as notifications, one sample of sample_size bytes per notification, as fast
+// as the TX queue allows. progress_callback, if not null, is called with the number of samples sent and
+// transmitted after each run in the command thread. The callback is called once, with the number of
+// samples sent. Only one stream can be active per connection.
+NAN_METHOD(Adapter::GattsHVXStream)
+{
+    auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
+    uint16_t conn_handle;
+    uint16_t handle;
+    uint16_t sample_size;
+    v8::Local<v8::Value> value;
+    v8::Local<v8::Function> progress_callback;
+    v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
+
+    try
+    {
+        conn_handle = ConversionUtility::getNativeUint16(info[argumentcount]);
+        argumentcount++;
+
+        handle = ConversionUtility::getNativeUint16(info[argumentcount]);
+        argumentcount++;
+
+        if (!info[argumentcount]->IsArrayBufferView())
+        {
+            throw std::string("Buffer or Uint8Array");
+        }
+
+        value = info[argumentcount];
+        argumentcount++;
+
+        sample_size = ConversionUtility::getNativeUint16(info[argumentcount]);
+
+        if (sample_size == 0)
+        {
+            throw std::string("number larger than 0");
+        }
+
+        argumentcount++;
+
+        if (!info[argumentcount]->IsNull())
+        {
+            progress_callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        }
+
+        argumentcount++;
+
+        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto credits = obj->startWriteStream(conn_handle, WRITE_STREAM_GATTS_HVX);
+
+    if (credits == nullptr)
+    {
+        Nan::ThrowError("A notification stream is already active on this connection");
+        return;
+    }
+
+    Nan::TypedArrayContents<uint8_t> contents(value);
+
+    auto baton = new GattsHVXStreamBaton(callback);
+    baton->adapter = obj->adapter;
+    baton->mainObject = obj;
+    baton->conn_handle = conn_handle;
+    baton->handle = handle;
+    baton->sample_size = sample_size;
+    baton->value.assign(*contents, *contents + contents.length());
+    baton->credits = credits;
+    baton->progress_callback = progress_callback.IsEmpty() ? nullptr : new Nan::Callback(progress_callback);
+    baton->offset = 0;
+    baton->sent = 0;
+    baton->reported = 0;
+    baton->done = false;
+    baton->result = NRF_SUCCESS;
+
+    obj->commandQueue.submit(baton->req, GattsHVXStream, reinterpret_cast<uv_after_work_cb>(AfterGattsHVXStream));
+}
+
+// This runs in a worker thread (not Main Thread)
+// Sends at most WRITE_STREAM_SLICE_PACKETS notifications per run. AfterGattsHVXStream submits the stream
+// again until it is done, so other commands are run in between.
+void Adapter::GattsHVXStream(uv_work_t *req)
+{
+    auto baton = static_cast<GattsHVXStreamBaton *>(req->data);
+    auto &credits = *baton->credits;
+    const auto length = baton->value.size();
+    auto packets = 0;
+
+    while (baton->offset < length && packets < WRITE_STREAM_SLICE_PACKETS)
+    {
+        if (!credits.take(WRITE_STREAM_WAIT_TIMEOUT))
+        {
+            break;
+        }
+
+        auto len = static_cast<uint16_t>(std::min<size_t>(length - baton->offset, baton->sample_size));
+        const auto requested = len;
+
+        ble_gatts_hvx_params_t hvx_params;
+        memset(&hvx_params, 0, sizeof(hvx_params));
+        hvx_params.handle = baton->handle;
+        hvx_params.type = BLE_GATT_HVX_NOTIFICATION;
+        hvx_params.p_len = &len;
+        hvx_params.p_data = baton->value.data() + baton->offset;
+
+        const auto err_code = sd_ble_gatts_hvx(baton->adapter, baton->conn_handle, &hvx_params);
+
+        if (err_code == WRITE_STREAM_TX_QUEUE_FULL)
+        {
+            credits.exhausted();
+            continue;
+        }
+
+        if (err_code != NRF_SUCCESS)
+        {
+            baton->result = err_code;
+            baton->done = true;
+            return;
+        }
+
+        baton->mainObject->connectionStats.onTx(baton->conn_handle, 1, requested, true);
+        baton->offset += requested;
+        baton->sent++;
+        packets++;
+
+        // The SoftDevice truncates notifications longer than the ATT MTU allows
+        if (len != requested)
+        {
+            baton->result = NRF_ERROR_DATA_SIZE;
+            baton->done = true;
+            return;
+        }
+    }
+
+    if (baton->offset == length && credits.waitForTransmitted(baton->sent, WRITE_STREAM_WAIT_TIMEOUT))
+    {
+        baton->done = true;
+        return;
+    }
+
+    if (credits.isAborted())
+    {
+        baton->result = BLE_ERROR_INVALID_CONN_HANDLE;
+        baton->done = true;
+        return;
+    }
+
+    if (!baton->progress.update(credits, packets > 0))
+    {
+        baton->result = NRF_ERROR_TIMEOUT;
+        baton->done = true;
+    }
+}
+
+// This runs in Main Thread
+void Adapter::AfterGattsHVXStream(uv_work_t *req)
+{
+    Nan::HandleScope scope;
+
+    auto baton = static_cast<GattsHVXStreamBaton *>(req->data);
+
+    if (!baton->done)
+    {
+        if (baton->progress_callback != nullptr && baton->sent != baton->reported)
+        {
+            baton->reported = baton->sent;
+
+            v8::Local<v8::Value> argv[2];
+            argv[0] = ConversionUtility::toJsNumber(baton->sent);
+            argv[1] = ConversionUtility::toJsNumber(std::min(baton->progress.transmitted, baton->sent));
+
+            Nan::AsyncResource resource("pc-ble-driver-js:callback");
+            baton->progress_callback->Call(2, argv, &resource);
+        }
+
+        baton->mainObject->commandQueue.submit(baton->req, GattsHVXStream, reinterpret_cast<uv_after_work_cb>(AfterGattsHVXStream));
+        return;
+    }
+
+    baton->mainObject->stopWriteStream(baton->conn_handle, WRITE_STREAM_GATTS_HVX);
+
+    v8::Local<v8::Value> argv[2];
+
+    if (baton->result != NRF_SUCCESS)
+    {
+        argv[0] = ErrorMessage::getErrorMessage(baton->result, "hvx stream");
+    }
+    else
+    {
+        argv[0] = Nan::Undefined();
+    }
+
+    argv[1] = ConversionUtility::toJsNumber(baton->sent);
+
+    Nan::AsyncResource resource("pc-ble-driver-js:callback");
+    baton->callback->Call(2, argv, &resource);
+    delete baton;
+}
+
 NAN_METHOD(Adapter::GattsSystemAttributeSet)
 {
     auto obj = Nan::ObjectWrap::Unwrap<Adapter>(info.Holder());
@@ -771,7 +985,7 @@ NAN_METHOD(Adapter::GattsSystemAttributeSet)
     baton->len = len;
     baton->flags = flags;
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsSystemAttributeSet, reinterpret_cast<uv_after_work_cb>(AfterGattsSystemAttributeSet));
+    obj->commandQueue.submit(baton->req, GattsSystemAttributeSet, reinterpret_cast<uv_after_work_cb>(AfterGattsSystemAttributeSet));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -849,7 +1063,7 @@ NAN_METHOD(Adapter::GattsSetValue)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsSetValue, reinterpret_cast<uv_after_work_cb>(AfterGattsSetValue));
+    obj->commandQueue.submit(baton->req, GattsSetValue, reinterpret_cast<uv_after_work_cb>(AfterGattsSetValue));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -929,7 +1143,7 @@ NAN_METHOD(Adapter::GattsGetValue)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsGetValue, reinterpret_cast<uv_after_work_cb>(AfterGattsGetValue));
+    obj->commandQueue.submit(baton->req, GattsGetValue, reinterpret_cast<uv_after_work_cb>(AfterGattsGetValue));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1004,7 +1218,7 @@ NAN_METHOD(Adapter::GattsReplyReadWriteAuthorize)
         return;
     }
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsReplyReadWriteAuthorize, reinterpret_cast<uv_after_work_cb>(AfterGattsReplyReadWriteAuthorize));
+    obj->commandQueue.submit(baton->req, GattsReplyReadWriteAuthorize, reinterpret_cast<uv_after_work_cb>(AfterGattsReplyReadWriteAuthorize));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -1068,7 +1282,7 @@ NAN_METHOD(Adapter::GattsExchangeMtuReply)
     baton->conn_handle = conn_handle;
     baton->server_rx_mtu = server_rx_mtu;
 
-    uv_queue_work(uv_default_loop(), baton->req, GattsExchangeMtuReply, reinterpret_cast<uv_after_work_cb>(AfterGattsExchangeMtuReply));
+    obj->commandQueue.submit(baton->req, GattsExchangeMtuReply, reinterpret_cast<uv_after_work_cb>(AfterGattsExchangeMtuReply));
 }
 
 // This runs in a worker thread (not Main Thread)
@@ -37,8 +37,14 @@
 #ifndef DRIVER_GATTS_H
 #define DRIVER_GATTS_H
 
+#include <memory>
+#include <vector>
+
 #include "common.h"
 #include "ble_gatts.h"
+#include "write_stream.h"
+
+class Adapter;
 
 static name_map_t gatts_event_name_map =
 {
@@ -145,7 +151,7 @@ private:
     BleDriverGattsEvent() {}
 
 public:
-    BleDriverGattsEvent(uint16_t evt_id, std::string timestamp, uint16_t conn_handle, EventType *evt)
+    BleDriverGattsEvent(uint16_t evt_id, const EventTime timestamp, uint16_t conn_handle, EventType *evt)
         : BleDriverEvent<EventType>(evt_id, timestamp, conn_handle, evt)
     {
     }
@@ -164,7 +170,7 @@ public:
 class GattsWriteEvent : BleDriverGattsEvent<ble_gatts_evt_write_t>
 {
 public:
-    GattsWriteEvent(std::string timestamp, uint16_t conn_handle, ble_gatts_evt_write_t *evt)
+    GattsWriteEvent(const EventTime timestamp, uint16_t conn_handle, ble_gatts_evt_write_t *evt)
         : BleDriverGattsEvent<ble_gatts_evt_write_t>(BLE_GATTS_EVT_WRITE, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs() override;
@@ -181,7 +187,7 @@ public:
 class GattsRWAuthorizeRequestEvent : BleDriverGattsEvent<ble_gatts_evt_rw_authorize_request_t>
 {
 public:
-    GattsRWAuthorizeRequestEvent(std::string timestamp, uint16_t conn_handle, ble_gatts_evt_rw_authorize_request_t *evt)
+    GattsRWAuthorizeRequestEvent(const EventTime timestamp, uint16_t conn_handle, ble_gatts_evt_rw_authorize_request_t *evt)
         : BleDriverGattsEvent<ble_gatts_evt_rw_authorize_request_t>(BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -190,7 +196,7 @@ public:
 class GattsSystemAttributeMissingEvent : BleDriverGattsEvent<ble_gatts_evt_sys_attr_missing_t>
 {
 public:
-    GattsSystemAttributeMissingEvent(std::string timestamp, uint16_t conn_handle, ble_gatts_evt_sys_attr_missing_t *evt)
+    GattsSystemAttributeMissingEvent(const EventTime timestamp, uint16_t conn_handle, ble_gatts_evt_sys_attr_missing_t *evt)
         : BleDriverGattsEvent<ble_gatts_evt_sys_attr_missing_t>(BLE_GATTS_EVT_SYS_ATTR_MISSING, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -199,7 +205,7 @@ public:
 class GattsHVCEvent : BleDriverGattsEvent<ble_gatts_evt_hvc_t>
 {
 public:
-    GattsHVCEvent(std::string timestamp, uint16_t conn_handle, ble_gatts_evt_hvc_t *evt)
+    GattsHVCEvent(const EventTime timestamp, uint16_t conn_handle, ble_gatts_evt_hvc_t *evt)
         : BleDriverGattsEvent<ble_gatts_evt_hvc_t>(BLE_GATTS_EVT_HVC, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -208,7 +214,7 @@ public:
 class GattsSCConfirmEvent : BleDriverGattsEvent<ble_gatts_evt_timeout_t>
 {
 public:
-    GattsSCConfirmEvent(std::string timestamp, uint16_t conn_handle, ble_gatts_evt_timeout_t *evt)
+    GattsSCConfirmEvent(const EventTime timestamp, uint16_t conn_handle, ble_gatts_evt_timeout_t *evt)
         : BleDriverGattsEvent<ble_gatts_evt_timeout_t>(BLE_GATTS_EVT_SC_CONFIRM, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -217,7 +223,7 @@ public:
 class GattsTimeoutEvent : BleDriverGattsEvent<ble_gatts_evt_timeout_t>
 {
 public:
-    GattsTimeoutEvent(std::string timestamp, uint16_t conn_handle, ble_gatts_evt_timeout_t *evt)
+    GattsTimeoutEvent(const EventTime timestamp, uint16_t conn_handle, ble_gatts_evt_timeout_t *evt)
         : BleDriverGattsEvent<ble_gatts_evt_timeout_t>(BLE_GATTS_EVT_TIMEOUT, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs();
@@ -227,7 +233,7 @@ public:
 class GattsExchangeMtuRequestEvent : BleDriverGattsEvent<ble_gatts_evt_exchange_mtu_request_t>
 {
 public:
-	GattsExchangeMtuRequestEvent(std::string timestamp, uint16_t conn_handle, ble_gatts_evt_exchange_mtu_request_t *evt)
+	GattsExchangeMtuRequestEvent(const EventTime timestamp, uint16_t conn_handle, ble_gatts_evt_exchange_mtu_request_t *evt)
 		: BleDriverGattsEvent<ble_gatts_evt_exchange_mtu_request_t>(BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST, timestamp, conn_handle, evt) {}
 
 	v8::Local<v8::Object> ToJs();
@@ -236,7 +242,7 @@ public:
 class GattsHvnTxCompleteEvent : BleDriverGattsEvent<ble_gatts_evt_hvn_tx_complete_t>
 {
 public:
-    GattsHvnTxCompleteEvent(std::string timestamp, uint16_t conn_handle, ble_gatts_evt_hvn_tx_complete_t *evt)
+    GattsHvnTxCompleteEvent(const EventTime timestamp, uint16_t conn_handle, ble_gatts_evt_hvn_tx_complete_t *evt)
         : BleDriverGattsEvent<ble_gatts_evt_hvn_tx_complete_t>(BLE_GATTS_EVT_HVN_TX_COMPLETE, timestamp, conn_handle, evt) {}
 
     v8::Local<v8::Object> ToJs() override;
@@ -294,10 +300,30 @@ public:
         free((char*)(p_hvx_params->p_data));
         delete p_hvx_params;
     }
+    Adapter *mainObject;
     uint16_t conn_handle;
     ble_gatts_hvx_params_t *p_hvx_params;
 };
 
+struct GattsHVXStreamBaton : public Baton
+{
+public:
+    BATON_CONSTRUCTOR(GattsHVXStreamBaton);
+    BATON_DESTRUCTOR(GattsHVXStreamBaton) { delete progress_callback; }
+    Adapter *mainObject;
+    uint16_t conn_handle;
+    uint16_t handle;
+    uint16_t sample_size;
+    std::vector<uint8_t> value;
+    std::shared_ptr<WriteStreamCredits> credits;
+    Nan::Callback *progress_callback;   // nullptr if progress is not reported
+    size_t offset;                      // Bytes accepted by the SoftDevice
+    uint32_t sent;                      // Notifications accepted by the SoftDevice
+    uint32_t reported;                  // sent when progress was last reported
+    WriteStreamProgress progress;
+    bool done;
+};
+
 struct GattsSystemAttributeSetBaton : public Baton
 {
 public:
@@ -0,0 +1,381 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "driver_replay.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "ble.h"
+#include "common.h"
+#include "adapter.h"
+#include "event_capture.h"
+
+#pragma region Replay reader
+
+static const char captureMagic[] = { 'P', 'B', 'E', 'C' };
+static const uint16_t CAPTURE_VERSION = 1;
+
+static uint16_t readUint16(const uint8_t *data)
+{
+    return static_cast<uint16_t>(data[0] | (data[1] << 8));
+}
+
+static uint32_t readUint32(const uint8_t *data)
+{
+    return readUint16(data) | (static_cast<uint32_t>(readUint16(data + 2)) << 16);
+}
+
+// Events pointing to memory of the process that received them can not be replayed, except a
+// LESC DHKey request with the peer key captured inline after it, see EventCapture
+static bool isReplayable(const uint8_t *event, const size_t eventLength, std::string &error)
+{
+    switch (readUint16(event))
+    {
+        case BLE_GAP_EVT_LESC_DHKEY_REQUEST:
+            if (eventLength < sizeof(ble_evt_t) + sizeof(ble_gap_lesc_p256_pk_t))
+            {
+                error = "LESC DHKey request without the peer key";
+                return false;
+            }
+
+            return true;
+        case BLE_EVT_USER_MEM_RELEASE:
+            error = "User memory release events can not be replayed";
+            return false;
+        default:
+            return true;
+    }
+}
+
+ReplayReader::ReplayReader(const uint8_t *data, const size_t length) :
+    data(data),
+    length(length),
+    offset(0),
+    segmentSize(0),
+    // The rest of the header is checked by the first call to next()
+    capture(length >= EVENT_CAPTURE_HEADER_SIZE && memcmp(data, captureMagic, sizeof(captureMagic)) == 0)
+{}
+
+bool ReplayReader::next(const uint8_t *&event, size_t &eventLength, uint64_t &timestamp, std::string &error)
+{
+    if (!capture)
+    {
+        if (offset >= length)
+        {
+            return false;
+        }
+
+        if (offset + REPLAY_RECORD_HEADER_SIZE > length)
+        {
+            error = "Truncated record header";
+            return false;
+        }
+
+        const size_t recordLength = readUint16(data + offset);
+        offset += REPLAY_RECORD_HEADER_SIZE;
+
+        if (recordLength < sizeof(ble_evt_hdr_t) || recordLength > EVENT_ENTRY_SIZE || offset + recordLength > length)
+        {
+            error = "Invalid record length";
+            return false;
+        }
+
+        if (!isReplayable(data + offset, recordLength, error))
+        {
+            return false;
+        }
+
+        event = data + offset;
+        eventLength = recordLength;
+        timestamp = 0;
+        offset += recordLength;
+        return true;
+    }
+
+    if (offset == 0)
+    {
+        if (readUint16(data + 4) != CAPTURE_VERSION)
+        {
+            error = "Unsupported event capture version";
+            return false;
+        }
+
+        if (readUint16(data + 6) != NRF_SD_BLE_API_VERSION)
+        {
+            error = "Event capture of another SoftDevice API version";
+            return false;
+        }
+
+        segmentSize = readUint32(data + 8);
+
+        if (segmentSize < EVENT_CAPTURE_HEADER_SIZE)
+        {
+            error = "Invalid event capture segment size";
+            return false;
+        }
+
+        offset = EVENT_CAPTURE_HEADER_SIZE;
+    }
+
+    while (offset + EVENT_CAPTURE_RECORD_HEADER_SIZE <= length)
+    {
+        const auto segmentEnd = (offset / segmentSize + 1) * segmentSize;
+        const size_t recordLength = readUint16(data + offset);
+
+        // The zero rest of a segment
+        if (recordLength == 0 || offset + EVENT_CAPTURE_RECORD_HEADER_SIZE > segmentEnd)
+        {
+            offset = segmentEnd;
+            continue;
+        }
+
+        if (recordLength < sizeof(ble_evt_hdr_t) || recordLength > EVENT_ENTRY_SIZE)
+        {
+            error = "Invalid record length";
+            return false;
+        }
+
+        const auto start = offset + EVENT_CAPTURE_RECORD_HEADER_SIZE;
+
+        // A capture that was not closed may end with a truncated record
+        if (start + recordLength > length)
+        {
+            return false;
+        }
+
+        if (!isReplayable(data + start, recordLength, error))
+        {
+            return false;
+        }
+
+        event = data + start;
+        eventLength = recordLength;
+        timestamp = readUint32(data + offset + 4) | (static_cast<uint64_t>(readUint32(data + offset + 8)) << 32);
+        offset = start + recordLength;
+        return true;
+    }
+
+    return false;
+}
+
+size_t ReplayReader::getOffset() const
+{
+    return offset;
+}
+
+TimedReplay::TimedReplay(v8::Local<v8::Object> stream, const uint8_t *data, const size_t length) :
+    buffer(stream),
+    reader(data, length),
+    start(0),
+    firstTimestamp(0),
+    replayed(0),
+    event(nullptr),
+    eventLength(0),
+    timestamp(0)
+{}
+
+TimedReplay::~TimedReplay()
+{
+    buffer.Reset();
+}
+
+#pragma endregion Replay reader
+
+#pragma region Synthetic events
+
+static const uint8_t syntheticAdvData[] = {
+    0x02, 0x01, 0x06,                          // Flags: LE General Discoverable, BR/EDR not supported
+    0x06, 0x09, 'B', 'e', 'n', 'c', 'h',       // Complete local name
+    0x05, 0xFF, 0x59, 0x00, 0x00, 0x00,        // Manufacturer specific data, Nordic Semiconductor
+};
+
+static const uint8_t SYNTHETIC_VALUE_LENGTH = 20;
+
+static void fillAdvReport(ble_evt_t *event, const uint32_t index)
+{
+    event->header.evt_id = BLE_GAP_EVT_ADV_REPORT;
+    event->evt.gap_evt.conn_handle = BLE_CONN_HANDLE_INVALID;
+
+    auto &report = event->evt.gap_evt.params.adv_report;
+    report.peer_addr.addr_type = BLE_GAP_ADDR_TYPE_RANDOM_STATIC;
+
+    // A few hundred different peers, as in a typical scanning environment
+    const auto peer = index % 256;
+    report.peer_addr.addr[0] = static_cast<uint8_t>(peer);
+    report.peer_addr.addr[5] = 0xC0;
+    report.rssi = static_cast<int8_t>(-40 - static_cast<int>(index % 50));
+    report.scan_rsp = 0;
+    report.type = BLE_GAP_ADV_TYPE_ADV_IND;
+    report.dlen = sizeof(syntheticAdvData);
+    memcpy(report.data, syntheticAdvData, sizeof(syntheticAdvData));
+
+    // Changing payload at the end of the manufacturer specific data
+    report.data[sizeof(syntheticAdvData) - 1] = static_cast<uint8_t>(index >> 8);
+    report.data[sizeof(syntheticAdvData) - 2] = static_cast<uint8_t>(index);
+}
+
+static void fillHvx(ble_evt_t *event, const uint32_t index)
+{
+    event->header.evt_id = BLE_GATTC_EVT_HVX;
+    event->evt.gattc_evt.conn_handle = 0;
+    event->evt.gattc_evt.gatt_status = BLE_GATT_STATUS_SUCCESS;
+    event->evt.gattc_evt.error_handle = BLE_GATT_HANDLE_INVALID;
+
+    auto &hvx = event->evt.gattc_evt.params.hvx;
+    hvx.handle = 0x000E;
+    hvx.type = BLE_GATT_HVX_NOTIFICATION;
+    hvx.len = SYNTHETIC_VALUE_LENGTH;
+
+    for (uint8_t i = 0; i < SYNTHETIC_VALUE_LENGTH; i++)
+    {
+        hvx.data[i] = static_cast<uint8_t>(index + i);
+    }
+}
+
+static void fillReadRsp(ble_evt_t *event, const uint32_t index)
+{
+    event->header.evt_id = BLE_GATTC_EVT_READ_RSP;
+    event->evt.gattc_evt.conn_handle = 0;
+    event->evt.gattc_evt.gatt_status = BLE_GATT_STATUS_SUCCESS;
+    event->evt.gattc_evt.error_handle = BLE_GATT_HANDLE_INVALID;
+
+    auto &readRsp = event->evt.gattc_evt.params.read_rsp;
+    readRsp.handle = 0x0010;
+    readRsp.offset = 0;
+    readRsp.len = SYNTHETIC_VALUE_LENGTH;
+
+    for (uint8_t i = 0; i < SYNTHETIC_VALUE_LENGTH; i++)
+    {
+        readRsp.data[i] = static_cast<uint8_t>(index + i);
+    }
+}
+
+static void fillAuthStatus(ble_evt_t *event, const uint32_t index)
+{
+    event->header.evt_id = BLE_GAP_EVT_AUTH_STATUS;
+    event->evt.gap_evt.conn_handle = static_cast<uint16_t>(index % 8);
+
+    auto &authStatus = event->evt.gap_evt.params.auth_status;
+    authStatus.auth_status = BLE_GAP_SEC_STATUS_SUCCESS;
+    authStatus.error_src = 0;
+    authStatus.bonded = 1;
+    authStatus.sm1_levels.lv1 = 1;
+    authStatus.sm1_levels.lv2 = 1;
+}
+
+// Creates a replay stream with count synthetic events of the given type, one of 'advReport',
+// 'hvx', 'readRsp' or 'authStatus'. The events are built with the SoftDevice structs the addon is
+// compiled with, so the stream matches the SoftDevice API version of the addon.
+NAN_METHOD(CreateSyntheticEvents)
+{
+    std::string type;
+    uint32_t count;
+    auto argumentcount = 0;
+
+    try
+    {
+        type = ConversionUtility::getNativeString(info[argumentcount]);
+        argumentcount++;
+
+        count = ConversionUtility::getNativeUint32(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        auto message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    void (*fill)(ble_evt_t *, const uint32_t) = nullptr;
+
+    if (type == "advReport")
+    {
+        fill = fillAdvReport;
+    }
+    else if (type == "hvx")
+    {
+        fill = fillHvx;
+    }
+    else if (type == "readRsp")
+    {
+        fill = fillReadRsp;
+    }
+    else if (type == "authStatus")
+    {
+        fill = fillAuthStatus;
+    }
+    else
+    {
+        auto message = ErrorMessage::getTypeErrorMessage(0, "one of 'advReport', 'hvx', 'readRsp' or 'authStatus'");
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    // Room for the variable length values at the end of HVX and read response events
+    const uint16_t eventSize = sizeof(ble_evt_t) + SYNTHETIC_VALUE_LENGTH;
+    static_assert(sizeof(ble_evt_t) + SYNTHETIC_VALUE_LENGTH <= EVENT_ENTRY_SIZE, "Synthetic events must fit in an event entry");
+
+    const size_t recordSize = REPLAY_RECORD_HEADER_SIZE + eventSize;
+    std::vector<uint8_t> stream(recordSize * count);
+    std::vector<uint8_t> eventData(EVENT_ENTRY_SIZE);
+    auto event = reinterpret_cast<ble_evt_t *>(eventData.data());
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        std::fill(eventData.begin(), eventData.end(), 0);
+        fill(event, i);
+        event->header.evt_len = eventSize;
+
+        auto record = &stream[i * recordSize];
+        record[0] = static_cast<uint8_t>(eventSize & 0xFF);
+        record[1] = static_cast<uint8_t>(eventSize >> 8);
+        memcpy(record + REPLAY_RECORD_HEADER_SIZE, eventData.data(), eventSize);
+    }
+
+    info.GetReturnValue().Set(Nan::CopyBuffer(reinterpret_cast<char *>(stream.data()), static_cast<uint32_t>(stream.size())).ToLocalChecked());
+}
+
+#pragma endregion Synthetic events
+
+extern "C" {
+    void init_replay(Nan::ADDON_REGISTER_FUNCTION_ARGS_TYPE target)
+    {
+        Utility::SetMethod(target, "createSyntheticEvents", CreateSyntheticEvents);
+    }
+}
@@ -0,0 +1,100 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DRIVER_REPLAY_H
+#define DRIVER_REPLAY_H
+
+#include <nan.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Replay streams are a sequence of records, each a little endian uint16_t length followed by
+// that many bytes of a ble_evt_t as received from the SoftDevice. They are queued by
+// Adapter::ReplayEvents with Adapter::pushEvent, without a serial port and without the driver
+// thread hooks of Adapter::appendEvent. Event captures, see EventCapture, can be replayed the same way.
+// Events with pointers are refused, except a LESC DHKey request followed by its peer key as in a capture.
+#define REPLAY_RECORD_HEADER_SIZE 2
+
+// Reads the events of a replay stream or an event capture, telling them apart by the header of the
+// capture. Events of plain replay streams have timestamp 0.
+class ReplayReader
+{
+public:
+    ReplayReader(const uint8_t *data, const size_t length);
+
+    // Returns false at the end of the data, with error set if it is not valid
+    bool next(const uint8_t *&event, size_t &eventLength, uint64_t &timestamp, std::string &error);
+
+    size_t getOffset() const;
+
+private:
+    const uint8_t *data;
+    size_t length;
+    size_t offset;
+    size_t segmentSize;
+    const bool capture;     // An event capture, not a plain replay stream
+};
+
+// A replay at the recorded speed, run from a timer in the NodeJS thread, see Adapter::ReplayEvents
+struct TimedReplay
+{
+    TimedReplay(v8::Local<v8::Object> stream, const uint8_t *data, const size_t length);
+    ~TimedReplay();
+
+    Nan::Persistent<v8::Object> buffer;     // Keeps the data alive
+    ReplayReader reader;
+    std::unique_ptr<Nan::Callback> doneCallback;
+    std::unique_ptr<uv_timer_t> timer;
+
+    uint64_t start;                         // Microseconds, uv_hrtime() based
+    uint64_t firstTimestamp;
+    uint32_t replayed;
+
+    // The next event, read but not yet due
+    const uint8_t *event;
+    size_t eventLength;
+    uint64_t timestamp;
+};
+
+NAN_METHOD(CreateSyntheticEvents);
+
+extern "C" {
+    void init_replay(Nan::ADDON_REGISTER_FUNCTION_ARGS_TYPE target);
+}
+
+#endif
@@ -37,17 +37,24 @@
 #include "driver_uecc.h"
 #include "uECC/uECC.h"
 #include "nrf_error.h"
+#include <atomic>
+#include <cstring>
+#include <deque>
 #include <iostream>
 #include <cstdlib>
+#include <mutex>
 #include <time.h>
 
 #include "common.h"
 
-#define ECC_P256_SK_LEN 32
-#define ECC_P256_PK_LEN 64
+// rand() is not thread safe, and keys are generated in the pool, the libuv thread pool and the
+// SoftDevice driver threads
+static std::mutex rngMutex;
 
 int rng(uint8_t *dest, unsigned size)
 {
+    std::lock_guard<std::mutex> lock(rngMutex);
+
     for (unsigned i = 0; i < size; ++i)
     {
         dest[i] = rand() % 256;
@@ -56,9 +63,7 @@ int rng(uint8_t *dest, unsigned size)
     return 1;
 }
 
-static uint8_t m_be_keys[ECC_P256_SK_LEN * 3];
-
-static void reverse(uint8_t* p_dst, uint8_t* p_src, uint32_t len)
+static void reverse(uint8_t* p_dst, const uint8_t* p_src, uint32_t len)
 {
     uint32_t i, j;
 
@@ -68,51 +73,355 @@ static void reverse(uint8_t* p_dst, uint8_t* p_src, uint32_t len)
     }
 }
 
-static bool isEccInitialized = false;
+// The random number generator is shared by all worker threads that load the addon
+static std::atomic<bool> isEccInitialized(false);
 
-NAN_METHOD(ECCInit)
+static void initEcc()
 {
-    if (!isEccInitialized)
+    if (!isEccInitialized.exchange(true))
     {
         srand ((unsigned int)time(NULL));
         uECC_set_rng(rng);
-        isEccInitialized = true;
     }
 }
 
-NAN_METHOD(ECCP256GenerateKeypair)
+bool eccGenerateKeypair(uint8_t *le_sk, uint8_t *le_pk)
 {
-    const struct uECC_Curve_t * p_curve;
+    uint8_t be_sk[ECC_P256_SK_LEN];
+    uint8_t be_pk[ECC_P256_PK_LEN];
 
-    uint8_t p_le_sk[ECC_P256_SK_LEN];   // Out
-    uint8_t p_le_pk[ECC_P256_PK_LEN];   // Out
+    initEcc();
 
-    p_curve = uECC_secp256r1();
-    int ret = uECC_make_key((uint8_t *)&m_be_keys[ECC_P256_SK_LEN], (uint8_t *)&m_be_keys[0], p_curve);
+    if (!uECC_make_key(be_pk, be_sk, uECC_secp256r1()))
+    {
+        return false;
+    }
 
-    if (!ret)
+    /* convert to little endian bytes, the public key in 2 passes */
+    reverse(le_sk, be_sk, ECC_P256_SK_LEN);
+    reverse(&le_pk[0], &be_pk[0], ECC_P256_SK_LEN);
+    reverse(&le_pk[ECC_P256_SK_LEN], &be_pk[ECC_P256_SK_LEN], ECC_P256_SK_LEN);
+
+    return true;
+}
+
+bool eccComputePublicKey(const uint8_t *le_sk, uint8_t *le_pk)
+{
+    uint8_t be_sk[ECC_P256_SK_LEN];
+    uint8_t be_pk[ECC_P256_PK_LEN];
+
+    reverse(be_sk, le_sk, ECC_P256_SK_LEN);
+
+    if (!uECC_compute_public_key(be_sk, be_pk, uECC_secp256r1()))
     {
-        Nan::ThrowTypeError("NRF_ERROR_INTERNAL");
-        return;
+        return false;
     }
 
-    /* convert to little endian bytes and store in p_le_sk */
-    reverse(&p_le_sk[0], &m_be_keys[0], ECC_P256_SK_LEN);
-    /* convert to little endian bytes in 2 passes, store in p_le_pk */
-    reverse(&p_le_pk[0], &m_be_keys[ECC_P256_SK_LEN], ECC_P256_SK_LEN);
-    reverse(&p_le_pk[ECC_P256_SK_LEN], &m_be_keys[ECC_P256_SK_LEN * 2], ECC_P256_SK_LEN);
+    reverse(&le_pk[0], &be_pk[0], ECC_P256_SK_LEN);
+    reverse(&le_pk[ECC_P256_SK_LEN], &be_pk[ECC_P256_SK_LEN], ECC_P256_SK_LEN);
 
+    return true;
+}
 
-    v8::Local<v8::Object> retObject = Nan::New<v8::Object>();
-    Utility::Set(retObject, "sk", ConversionUtility::toJsValueArray(p_le_sk, ECC_P256_SK_LEN));
-    Utility::Set(retObject, "pk", ConversionUtility::toJsValueArray(p_le_pk, ECC_P256_PK_LEN));
+bool eccComputeSharedSecret(const uint8_t *le_sk, const uint8_t *le_pk, uint8_t *le_ss)
+{
+    uint8_t be_sk[ECC_P256_SK_LEN];
+    uint8_t be_pk[ECC_P256_PK_LEN];
+    uint8_t be_ss[ECC_P256_SK_LEN];
 
-    info.GetReturnValue().Set(retObject);
+    initEcc();
+
+    /* convert to big endian bytes */
+    reverse(be_sk, le_sk, ECC_P256_SK_LEN);
+    reverse(&be_pk[0], &le_pk[0], ECC_P256_SK_LEN);
+    reverse(&be_pk[ECC_P256_SK_LEN], &le_pk[ECC_P256_SK_LEN], ECC_P256_SK_LEN);
+
+    if (!uECC_shared_secret(be_pk, be_sk, be_ss, uECC_secp256r1()))
+    {
+        return false;
+    }
+
+    reverse(le_ss, be_ss, ECC_P256_SK_LEN);
+
+    return true;
+}
+
+namespace {
+    struct EccKeypair
+    {
+        uint8_t sk[ECC_P256_SK_LEN];
+        uint8_t pk[ECC_P256_PK_LEN];
+    };
+
+    // Keypairs generated ahead of time in a background thread, shared by all adapters in the
+    // process. Taking a keypair is a copy, generating one takes a P-256 point multiplication.
+    class EccKeypairPool
+    {
+    public:
+        EccKeypairPool() : size(0), started(false), stopping(false)
+        {
+            if (uv_mutex_init(&mutex) != 0 || uv_cond_init(&refill) != 0)
+            {
+                std::cerr << "Not able to create the keypair pool! Terminating." << std::endl;
+                std::terminate();
+            }
+        }
+
+        ~EccKeypairPool()
+        {
+            uv_mutex_lock(&mutex);
+            stopping = true;
+            uv_cond_signal(&refill);
+            uv_mutex_unlock(&mutex);
+
+            if (started)
+            {
+                uv_thread_join(&thread);
+            }
+
+            uv_cond_destroy(&refill);
+            uv_mutex_destroy(&mutex);
+        }
+
+        void setSize(const size_t poolSize)
+        {
+            uv_mutex_lock(&mutex);
+            size = poolSize;
+
+            while (keypairs.size() > size)
+            {
+                keypairs.pop_back();
+            }
+
+            if (size > 0 && !started)
+            {
+                if (uv_thread_create(&thread, run, this) != 0)
+                {
+                    std::cerr << "Not able to create the keypair pool thread." << std::endl;
+                    std::terminate();
+                }
+
+                started = true;
+            }
+
+            uv_cond_signal(&refill);
+            uv_mutex_unlock(&mutex);
+        }
+
+        size_t getAvailable()
+        {
+            uv_mutex_lock(&mutex);
+            const auto available = keypairs.size();
+            uv_mutex_unlock(&mutex);
+            return available;
+        }
+
+        // Generates the keypair in the calling thread if the pool is empty
+        bool take(EccKeypair &keypair)
+        {
+            uv_mutex_lock(&mutex);
+            const auto available = !keypairs.empty();
+
+            if (available)
+            {
+                keypair = keypairs.front();
+                keypairs.pop_front();
+                uv_cond_signal(&refill);
+            }
+
+            uv_mutex_unlock(&mutex);
+
+            return available || eccGenerateKeypair(keypair.sk, keypair.pk);
+        }
+
+    private:
+        static void run(void *arg)
+        {
+            static_cast<EccKeypairPool *>(arg)->fill();
+        }
+
+        void fill()
+        {
+            uv_mutex_lock(&mutex);
+
+            while (!stopping)
+            {
+                if (keypairs.size() >= size)
+                {
+                    uv_cond_wait(&refill, &mutex);
+                    continue;
+                }
+
+                uv_mutex_unlock(&mutex);
+
+                EccKeypair keypair;
+                const auto generated = eccGenerateKeypair(keypair.sk, keypair.pk);
+
+                uv_mutex_lock(&mutex);
+
+                if (generated && keypairs.size() < size)
+                {
+                    keypairs.push_back(keypair);
+                }
+            }
+
+            uv_mutex_unlock(&mutex);
+        }
+
+        std::deque<EccKeypair> keypairs;
+        size_t size;
+        bool started;
+        bool stopping;
+        uv_mutex_t mutex;
+        uv_cond_t refill;
+        uv_thread_t thread;
+    };
+
+    EccKeypairPool &getKeypairPool()
+    {
+        static EccKeypairPool pool;
+        return pool;
+    }
+
+    // Reads a key of exactly length bytes, given as an array or a Buffer
+    void getKey(v8::Local<v8::Value> js, uint8_t *key, const size_t length)
+    {
+        const size_t jsLength = js->IsArrayBufferView()
+            ? Nan::TypedArrayContents<uint8_t>(js).length()
+            : (js->IsArray() ? v8::Local<v8::Array>::Cast(js)->Length() : 0);
+
+        if (jsLength != length)
+        {
+            throw std::string("array of ") + std::to_string(length) + " bytes";
+        }
+
+        auto native = ConversionUtility::getNativePointerToUint8(js);
+        memcpy(key, native, length);
+        free(native);
+    }
+
+    v8::Local<v8::Object> keypairToJs(const uint8_t *sk, const uint8_t *pk)
+    {
+        Nan::EscapableHandleScope scope;
+        v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+        Utility::Set(obj, "sk", ConversionUtility::toJsValueArray(sk, ECC_P256_SK_LEN));
+        Utility::Set(obj, "pk", ConversionUtility::toJsValueArray(pk, ECC_P256_PK_LEN));
+        return scope.Escape(obj);
+    }
+
+    struct EccBaton : public Baton
+    {
+    public:
+        BATON_CONSTRUCTOR(EccBaton);
+        uint8_t sk[ECC_P256_SK_LEN];
+        uint8_t pk[ECC_P256_PK_LEN];
+        uint8_t ss[ECC_P256_SK_LEN];
+        bool fromPool;
+    };
+
+    std::remove_pointer<uv_work_cb>::type generate_keypair;
+    void generate_keypair(uv_work_t *req)
+    {
+        auto baton = static_cast<EccBaton *>(req->data);
+        EccKeypair keypair;
+        auto generated = false;
+
+        if (baton->fromPool)
+        {
+            generated = getKeypairPool().take(keypair);
+        }
+        else
+        {
+            generated = eccGenerateKeypair(keypair.sk, keypair.pk);
+        }
+
+        memcpy(baton->sk, keypair.sk, ECC_P256_SK_LEN);
+        memcpy(baton->pk, keypair.pk, ECC_P256_PK_LEN);
+        baton->result = generated ? NRF_SUCCESS : NRF_ERROR_INTERNAL;
+    }
+
+    std::remove_pointer<uv_work_cb>::type compute_public_key;
+    void compute_public_key(uv_work_t *req)
+    {
+        auto baton = static_cast<EccBaton *>(req->data);
+        baton->result = eccComputePublicKey(baton->sk, baton->pk) ? NRF_SUCCESS : NRF_ERROR_INTERNAL;
+    }
+
+    std::remove_pointer<uv_work_cb>::type compute_shared_secret;
+    void compute_shared_secret(uv_work_t *req)
+    {
+        auto baton = static_cast<EccBaton *>(req->data);
+        baton->result = eccComputeSharedSecret(baton->sk, baton->pk, baton->ss) ? NRF_SUCCESS : NRF_ERROR_INTERNAL;
+    }
+
+    void callEccCallback(uv_work_t *req, const char *operation, const char *name)
+    {
+        Nan::HandleScope scope;
+        auto baton = static_cast<EccBaton *>(req->data);
+        v8::Local<v8::Value> argv[2];
+
+        if (baton->result != NRF_SUCCESS)
+        {
+            argv[0] = ErrorMessage::getErrorMessage(baton->result, operation);
+            argv[1] = Nan::Undefined();
+        }
+        else if (name == nullptr)
+        {
+            argv[0] = Nan::Undefined();
+            argv[1] = keypairToJs(baton->sk, baton->pk);
+        }
+        else
+        {
+            v8::Local<v8::Object> obj = Nan::New<v8::Object>();
+            const auto ss = std::strcmp(name, "ss") == 0;
+            Utility::Set(obj, name, ss ? ConversionUtility::toJsValueArray(baton->ss, ECC_P256_SK_LEN)
+                                       : ConversionUtility::toJsValueArray(baton->pk, ECC_P256_PK_LEN));
+            argv[0] = Nan::Undefined();
+            argv[1] = obj;
+        }
+
+        Nan::AsyncResource resource("pc-ble-driver-js:callback");
+        baton->callback->Call(2, argv, &resource);
+        delete baton;
+    }
+
+    void after_generate_keypair(uv_work_t *req, int)
+    {
+        callEccCallback(req, "generating keypair", nullptr);
+    }
+
+    void after_compute_public_key(uv_work_t *req, int)
+    {
+        callEccCallback(req, "computing public key", "pk");
+    }
+
+    void after_compute_shared_secret(uv_work_t *req, int)
+    {
+        callEccCallback(req, "computing shared secret", "ss");
+    }
+}
+
+NAN_METHOD(ECCInit)
+{
+    initEcc();
+}
+
+NAN_METHOD(ECCP256GenerateKeypair)
+{
+    uint8_t p_le_sk[ECC_P256_SK_LEN];   // Out
+    uint8_t p_le_pk[ECC_P256_PK_LEN];   // Out
+
+    if (!eccGenerateKeypair(p_le_sk, p_le_pk))
+    {
+        Nan::ThrowTypeError("NRF_ERROR_INTERNAL");
+        return;
+    }
+
+    info.GetReturnValue().Set(keypairToJs(p_le_sk, p_le_pk));
 }
 
 NAN_METHOD(ECCP256ComputePublicKey)
 {
-    const struct uECC_Curve_t * p_curve;
     uint8_t *p_le_sk;   // In
     uint8_t p_le_pk[ECC_P256_PK_LEN];   // Out
     auto argumentcount = 0;
@@ -135,24 +444,15 @@ NAN_METHOD(ECCP256ComputePublicKey)
         return;
     }
 
-    p_curve = uECC_secp256r1();
-
-    reverse(&m_be_keys[0], (uint8_t *)p_le_sk, ECC_P256_SK_LEN);
+    const auto ret = eccComputePublicKey(p_le_sk, p_le_pk);
     free(p_le_sk);
 
-    //int ret = uECC_compute_public_key(p_le_sk, (uint8_t *)p_le_pk, p_curve);
-    int ret = uECC_compute_public_key((uint8_t *)&m_be_keys[0], (uint8_t *)&m_be_keys[ECC_P256_SK_LEN], p_curve);
-
     if (!ret)
     {
         Nan::ThrowTypeError("NRF_ERROR_INTERNAL");
         return;
     }
 
-    /* convert to little endian bytes in 2 passes, store in m_be_keys */
-    reverse(&p_le_pk[0], &m_be_keys[ECC_P256_SK_LEN], ECC_P256_SK_LEN);
-    reverse(&p_le_pk[ECC_P256_SK_LEN], &m_be_keys[ECC_P256_SK_LEN * 2], ECC_P256_SK_LEN);
-
     v8::Local<v8::Object> retObject = Nan::New<v8::Object>();
     Utility::Set(retObject, "pk", ConversionUtility::toJsValueArray(p_le_pk, ECC_P256_PK_LEN));
 
@@ -161,7 +461,6 @@ NAN_METHOD(ECCP256ComputePublicKey)
 
 NAN_METHOD(ECCP256ComputeSharedSecret)
 {
-    const struct uECC_Curve_t * p_curve;
     uint8_t *p_le_sk;  // In
     uint8_t *p_le_pk;  // In
     uint8_t p_le_ss[ECC_P256_SK_LEN];  // Out
@@ -180,36 +479,139 @@ NAN_METHOD(ECCP256ComputeSharedSecret)
         return;
     }
 
-    p_curve = uECC_secp256r1();
-
-    /* convert to big endian bytes and store in m_be_keys */
-    reverse(&m_be_keys[0], (uint8_t *)p_le_sk, ECC_P256_SK_LEN);
-    reverse(&m_be_keys[ECC_P256_SK_LEN], (uint8_t *)&p_le_pk[0], ECC_P256_SK_LEN);
-    reverse(&m_be_keys[ECC_P256_SK_LEN * 2], (uint8_t *)&p_le_pk[ECC_P256_SK_LEN], ECC_P256_SK_LEN);
+    const auto ret = eccComputeSharedSecret(p_le_sk, p_le_pk, p_le_ss);
 
     free(p_le_sk);
     free(p_le_pk);
 
-    int ret = uECC_shared_secret((uint8_t *)&m_be_keys[ECC_P256_SK_LEN], (uint8_t *)&m_be_keys[0], p_le_ss, p_curve);
-
     if (!ret)
     {
         Nan::ThrowTypeError("NRF_ERROR_INTERNAL");
         return;
     }
 
-    /* convert to little endian bytes and store in m_be_keys */
-    reverse(&m_be_keys[0], &p_le_ss[0], ECC_P256_SK_LEN);
-
-    /* copy back the little endian bytes to p_le_pk */
-    memcpy(p_le_ss, m_be_keys, ECC_P256_SK_LEN);
-
     v8::Local<v8::Object> retObject = Nan::New<v8::Object>();
     Utility::Set(retObject, "ss", ConversionUtility::toJsValueArray(p_le_ss, ECC_P256_SK_LEN));
 
     info.GetReturnValue().Set(retObject);
 }
 
+NAN_METHOD(ECCSetKeypairPoolSize)
+{
+    uint32_t size;
+
+    try
+    {
+        size = ConversionUtility::getNativeUint32(info[0]);
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(0, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    getKeypairPool().setSize(size);
+}
+
+NAN_METHOD(ECCGetKeypairPoolAvailable)
+{
+    info.GetReturnValue().Set(static_cast<uint32_t>(getKeypairPool().getAvailable()));
+}
+
+NAN_METHOD(ECCTakeKeypair)
+{
+    EccKeypair keypair;
+
+    if (!getKeypairPool().take(keypair))
+    {
+        Nan::ThrowTypeError("NRF_ERROR_INTERNAL");
+        return;
+    }
+
+    info.GetReturnValue().Set(keypairToJs(keypair.sk, keypair.pk));
+}
+
+NAN_METHOD(ECCP256GenerateKeypairAsync)
+{
+    v8::Local<v8::Function> callback;
+
+    try
+    {
+        callback = ConversionUtility::getCallbackFunction(info[0]);
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(0, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto baton = new EccBaton(callback);
+    baton->fromPool = true;
+
+    uv_queue_work(Nan::GetCurrentEventLoop(), baton->req, generate_keypair, after_generate_keypair);
+}
+
+NAN_METHOD(ECCP256ComputePublicKeyAsync)
+{
+    uint8_t sk[ECC_P256_SK_LEN];
+    v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
+
+    try
+    {
+        getKey(info[argumentcount], sk, ECC_P256_SK_LEN);
+        argumentcount++;
+
+        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto baton = new EccBaton(callback);
+    memcpy(baton->sk, sk, ECC_P256_SK_LEN);
+
+    uv_queue_work(Nan::GetCurrentEventLoop(), baton->req, compute_public_key, after_compute_public_key);
+}
+
+NAN_METHOD(ECCP256ComputeSharedSecretAsync)
+{
+    uint8_t sk[ECC_P256_SK_LEN];
+    uint8_t pk[ECC_P256_PK_LEN];
+    v8::Local<v8::Function> callback;
+    auto argumentcount = 0;
+
+    try
+    {
+        getKey(info[argumentcount], sk, ECC_P256_SK_LEN);
+        argumentcount++;
+
+        getKey(info[argumentcount], pk, ECC_P256_PK_LEN);
+        argumentcount++;
+
+        callback = ConversionUtility::getCallbackFunction(info[argumentcount]);
+        argumentcount++;
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(argumentcount, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto baton = new EccBaton(callback);
+    memcpy(baton->sk, sk, ECC_P256_SK_LEN);
+    memcpy(baton->pk, pk, ECC_P256_PK_LEN);
+
+    uv_queue_work(Nan::GetCurrentEventLoop(), baton->req, compute_shared_secret, after_compute_shared_secret);
+}
+
 extern "C" {
     void init_uecc(Nan::ADDON_REGISTER_FUNCTION_ARGS_TYPE target)
     {
@@ -217,5 +619,11 @@ extern "C" {
         Utility::SetMethod(target, "eccGenerateKeypair", ECCP256GenerateKeypair);
         Utility::SetMethod(target, "eccComputePublicKey", ECCP256ComputePublicKey);
         Utility::SetMethod(target, "eccComputeSharedSecret", ECCP256ComputeSharedSecret);
+        Utility::SetMethod(target, "eccGenerateKeypairAsync", ECCP256GenerateKeypairAsync);
+        Utility::SetMethod(target, "eccComputePublicKeyAsync", ECCP256ComputePublicKeyAsync);
+        Utility::SetMethod(target, "eccComputeSharedSecretAsync", ECCP256ComputeSharedSecretAsync);
+        Utility::SetMethod(target, "eccSetKeypairPoolSize", ECCSetKeypairPoolSize);
+        Utility::SetMethod(target, "eccGetKeypairPoolAvailable", ECCGetKeypairPoolAvailable);
+        Utility::SetMethod(target, "eccTakeKeypair", ECCTakeKeypair);
     }
 }
@@ -38,11 +38,26 @@
 #define DRIVER_UECC_H
 
 #include <nan.h>
+#include <cstdint>
+
+#define ECC_P256_SK_LEN 32
+#define ECC_P256_PK_LEN 64
+
+// P-256 operations on little endian keys, as used by the SoftDevice. Thread safe.
+bool eccGenerateKeypair(uint8_t *le_sk, uint8_t *le_pk);
+bool eccComputePublicKey(const uint8_t *le_sk, uint8_t *le_pk);
+bool eccComputeSharedSecret(const uint8_t *le_sk, const uint8_t *le_pk, uint8_t *le_ss);
 
 NAN_METHOD(ECCInit);
 NAN_METHOD(ECCP256GenerateKeypair);
 NAN_METHOD(ECCP256ComputePublicKey);
 NAN_METHOD(ECCP256ComputeSharedSecret);
+NAN_METHOD(ECCP256GenerateKeypairAsync);
+NAN_METHOD(ECCP256ComputePublicKeyAsync);
+NAN_METHOD(ECCP256ComputeSharedSecretAsync);
+NAN_METHOD(ECCSetKeypairPoolSize);
+NAN_METHOD(ECCGetKeypairPoolAvailable);
+NAN_METHOD(ECCTakeKeypair);
 
 extern "C" {
     void init_uecc(Nan::ADDON_REGISTER_FUNCTION_ARGS_TYPE target);
@@ -0,0 +1,301 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "event_capture.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+const char EVENT_CAPTURE_MAGIC[] = { 'P', 'B', 'E', 'C' };
+const uint16_t EVENT_CAPTURE_VERSION = 1;
+
+void putUint16(uint8_t *data, const uint16_t value)
+{
+    data[0] = static_cast<uint8_t>(value);
+    data[1] = static_cast<uint8_t>(value >> 8);
+}
+
+void putUint32(uint8_t *data, const uint32_t value)
+{
+    putUint16(data, static_cast<uint16_t>(value));
+    putUint16(data + 2, static_cast<uint16_t>(value >> 16));
+}
+
+void putUint64(uint8_t *data, const uint64_t value)
+{
+    putUint32(data, static_cast<uint32_t>(value));
+    putUint32(data + 4, static_cast<uint32_t>(value >> 32));
+}
+}
+
+EventCapture::EventCapture() :
+    active(false),
+#ifdef _WIN32
+    file(INVALID_HANDLE_VALUE),
+    mapping(nullptr),
+#else
+    file(-1),
+#endif
+    segment(nullptr),
+    segmentOffset(0),
+    segmentSize(0),
+    position(0),
+    recordCount(0),
+    droppedCount(0)
+{
+    if (uv_mutex_init(&mutex) != 0)
+    {
+        std::cerr << "Not able to create event capture mutex! Terminating." << std::endl;
+        std::terminate();
+    }
+}
+
+EventCapture::~EventCapture()
+{
+    close();
+    uv_mutex_destroy(&mutex);
+}
+
+void EventCapture::open(const std::string &path, const size_t segmentSize, const uint16_t apiVersion)
+{
+    close();
+
+    if (segmentSize == 0 || segmentSize % EVENT_CAPTURE_SEGMENT_ALIGNMENT != 0)
+    {
+        throw std::string("multiple of 1048576 bytes");
+    }
+
+    uv_mutex_lock(&mutex);
+
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                       CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    const auto opened = file != INVALID_HANDLE_VALUE;
+#else
+    file = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    const auto opened = file >= 0;
+#endif
+
+    this->segmentSize = segmentSize;
+
+    if (!opened || !mapSegment(0))
+    {
+        uv_mutex_unlock(&mutex);
+        close();
+        throw std::string("path of a writable file, not able to map ") + path;
+    }
+
+    memcpy(segment, EVENT_CAPTURE_MAGIC, sizeof(EVENT_CAPTURE_MAGIC));
+    putUint16(segment + 4, EVENT_CAPTURE_VERSION);
+    putUint16(segment + 6, apiVersion);
+    putUint32(segment + 8, static_cast<uint32_t>(segmentSize));
+    putUint32(segment + 12, 0);
+    position = EVENT_CAPTURE_HEADER_SIZE;
+
+    recordCount = 0;
+    droppedCount = 0;
+    active = true;
+
+    uv_mutex_unlock(&mutex);
+}
+
+void EventCapture::close()
+{
+    uv_mutex_lock(&mutex);
+
+    active = false;
+    const auto end = segmentOffset + position;
+    unmapSegment();
+
+#ifdef _WIN32
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER size;
+        size.QuadPart = static_cast<LONGLONG>(end);
+        SetFilePointerEx(file, size, nullptr, FILE_BEGIN);
+        SetEndOfFile(file);
+        CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (file >= 0)
+    {
+        if (ftruncate(file, static_cast<off_t>(end)) != 0)
+        {
+            std::cerr << "Not able to truncate the event capture file." << std::endl;
+        }
+
+        ::close(file);
+        file = -1;
+    }
+#endif
+
+    segmentOffset = 0;
+    position = 0;
+
+    uv_mutex_unlock(&mutex);
+}
+
+bool EventCapture::isOpen() const
+{
+    return active;
+}
+
+void EventCapture::write(const uint16_t adapterId, const uint64_t timestamp, const void *event, const uint16_t length)
+{
+    const auto recordSize = EVENT_CAPTURE_RECORD_HEADER_SIZE + length;
+
+    uv_mutex_lock(&mutex);
+
+    if (!active)
+    {
+        uv_mutex_unlock(&mutex);
+        return;
+    }
+
+    if (segment != nullptr && position + recordSize > segmentSize)
+    {
+        // The rest of the segment is left zero, which a reader takes as a jump to the next one
+        const auto next = segmentOffset + segmentSize;
+        unmapSegment();
+
+        // If it fails, the file ends at the last record and later records are dropped
+        if (!mapSegment(next))
+        {
+            std::cerr << "Not able to grow the event capture file, events are no longer captured." << std::endl;
+        }
+    }
+
+    if (segment == nullptr || recordSize > segmentSize)
+    {
+        ++droppedCount;
+        uv_mutex_unlock(&mutex);
+        return;
+    }
+
+    auto record = segment + position;
+    putUint16(record, length);
+    putUint16(record + 2, adapterId);
+    putUint64(record + 4, timestamp);
+    memcpy(record + EVENT_CAPTURE_RECORD_HEADER_SIZE, event, length);
+
+    position += recordSize;
+    ++recordCount;
+
+    uv_mutex_unlock(&mutex);
+}
+
+uint32_t EventCapture::getRecordCount() const
+{
+    return recordCount;
+}
+
+uint32_t EventCapture::getDroppedCount() const
+{
+    return droppedCount;
+}
+
+// Grows the file to the end of the segment at offset and maps it. Called while holding the mutex.
+bool EventCapture::mapSegment(const uint64_t offset)
+{
+    const auto fileSize = offset + segmentSize;
+
+#ifdef _WIN32
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(fileSize >> 32),
+                                 static_cast<DWORD>(fileSize), nullptr);
+
+    if (mapping == nullptr)
+    {
+        return false;
+    }
+
+    auto view = MapViewOfFile(mapping, FILE_MAP_WRITE, static_cast<DWORD>(offset >> 32),
+                              static_cast<DWORD>(offset), segmentSize);
+
+    if (view == nullptr)
+    {
+        CloseHandle(mapping);
+        mapping = nullptr;
+        return false;
+    }
+#else
+    if (ftruncate(file, static_cast<off_t>(fileSize)) != 0)
+    {
+        return false;
+    }
+
+    auto view = mmap(nullptr, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, file, static_cast<off_t>(offset));
+
+    if (view == MAP_FAILED)
+    {
+        return false;
+    }
+#endif
+
+    segment = static_cast<uint8_t *>(view);
+    segmentOffset = offset;
+    position = 0;
+    return true;
+}
+
+// Called while holding the mutex
+void EventCapture::unmapSegment()
+{
+    if (segment == nullptr)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(segment);
+    CloseHandle(mapping);
+    mapping = nullptr;
+#else
+    munmap(segment, segmentSize);
+#endif
+
+    segment = nullptr;
+}
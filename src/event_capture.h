@@ -0,0 +1,123 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EVENT_CAPTURE_H
+#define EVENT_CAPTURE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <uv.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Default size of the segments a capture file grows by, a multiple of EVENT_CAPTURE_SEGMENT_ALIGNMENT
+const size_t EVENT_CAPTURE_SEGMENT_SIZE = 16 * 1024 * 1024;
+
+// Segments start at multiples of this, which is a multiple of any page size and the Windows
+// allocation granularity
+const size_t EVENT_CAPTURE_SEGMENT_ALIGNMENT = 1024 * 1024;
+
+const size_t EVENT_CAPTURE_HEADER_SIZE = 16;
+const size_t EVENT_CAPTURE_RECORD_HEADER_SIZE = 12;
+
+// Appends the raw events received from the SoftDevice to a capture file, which is written through
+// memory mapped segments so a record costs a memcpy. The format is:
+//
+//   header: "PBEC", uint16 version (1), uint16 SoftDevice API version, uint32 segment size,
+//           uint32 reserved
+//   record: uint16 event length, uint16 adapter id, uint64 timestamp (microseconds, see
+//           getMonotonicTimeInMicroseconds()), event length bytes of the ble_evt_t
+//
+// The peer key a BLE_GAP_EVT_LESC_DHKEY_REQUEST points to is written after the ble_evt_t, and the
+// event length includes it. Other events are written as received.
+//
+// All integers are little endian. Records do not cross segment boundaries, the rest of a segment is
+// left zero, and a record length of 0 means the next record starts at the next segment. The file is
+// truncated to the last record when the capture is closed; if the process stops before that, the
+// rest of the last segment is zero.
+//
+// write() is called from the SoftDevice driver thread, the other methods from the NodeJS thread.
+class EventCapture
+{
+public:
+    EventCapture();
+    ~EventCapture();
+
+    EventCapture(const EventCapture &) = delete;
+    EventCapture &operator=(const EventCapture &) = delete;
+
+    // Truncates the file at path. Throws std::string if it can not be opened or mapped.
+    void open(const std::string &path, const size_t segmentSize, const uint16_t apiVersion);
+    void close();
+
+    // Lock free, so appending events is not slowed down when there is no capture
+    bool isOpen() const;
+
+    void write(const uint16_t adapterId, const uint64_t timestamp, const void *event, const uint16_t length);
+
+    uint32_t getRecordCount() const;
+    // Records not written because the file could not grow
+    uint32_t getDroppedCount() const;
+
+private:
+    bool mapSegment(const uint64_t offset);
+    void unmapSegment();
+
+    uv_mutex_t mutex;
+    std::atomic<bool> active;
+
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int file;
+#endif
+
+    uint8_t *segment;           // Mapped segment, nullptr if none
+    uint64_t segmentOffset;     // Offset of the mapped segment in the file
+    size_t segmentSize;
+    size_t position;            // Next record in the mapped segment
+
+    std::atomic<uint32_t> recordCount;
+    std::atomic<uint32_t> droppedCount;
+};
+
+#endif // EVENT_CAPTURE_H
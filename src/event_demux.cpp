@@ -0,0 +1,143 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+
+#include "event_demux.h"
+
+#include "sd_rpc.h"
+
+EventDemux::EventDemux() :
+    count(0),
+    connectionLimit(0),
+    nextLane(0)
+{}
+
+void EventDemux::reset(const size_t limit)
+{
+    lanes.clear();
+    count = 0;
+    connectionLimit = limit;
+    nextLane = 0;
+}
+
+void EventDemux::add(EventEntry *eventEntry, const uint16_t connHandle)
+{
+    // There are only a few connections, a linear search is faster than a map
+    auto lane = std::find_if(lanes.begin(), lanes.end(), [connHandle](const Lane &candidate) {
+        return candidate.connHandle == connHandle;
+    });
+
+    if (lane == lanes.end())
+    {
+        lanes.push_back(Lane());
+        lane = lanes.end() - 1;
+        lane->connHandle = connHandle;
+    }
+
+    lane->events.push_back(eventEntry);
+    count++;
+}
+
+void EventDemux::take(std::vector<EventEntry *> &batch)
+{
+    batch.clear();
+
+    if (lanes.empty())
+    {
+        return;
+    }
+
+    for (auto &lane : lanes)
+    {
+        lane.taken = 0;
+    }
+
+    auto progress = true;
+
+    while (progress)
+    {
+        progress = false;
+
+        for (size_t i = 0; i < lanes.size(); i++)
+        {
+            auto &lane = lanes[(nextLane + i) % lanes.size()];
+
+            if (lane.events.empty() || (connectionLimit != 0 && lane.taken >= connectionLimit))
+            {
+                continue;
+            }
+
+            batch.push_back(lane.events.front());
+            lane.events.pop_front();
+            lane.taken++;
+            progress = true;
+        }
+    }
+
+    count -= batch.size();
+    nextLane = (nextLane + 1) % lanes.size();
+
+    lanes.erase(std::remove_if(lanes.begin(), lanes.end(), [](const Lane &lane) {
+        return lane.events.empty();
+    }), lanes.end());
+
+    if (nextLane >= lanes.size())
+    {
+        nextLane = 0;
+    }
+}
+
+void EventDemux::removeConnections(std::vector<EventEntry *> &removed)
+{
+    for (auto &lane : lanes)
+    {
+        if (lane.connHandle == BLE_CONN_HANDLE_INVALID)
+        {
+            continue;
+        }
+
+        removed.insert(removed.end(), lane.events.begin(), lane.events.end());
+        count -= lane.events.size();
+        lane.events.clear();
+    }
+
+    lanes.erase(std::remove_if(lanes.begin(), lanes.end(), [](const Lane &lane) {
+        return lane.events.empty();
+    }), lanes.end());
+
+    nextLane = 0;
+}
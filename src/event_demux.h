@@ -0,0 +1,89 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EVENT_DEMUX_H
+#define EVENT_DEMUX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+struct EventEntry;
+
+// Splits the events taken from the event queue by connection, so that one busy connection can
+// not hold back the events of the others. Each batch takes events round robin over the
+// connections, and at most the connection limit from each. The rest is kept for the next
+// batch. The order of the events of a connection is kept. Only used in the NodeJS thread.
+class EventDemux
+{
+public:
+    EventDemux();
+    EventDemux(const EventDemux &) = delete;
+    EventDemux &operator=(const EventDemux &) = delete;
+
+    // Drops all events and sets the most events taken from one connection in each batch
+    void reset(const size_t connectionLimit);
+
+    void add(EventEntry *eventEntry, const uint16_t connHandle);
+
+    // Replaces the content of batch with the events of the next batch
+    void take(std::vector<EventEntry *> &batch);
+
+    // Appends the events of the connections to removed and drops them, the events that are not
+    // for a connection are kept
+    void removeConnections(std::vector<EventEntry *> &removed);
+
+    // Number of events waiting for a later batch
+    size_t size() const { return count; }
+
+private:
+    struct Lane
+    {
+        uint16_t connHandle;
+        size_t taken; // Events taken in the batch being built
+        std::deque<EventEntry *> events;
+    };
+
+    std::vector<Lane> lanes;
+    size_t count;
+    size_t connectionLimit;
+
+    // The lane that goes first in the next batch, so no connection always comes first
+    size_t nextLane;
+};
+
+#endif // EVENT_DEMUX_H
@@ -0,0 +1,156 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "event_dispatch.h"
+#include "driver.h"
+#include "driver_gap.h"
+#include "driver_gattc.h"
+#include "driver_gatts.h"
+
+// Type and offset in ble_evt_t of the parameters of an event
+#define EVENT_PARAMS(member) decltype(std::declval<ble_evt_t>().evt.member), offsetof(ble_evt_t, evt.member)
+
+#define COMMON_EVENT(evt_enum, evt_to_js, params_name) \
+    { BLE_EVT_##evt_enum, "BLE_EVT_" #evt_enum, &EventConverters::convertCommonEvent<Common##evt_to_js##Event, EVENT_PARAMS(common_evt.params.params_name)> }
+
+#define GAP_EVENT(evt_enum, evt_to_js, params_name) \
+    { BLE_GAP_EVT_##evt_enum, "BLE_GAP_EVT_" #evt_enum, &EventConverters::convertGapEvent<Gap##evt_to_js, EVENT_PARAMS(gap_evt.params.params_name)> }
+
+#define GATTC_EVENT(evt_enum, evt_to_js, params_name) \
+    { BLE_GATTC_EVT_##evt_enum, "BLE_GATTC_EVT_" #evt_enum, &EventConverters::convertGattcEvent<Gattc##evt_to_js##Event, EVENT_PARAMS(gattc_evt.params.params_name)> }
+
+#define GATTS_EVENT(evt_enum, evt_to_js, params_name) \
+    { BLE_GATTS_EVT_##evt_enum, "BLE_GATTS_EVT_" #evt_enum, &EventConverters::convertGattsEvent<Gatts##evt_to_js##Event, EVENT_PARAMS(gatts_evt.params.params_name)> }
+
+namespace
+{
+    constexpr EventDescriptor eventDescriptors[] =
+    {
+        COMMON_EVENT(USER_MEM_REQUEST,          MemRequest,             user_mem_request),
+        COMMON_EVENT(USER_MEM_RELEASE,          MemRelease,             user_mem_release),
+#if NRF_SD_BLE_API_VERSION <= 3
+        COMMON_EVENT(TX_COMPLETE,               TXComplete,             tx_complete),
+#endif
+
+        GAP_EVENT(CONNECTED,                    Connected,              connected),
+        GAP_EVENT(DISCONNECTED,                 Disconnected,           disconnected),
+        GAP_EVENT(CONN_PARAM_UPDATE,            ConnParamUpdate,        conn_param_update),
+        GAP_EVENT(SEC_PARAMS_REQUEST,           SecParamsRequest,       sec_params_request),
+        GAP_EVENT(SEC_INFO_REQUEST,             SecInfoRequest,         sec_info_request),
+        GAP_EVENT(PASSKEY_DISPLAY,              PasskeyDisplay,         passkey_display),
+        GAP_EVENT(KEY_PRESSED,                  KeyPressed,             key_pressed),
+        GAP_EVENT(AUTH_KEY_REQUEST,             AuthKeyRequest,         auth_key_request),
+        GAP_EVENT(LESC_DHKEY_REQUEST,           LESCDHKeyRequest,       lesc_dhkey_request),
+        GAP_EVENT(AUTH_STATUS,                  AuthStatus,             auth_status),
+        GAP_EVENT(CONN_SEC_UPDATE,              ConnSecUpdate,          conn_sec_update),
+        GAP_EVENT(TIMEOUT,                      Timeout,                timeout),
+        GAP_EVENT(RSSI_CHANGED,                 RssiChanged,            rssi_changed),
+        GAP_EVENT(ADV_REPORT,                   AdvReport,              adv_report),
+        GAP_EVENT(SEC_REQUEST,                  SecRequest,             sec_request),
+        GAP_EVENT(CONN_PARAM_UPDATE_REQUEST,    ConnParamUpdateRequest, conn_param_update_request),
+        GAP_EVENT(SCAN_REQ_REPORT,              ScanReqReport,          scan_req_report),
+#if NRF_SD_BLE_API_VERSION >= 5
+        GAP_EVENT(DATA_LENGTH_UPDATE_REQUEST,   DataLengthUpdateRequest, data_length_update_request),
+        GAP_EVENT(DATA_LENGTH_UPDATE,           DataLengthUpdateEvt,    data_length_update),
+        GAP_EVENT(PHY_UPDATE_REQUEST,           PhyUpdateRequest,       phy_update_request),
+        GAP_EVENT(PHY_UPDATE,                   PhyUpdateEvt,           phy_update),
+#endif
+
+        GATTC_EVENT(PRIM_SRVC_DISC_RSP,         PrimaryServiceDiscovery,       prim_srvc_disc_rsp),
+        GATTC_EVENT(REL_DISC_RSP,               RelationshipDiscovery,         rel_disc_rsp),
+        GATTC_EVENT(CHAR_DISC_RSP,              CharacteristicDiscovery,       char_disc_rsp),
+        GATTC_EVENT(DESC_DISC_RSP,              DescriptorDiscovery,           desc_disc_rsp),
+        GATTC_EVENT(CHAR_VAL_BY_UUID_READ_RSP,  CharacteristicValueReadByUUID, char_val_by_uuid_read_rsp),
+        GATTC_EVENT(READ_RSP,                   Read,                          read_rsp),
+        GATTC_EVENT(CHAR_VALS_READ_RSP,         CharacteristicValueRead,       char_vals_read_rsp),
+        GATTC_EVENT(WRITE_RSP,                  Write,                         write_rsp),
+        GATTC_EVENT(HVX,                        HandleValueNotification,       hvx),
+        GATTC_EVENT(TIMEOUT,                    Timeout,                       timeout),
+#if NRF_SD_BLE_API_VERSION >= 5
+        GATTC_EVENT(EXCHANGE_MTU_RSP,           ExchangeMtuResponse,           exchange_mtu_rsp),
+        GATTC_EVENT(WRITE_CMD_TX_COMPLETE,      WriteCmdTxComplete,            write_cmd_tx_complete),
+#endif
+
+        GATTS_EVENT(WRITE,                      Write,                  write),
+        GATTS_EVENT(RW_AUTHORIZE_REQUEST,       RWAuthorizeRequest,     authorize_request),
+        GATTS_EVENT(SYS_ATTR_MISSING,           SystemAttributeMissing, sys_attr_missing),
+        GATTS_EVENT(HVC,                        HVC,                    hvc),
+        GATTS_EVENT(TIMEOUT,                    Timeout,                timeout),
+#if NRF_SD_BLE_API_VERSION >= 5
+        GATTS_EVENT(EXCHANGE_MTU_REQUEST,       ExchangeMtuRequest,     exchange_mtu_request),
+        GATTS_EVENT(HVN_TX_COMPLETE,            HvnTxComplete,          hvn_tx_complete),
+#endif
+
+        // There is no parameter for this in the event struct, the converter does not use it
+        GATTS_EVENT(SC_CONFIRM,                 SCConfirm,              timeout)
+    };
+
+    // The descriptors indexed by event id
+    struct EventDescriptorTable
+    {
+        const EventDescriptor *descriptors[EVENT_DESCRIPTOR_COUNT];
+    };
+
+    constexpr EventDescriptorTable buildEventDescriptorTable()
+    {
+        EventDescriptorTable table {};
+
+        for (const auto &descriptor : eventDescriptors)
+        {
+            table.descriptors[descriptor.id] = &descriptor;
+        }
+
+        return table;
+    }
+
+    constexpr EventDescriptorTable eventDescriptorTable = buildEventDescriptorTable();
+}
+
+const EventDescriptor *findEventDescriptor(const uint16_t id)
+{
+    if (id >= EVENT_DESCRIPTOR_COUNT)
+    {
+        return nullptr;
+    }
+
+    return eventDescriptorTable.descriptors[id];
+}
+
+const char *findEventName(const uint16_t id)
+{
+    const auto descriptor = findEventDescriptor(id);
+    return descriptor != nullptr ? descriptor->name : nullptr;
+}
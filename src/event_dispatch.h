@@ -0,0 +1,104 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EVENT_DISPATCH_H
+#define EVENT_DISPATCH_H
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "common.h"
+
+// Event ids below this have a slot in the dispatch table and the subscription mask. All
+// SoftDevice event ids are below it.
+#define EVENT_DESCRIPTOR_COUNT 0x100
+
+// Converts the parameters of a SoftDevice event to the JavaScript event object
+typedef v8::Local<v8::Object> (*EventConverter)(ble_evt_t *event, const EventTime &timestamp);
+
+// Everything the NodeJS thread needs to know about an event id to pass it on to JavaScript
+struct EventDescriptor
+{
+    uint16_t id;
+    const char *name;
+    EventConverter convert;
+};
+
+typedef std::bitset<EVENT_DESCRIPTOR_COUNT> EventSubscription;
+
+// Returns nullptr if the event id is not known
+const EventDescriptor *findEventDescriptor(const uint16_t id);
+
+// Converters for the four kinds of SoftDevice events, one instance per event type. JsEvent is
+// the BleDriverEvent class of the event, constructed on the stack and converted right away.
+// Params is the parameter struct at paramsOffset in ble_evt_t.
+namespace EventConverters
+{
+    template<typename Params, size_t paramsOffset>
+    Params *getParams(ble_evt_t *event)
+    {
+        return reinterpret_cast<Params *>(reinterpret_cast<uint8_t *>(event) + paramsOffset);
+    }
+
+    template<typename JsEvent, typename Params, size_t paramsOffset>
+    v8::Local<v8::Object> convertCommonEvent(ble_evt_t *event, const EventTime &timestamp)
+    {
+        return JsEvent(timestamp, event->evt.common_evt.conn_handle, getParams<Params, paramsOffset>(event)).ToJs();
+    }
+
+    template<typename JsEvent, typename Params, size_t paramsOffset>
+    v8::Local<v8::Object> convertGapEvent(ble_evt_t *event, const EventTime &timestamp)
+    {
+        return JsEvent(timestamp, event->evt.gap_evt.conn_handle, getParams<Params, paramsOffset>(event)).ToJs();
+    }
+
+    template<typename JsEvent, typename Params, size_t paramsOffset>
+    v8::Local<v8::Object> convertGattcEvent(ble_evt_t *event, const EventTime &timestamp)
+    {
+        const auto &gattcEvent = event->evt.gattc_evt;
+        return JsEvent(timestamp, gattcEvent.conn_handle, gattcEvent.gatt_status, gattcEvent.error_handle, getParams<Params, paramsOffset>(event)).ToJs();
+    }
+
+    template<typename JsEvent, typename Params, size_t paramsOffset>
+    v8::Local<v8::Object> convertGattsEvent(ble_evt_t *event, const EventTime &timestamp)
+    {
+        return JsEvent(timestamp, event->evt.gatts_evt.conn_handle, getParams<Params, paramsOffset>(event)).ToJs();
+    }
+}
+
+#endif // EVENT_DISPATCH_H
@@ -0,0 +1,404 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "gattc_discovery.h"
+
+#include <cstring>
+
+GattcDatabaseDiscovery::GattcDatabaseDiscovery(adapter_t *adapter, const uint16_t connHandle) :
+    GattcProcedure(adapter, connHandle),
+    state(STATE_PRIMARY_SERVICES),
+    serviceIndex(0),
+    characteristicIndex(0),
+    nextHandle(0x0001)
+{}
+
+void GattcDatabaseDiscovery::start()
+{
+    const auto err_code = sd_ble_gattc_primary_services_discover(adapter, connHandle, static_cast<uint16_t>(nextHandle), nullptr);
+
+    if (err_code != NRF_SUCCESS)
+    {
+        finish(err_code);
+    }
+}
+
+const std::vector<GattcDatabaseDiscovery::Service> &GattcDatabaseDiscovery::getServices() const
+{
+    return services;
+}
+
+bool GattcDatabaseDiscovery::onGattcEvent(const uint16_t id, const ble_gattc_evt_t &event)
+{
+    switch (id)
+    {
+        case BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP:
+            if (state != STATE_PRIMARY_SERVICES)
+            {
+                return false;
+            }
+
+            onPrimaryServices(event);
+            return true;
+
+        case BLE_GATTC_EVT_CHAR_DISC_RSP:
+            if (state != STATE_CHARACTERISTICS)
+            {
+                return false;
+            }
+
+            onCharacteristics(event);
+            return true;
+
+        case BLE_GATTC_EVT_DESC_DISC_RSP:
+            if (state != STATE_DESCRIPTORS)
+            {
+                return false;
+            }
+
+            onDescriptors(event);
+            return true;
+
+        case BLE_GATTC_EVT_READ_RSP:
+            if (state != STATE_SERVICE_UUIDS && state != STATE_CHARACTERISTIC_UUIDS)
+            {
+                return false;
+            }
+
+            onRead(event);
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+void GattcDatabaseDiscovery::onPrimaryServices(const ble_gattc_evt_t &event)
+{
+    if (event.gatt_status == BLE_GATT_STATUS_SUCCESS)
+    {
+        const auto &response = event.params.prim_srvc_disc_rsp;
+
+        for (auto i = 0; i < response.count; i++)
+        {
+            Service service;
+            service.service = response.services[i];
+            service.hasUuid128 = false;
+            services.push_back(service);
+        }
+
+        if (response.count > 0)
+        {
+            nextHandle = services.back().service.handle_range.end_handle + 1u;
+
+            if (nextHandle <= 0xFFFF)
+            {
+                const auto err_code = sd_ble_gattc_primary_services_discover(adapter, connHandle, static_cast<uint16_t>(nextHandle), nullptr);
+
+                if (err_code != NRF_SUCCESS)
+                {
+                    finish(err_code);
+                }
+
+                return;
+            }
+        }
+    }
+    else if (event.gatt_status != BLE_GATT_STATUS_ATTERR_ATTRIBUTE_NOT_FOUND)
+    {
+        fail(event);
+        return;
+    }
+
+    state = STATE_SERVICE_UUIDS;
+    serviceIndex = 0;
+    issueNext();
+}
+
+void GattcDatabaseDiscovery::onCharacteristics(const ble_gattc_evt_t &event)
+{
+    auto &service = services[serviceIndex];
+    const uint32_t endHandle = service.service.handle_range.end_handle;
+
+    if (event.gatt_status == BLE_GATT_STATUS_SUCCESS)
+    {
+        const auto &response = event.params.char_disc_rsp;
+
+        for (auto i = 0; i < response.count; i++)
+        {
+            Characteristic characteristic;
+            characteristic.characteristic = response.chars[i];
+            characteristic.hasUuid128 = false;
+            service.characteristics.push_back(characteristic);
+        }
+
+        nextHandle = response.count > 0 ? response.chars[response.count - 1].handle_decl + 1u : endHandle + 1;
+    }
+    else if (event.gatt_status == BLE_GATT_STATUS_ATTERR_ATTRIBUTE_NOT_FOUND)
+    {
+        nextHandle = endHandle + 1;
+    }
+    else
+    {
+        fail(event);
+        return;
+    }
+
+    issueNext();
+}
+
+void GattcDatabaseDiscovery::onDescriptors(const ble_gattc_evt_t &event)
+{
+    auto &characteristic = services[serviceIndex].characteristics[characteristicIndex];
+    const uint32_t endHandle = getDescriptorsEndHandle();
+
+    if (event.gatt_status == BLE_GATT_STATUS_SUCCESS)
+    {
+        const auto &response = event.params.desc_disc_rsp;
+        nextHandle = endHandle + 1;
+
+        for (auto i = 0; i < response.count; i++)
+        {
+            const auto &descriptor = response.descs[i];
+
+            // A service or characteristic declaration ends the descriptors of the characteristic
+            if (descriptor.handle > endHandle ||
+                (descriptor.uuid.type == BLE_UUID_TYPE_BLE &&
+                 (descriptor.uuid.uuid == BLE_UUID_SERVICE_PRIMARY ||
+                  descriptor.uuid.uuid == BLE_UUID_SERVICE_SECONDARY ||
+                  descriptor.uuid.uuid == BLE_UUID_CHARACTERISTIC)))
+            {
+                nextHandle = endHandle + 1;
+                break;
+            }
+
+            characteristic.descriptors.push_back(descriptor);
+            nextHandle = descriptor.handle + 1u;
+        }
+    }
+    else if (event.gatt_status == BLE_GATT_STATUS_ATTERR_ATTRIBUTE_NOT_FOUND)
+    {
+        nextHandle = endHandle + 1;
+    }
+    else
+    {
+        fail(event);
+        return;
+    }
+
+    issueNext();
+}
+
+void GattcDatabaseDiscovery::onRead(const ble_gattc_evt_t &event)
+{
+    const auto &response = event.params.read_rsp;
+    const auto success = event.gatt_status == BLE_GATT_STATUS_SUCCESS;
+
+    // A UUID that can not be read is left unknown, the rest of the table can still be discovered
+    if (state == STATE_SERVICE_UUIDS)
+    {
+        auto &service = services[serviceIndex];
+
+        // The value of a service declaration is the UUID of the service
+        if (success && response.handle == service.service.handle_range.start_handle && response.len == GATTC_DISCOVERY_UUID128_SIZE)
+        {
+            memcpy(service.uuid128, response.data, GATTC_DISCOVERY_UUID128_SIZE);
+            service.hasUuid128 = true;
+        }
+
+        serviceIndex++;
+    }
+    else
+    {
+        auto &characteristic = services[serviceIndex].characteristics[characteristicIndex];
+
+        // The value of a characteristic declaration is the properties (1 byte), the value handle (2 bytes) and the UUID
+        if (success && response.handle == characteristic.characteristic.handle_decl && response.len >= 3 + GATTC_DISCOVERY_UUID128_SIZE)
+        {
+            memcpy(characteristic.uuid128, response.data + 3, GATTC_DISCOVERY_UUID128_SIZE);
+            characteristic.hasUuid128 = true;
+        }
+
+        characteristicIndex++;
+    }
+
+    issueNext();
+}
+
+void GattcDatabaseDiscovery::issueNext()
+{
+    uint32_t err_code = NRF_SUCCESS;
+
+    for (;;)
+    {
+        switch (state)
+        {
+            case STATE_SERVICE_UUIDS:
+                while (serviceIndex < services.size() && services[serviceIndex].service.uuid.type != BLE_UUID_TYPE_UNKNOWN)
+                {
+                    serviceIndex++;
+                }
+
+                if (serviceIndex < services.size())
+                {
+                    err_code = sd_ble_gattc_read(adapter, connHandle, services[serviceIndex].service.handle_range.start_handle, 0);
+                    break;
+                }
+
+                state = STATE_CHARACTERISTICS;
+                serviceIndex = 0;
+                nextHandle = services.empty() ? 0 : services[0].service.handle_range.start_handle;
+                continue;
+
+            case STATE_CHARACTERISTICS:
+            {
+                if (serviceIndex >= services.size())
+                {
+                    state = STATE_CHARACTERISTIC_UUIDS;
+                    serviceIndex = 0;
+                    characteristicIndex = 0;
+                    continue;
+                }
+
+                const auto &serviceRange = services[serviceIndex].service.handle_range;
+
+                if (nextHandle > serviceRange.end_handle)
+                {
+                    serviceIndex++;
+
+                    if (serviceIndex < services.size())
+                    {
+                        nextHandle = services[serviceIndex].service.handle_range.start_handle;
+                    }
+
+                    continue;
+                }
+
+                ble_gattc_handle_range_t range;
+                range.start_handle = static_cast<uint16_t>(nextHandle);
+                range.end_handle = serviceRange.end_handle;
+                err_code = sd_ble_gattc_characteristics_discover(adapter, connHandle, &range);
+                break;
+            }
+
+            case STATE_CHARACTERISTIC_UUIDS:
+                while (selectCharacteristic() &&
+                       services[serviceIndex].characteristics[characteristicIndex].characteristic.uuid.type != BLE_UUID_TYPE_UNKNOWN)
+                {
+                    characteristicIndex++;
+                }
+
+                if (selectCharacteristic())
+                {
+                    err_code = sd_ble_gattc_read(adapter, connHandle, services[serviceIndex].characteristics[characteristicIndex].characteristic.handle_decl, 0);
+                    break;
+                }
+
+                state = STATE_DESCRIPTORS;
+                serviceIndex = 0;
+                characteristicIndex = 0;
+
+                if (selectCharacteristic())
+                {
+                    nextHandle = services[serviceIndex].characteristics[characteristicIndex].characteristic.handle_value + 1u;
+                }
+
+                continue;
+
+            case STATE_DESCRIPTORS:
+            {
+                if (!selectCharacteristic())
+                {
+                    finish(NRF_SUCCESS);
+                    return;
+                }
+
+                const auto endHandle = getDescriptorsEndHandle();
+
+                if (nextHandle > endHandle)
+                {
+                    characteristicIndex++;
+
+                    if (selectCharacteristic())
+                    {
+                        nextHandle = services[serviceIndex].characteristics[characteristicIndex].characteristic.handle_value + 1u;
+                    }
+
+                    continue;
+                }
+
+                ble_gattc_handle_range_t range;
+                range.start_handle = static_cast<uint16_t>(nextHandle);
+                range.end_handle = endHandle;
+                err_code = sd_ble_gattc_descriptors_discover(adapter, connHandle, &range);
+                break;
+            }
+
+            default:
+                return;
+        }
+
+        break;
+    }
+
+    if (err_code != NRF_SUCCESS)
+    {
+        finish(err_code);
+    }
+}
+
+bool GattcDatabaseDiscovery::selectCharacteristic()
+{
+    while (serviceIndex < services.size() && characteristicIndex >= services[serviceIndex].characteristics.size())
+    {
+        serviceIndex++;
+        characteristicIndex = 0;
+    }
+
+    return serviceIndex < services.size();
+}
+
+uint16_t GattcDatabaseDiscovery::getDescriptorsEndHandle() const
+{
+    const auto &service = services[serviceIndex];
+
+    if (characteristicIndex + 1 < service.characteristics.size())
+    {
+        return service.characteristics[characteristicIndex + 1].characteristic.handle_decl - 1;
+    }
+
+    return service.service.handle_range.end_handle;
+}
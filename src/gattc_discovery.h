@@ -0,0 +1,117 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GATTC_DISCOVERY_H
+#define GATTC_DISCOVERY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "sd_rpc.h"
+
+#include "gattc_procedure.h"
+
+// Size of a 128-bit UUID read from an attribute declaration
+const auto GATTC_DISCOVERY_UUID128_SIZE = 16;
+
+// Discovers the whole attribute table of a GATT server: primary services, characteristics and
+// descriptors.
+//
+// 128-bit UUIDs that are not registered with sd_ble_uuid_vs_add are reported as
+// BLE_UUID_TYPE_UNKNOWN by the SoftDevice. They are read from the service and characteristic
+// declarations. Descriptor UUIDs are not resolved.
+class GattcDatabaseDiscovery : public GattcProcedure
+{
+public:
+    struct Characteristic
+    {
+        ble_gattc_char_t characteristic;
+        bool hasUuid128;
+        uint8_t uuid128[GATTC_DISCOVERY_UUID128_SIZE];   // Little endian, as in the declaration
+        std::vector<ble_gattc_desc_t> descriptors;
+    };
+
+    struct Service
+    {
+        ble_gattc_service_t service;
+        bool hasUuid128;
+        uint8_t uuid128[GATTC_DISCOVERY_UUID128_SIZE];
+        std::vector<Characteristic> characteristics;
+    };
+
+    GattcDatabaseDiscovery(adapter_t *adapter, const uint16_t connHandle);
+
+    void start() override;
+
+    const std::vector<Service> &getServices() const;
+
+protected:
+    bool onGattcEvent(const uint16_t id, const ble_gattc_evt_t &event) override;
+
+private:
+    enum State
+    {
+        STATE_PRIMARY_SERVICES,
+        STATE_SERVICE_UUIDS,
+        STATE_CHARACTERISTICS,
+        STATE_CHARACTERISTIC_UUIDS,
+        STATE_DESCRIPTORS
+    };
+
+    void onPrimaryServices(const ble_gattc_evt_t &event);
+    void onCharacteristics(const ble_gattc_evt_t &event);
+    void onDescriptors(const ble_gattc_evt_t &event);
+    void onRead(const ble_gattc_evt_t &event);
+
+    // Issues the request for the current state, moves on to the next state when it has nothing left
+    void issueNext();
+
+    // Selects the first characteristic from serviceIndex and characteristicIndex on
+    bool selectCharacteristic();
+    // Last handle of the descriptors of the selected characteristic
+    uint16_t getDescriptorsEndHandle() const;
+
+    State state;
+    size_t serviceIndex;
+    size_t characteristicIndex;
+    // 32 bits, the handle after 0xFFFF ends a range
+    uint32_t nextHandle;
+
+    std::vector<Service> services;
+};
+
+#endif // GATTC_DISCOVERY_H
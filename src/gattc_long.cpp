@@ -0,0 +1,289 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "gattc_long.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace {
+    // Bytes of the ATT_MTU used by the opcode and handle of a read response, and by the opcode,
+    // handle and offset of a prepare write request
+    const uint16_t READ_RESPONSE_HEADER_SIZE = 1;
+    const uint16_t PREPARE_WRITE_HEADER_SIZE = 5;
+
+    // Offsets are 16 bits
+    const size_t MAX_LONG_VALUE_LENGTH = 0xFFFF;
+}
+
+GattcLongRead::GattcLongRead(adapter_t *adapter, const uint16_t connHandle, const uint16_t handle, const uint16_t attMtu) :
+    GattcProcedure(adapter, connHandle),
+    handle(handle),
+    chunkSize(attMtu - READ_RESPONSE_HEADER_SIZE)
+{}
+
+void GattcLongRead::start()
+{
+    read();
+}
+
+const std::vector<uint8_t> &GattcLongRead::getValue() const
+{
+    return value;
+}
+
+bool GattcLongRead::onGattcEvent(const uint16_t id, const ble_gattc_evt_t &event)
+{
+    if (id != BLE_GATTC_EVT_READ_RSP || event.params.read_rsp.handle != handle)
+    {
+        return false;
+    }
+
+    const auto &response = event.params.read_rsp;
+
+    if (event.gatt_status != BLE_GATT_STATUS_SUCCESS)
+    {
+        // A value that is a multiple of the chunk size ends with an error on the read blob request after it
+        if (!value.empty() &&
+            (event.gatt_status == BLE_GATT_STATUS_ATTERR_INVALID_OFFSET || event.gatt_status == BLE_GATT_STATUS_ATTERR_ATTRIBUTE_NOT_LONG))
+        {
+            finish(NRF_SUCCESS);
+        }
+        else
+        {
+            fail(event);
+        }
+
+        return true;
+    }
+
+    value.insert(value.end(), response.data, response.data + response.len);
+
+    if (response.len < chunkSize || value.size() + chunkSize > MAX_LONG_VALUE_LENGTH)
+    {
+        finish(NRF_SUCCESS);
+    }
+    else
+    {
+        read();
+    }
+
+    return true;
+}
+
+void GattcLongRead::read()
+{
+    const auto err_code = sd_ble_gattc_read(adapter, connHandle, handle, static_cast<uint16_t>(value.size()));
+
+    if (err_code != NRF_SUCCESS)
+    {
+        finish(err_code);
+    }
+}
+
+GattcLongWrite::GattcLongWrite(adapter_t *adapter, const uint16_t connHandle, const uint16_t handle, std::vector<uint8_t> value, const uint16_t attMtu) :
+    GattcProcedure(adapter, connHandle),
+    handle(handle),
+    chunkSize(attMtu - PREPARE_WRITE_HEADER_SIZE),
+    value(std::move(value)),
+    state(STATE_PREPARE),
+    offset(0),
+    length(0),
+    requestCount(0),
+    cancelResult(NRF_SUCCESS),
+    cancelGattStatus(BLE_GATT_STATUS_SUCCESS),
+    cancelErrorHandle(0)
+{}
+
+void GattcLongWrite::start()
+{
+    if (value.size() > MAX_LONG_VALUE_LENGTH)
+    {
+        finish(NRF_ERROR_DATA_SIZE);
+        return;
+    }
+
+    issueNext();
+}
+
+uint32_t GattcLongWrite::getRequestCount() const
+{
+    return requestCount;
+}
+
+size_t GattcLongWrite::getPreparedLength() const
+{
+    return offset;
+}
+
+bool GattcLongWrite::onGattcEvent(const uint16_t id, const ble_gattc_evt_t &event)
+{
+    if (id != BLE_GATTC_EVT_WRITE_RSP)
+    {
+        return false;
+    }
+
+    const auto &response = event.params.write_rsp;
+
+    switch (state)
+    {
+        case STATE_PREPARE:
+            if (response.write_op != BLE_GATT_OP_PREP_WRITE_REQ || response.handle != handle)
+            {
+                return false;
+            }
+
+            if (event.gatt_status != BLE_GATT_STATUS_SUCCESS)
+            {
+                cancel(NRF_ERROR_INVALID_DATA, event.gatt_status, event.error_handle);
+            }
+            else if (response.offset != offset || response.len != length || memcmp(response.data, value.data() + offset, length) != 0)
+            {
+                // The server did not queue what was sent
+                cancel(NRF_ERROR_INVALID_DATA, BLE_GATT_STATUS_ATTERR_UNLIKELY_ERROR, handle);
+            }
+            else
+            {
+                offset += length;
+                issueNext();
+            }
+
+            return true;
+
+        case STATE_EXECUTE:
+            if (response.write_op != BLE_GATT_OP_EXEC_WRITE_REQ)
+            {
+                return false;
+            }
+
+            if (event.gatt_status == BLE_GATT_STATUS_SUCCESS)
+            {
+                finish(NRF_SUCCESS);
+            }
+            else
+            {
+                fail(event);
+            }
+
+            return true;
+
+        case STATE_CANCEL:
+            if (response.write_op != BLE_GATT_OP_EXEC_WRITE_REQ)
+            {
+                return false;
+            }
+
+            finishCancelled();
+            return true;
+    }
+
+    return false;
+}
+
+void GattcLongWrite::issueNext()
+{
+    uint32_t err_code;
+
+    if (offset < value.size())
+    {
+        length = static_cast<uint16_t>(std::min<size_t>(chunkSize, value.size() - offset));
+        err_code = write(BLE_GATT_OP_PREP_WRITE_REQ, 0, static_cast<uint16_t>(offset), length);
+    }
+    else
+    {
+        state = STATE_EXECUTE;
+        err_code = write(BLE_GATT_OP_EXEC_WRITE_REQ, BLE_GATT_EXEC_WRITE_FLAG_PREPARED_WRITE, 0, 0);
+    }
+
+    if (err_code != NRF_SUCCESS)
+    {
+        // Nothing is known to be queued by the server if the first request could not be sent
+        if (state == STATE_PREPARE && offset > 0)
+        {
+            cancel(err_code, BLE_GATT_STATUS_SUCCESS, 0);
+            return;
+        }
+
+        finish(err_code);
+    }
+}
+
+void GattcLongWrite::cancel(const uint32_t result, const uint16_t gattStatus, const uint16_t errorHandle)
+{
+    state = STATE_CANCEL;
+    cancelResult = result;
+    cancelGattStatus = gattStatus;
+    cancelErrorHandle = errorHandle;
+
+    // The failure is reported rather than the failure to cancel
+    if (write(BLE_GATT_OP_EXEC_WRITE_REQ, BLE_GATT_EXEC_WRITE_FLAG_PREPARED_CANCEL, 0, 0) != NRF_SUCCESS)
+    {
+        finishCancelled();
+    }
+}
+
+void GattcLongWrite::finishCancelled()
+{
+    if (cancelResult == NRF_ERROR_INVALID_DATA)
+    {
+        fail(cancelGattStatus, cancelErrorHandle);
+    }
+    else
+    {
+        finish(cancelResult);
+    }
+}
+
+uint32_t GattcLongWrite::write(const uint8_t writeOp, const uint8_t flags, const uint16_t writeOffset, const uint16_t writeLength)
+{
+    ble_gattc_write_params_t params;
+    params.write_op = writeOp;
+    params.flags = flags;
+    params.handle = handle;
+    params.offset = writeOffset;
+    params.len = writeLength;
+    params.p_value = writeLength > 0 ? value.data() + writeOffset : nullptr;
+
+    const auto err_code = sd_ble_gattc_write(adapter, connHandle, &params);
+
+    if (err_code == NRF_SUCCESS)
+    {
+        requestCount++;
+    }
+
+    return err_code;
+}
@@ -0,0 +1,124 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GATTC_LONG_H
+#define GATTC_LONG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "sd_rpc.h"
+
+#include "gattc_procedure.h"
+
+// The default ATT_MTU, no connection has a smaller one
+const auto GATTC_LONG_MIN_ATT_MTU = 23;
+
+// Reads the whole value of an attribute with a read request followed by read blob requests,
+// until a response is shorter than ATT_MTU - 1.
+class GattcLongRead : public GattcProcedure
+{
+public:
+    GattcLongRead(adapter_t *adapter, const uint16_t connHandle, const uint16_t handle, const uint16_t attMtu);
+
+    void start() override;
+
+    const std::vector<uint8_t> &getValue() const;
+
+protected:
+    bool onGattcEvent(const uint16_t id, const ble_gattc_evt_t &event) override;
+
+private:
+    void read();
+
+    const uint16_t handle;
+    // Length of a full response, a shorter response is the last
+    const uint16_t chunkSize;
+
+    std::vector<uint8_t> value;
+};
+
+// Writes a value of any length to an attribute with prepare write requests followed by an
+// execute write request. Prepared values echoed by the server are checked, and the prepared
+// writes are cancelled if one fails, so the attribute is written completely or not at all.
+class GattcLongWrite : public GattcProcedure
+{
+public:
+    GattcLongWrite(adapter_t *adapter, const uint16_t connHandle, const uint16_t handle, std::vector<uint8_t> value, const uint16_t attMtu);
+
+    void start() override;
+
+    // Write requests sent, and bytes of the value prepared by the server
+    uint32_t getRequestCount() const;
+    size_t getPreparedLength() const;
+
+protected:
+    bool onGattcEvent(const uint16_t id, const ble_gattc_evt_t &event) override;
+
+private:
+    enum State
+    {
+        STATE_PREPARE,
+        STATE_EXECUTE,
+        STATE_CANCEL
+    };
+
+    // Prepares the next part of the value, or executes the prepared writes when all are prepared
+    void issueNext();
+    // Cancels the prepared writes, the procedure ends with the result when the cancel is done.
+    // The GATT status and error handle are those of the failed request if the result is NRF_ERROR_INVALID_DATA.
+    void cancel(const uint32_t result, const uint16_t gattStatus, const uint16_t errorHandle);
+    void finishCancelled();
+    uint32_t write(const uint8_t writeOp, const uint8_t flags, const uint16_t writeOffset, const uint16_t writeLength);
+
+    const uint16_t handle;
+    // Length of the value in a prepare write request
+    const uint16_t chunkSize;
+    const std::vector<uint8_t> value;
+
+    State state;
+    // Bytes of the value prepared so far, and the length of the outstanding prepare write request
+    size_t offset;
+    uint16_t length;
+    uint32_t requestCount;
+
+    uint32_t cancelResult;
+    uint16_t cancelGattStatus;
+    uint16_t cancelErrorHandle;
+};
+
+#endif // GATTC_LONG_H
@@ -0,0 +1,135 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "gattc_procedure.h"
+
+GattcProcedure::GattcProcedure(adapter_t *adapter, const uint16_t connHandle) :
+    adapter(adapter),
+    connHandle(connHandle),
+    result(NRF_SUCCESS),
+    gattStatus(BLE_GATT_STATUS_SUCCESS),
+    errorHandle(0),
+    finishing(false),
+    done(false)
+{}
+
+bool GattcProcedure::onEvent(const ble_evt_t *event)
+{
+    if (done)
+    {
+        return false;
+    }
+
+    const auto id = event->header.evt_id;
+
+    if (id == BLE_GAP_EVT_DISCONNECTED)
+    {
+        if (event->evt.gap_evt.conn_handle == connHandle)
+        {
+            finish(BLE_ERROR_INVALID_CONN_HANDLE);
+        }
+
+        // Others need to know about the disconnect too
+        return false;
+    }
+
+    if (id < BLE_GATTC_EVT_BASE || id > BLE_GATTC_EVT_LAST || event->evt.gattc_evt.conn_handle != connHandle)
+    {
+        return false;
+    }
+
+    if (id == BLE_GATTC_EVT_TIMEOUT)
+    {
+        finish(NRF_ERROR_TIMEOUT);
+        return false;
+    }
+
+    return onGattcEvent(id, event->evt.gattc_evt);
+}
+
+bool GattcProcedure::isDone() const
+{
+    return done;
+}
+
+uint32_t GattcProcedure::getResult() const
+{
+    return result;
+}
+
+uint16_t GattcProcedure::getGattStatus() const
+{
+    return gattStatus;
+}
+
+uint16_t GattcProcedure::getErrorHandle() const
+{
+    return errorHandle;
+}
+
+uint16_t GattcProcedure::getConnHandle() const
+{
+    return connHandle;
+}
+
+void GattcProcedure::abort(const uint32_t result)
+{
+    finish(result);
+}
+
+void GattcProcedure::fail(const ble_gattc_evt_t &event)
+{
+    fail(event.gatt_status, event.error_handle);
+}
+
+void GattcProcedure::fail(const uint16_t gattStatus, const uint16_t errorHandle)
+{
+    this->gattStatus = gattStatus;
+    this->errorHandle = errorHandle;
+    finish(NRF_ERROR_INVALID_DATA);
+}
+
+void GattcProcedure::finish(const uint32_t result)
+{
+    // The command thread and the SoftDevice driver thread may both end the procedure
+    if (finishing.exchange(true))
+    {
+        return;
+    }
+
+    this->result = result;
+    done = true;
+}
@@ -0,0 +1,96 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GATTC_PROCEDURE_H
+#define GATTC_PROCEDURE_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "sd_rpc.h"
+
+// A GATT client procedure of several requests. The next request is issued from the response to
+// the previous, in the SoftDevice driver thread, so there is no round trip to the NodeJS thread
+// per request. Only one procedure can be active on a connection, see Adapter::startGattcProcedure.
+//
+// start() is called once, from the command thread, onEvent() from the SoftDevice driver thread.
+// The result may be read when isDone() returns true.
+class GattcProcedure
+{
+public:
+    GattcProcedure(adapter_t *adapter, const uint16_t connHandle);
+    virtual ~GattcProcedure() = default;
+
+    GattcProcedure(const GattcProcedure &) = delete;
+    GattcProcedure &operator=(const GattcProcedure &) = delete;
+
+    virtual void start() = 0;
+
+    // Returns true if the event is a response to this procedure and must not be passed on
+    bool onEvent(const ble_evt_t *event);
+
+    bool isDone() const;
+    // NRF_SUCCESS, the error of a SoftDevice call, or NRF_ERROR_INVALID_DATA when the GATT server
+    // responded with an error, see getGattStatus()
+    uint32_t getResult() const;
+    uint16_t getGattStatus() const;
+    uint16_t getErrorHandle() const;
+    uint16_t getConnHandle() const;
+
+    // Ends the procedure without a response, e.g. when the connectivity device is reset
+    void abort(const uint32_t result);
+
+protected:
+    // Called for the GATTC events of the connection while the procedure is not done,
+    // returns true if the event is a response to the procedure
+    virtual bool onGattcEvent(const uint16_t id, const ble_gattc_evt_t &event) = 0;
+
+    void fail(const ble_gattc_evt_t &event);
+    void fail(const uint16_t gattStatus, const uint16_t errorHandle);
+    void finish(const uint32_t result);
+
+    adapter_t *adapter;
+    const uint16_t connHandle;
+
+private:
+    uint32_t result;
+    uint16_t gattStatus;
+    uint16_t errorHandle;
+    std::atomic<bool> finishing;
+    std::atomic<bool> done;
+};
+
+#endif // GATTC_PROCEDURE_H
@@ -0,0 +1,169 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Histogram of durations in microseconds with a fixed memory footprint.
+//
+// Values below 16 have a bucket each. Larger values are grouped in buckets that split each
+// power of two in 8, so the percentiles are within 12.5% of the recorded values. Values from
+// 2^40 us (about 12 days) and up share the last bucket.
+//
+// Not thread safe, all calls must be done from the same thread.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram()
+    {
+        reset();
+    }
+
+    void record(const uint64_t value)
+    {
+        buckets[bucketIndex(value)]++;
+        total++;
+
+        if (value > maxValue)
+        {
+            maxValue = value;
+        }
+    }
+
+    void reset()
+    {
+        buckets.fill(0);
+        total = 0;
+        maxValue = 0;
+    }
+
+    uint64_t count() const
+    {
+        return total;
+    }
+
+    uint64_t max() const
+    {
+        return maxValue;
+    }
+
+    // Returns the upper bound of the bucket holding the given percentile (0 to 100) of the
+    // recorded values, never more than the largest recorded value. Returns 0 if empty.
+    uint64_t percentile(const double percent) const
+    {
+        if (total == 0)
+        {
+            return 0;
+        }
+
+        auto rank = static_cast<uint64_t>(percent / 100.0 * static_cast<double>(total) + 0.5);
+
+        if (rank < 1)
+        {
+            rank = 1;
+        }
+
+        uint64_t seen = 0;
+
+        for (size_t i = 0; i < BUCKET_COUNT; i++)
+        {
+            seen += buckets[i];
+
+            if (seen >= rank)
+            {
+                // The last bucket has no upper bound
+                const auto bound = (i == BUCKET_COUNT - 1) ? maxValue : bucketUpperBound(i);
+                return bound < maxValue ? bound : maxValue;
+            }
+        }
+
+        return maxValue;
+    }
+
+private:
+    static const size_t LINEAR_BUCKETS = 16;
+    static const size_t SUB_BUCKET_BITS = 3;
+    static const size_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const size_t MAX_EXPONENT = 40;
+    static const size_t BUCKET_COUNT = LINEAR_BUCKETS + (MAX_EXPONENT - 4) * SUB_BUCKETS;
+
+    static size_t bucketIndex(const uint64_t value)
+    {
+        if (value < LINEAR_BUCKETS)
+        {
+            return static_cast<size_t>(value);
+        }
+
+        size_t exponent = 0;
+
+        for (auto rest = value; rest > 1; rest >>= 1)
+        {
+            exponent++;
+        }
+
+        if (exponent >= MAX_EXPONENT)
+        {
+            return BUCKET_COUNT - 1;
+        }
+
+        const auto subBucket = static_cast<size_t>(value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+        return LINEAR_BUCKETS + (exponent - 4) * SUB_BUCKETS + subBucket;
+    }
+
+    static uint64_t bucketUpperBound(const size_t index)
+    {
+        if (index < LINEAR_BUCKETS)
+        {
+            return index;
+        }
+
+        const auto exponent = (index - LINEAR_BUCKETS) / SUB_BUCKETS + 4;
+        const auto subBucket = (index - LINEAR_BUCKETS) % SUB_BUCKETS;
+        const auto width = static_cast<uint64_t>(1) << (exponent - SUB_BUCKET_BITS);
+
+        return (static_cast<uint64_t>(1) << exponent) + (subBucket + 1) * width - 1;
+    }
+
+    std::array<uint32_t, BUCKET_COUNT> buckets;
+    uint64_t total;
+    uint64_t maxValue;
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,150 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "log_pipeline.h"
+
+#include <cstring>
+
+namespace {
+    const uint8_t LOG_FILE_VERSION = 1;
+    const size_t LOG_FILE_BUFFER_SIZE = 64 * 1024;
+}
+
+LogRateLimiter::LogRateLimiter() :
+    burstLimit(0),
+    interval(0),
+    intervalStart(0),
+    admittedInInterval(0),
+    suppressedSinceReport(0)
+{}
+
+void LogRateLimiter::configure(const uint32_t limit, const uint32_t intervalMs)
+{
+    burstLimit = limit;
+    interval = static_cast<uint64_t>(intervalMs) * 1000;
+    intervalStart = 0;
+    admittedInInterval = 0;
+    suppressedSinceReport = 0;
+}
+
+bool LogRateLimiter::admit(const uint64_t now, uint32_t &suppressed)
+{
+    suppressed = 0;
+
+    if (burstLimit == 0)
+    {
+        return true;
+    }
+
+    if (admittedInInterval == 0 || now - intervalStart >= interval)
+    {
+        intervalStart = now;
+        admittedInInterval = 0;
+        suppressed = suppressedSinceReport;
+        suppressedSinceReport = 0;
+    }
+
+    if (admittedInInterval >= burstLimit)
+    {
+        ++suppressedSinceReport;
+        return false;
+    }
+
+    ++admittedInInterval;
+    return true;
+}
+
+LogFileSink::LogFileSink() : file(nullptr)
+{}
+
+LogFileSink::~LogFileSink()
+{
+    close();
+}
+
+void LogFileSink::open(const std::string &path)
+{
+    close();
+
+    file = std::fopen(path.c_str(), "wb");
+
+    if (file == nullptr)
+    {
+        throw std::string("path of a writable file, not able to open ") + path;
+    }
+
+    std::setvbuf(file, nullptr, _IOFBF, LOG_FILE_BUFFER_SIZE);
+
+    const uint8_t header[] = { 'P', 'B', 'L', 'G', LOG_FILE_VERSION };
+    std::fwrite(header, sizeof(header), 1, file);
+}
+
+void LogFileSink::close()
+{
+    if (file != nullptr)
+    {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+bool LogFileSink::isOpen() const
+{
+    return file != nullptr;
+}
+
+void LogFileSink::write(const uint64_t timestamp, const uint8_t severity, const char *message, const size_t length)
+{
+    if (file == nullptr)
+    {
+        return;
+    }
+
+    const auto messageLength = static_cast<uint16_t>(length > UINT16_MAX ? UINT16_MAX : length);
+    uint8_t record[11];
+
+    for (auto i = 0; i < 8; i++)
+    {
+        record[i] = static_cast<uint8_t>(timestamp >> (8 * i));
+    }
+
+    record[8] = severity;
+    record[9] = static_cast<uint8_t>(messageLength);
+    record[10] = static_cast<uint8_t>(messageLength >> 8);
+
+    std::fwrite(record, sizeof(record), 1, file);
+    std::fwrite(message, messageLength, 1, file);
+}
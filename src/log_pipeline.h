@@ -0,0 +1,99 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOG_PIPELINE_H
+#define LOG_PIPELINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Longer driver log messages are truncated
+const size_t LOG_ENTRY_MESSAGE_SIZE = 256;
+
+// Admits at most burstLimit messages in every interval. The number of suppressed messages is
+// reported with the next admitted message, so a summary can be logged. Not thread safe, used while holding the log queue mutex.
+class LogRateLimiter
+{
+public:
+    LogRateLimiter();
+
+    // A burstLimit of 0 admits all messages
+    void configure(const uint32_t burstLimit, const uint32_t intervalMs);
+
+    // Returns true if the message at time now (microseconds) is admitted. When the first message
+    // of an interval is admitted, suppressed is set to the number of messages suppressed in the
+    // intervals before it, and is 0 otherwise.
+    bool admit(const uint64_t now, uint32_t &suppressed);
+
+private:
+    uint32_t burstLimit;
+    uint64_t interval;
+    uint64_t intervalStart;
+    uint32_t admittedInInterval;
+    uint32_t suppressedSinceReport;
+};
+
+// Writes log messages to a file in a compact binary format:
+//
+//   header: "PBLG", uint8 version (1)
+//   record: uint64 timestamp (microseconds, see getMonotonicTimeInMicroseconds()), uint8 severity,
+//           uint16 message length, message bytes without terminator
+//
+// All integers are little endian. Writes are buffered, the file is flushed when it is closed.
+// Not thread safe, used in the NodeJS thread that drains the log queue.
+class LogFileSink
+{
+public:
+    LogFileSink();
+    ~LogFileSink();
+
+    LogFileSink(const LogFileSink &) = delete;
+    LogFileSink &operator=(const LogFileSink &) = delete;
+
+    // Truncates the file at path. Throws std::string if it can not be opened.
+    void open(const std::string &path);
+    void close();
+    bool isOpen() const;
+
+    void write(const uint64_t timestamp, const uint8_t severity, const char *message, const size_t length);
+
+private:
+    FILE *file;
+};
+
+#endif // LOG_PIPELINE_H
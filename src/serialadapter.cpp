@@ -27,17 +27,329 @@
  *
  */
 
+
 #include "serialadapter.h"
 
 #include <nan.h>
 #include <sd_rpc.h>
 
-#include <vector>
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 // Maximum of adapters allowed on a system before GetAdapterList fails
 constexpr size_t max_adapter_count = 64;
 
+// Time to let a burst of hotplug notifications settle before the ports are enumerated
+constexpr std::chrono::milliseconds hotplug_settle_time(100);
+
+namespace {
+    typedef std::vector<sd_rpc_serial_port_desc_t> PortList;
+
+    bool isSamePort(const sd_rpc_serial_port_desc_t &a, const sd_rpc_serial_port_desc_t &b)
+    {
+        return std::strcmp(a.port, b.port) == 0 && std::strcmp(a.serialNumber, b.serialNumber) == 0;
+    }
+
+    uint32_t enumeratePorts(PortList &ports)
+    {
+        ports.resize(max_adapter_count);
+        auto count = static_cast<std::uint32_t>(ports.size());
+        const auto status = sd_rpc_serial_port_enum(ports.data(), &count);
+        ports.resize(status == NRF_SUCCESS ? count : 0);
+        return status;
+    }
+
+    // Attach and detach notifications for one JavaScript environment, delivered on its event loop
+    struct MonitorListener
+    {
+        uv_loop_t *loop;
+        uv_async_t *async;
+        // Shared with deliver(), which keeps it while calling it after the listener may be removed
+        std::shared_ptr<Nan::Callback> callback;
+        // Guarded by the registry mutex
+        std::vector<std::pair<bool, sd_rpc_serial_port_desc_t>> pending;
+    };
+
+    std::remove_pointer<uv_async_cb>::type deliver_port_changes;
+    std::remove_pointer<uv_close_cb>::type free_async;
+
+    // The serial ports of the system, enumerated again only when the monitor reports a change.
+    // Without hotplug notifications every list request enumerates the ports.
+    class SerialPortRegistry
+    {
+    public:
+        SerialPortRegistry() : monitorState(MONITOR_NOT_STARTED), stale(true), lastStatus(NRF_SUCCESS)
+        {
+            if (uv_mutex_init(&mutex) != 0 || uv_sem_init(&monitorStarted, 0) != 0)
+            {
+                std::cerr << "Not able to create the serial port registry! Terminating." << std::endl;
+                std::terminate();
+            }
+        }
+
+        // Called from the libuv thread pool
+        uint32_t getPorts(PortList &ports)
+        {
+            startMonitor();
+
+            uv_mutex_lock(&mutex);
+
+            if (stale || monitorState != MONITOR_RUNNING)
+            {
+                lastStatus = enumeratePorts(cachedPorts);
+                stale = lastStatus != NRF_SUCCESS;
+            }
+
+            ports = cachedPorts;
+            const auto status = lastStatus;
+
+            uv_mutex_unlock(&mutex);
+
+            return status;
+        }
+
+        // Called from the NodeJS thread of the listener. Returns false if there are no notifications.
+        bool addListener(std::unique_ptr<MonitorListener> listener)
+        {
+            startMonitor();
+
+            if (monitorState != MONITOR_RUNNING)
+            {
+                return false;
+            }
+
+            uv_mutex_lock(&mutex);
+            removeListenerLocked(listener->loop);
+            listeners.push_back(std::move(listener));
+            uv_mutex_unlock(&mutex);
+
+            return true;
+        }
+
+        void removeListener(uv_loop_t *loop)
+        {
+            uv_mutex_lock(&mutex);
+            removeListenerLocked(loop);
+            uv_mutex_unlock(&mutex);
+        }
+
+        // Called from the NodeJS thread of the listener
+        void deliver(MonitorListener *listener)
+        {
+            Nan::HandleScope scope;
+            std::vector<std::pair<bool, sd_rpc_serial_port_desc_t>> changes;
+            std::shared_ptr<Nan::Callback> callback;
+
+            uv_mutex_lock(&mutex);
+
+            const auto found = std::any_of(listeners.begin(), listeners.end(),
+                                           [listener](const std::unique_ptr<MonitorListener> &l) { return l.get() == listener; });
+
+            if (found)
+            {
+                changes.swap(listener->pending);
+                callback = listener->callback;
+            }
+
+            uv_mutex_unlock(&mutex);
+
+            // The callback may call StopAdapterMonitor, which frees the listener
+            for (const auto &change : changes)
+            {
+                if (!isListening(callback))
+                {
+                    break;
+                }
+
+                v8::Local<v8::Value> argv[2];
+                argv[0] = ConversionUtility::toJsBool(change.first);
+                argv[1] = portToJs(change.second);
+                Nan::AsyncResource resource("pc-ble-driver-js:callback");
+                callback->Call(2, argv, &resource);
+            }
+        }
+
+        bool isListening(const std::shared_ptr<Nan::Callback> &callback)
+        {
+            uv_mutex_lock(&mutex);
+
+            const auto found = std::any_of(listeners.begin(), listeners.end(),
+                                           [&callback](const std::unique_ptr<MonitorListener> &l) { return l->callback == callback; });
+
+            uv_mutex_unlock(&mutex);
+            return found;
+        }
+
+        static v8::Local<v8::Object> portToJs(const sd_rpc_serial_port_desc_t &port)
+        {
+            Nan::EscapableHandleScope scope;
+            v8::Local<v8::Object> item = Nan::New<v8::Object>();
+            Utility::Set(item, "path", port.port);
+            Utility::Set(item, "manufacturer", port.manufacturer);
+            Utility::Set(item, "serialNumber", port.serialNumber);
+            Utility::Set(item, "pnpId", port.pnpId);
+            Utility::Set(item, "locationId", port.locationId);
+            Utility::Set(item, "vendorId", port.vendorId);
+            Utility::Set(item, "productId", port.productId);
+            return scope.Escape(item);
+        }
+
+    private:
+        enum MonitorState
+        {
+            MONITOR_NOT_STARTED,
+            MONITOR_RUNNING,
+            MONITOR_UNAVAILABLE
+        };
+
+        void startMonitor()
+        {
+            uv_mutex_lock(&mutex);
+
+            if (monitorState == MONITOR_NOT_STARTED)
+            {
+                if (uv_thread_create(&thread, run, this) != 0)
+                {
+                    std::cerr << "Not able to create the serial port monitor thread." << std::endl;
+                    monitorState = MONITOR_UNAVAILABLE;
+                }
+                else
+                {
+                    // The monitor sets its state before it signals
+                    uv_sem_wait(&monitorStarted);
+                }
+            }
+
+            uv_mutex_unlock(&mutex);
+        }
+
+        static void run(void *arg)
+        {
+            static_cast<SerialPortRegistry *>(arg)->monitorPorts();
+        }
+
+        // Runs in the monitor thread. startMonitor() holds the mutex until the state is set.
+        void monitorPorts()
+        {
+            monitorState = monitor.start() ? MONITOR_RUNNING : MONITOR_UNAVAILABLE;
+            uv_sem_post(&monitorStarted);
+
+            if (monitorState != MONITOR_RUNNING)
+            {
+                return;
+            }
+
+            // The ports the first notifications are compared with
+            uv_mutex_lock(&mutex);
+            lastStatus = enumeratePorts(cachedPorts);
+            stale = lastStatus != NRF_SUCCESS;
+            uv_mutex_unlock(&mutex);
+
+            while (monitor.waitForChange())
+            {
+                std::this_thread::sleep_for(hotplug_settle_time);
+
+                PortList ports;
+                const auto status = enumeratePorts(ports);
+
+                uv_mutex_lock(&mutex);
+
+                if (status == NRF_SUCCESS)
+                {
+                    // Without a successful enumeration to compare with, changes are not known
+                    if (!stale)
+                    {
+                        notifyChanges(cachedPorts, ports, false);
+                        notifyChanges(ports, cachedPorts, true);
+                    }
+
+                    cachedPorts.swap(ports);
+                    stale = false;
+                }
+                else
+                {
+                    stale = true;
+                }
+
+                lastStatus = status;
+
+                uv_mutex_unlock(&mutex);
+            }
+        }
+
+        // Queues the ports in from that are not in to, called while holding the mutex
+        void notifyChanges(const PortList &from, const PortList &to, const bool attached)
+        {
+            for (const auto &port : from)
+            {
+                const auto kept = std::any_of(to.begin(), to.end(),
+                                              [&port](const sd_rpc_serial_port_desc_t &p) { return isSamePort(port, p); });
+
+                if (kept)
+                {
+                    continue;
+                }
+
+                for (auto &listener : listeners)
+                {
+                    listener->pending.emplace_back(attached, port);
+                    uv_async_send(listener->async);
+                }
+            }
+        }
+
+        void removeListenerLocked(uv_loop_t *loop)
+        {
+            auto listener = std::find_if(listeners.begin(), listeners.end(),
+                                         [loop](const std::unique_ptr<MonitorListener> &l) { return l->loop == loop; });
+
+            if (listener != listeners.end())
+            {
+                // The handle is closed in its own thread, which is the calling thread
+                uv_close(reinterpret_cast<uv_handle_t *>((*listener)->async), free_async);
+                listeners.erase(listener);
+            }
+        }
+
+        SerialPortMonitor monitor;
+        std::atomic<MonitorState> monitorState;
+        uv_thread_t thread;
+        uv_sem_t monitorStarted;
+
+        // Guards the members below
+        uv_mutex_t mutex;
+        PortList cachedPorts;
+        bool stale;
+        uint32_t lastStatus;
+        std::vector<std::unique_ptr<MonitorListener>> listeners;
+    };
+
+    SerialPortRegistry &getRegistry()
+    {
+        // Never destroyed, the monitor thread may be blocked waiting for notifications when the
+        // process exits, and the listeners belong to JavaScript environments torn down before it
+        static auto registry = new SerialPortRegistry();
+        return *registry;
+    }
+
+    void deliver_port_changes(uv_async_t *handle)
+    {
+        getRegistry().deliver(static_cast<MonitorListener *>(handle->data));
+    }
+
+    void free_async(uv_handle_t *handle)
+    {
+        delete reinterpret_cast<uv_async_t *>(handle);
+    }
+}
+
 NAN_METHOD(GetAdapterList)
 {
     if(!info[0]->IsFunction())
@@ -49,19 +361,13 @@ NAN_METHOD(GetAdapterList)
     v8::Local<v8::Function> callback = info[0].As<v8::Function>();
     auto baton = new AdapterListBaton(callback);
 
-    uv_queue_work(uv_default_loop(), baton->req, GetAdapterList, reinterpret_cast<uv_after_work_cb>(AfterGetAdapterList));
+    uv_queue_work(Nan::GetCurrentEventLoop(), baton->req, GetAdapterList, reinterpret_cast<uv_after_work_cb>(AfterGetAdapterList));
 }
 
 void GetAdapterList(uv_work_t *req)
 {
-    auto adapters = std::vector<sd_rpc_serial_port_desc_t>(max_adapter_count);
-    auto adapter_count = adapters.size();
-    auto status = sd_rpc_serial_port_enum(adapters.data(), (std::uint32_t*) &adapter_count);
-    adapters.resize(adapter_count);
-
     auto baton = static_cast<AdapterListBaton*>(req->data);
-    baton->result = status;
-    baton->results = adapters;
+    baton->result = getRegistry().getPorts(baton->results);
 }
 
 void AfterGetAdapterList(uv_work_t* req)
@@ -76,17 +382,9 @@ void AfterGetAdapterList(uv_work_t* req)
         v8::Local<v8::Array> results = Nan::New<v8::Array>();
         auto i = 0;
 
-        for(auto adapterItem : baton->results)
+        for(const auto &adapterItem : baton->results)
         {
-            v8::Local<v8::Object> item = Nan::New<v8::Object>();
-            Utility::Set(item, "path", adapterItem.port);
-            Utility::Set(item, "manufacturer", adapterItem.manufacturer);
-            Utility::Set(item, "serialNumber", adapterItem.serialNumber);
-            Utility::Set(item, "pnpId", adapterItem.pnpId);
-            Utility::Set(item, "locationId", adapterItem.locationId);
-            Utility::Set(item, "vendorId", adapterItem.vendorId);
-            Utility::Set(item, "productId", adapterItem.productId);
-            Nan::Set(results, i++, item);
+            Nan::Set(results, i++, SerialPortRegistry::portToJs(adapterItem));
         }
 
         argv[0] = Nan::Undefined();
@@ -101,3 +399,86 @@ void AfterGetAdapterList(uv_work_t* req)
 
     delete baton;
 }
+
+NAN_METHOD(StartAdapterMonitor)
+{
+    v8::Local<v8::Function> callback;
+
+    try
+    {
+        callback = ConversionUtility::getCallbackFunction(info[0]);
+    }
+    catch (std::string error)
+    {
+        v8::Local<v8::String> message = ErrorMessage::getTypeErrorMessage(0, error);
+        Nan::ThrowTypeError(message);
+        return;
+    }
+
+    auto listener = std::make_unique<MonitorListener>();
+    listener->loop = Nan::GetCurrentEventLoop();
+    listener->async = new uv_async_t();
+    listener->async->data = listener.get();
+    listener->callback = std::make_shared<Nan::Callback>(callback);
+
+    if (uv_async_init(listener->loop, listener->async, deliver_port_changes) != 0)
+    {
+        delete listener->async;
+        Nan::ThrowError("Not able to create the adapter monitor handle");
+        return;
+    }
+
+    const auto async = listener->async;
+
+    if (!getRegistry().addListener(std::move(listener)))
+    {
+        uv_close(reinterpret_cast<uv_handle_t *>(async), free_async);
+        info.GetReturnValue().Set(false);
+        return;
+    }
+
+#if NODE_MAJOR_VERSION >= 10
+    // Stop notifying a worker thread that is terminated without calling stopAdapterMonitor.
+    // A hook may only be added once for each environment.
+    static thread_local bool cleanupHookAdded = false;
+
+    if (!cleanupHookAdded)
+    {
+        node::AddEnvironmentCleanupHook(v8::Isolate::GetCurrent(), [](void *loop) {
+            getRegistry().removeListener(static_cast<uv_loop_t *>(loop));
+        }, Nan::GetCurrentEventLoop());
+        cleanupHookAdded = true;
+    }
+#endif
+
+    info.GetReturnValue().Set(true);
+}
+
+NAN_METHOD(StopAdapterMonitor)
+{
+    getRegistry().removeListener(Nan::GetCurrentEventLoop());
+}
+
+#if !defined(__linux__) && !defined(__APPLE__)
+// Without hotplug notifications the registry enumerates the ports on every list request
+SerialPortMonitor::SerialPortMonitor() : interrupted(false)
+{}
+
+SerialPortMonitor::~SerialPortMonitor()
+{}
+
+bool SerialPortMonitor::start()
+{
+    return false;
+}
+
+bool SerialPortMonitor::waitForChange()
+{
+    return false;
+}
+
+void SerialPortMonitor::interrupt()
+{
+    interrupted = true;
+}
+#endif
@@ -34,12 +34,24 @@
 
 #include <sd_rpc_types.h>
 
+#include <atomic>
 #include <vector>
 
+#if defined(__APPLE__)
+#include <CoreFoundation/CoreFoundation.h>
+#include <IOKit/IOKitLib.h>
+#endif
+
 #define ERROR_STRING_SIZE 1024
 
 METHOD_DEFINITIONS(GetAdapterList);
 
+// Starts calling the callback with (attached, adapter) when a serial port is attached or
+// detached, until StopAdapterMonitor is called. Like a timer, the monitor keeps the event loop
+// alive. Returns false if the platform has no hotplug notifications.
+NAN_METHOD(StartAdapterMonitor);
+NAN_METHOD(StopAdapterMonitor);
+
 struct AdapterListBaton : Baton
 {
 public:
@@ -47,4 +59,41 @@ public:
     std::vector<sd_rpc_serial_port_desc_t> results;
 };
 
-#endif // ADAPTER_H
+// Waits for serial ports to be attached or detached, with udev on Linux and IOKit on macOS.
+// All methods except interrupt() must be called from the same thread.
+class SerialPortMonitor
+{
+public:
+    SerialPortMonitor();
+    ~SerialPortMonitor();
+
+    SerialPortMonitor(const SerialPortMonitor &) = delete;
+    SerialPortMonitor &operator=(const SerialPortMonitor &) = delete;
+
+    // Returns false if notifications are not available on this platform or system
+    bool start();
+    // Blocks until a serial port may have been attached or detached and returns true, or
+    // returns false when interrupt() is called
+    bool waitForChange();
+    // Called from any thread
+    void interrupt();
+
+private:
+    std::atomic<bool> interrupted;
+
+#if defined(__linux__)
+    struct udev *udevContext;
+    struct udev_monitor *udevMonitor;
+    int wakePipe[2];
+#elif defined(__APPLE__)
+    static void onServices(void *context, io_iterator_t iterator);
+
+    IONotificationPortRef notifyPort;
+    io_iterator_t matchedIterator;
+    io_iterator_t terminatedIterator;
+    CFRunLoopRef runLoop;
+    bool changed;
+#endif
+};
+
+#endif // SERIALADAPTER_H
@@ -38,135 +38,116 @@
 
 #include <libudev.h>
 
-#include <vector>
-#include <cstring>
-#include <cassert>
-
-#include <sys/param.h>
-
-using namespace std;
-
-typedef struct serial_device_t
+#include <cerrno>
+#include <string>
+#include <poll.h>
+#include <unistd.h>
+
+SerialPortMonitor::SerialPortMonitor() :
+    interrupted(false),
+    udevContext(nullptr),
+    udevMonitor(nullptr)
 {
-    char port[MAXPATHLEN];
-    char locationId[MAXPATHLEN];
-    char vendorId[MAXPATHLEN];
-    char productId[MAXPATHLEN];
-    char manufacturer[MAXPATHLEN];
-    char serialNumber[MAXPATHLEN];
-} serial_device_t;
-
-const char* SEGGER_VENDOR_ID = "1366";
-const char* NXP_VENDOR_ID = "0d28";
-
-typedef vector<serial_device_t*> adapter_list_t;
+    wakePipe[0] = -1;
+    wakePipe[1] = -1;
+}
 
-static adapter_list_t* GetAdapters()
+SerialPortMonitor::~SerialPortMonitor()
 {
-    // Setup return value
-    adapter_list_t* devices = new adapter_list_t();
-
-    // Setup udev related variables
-    struct udev *udev_ctx = udev_new();
-    assert(udev_ctx != NULL);
-
-    struct udev_enumerate *udev_enum = udev_enumerate_new(udev_ctx);
-    assert(udev_enum != NULL);
-
-    udev_enumerate_add_match_subsystem(udev_enum, "tty");
-    udev_enumerate_scan_devices(udev_enum);
-
-    struct udev_list_entry *udev_devices = udev_enumerate_get_list_entry(udev_enum);
-    struct udev_list_entry *udev_entry;
-    struct udev_device *udev_dev;
-
-    udev_list_entry_foreach(udev_entry, udev_devices)
+    if (udevMonitor != nullptr)
     {
-        const char *path = udev_list_entry_get_name(udev_entry);
-
-        udev_dev = udev_device_new_from_syspath(udev_ctx, path);
-        const char *devname = udev_device_get_devnode(udev_dev);
-
-        udev_dev = udev_device_get_parent_with_subsystem_devtype(
-            udev_dev,
-            "usb",
-            "usb_device"
-        );
+        udev_monitor_unref(udevMonitor);
+    }
 
-        const char *idVendor = udev_device_get_sysattr_value(udev_dev, "idVendor");
+    if (udevContext != nullptr)
+    {
+        udev_unref(udevContext);
+    }
 
-        // Only add SEGGER and ARM (even though VENDOR_ID is NXPs...) devices to list
-        if (idVendor != NULL && ((strcmp(idVendor, SEGGER_VENDOR_ID) == 0) || (strcmp(idVendor, NXP_VENDOR_ID) == 0)))
+    for (auto fd : wakePipe)
+    {
+        if (fd != -1)
         {
-            serial_device_t *serial_device = (serial_device_t*)malloc(sizeof(serial_device_t));
-            memset(serial_device, 0, sizeof(serial_device_t));
+            close(fd);
+        }
+    }
+}
 
-            strcpy(serial_device->vendorId, idVendor);
-            strcpy(serial_device->port, devname);
-            strcpy(serial_device->locationId, path);
-            strcpy(serial_device->productId, udev_device_get_sysattr_value(udev_dev, "idProduct"));
-            strcpy(serial_device->manufacturer, udev_device_get_sysattr_value(udev_dev,"manufacturer"));
-            strcpy(serial_device->serialNumber, udev_device_get_sysattr_value(udev_dev, "serial"));
+bool SerialPortMonitor::start()
+{
+    if (pipe(wakePipe) != 0)
+    {
+        return false;
+    }
 
-            devices->push_back(serial_device);
-        }
+    udevContext = udev_new();
 
-        udev_device_unref(udev_dev);
+    if (udevContext == nullptr)
+    {
+        return false;
     }
 
-    udev_enumerate_unref(udev_enum);
-    udev_unref(udev_ctx);
+    udevMonitor = udev_monitor_new_from_netlink(udevContext, "udev");
+
+    if (udevMonitor == nullptr)
+    {
+        return false;
+    }
 
-    return devices;
+    return udev_monitor_filter_add_match_subsystem_devtype(udevMonitor, "tty", nullptr) >= 0
+        && udev_monitor_enable_receiving(udevMonitor) >= 0;
 }
 
-void GetAdapterList(uv_work_t* req)
+bool SerialPortMonitor::waitForChange()
 {
-    AdapterListBaton* data = static_cast<AdapterListBaton*>(req->data);
+    struct pollfd fds[2];
+    fds[0].fd = udev_monitor_get_fd(udevMonitor);
+    fds[0].events = POLLIN;
+    fds[1].fd = wakePipe[0];
+    fds[1].events = POLLIN;
 
-    adapter_list_t* devices = GetAdapters();
-
-    for (auto device : *devices)
+    while (!interrupted)
     {
-        if ((strcmp(device->manufacturer,"SEGGER") == 0)
-            || (strcasecmp(device->manufacturer, "arm") == 0)
-            || (strcasecmp(device->manufacturer, "mbed") == 0))
+        const auto ready = poll(fds, 2, -1);
+
+        if (ready < 0 && errno != EINTR)
         {
-            AdapterListResultItem* resultItem = new AdapterListResultItem();
+            return false;
+        }
 
-            resultItem->path = device->port;
+        if (ready <= 0 || (fds[0].revents & POLLIN) == 0)
+        {
+            continue;
+        }
 
-            if (device->locationId != NULL)
-            {
-                resultItem->locationId = device->locationId;
-            }
+        // Only add and remove change the ports, the other actions are attribute changes
+        auto device = udev_monitor_receive_device(udevMonitor);
 
-            if (device->vendorId != NULL)
-            {
-                resultItem->vendorId = device->vendorId;
-            }
+        if (device == nullptr)
+        {
+            continue;
+        }
 
-            if (device->productId != NULL)
-            {
-                resultItem->productId = device->productId;
-            }
+        const auto action = udev_device_get_action(device);
+        const auto changed = action != nullptr && (std::string(action) == "add" || std::string(action) == "remove");
+        udev_device_unref(device);
 
-            if (device->manufacturer != NULL)
-            {
-                resultItem->manufacturer = device->manufacturer;
-            }
+        if (changed)
+        {
+            return true;
+        }
+    }
 
-            if (device->serialNumber != NULL)
-            {
-                resultItem->serialNumber = device->serialNumber;
-            }
+    return false;
+}
 
-            data->results.push_back(resultItem);
-        }
+void SerialPortMonitor::interrupt()
+{
+    interrupted = true;
 
-        delete device;
+    if (wakePipe[1] != -1)
+    {
+        const char wake = 0;
+        (void)write(wakePipe[1], &wake, 1);
     }
-
-    devices->clear();
-    delete devices;
 }
@@ -0,0 +1,107 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SLOT_POOL_H
+#define SLOT_POOL_H
+
+#include <cstddef>
+#include <memory>
+
+#include "spsc_queue.h"
+
+// Fixed set of preallocated elements that are handed out and given back again,
+// so that the elements can be reused without allocating memory.
+//
+// The free list is a single producer/single consumer queue. acquire() must only
+// be called from one thread and release() must only be called from one (possibly
+// other) thread.
+template<typename Element>
+class SlotPool
+{
+public:
+    SlotPool() : slotCount(0) {}
+
+    SlotPool(const SlotPool &) = delete;
+    SlotPool &operator=(const SlotPool &) = delete;
+
+    // Not thread safe. Must only be called when no slots are in use. The slots
+    // are only reallocated if the number of slots changes.
+    void reset(const size_t size)
+    {
+        if (size != slotCount)
+        {
+            slots.reset(size > 0 ? new Element[size] : nullptr);
+            slotCount = size;
+        }
+
+        freeSlots.reset(size);
+
+        for (size_t i = 0; i < slotCount; ++i)
+        {
+            freeSlots.push(&slots[i]);
+        }
+    }
+
+    // Returns nullptr if all slots are in use
+    Element *acquire()
+    {
+        Element *slot = nullptr;
+
+        if (!freeSlots.pop(slot))
+        {
+            return nullptr;
+        }
+
+        return slot;
+    }
+
+    void release(Element *slot)
+    {
+        freeSlots.push(slot);
+    }
+
+    size_t size() const
+    {
+        return slotCount;
+    }
+
+private:
+    std::unique_ptr<Element[]> slots;
+    size_t slotCount;
+    SpscQueue<Element *> freeSlots;
+};
+
+#endif // SLOT_POOL_H
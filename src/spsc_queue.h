@@ -0,0 +1,275 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Assumed size of a cache line, used to keep the producer and consumer positions apart
+const size_t SPSC_QUEUE_CACHE_LINE_SIZE = 64;
+
+// Bounded lock free queue with a capacity chosen at runtime.
+//
+// There must be exactly one producer thread calling push(), push_n(), evict(),
+// anyPending(), findPending() and findLastPending(), and exactly one consumer thread calling pop() and pop_n(). The
+// producer may remove the oldest element with evict() when the queue is full, so
+// head is advanced with compare and swap by both the consumer and the producer.
+//
+// Memory ordering:
+// - The producer writes the slots before it publishes them with a release store of
+//   tail. The consumer loads tail with acquire before it reads the slots.
+// - Whoever takes elements publishes the new head with a release compare and swap after
+//   reading the slots. The producer loads head with acquire before it reuses the slots.
+//
+// head and tail are written by different threads and are kept on separate cache
+// lines, together with the copy of the other position each side caches, so the
+// producer and the consumer do not invalidate each other's cache line on every
+// operation.
+//
+// Element must be trivially copyable, it is intended to be used with pointers.
+template<typename Element>
+class SpscQueue
+{
+public:
+    SpscQueue() : capacityValue(0), head(0), cachedTail(0), tail(0), cachedHead(0) {}
+
+    explicit SpscQueue(const size_t capacity) : SpscQueue()
+    {
+        reset(capacity);
+    }
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    // Not thread safe. Must only be called when neither the producer nor the consumer is active.
+    void reset(const size_t capacity)
+    {
+        if (capacity != capacityValue)
+        {
+            slots.reset(capacity > 0 ? new std::atomic<Element>[capacity] : nullptr);
+            capacityValue = capacity;
+        }
+
+        head.store(0);
+        tail.store(0);
+        cachedHead = 0;
+        cachedTail = 0;
+    }
+
+    // Called by the producer. Returns false if the queue is full.
+    bool push(const Element &item)
+    {
+        return push_n(&item, 1) == 1;
+    }
+
+    // Called by the producer. Pushes as many of the count items as there is room for
+    // and returns the number of items pushed.
+    size_t push_n(const Element *items, const size_t count)
+    {
+        const auto currentTail = tail.load(std::memory_order_relaxed);
+
+        // head only moves forward, so the cached value can only underestimate the free space
+        if (capacityValue - (currentTail - cachedHead) < count)
+        {
+            cachedHead = head.load(std::memory_order_acquire);
+        }
+
+        const auto pushCount = std::min(count, capacityValue - (currentTail - cachedHead));
+
+        for (size_t i = 0; i < pushCount; ++i)
+        {
+            slots[(currentTail + i) % capacityValue].store(items[i], std::memory_order_relaxed);
+        }
+
+        if (pushCount > 0)
+        {
+            tail.store(currentTail + pushCount, std::memory_order_release);
+        }
+
+        return pushCount;
+    }
+
+    // Called by the consumer. Returns false if the queue is empty.
+    bool pop(Element &item)
+    {
+        return pop_n(&item, 1) == 1;
+    }
+
+    // Called by the consumer. Pops up to maxCount items into items and returns the number of
+    // items popped.
+    size_t pop_n(Element *items, const size_t maxCount)
+    {
+        return take(items, maxCount, cachedTail);
+    }
+
+    // Called by the producer to remove the oldest element. Returns false if the queue is empty.
+    bool evict(Element &item)
+    {
+        // The producer knows tail, there is no need to cache it
+        auto producerTail = tail.load(std::memory_order_relaxed);
+        return take(&item, 1, producerTail) == 1;
+    }
+
+    // Called by the producer. Returns true if predicate returns true for any element in the queue.
+    //
+    // The consumer may pop elements while this runs, the elements are still valid to read since
+    // only the producer writes to the slots.
+    template<typename Predicate>
+    bool anyPending(Predicate predicate) const
+    {
+        Element item;
+        return findPending(predicate, item);
+    }
+
+    // Called by the producer. Sets item to the oldest element in the queue predicate returns true for,
+    // returns false if there is none. The element may be popped by the consumer by the time it is
+    // returned, see anyPending.
+    template<typename Predicate>
+    bool findPending(Predicate predicate, Element &item) const
+    {
+        const auto currentTail = tail.load(std::memory_order_relaxed);
+
+        for (auto index = head.load(std::memory_order_acquire); index != currentTail; ++index)
+        {
+            const auto element = slots[index % capacityValue].load(std::memory_order_relaxed);
+
+            if (predicate(element))
+            {
+                item = element;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Called by the producer. As findPending, but finds the newest element predicate returns true for.
+    template<typename Predicate>
+    bool findLastPending(Predicate predicate, Element &item) const
+    {
+        const auto currentHead = head.load(std::memory_order_acquire);
+
+        for (auto index = tail.load(std::memory_order_relaxed); index != currentHead; --index)
+        {
+            const auto element = slots[(index - 1) % capacityValue].load(std::memory_order_relaxed);
+
+            if (predicate(element))
+            {
+                item = element;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // snapshot with acceptance that the result may be outdated when returned
+    bool wasEmpty() const
+    {
+        return head.load() == tail.load();
+    }
+
+    // snapshot with acceptance that the result may be outdated when returned
+    size_t size() const
+    {
+        return tail.load() - head.load();
+    }
+
+    size_t capacity() const
+    {
+        return capacityValue;
+    }
+
+private:
+    size_t take(Element *items, const size_t maxCount, size_t &knownTail)
+    {
+        auto currentHead = head.load(std::memory_order_acquire);
+
+        for (;;)
+        {
+            // head may have been moved past a cached tail by evict()
+            auto available = knownTail > currentHead ? knownTail - currentHead : 0;
+
+            if (available < maxCount)
+            {
+                knownTail = tail.load(std::memory_order_acquire);
+                available = knownTail - currentHead;
+            }
+
+            const auto takeCount = std::min(maxCount, available);
+
+            if (takeCount == 0)
+            {
+                return 0;
+            }
+
+            // The slots may be refilled by the producer if another thread takes them first,
+            // in that case the compare and swap fails and we retry with the new head.
+            for (size_t i = 0; i < takeCount; ++i)
+            {
+                items[i] = slots[(currentHead + i) % capacityValue].load(std::memory_order_relaxed);
+            }
+
+            if (head.compare_exchange_weak(currentHead, currentHead + takeCount, std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+                return takeCount;
+            }
+        }
+    }
+
+    // Written by reset() only
+    size_t capacityValue;
+    std::unique_ptr<std::atomic<Element>[]> slots;
+    char padding0[SPSC_QUEUE_CACHE_LINE_SIZE];
+
+    // Monotonically increasing positions, the slot index is the position modulo capacity
+
+    // Consumer side
+    std::atomic<size_t> head; // head(output) position
+    size_t cachedTail;        // Consumer copy of tail
+    char padding1[SPSC_QUEUE_CACHE_LINE_SIZE - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+
+    // Producer side
+    std::atomic<size_t> tail; // tail(input) position
+    size_t cachedHead;        // Producer copy of head
+    char padding2[SPSC_QUEUE_CACHE_LINE_SIZE - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+};
+
+#endif // SPSC_QUEUE_H
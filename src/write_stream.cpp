@@ -0,0 +1,306 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "write_stream.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+WriteStreamCredits::WriteStreamCredits() :
+    inFlight(0),
+    limit(0),
+    transmitted(0),
+    full(false),
+    aborted(false)
+{
+    if (uv_mutex_init(&mutex) != 0 || uv_cond_init(&changed) != 0)
+    {
+        std::cerr << "Not able to create write stream credits! Terminating." << std::endl;
+        std::terminate();
+    }
+}
+
+WriteStreamCredits::~WriteStreamCredits()
+{
+    uv_cond_destroy(&changed);
+    uv_mutex_destroy(&mutex);
+}
+
+void WriteStreamCredits::add(const uint16_t count)
+{
+    uv_mutex_lock(&mutex);
+    // TX complete events count the packets of the connection, not only those of this stream
+    inFlight -= std::min<uint32_t>(inFlight, count);
+    transmitted += count;
+    full = false;
+    uv_cond_signal(&changed);
+    uv_mutex_unlock(&mutex);
+}
+
+void WriteStreamCredits::abort()
+{
+    uv_mutex_lock(&mutex);
+    aborted = true;
+    uv_cond_signal(&changed);
+    uv_mutex_unlock(&mutex);
+}
+
+void WriteStreamCredits::exhausted()
+{
+    uv_mutex_lock(&mutex);
+
+    if (inFlight > 0)
+    {
+        inFlight--;
+    }
+
+    // Packets transmitted between the refusal and now are already counted out of inFlight. If all
+    // of them are, there is no TX complete event to wait for and the packet is written again at once.
+    limit = std::max<uint32_t>(std::max<uint32_t>(limit, inFlight), 1);
+    full = inFlight > 0;
+
+    uv_mutex_unlock(&mutex);
+}
+
+bool WriteStreamCredits::take(const uint64_t timeout)
+{
+    uv_mutex_lock(&mutex);
+
+    while (limit != 0 && (full || inFlight >= limit) && !aborted)
+    {
+        if (uv_cond_timedwait(&changed, &mutex, timeout * 1000) != 0)
+        {
+            break;
+        }
+    }
+
+    const auto result = !aborted && (limit == 0 || (!full && inFlight < limit));
+
+    if (result)
+    {
+        inFlight++;
+    }
+
+    uv_mutex_unlock(&mutex);
+    return result;
+}
+
+bool WriteStreamCredits::waitForTransmitted(const uint32_t count, const uint64_t timeout)
+{
+    uv_mutex_lock(&mutex);
+
+    while (transmitted < count && !aborted)
+    {
+        if (uv_cond_timedwait(&changed, &mutex, timeout * 1000) != 0)
+        {
+            break;
+        }
+    }
+
+    const auto result = transmitted >= count && !aborted;
+
+    uv_mutex_unlock(&mutex);
+    return result;
+}
+
+uint32_t WriteStreamCredits::getTransmitted()
+{
+    uv_mutex_lock(&mutex);
+    const auto result = transmitted;
+    uv_mutex_unlock(&mutex);
+    return result;
+}
+
+bool WriteStreamCredits::isAborted()
+{
+    uv_mutex_lock(&mutex);
+    const auto result = aborted;
+    uv_mutex_unlock(&mutex);
+    return result;
+}
+
+WriteStreamProgress::WriteStreamProgress() :
+    transmitted(0),
+    lastProgress(uv_hrtime() / 1000)
+{}
+
+bool WriteStreamProgress::update(WriteStreamCredits &credits, const bool sent)
+{
+    const auto now = uv_hrtime() / 1000;
+    const auto current = credits.getTransmitted();
+
+    if (sent || current != transmitted)
+    {
+        transmitted = current;
+        lastProgress = now;
+        return true;
+    }
+
+    return now - lastProgress <= WRITE_STREAM_STALL_TIMEOUT;
+}
+
+namespace
+{
+// Response to the Calculate Checksum operation of the Secure DFU control point, which is also what
+// the target sends as packet receipt notification: opcode, request opcode, result, offset, crc32
+const uint8_t DFU_OP_RESPONSE = 0x60;
+const uint8_t DFU_OP_CALCULATE_CRC = 0x03;
+const uint8_t DFU_RESULT_SUCCESS = 0x01;
+const uint16_t DFU_RECEIPT_LENGTH = 11;
+
+uint32_t readUint32(const uint8_t *value)
+{
+    return static_cast<uint32_t>(value[0]) |
+        (static_cast<uint32_t>(value[1]) << 8) |
+        (static_cast<uint32_t>(value[2]) << 16) |
+        (static_cast<uint32_t>(value[3]) << 24);
+}
+}
+
+DfuReceipts::DfuReceipts(const uint16_t controlPointHandle, const uint32_t offset, const uint32_t crc32) :
+    controlPointHandle(controlPointHandle),
+    verifiedOffset(offset),
+    verifiedCrc32(crc32),
+    result(NRF_SUCCESS),
+    aborted(false)
+{
+    if (uv_mutex_init(&mutex) != 0 || uv_cond_init(&changed) != 0)
+    {
+        std::cerr << "Not able to create DFU receipts! Terminating." << std::endl;
+        std::terminate();
+    }
+}
+
+DfuReceipts::~DfuReceipts()
+{
+    uv_cond_destroy(&changed);
+    uv_mutex_destroy(&mutex);
+}
+
+uint16_t DfuReceipts::getControlPointHandle() const
+{
+    return controlPointHandle;
+}
+
+bool DfuReceipts::add(const uint8_t *value, const uint16_t length)
+{
+    if (length < 3 || value[0] != DFU_OP_RESPONSE || value[1] != DFU_OP_CALCULATE_CRC)
+    {
+        return false;
+    }
+
+    uv_mutex_lock(&mutex);
+
+    // Receipts that are not due are left to the control point procedures in JavaScript. Receipts
+    // that are due are consumed even after a mismatch, a late one would otherwise be taken as the
+    // response to the next CALCULATE_CRC request.
+    const auto due = !pending.empty();
+
+    if (due)
+    {
+        const auto expected = pending.front();
+        pending.pop_front();
+
+        const auto matches = length >= DFU_RECEIPT_LENGTH && value[2] == DFU_RESULT_SUCCESS &&
+                             readUint32(value + 3) == expected.first && readUint32(value + 7) == expected.second;
+
+        // The receipts after a mismatch are not checked
+        if (result == NRF_SUCCESS && matches)
+        {
+            verifiedOffset = expected.first;
+            verifiedCrc32 = expected.second;
+        }
+        else
+        {
+            result = NRF_ERROR_INVALID_DATA;
+        }
+
+        uv_cond_signal(&changed);
+    }
+
+    uv_mutex_unlock(&mutex);
+    return due;
+}
+
+void DfuReceipts::abort()
+{
+    uv_mutex_lock(&mutex);
+    aborted = true;
+    uv_cond_signal(&changed);
+    uv_mutex_unlock(&mutex);
+}
+
+void DfuReceipts::expect(const uint32_t offset, const uint32_t crc32)
+{
+    uv_mutex_lock(&mutex);
+    pending.emplace_back(offset, crc32);
+    uv_mutex_unlock(&mutex);
+}
+
+bool DfuReceipts::waitForPending(const uint32_t count, const uint64_t timeout)
+{
+    uv_mutex_lock(&mutex);
+
+    while (pending.size() > count && result == NRF_SUCCESS && !aborted)
+    {
+        if (uv_cond_timedwait(&changed, &mutex, timeout * 1000) != 0)
+        {
+            break;
+        }
+    }
+
+    const auto success = pending.size() <= count && result == NRF_SUCCESS && !aborted;
+
+    uv_mutex_unlock(&mutex);
+    return success;
+}
+
+uint32_t DfuReceipts::getResult()
+{
+    uv_mutex_lock(&mutex);
+    const auto current = result;
+    uv_mutex_unlock(&mutex);
+    return current;
+}
+
+void DfuReceipts::getVerified(uint32_t &offset, uint32_t &crc32)
+{
+    uv_mutex_lock(&mutex);
+    offset = verifiedOffset;
+    crc32 = verifiedCrc32;
+    uv_mutex_unlock(&mutex);
+}
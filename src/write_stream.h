@@ -0,0 +1,188 @@
+/* Copyright (c) 2010 - 2017, Nordic Semiconductor ASA
+ *
+ * All rights reserved.
+ *
+ * Use in source and binary forms, redistribution in binary form only, with
+ * or without modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions in binary form, except as embedded into a Nordic
+ *    Semiconductor ASA integrated circuit in a product or a software update for
+ *    such product, must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other
+ *    materials provided with the distribution.
+ *
+ * 2. Neither the name of Nordic Semiconductor ASA nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * 3. This software, with or without modification, must only be used with a Nordic
+ *    Semiconductor ASA integrated circuit.
+ *
+ * 4. Any software provided in binary form under this license must not be reverse
+ *    engineered, decompiled, modified and/or disassembled.
+ *
+ * THIS SOFTWARE IS PROVIDED BY NORDIC SEMICONDUCTOR ASA "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, NONINFRINGEMENT, AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL NORDIC SEMICONDUCTOR ASA OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+ * TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WRITE_STREAM_H
+#define WRITE_STREAM_H
+
+#include <cstdint>
+#include <deque>
+
+#include <uv.h>
+
+#include "sd_rpc.h"
+
+// Error returned by the SoftDevice when the TX queue has no room for a write command or notification
+#if NRF_SD_BLE_API_VERSION >= 5
+const uint32_t WRITE_STREAM_TX_QUEUE_FULL = NRF_ERROR_RESOURCES;
+#else
+const uint32_t WRITE_STREAM_TX_QUEUE_FULL = BLE_ERROR_NO_TX_PACKETS;
+#endif
+
+// A connection can have one active stream of each type
+enum WriteStreamType
+{
+    WRITE_STREAM_GATTC_WRITE,   // Write commands, see gattcWriteStream
+    WRITE_STREAM_GATTS_HVX      // Notifications, see gattsHVXStream
+};
+
+// Max number of packets sent in one run of a write stream in the command thread. The
+// stream is submitted again after that, so other commands are not held back by a long stream.
+const auto WRITE_STREAM_SLICE_PACKETS = 32;
+
+// Max time to wait for TX credits in one run of a write stream, in microseconds
+const uint64_t WRITE_STREAM_WAIT_TIMEOUT = 50000;
+
+// A write stream fails when no packet has been transmitted for this long, in microseconds
+const uint64_t WRITE_STREAM_STALL_TIMEOUT = 5000000;
+
+// TX credits of one connection, used by an active write stream to keep the SoftDevice TX queue
+// full without polling it. The SoftDevice does not tell the size of its TX queue, so the stream
+// counts the packets in flight, those written and not yet reported by a TX complete event. It
+// writes until a packet is refused, and from then on keeps at most as many packets in flight as
+// there were when the TX queue was found full. The credits are the limit less the packets in flight.
+//
+// add() and abort() are called from the SoftDevice driver thread, the other methods from the
+// command thread.
+class WriteStreamCredits
+{
+public:
+    WriteStreamCredits();
+    ~WriteStreamCredits();
+
+    WriteStreamCredits(const WriteStreamCredits &) = delete;
+    WriteStreamCredits &operator=(const WriteStreamCredits &) = delete;
+
+    // count packets have been transmitted
+    void add(const uint16_t count);
+
+    // The connection is gone, stops waiting
+    void abort();
+
+    // The SoftDevice refused the packet of the last credit taken, the TX queue is full. The credit
+    // is given back, and is available again when a packet in flight is transmitted.
+    void exhausted();
+
+    // Takes one credit for a packet to write, waits up to timeout microseconds for one when the TX
+    // queue is full. Returns false if no credit was available or the stream is aborted.
+    bool take(const uint64_t timeout);
+
+    // Waits up to timeout microseconds until count packets have been transmitted.
+    // Returns false if they have not or the stream is aborted.
+    bool waitForTransmitted(const uint32_t count, const uint64_t timeout);
+
+    uint32_t getTransmitted();
+    bool isAborted();
+
+private:
+    uv_mutex_t mutex;
+    uv_cond_t changed;
+
+    uint32_t inFlight;
+    // Most packets in flight, 0 until the TX queue has been found full once
+    uint32_t limit;
+    uint32_t transmitted;
+    // A packet was refused and no packet has been transmitted since
+    bool full;
+    bool aborted;
+};
+
+// Detects a stalled stream from one run of it to the next. Only used in the command thread.
+struct WriteStreamProgress
+{
+    WriteStreamProgress();
+
+    // Returns false when nothing has been sent or transmitted for WRITE_STREAM_STALL_TIMEOUT
+    bool update(WriteStreamCredits &credits, const bool sent);
+
+    uint32_t transmitted;   // Packets reported transmitted when progress was last seen
+    uint64_t lastProgress;  // Microseconds, uv_hrtime() based
+};
+
+// Max number of packet receipt notifications a DFU object write can be ahead of. Keeps the TX queue
+// full while the target is writing to flash, but bounds how much is sent before a bad receipt is seen.
+const uint32_t DFU_RECEIPT_WINDOW = 2;
+
+// Packet receipt notifications of a DFU object write, see gattcWriteDfuObject. The write records the
+// offset and CRC32 expected at each receipt as it sends the packets, and the receipts received on the
+// control point are checked against them.
+//
+// add() and abort() are called from the SoftDevice driver thread, the other methods from the
+// command thread.
+class DfuReceipts
+{
+public:
+    DfuReceipts(const uint16_t controlPointHandle, const uint32_t offset, const uint32_t crc32);
+    ~DfuReceipts();
+
+    DfuReceipts(const DfuReceipts &) = delete;
+    DfuReceipts &operator=(const DfuReceipts &) = delete;
+
+    uint16_t getControlPointHandle() const;
+
+    // A notification of length bytes has been received on the control point. Returns true if it is
+    // a receipt that is due, which must not be passed on to the control point procedures in JavaScript.
+    bool add(const uint8_t *value, const uint16_t length);
+
+    // The connection is gone, stops waiting
+    void abort();
+
+    // A receipt is due for offset and crc32
+    void expect(const uint32_t offset, const uint32_t crc32);
+
+    // Waits up to timeout microseconds until at most count receipts are due. Returns false if
+    // they are not, a receipt did not match or the write is aborted.
+    bool waitForPending(const uint32_t count, const uint64_t timeout);
+
+    // NRF_SUCCESS, or NRF_ERROR_INVALID_DATA when a receipt did not match
+    uint32_t getResult();
+
+    // Offset and CRC32 of the last matching receipt, or where the write started
+    void getVerified(uint32_t &offset, uint32_t &crc32);
+
+private:
+    const uint16_t controlPointHandle;
+
+    uv_mutex_t mutex;
+    uv_cond_t changed;
+
+    std::deque<std::pair<uint32_t, uint32_t>> pending;
+    uint32_t verifiedOffset;
+    uint32_t verifiedCrc32;
+    uint32_t result;
+    bool aborted;
+};
+
+#endif // WRITE_STREAM_H
@@ -10,17 +10,32 @@ export declare interface AdapterOpenOptions {
   parity?: string;
   flowControl?: string;
   eventInterval?: number;
-  logLevel?: string;
+  eventBatchLatency?: number;
+  eventBatchSize?: number;
+  eventBatchConnectionLimit?: number;
+  /** Fixed capacity of the event queue, 1 to 16384. It is allocated when the adapter is opened and does not grow. */
+  eventQueueSize?: number;
+  eventQueueOverflowPolicy?: 'block' | 'dropOldest' | 'dropNewest' | 'coalesceAdvReports';
+  eventTimeFormat?: 'number' | 'string';
+  valueFormat?: 'array' | 'buffer';
+  logLevel?: 'trace' | 'debug' | 'info' | 'warning' | 'error' | 'fatal';
+  logBurstLimit?: number;
+  logBurstInterval?: number;
+  logFile?: string;
+  eventCaptureFile?: string;
+  eventCaptureSegmentSize?: number;
   retransmissionInterval?: number;
   responseTimeout?: number;
   enableBLE?: boolean;
+  useProbeCache?: boolean;
 }
 
 export declare interface AdapterStatus {
   id: number;
   name: string;
   message: string;
-  timestamp: string;
+  time: string | number; // ISO 8601 string, or milliseconds since epoch with the eventTimeFormat 'number'
+  timestamp: number; // Monotonic microseconds
 }
 
 export declare interface Address {
@@ -35,6 +50,82 @@ export declare interface ScanParameters {
   timeout: number;
 }
 
+export declare interface ScanDedupOptions {
+  payloadChange?: boolean;
+  rssiDelta?: number;
+  interval?: number;
+  maxDevices?: number;
+}
+
+export declare interface ScanFilter {
+  addresses?: Array<string | { address: string; type: string }>;
+  minRssi?: number;
+  serviceUuids?: string[];
+  manufacturerIds?: number[];
+  namePrefix?: string;
+  dedup?: ScanDedupOptions;
+  batch?: boolean;
+}
+
+export declare interface AutoReplyPolicy {
+  connectionParameters?: {
+    minConnectionInterval?: number;
+    maxConnectionInterval?: number;
+    maxSlaveLatency?: number;
+    minConnectionSupervisionTimeout?: number;
+    maxConnectionSupervisionTimeout?: number;
+    reject?: boolean;
+  };
+  secParams?: any;
+  lescDhkey?: boolean;
+  attMtu?: number;
+  maxDataLength?: number;
+  phys?: { tx_phys: number; rx_phys: number };
+}
+
+export declare interface ConnectionStats {
+  connHandle: number;
+  rxPackets: number;
+  rxBytes: number;
+  txPackets: number;
+  txBytes: number;
+  txPendingPackets: number;
+  gattcTimeoutCount: number;
+  gattsTimeoutCount: number;
+  droppedEventCount: number;
+  gattcLatency: any;
+}
+
+export declare interface NotificationStreamOptions {
+  sampleSize?: number;
+  progress?: (samplesSent: number, samplesTransmitted: number) => void;
+}
+
+export declare interface DfuObjectWriteOptions {
+  chunkSize?: number;
+  prn?: number;
+  offset?: number;
+  crc32?: number;
+  progress?: (offset: number) => void;
+}
+
+export declare interface DfuObjectProgress {
+  offset: number;
+  crc32: number;
+}
+
+export declare interface AdvertisementReportBatch {
+  count: number;
+  timestamps: Float64Array;
+  dataOffsets: Uint32Array;
+  addresses: Uint8Array;
+  addressTypes: Uint8Array;
+  rssi: Int8Array;
+  types: Uint8Array;
+  scanRsp: Uint8Array;
+  data: Uint8Array;
+}
+
 export declare interface ConnectionParameters {
   minConnectionInterval?: number;
   min_conn_interval?: number; // FIXME: https://github.com/NordicSemiconductor/pc-ble-driver-js/issues/76
@@ -193,9 +284,28 @@ declare class Adapter extends EventEmitter {
 
   open(options?: AdapterOpenOptions, callback?: (err: any) => void): void;
   close(callback?: (err: any) => void): void;
+  connReset(options?: { warm?: boolean } | ((err: any) => void), callback?: (err: any) => void): void;
+  getStats(): any;
+  resetStats(): void;
+  setLogLevel(level: 'trace' | 'debug' | 'info' | 'warning' | 'error' | 'fatal'): void;
+  setEventCapture(path: string | null, options?: { segmentSize?: number }): void;
+  setEventSubscription(eventIds: number[] | null): void;
+  subscribeNotifications(id: string, listener: (characteristic: Characteristic, values: Array<number>[]) => void): void;
+  unsubscribeNotifications(id: string): void;
+  getConnectionStats(): { [deviceInstanceId: string]: ConnectionStats };
+  setConnectionStatsInterval(interval: number): void;
   enableBLE(options: any, callback?: (err: any) => void): void; // FIXME: define options
   startScan(options: ScanParameters, callback?: (err: any) => void): void;
   stopScan(callback?: (err: any) => void): void;
+  setScanFilter(filter: ScanFilter | null): void;
+  setAutoReplyPolicy(policy: AutoReplyPolicy | null): void;
+  setBondStore(options: { path?: string; encryptOnConnect?: boolean } | null): void;
+  getBonds(): any[];
+  deleteBond(address: { address: string; type: string }): boolean;
+  clearBonds(): void;
+  computeSharedSecretAsync(peerPublicKey: any, callback: (err: any, sharedSecret: any) => void): void;
+  computePublicKeyAsync(callback: (err: any, publicKey: any) => void): void;
+  setKeyPairPoolSize(size: number): void;
 
   connect(deviceAddress: string | Address, options: ConnectionOptions, callback?: (err: any) => void): void;
   cancelConnect(callback?: (err: any) => void): void;
@@ -217,8 +327,13 @@ declare class Adapter extends EventEmitter {
   getCharacteristics(serviceInstanceId: string, callback?: (err: any, services: Array<Characteristic>) => void): void;
   getDescriptor(descriptorId: string): Descriptor;
   getDescriptors(characteristicId: string, callback?: (err?: any, descriptors?: Array<Descriptor>) => void): void;
+  discoverAttributes(deviceInstanceId: string, callback?: (err: any, attributes: { services: { [serviceInstanceId: string]: Service } }) => void): void;
+  setGattCacheDirectory(directory: string | null): void;
   readCharacteristicValue(characteristicId: string, callback?: (err: any, bytesRead: Array<number>) => void): void;
   writeCharacteristicValue(characteristicId: string, value: Array<number>, ack: boolean, callback?: (error: Error) => void): void;
+  writeCharacteristicValueStream(characteristicId: string, value: Buffer | Uint8Array | Array<number>, callback?: (error: Error | undefined, bytesWritten: number) => void): void;
+  writeDfuObject(packetCharacteristicId: string, controlPointCharacteristicId: string, data: Buffer | Uint8Array | Array<number>, options?: DfuObjectWriteOptions, callback?: (error: Error | undefined, progress: DfuObjectProgress) => void): void;
+  notifyCharacteristicValueStream(characteristicId: string, deviceInstanceId: string, value: Buffer | Uint8Array | Array<number>, options?: NotificationStreamOptions, callback?: (error: Error | undefined, samplesSent: number) => void): void;
   readDescriptorValue(descriptorId: string, callback?: (err: any, value: Array<number>) => void): void;
   writeDescriptorValue(descriptorId: string, value: Array<number>, ack: boolean, callback?: (error: Error) => void): void;
 
@@ -249,11 +364,12 @@ declare class Adapter extends EventEmitter {
   on(event: 'passkeyDisplay', listener: (device: Device, matchRequest: number, passkey: string) => void): this;
   on(event: 'authKeyRequest', listener: (device: Device, keyType: string) => void): this;
   on(event: 'keyPressed', listener: (device: Device, keyPressNotificationType: string) => void): this;
-  on(event: 'lescDhkeyRequest', listener: (device: Device, pk_peer: any) => void): this; // FIXME: define pk_peer
+  on(event: 'lescDhkeyRequest', listener: (device: Device, pk_peer: any, oobd_req: boolean, autoReplied: boolean) => void): this; // FIXME: define pk_peer
   on(event: 'secInfoRequest', listener: (device: Device, event: any) => void): this; // FIXME: define event
   on(event: 'securityRequest', listener: (device: Device, event: any) => void): this; // FIXME: define event
   on(event: 'connParamUpdateRequest', listener: (device: Device, connectionParameters: ConnectionParameters) => void): this;
   on(event: 'deviceDiscovered', listener: (device: Device) => void): this;
+  on(event: 'advertisementReports', listener: (reports: AdvertisementReportBatch) => void): this;
   on(event: 'advertiseTimeout', listener: () => void): this;
   on(event: 'scanTimedOut', listener: () => void): this;
   on(event: 'connectTimedOut', listener: (address: Address) => void): this;
@@ -273,6 +389,9 @@ export declare class AdapterFactory extends EventEmitter {
   static getInstance(): AdapterFactory;
   getAdapters(callback?: (err: any, adapters: Adapter[]) => void): void;
   createAdapter(sdVersion: 'v2' | 'v5', path: string, instanceId: string): Adapter;
+  openAdapters(adapters: Adapter[], options: AdapterOpenOptions | ((adapter: Adapter) => AdapterOpenOptions),
+               callback?: (err: any, results: { adapter: Adapter, error: any }[]) => void): void;
+  setProbeCacheFile(file: string | null, callback?: (err: any) => void): void;
 }
 
 export declare class ServiceFactory {